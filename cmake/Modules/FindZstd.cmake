@@ -0,0 +1,20 @@
+include(FindPackageHandleStandardArgs)
+
+set(Zstd_ROOT_DIR "" CACHE PATH "Folder contains libzstd")
+
+find_path(Zstd_INCLUDE_DIR zstd.h
+    PATHS ${Zstd_ROOT_DIR}
+    PATH_SUFFIXES include)
+
+find_library(Zstd_LIBRARY zstd
+    PATHS ${Zstd_ROOT_DIR}
+    PATH_SUFFIXES lib lib64)
+
+find_package_handle_standard_args(Zstd DEFAULT_MSG Zstd_INCLUDE_DIR Zstd_LIBRARY)
+
+if(ZSTD_FOUND)
+  set(Zstd_INCLUDE_DIRS ${Zstd_INCLUDE_DIR})
+  set(Zstd_LIBRARIES ${Zstd_LIBRARY})
+  message(STATUS "Found libzstd (include: ${Zstd_INCLUDE_DIR}, library: ${Zstd_LIBRARY})")
+  mark_as_advanced(Zstd_ROOT_DIR Zstd_LIBRARY Zstd_INCLUDE_DIR)
+endif()
@@ -0,0 +1,349 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) [2016] [BTC.COM]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+#include "BlockSubmitter.h"
+
+#include "Utils.h"
+
+#include <event2/buffer.h>
+#include <event2/keyvalq_struct.h>
+#include <event2/thread.h>
+
+#include <strings.h>
+
+#include <glog/logging.h>
+
+///////////////////////////////// LatencyHistogram /////////////////////////////////
+const size_t LatencyHistogram::kBuckets_;
+
+LatencyHistogram::LatencyHistogram()
+  : count_(0)
+  , sumUs_(0)
+  , maxUs_(0)
+{
+  for (auto &bucket : buckets_) {
+    bucket = 0;
+  }
+}
+
+void LatencyHistogram::add(uint64_t latencyUs) {
+  size_t i = 0;
+  while (i < kBuckets_ - 1 && (latencyUs >> i) != 0) {
+    i++;
+  }
+  buckets_[i]++;
+  count_++;
+  sumUs_ += latencyUs;
+
+  uint64_t maxUs = maxUs_;
+  while (latencyUs > maxUs && !maxUs_.compare_exchange_weak(maxUs, latencyUs)) {
+  }
+}
+
+uint64_t LatencyHistogram::percentileUs(double p) const {
+  const uint64_t count = count_;
+  if (count == 0) {
+    return 0;
+  }
+
+  uint64_t rank = (uint64_t)(count * p / 100.0 + 0.5);
+  rank = std::max<uint64_t>(rank, 1);
+
+  uint64_t n = 0;
+  for (size_t i = 0; i < kBuckets_ - 1; i++) {
+    n += buckets_[i];
+    if (n >= rank) {
+      return std::min<uint64_t>(1ULL << i, maxUs_);
+    }
+  }
+  return maxUs_;
+}
+
+string LatencyHistogram::toString() const {
+  return Strings::Format("count: %" PRIu64 ", avg: %.3f ms, p50: %.3f ms, "
+                         "p99: %.3f ms, max: %.3f ms",
+                         count(), avgUs() / 1000.0, percentileUs(50) / 1000.0,
+                         percentileUs(99) / 1000.0, maxUs() / 1000.0);
+}
+
+///////////////////////////////// BlockSubmitter /////////////////////////////////
+const uint32_t BlockSubmitter::kMaxTries_;
+const uint32_t BlockSubmitter::kKeepAliveInterval_;
+
+BlockSubmitter::BlockSubmitter(const vector<NodeDefinition> &nodes,
+                               const string &keepAliveRequest, uint32_t timeoutMs)
+  : keepAliveRequest_(keepAliveRequest)
+  , timeoutMs_(timeoutMs)
+  , base_(nullptr)
+  , submitEvent_(nullptr)
+  , keepAliveTimer_(nullptr)
+{
+  for (const auto &itr : nodes) {
+    unique_ptr<Node> node(new Node);
+    node->rpcAddr_ = itr.rpcAddr_;
+    node->port_ = 80;
+    node->authorization_ = "Basic " + EncodeBase64(itr.rpcUserPwd_);
+    node->conn_ = nullptr;
+    node->pendingRequests_ = 0;
+    nodes_.push_back(std::move(node));
+  }
+}
+
+BlockSubmitter::~BlockSubmitter() {
+  stop();
+
+  for (auto &node : nodes_) {
+    if (node->conn_ != nullptr) {
+      evhttp_connection_free(node->conn_);
+    }
+  }
+  if (submitEvent_ != nullptr) {
+    event_free(submitEvent_);
+  }
+  if (keepAliveTimer_ != nullptr) {
+    event_free(keepAliveTimer_);
+  }
+  if (base_ != nullptr) {
+    event_base_free(base_);
+  }
+}
+
+bool BlockSubmitter::init() {
+  for (auto &node : nodes_) {
+    struct evhttp_uri *uri = evhttp_uri_parse(node->rpcAddr_.c_str());
+    if (uri == nullptr) {
+      LOG(ERROR) << "invalid rpc address: " << node->rpcAddr_;
+      return false;
+    }
+
+    const char *scheme = evhttp_uri_get_scheme(uri);
+    const char *host = evhttp_uri_get_host(uri);
+    const char *path = evhttp_uri_get_path(uri);
+    const int port = evhttp_uri_get_port(uri);
+
+    if (scheme == nullptr || strcasecmp(scheme, "http") != 0 || host == nullptr) {
+      LOG(ERROR) << "unsupported rpc address: " << node->rpcAddr_;
+      evhttp_uri_free(uri);
+      return false;
+    }
+
+    node->host_ = host;
+    if (port > 0) {
+      node->port_ = (uint16_t)port;
+    }
+    node->path_ = (path == nullptr || *path == '\0') ? "/" : path;
+    evhttp_uri_free(uri);
+  }
+
+  // submit() is called from other threads
+  evthread_use_pthreads();
+
+  base_ = event_base_new();
+  if (base_ == nullptr) {
+    LOG(ERROR) << "create event base failed";
+    return false;
+  }
+
+  for (auto &node : nodes_) {
+    node->conn_ = evhttp_connection_base_new(base_, nullptr, node->host_.c_str(), node->port_);
+    if (node->conn_ == nullptr) {
+      LOG(ERROR) << "create http connection failed: " << node->rpcAddr_;
+      return false;
+    }
+    evhttp_connection_set_timeout(node->conn_, (timeoutMs_ + 999) / 1000);
+  }
+
+  submitEvent_ = event_new(base_, -1, 0, BlockSubmitter::submitCallback, this);
+  keepAliveTimer_ = event_new(base_, -1, EV_PERSIST, BlockSubmitter::keepAliveCallback, this);
+  if (submitEvent_ == nullptr || keepAliveTimer_ == nullptr) {
+    LOG(ERROR) << "create events failed";
+    return false;
+  }
+
+  // the timer also keeps the event loop running when there is no request
+  struct timeval interval = {kKeepAliveInterval_, 0};
+  event_add(keepAliveTimer_, &interval);
+
+  // connect to the nodes now
+  sendKeepAliveRequests();
+
+  thread_ = thread([this]() {
+    LOG(INFO) << "block submitter running, nodes: " << nodes_.size();
+    event_base_dispatch(base_);
+    LOG(INFO) << "block submitter stopped";
+  });
+  return true;
+}
+
+void BlockSubmitter::stop() {
+  if (!thread_.joinable()) {
+    return;
+  }
+  event_base_loopbreak(base_);
+  thread_.join();
+}
+
+void BlockSubmitter::submit(shared_ptr<const string> request, Callback callback) {
+  auto submission = std::make_shared<Submission>();
+  submission->request_ = request;
+  submission->callback_ = callback;
+  submission->accepted_ = false;
+
+  {
+    ScopeLock sl(lock_);
+    newSubmissions_.push_back(submission);
+  }
+  event_active(submitEvent_, EV_READ, 0);
+}
+
+void BlockSubmitter::submitCallback(evutil_socket_t fd, short events, void *ptr) {
+  BlockSubmitter *submitter = static_cast<BlockSubmitter *>(ptr);
+
+  std::deque<shared_ptr<Submission>> submissions;
+  {
+    ScopeLock sl(submitter->lock_);
+    submissions.swap(submitter->newSubmissions_);
+  }
+
+  for (auto &submission : submissions) {
+    for (size_t i = 0; i < submitter->nodes_.size(); i++) {
+      submitter->sendRequest(i, submission, 1);
+    }
+  }
+}
+
+void BlockSubmitter::keepAliveCallback(evutil_socket_t fd, short events, void *ptr) {
+  static_cast<BlockSubmitter *>(ptr)->sendKeepAliveRequests();
+}
+
+void BlockSubmitter::sendKeepAliveRequests() {
+  if (keepAliveRequest_.empty()) {
+    return;
+  }
+  for (size_t i = 0; i < nodes_.size(); i++) {
+    if (nodes_[i]->pendingRequests_ == 0) {
+      sendRequest(i, nullptr, 1);
+    }
+  }
+}
+
+static void releaseRequestData(const void *data, size_t len, void *ptr) {
+  delete static_cast<shared_ptr<const string> *>(ptr);
+}
+
+void BlockSubmitter::sendRequest(size_t node, shared_ptr<Submission> submission, uint32_t tries) {
+  Node &n = *nodes_[node];
+
+  Request *request = new Request;
+  request->submitter_ = this;
+  request->node_ = node;
+  request->submission_ = submission;
+  request->tries_ = tries;
+  request->start_ = std::chrono::steady_clock::now();
+
+  struct evhttp_request *req = evhttp_request_new(BlockSubmitter::requestDoneCallback, request);
+
+  struct evkeyvalq *headers = evhttp_request_get_output_headers(req);
+  evhttp_add_header(headers, "Host", Strings::Format("%s:%u", n.host_.c_str(), n.port_).c_str());
+  evhttp_add_header(headers, "Content-Type", "application/json");
+  evhttp_add_header(headers, "Authorization", n.authorization_.c_str());
+
+  // the block may be megabytes, all nodes share the same request string
+  struct evbuffer *body = evhttp_request_get_output_buffer(req);
+  if (submission) {
+    auto data = new shared_ptr<const string>(submission->request_);
+    evbuffer_add_reference(body, (*data)->data(), (*data)->size(), releaseRequestData, data);
+  } else {
+    evbuffer_add(body, keepAliveRequest_.data(), keepAliveRequest_.size());
+  }
+
+  n.pendingRequests_++;
+  if (evhttp_make_request(n.conn_, req, EVHTTP_REQ_POST, n.path_.c_str()) != 0) {
+    // req has been freed by libevent
+    requestDone(request, nullptr);
+  }
+}
+
+void BlockSubmitter::requestDoneCallback(struct evhttp_request *req, void *ptr) {
+  Request *request = static_cast<Request *>(ptr);
+  request->submitter_->requestDone(request, req);
+}
+
+void BlockSubmitter::requestDone(Request *request, struct evhttp_request *req) {
+  unique_ptr<Request> autoDelete(request);
+  Node &node = *nodes_[request->node_];
+  node.pendingRequests_--;
+
+  const uint64_t latencyUs = std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - request->start_).count();
+
+  // 0 if the node is unreachable or timeout
+  const int code = req != nullptr ? evhttp_request_get_response_code(req) : 0;
+  string response;
+  if (req != nullptr) {
+    struct evbuffer *input = evhttp_request_get_input_buffer(req);
+    const size_t len = evbuffer_get_length(input);
+    if (len > 0) {
+      response.assign((const char *)evbuffer_pullup(input, -1), len);
+    }
+  }
+  // the same as httpPOST()
+  const bool success = code >= 200 && code <= 208;
+
+  if (!request->submission_) {
+    if (!success) {
+      LOG(WARNING) << "keep-alive request to " << node.rpcAddr_ << " failed, http code: " << code;
+    }
+    return;
+  }
+
+  Submission &submission = *request->submission_;
+  node.latency_.add(latencyUs);
+
+  if (success) {
+    submission.accepted_ = true;
+    LOG(INFO) << "submit block to " << node.rpcAddr_ << " success, try: " << request->tries_
+              << ", latency: " << latencyUs / 1000.0 << " ms, response: " << response;
+  } else {
+    LOG(ERROR) << "submit block to " << node.rpcAddr_ << " failed, try: " << request->tries_
+               << ", latency: " << latencyUs / 1000.0 << " ms, http code: " << code
+               << ", response: " << response;
+
+    // no need to retry if a node has accepted the block
+    if (request->tries_ < kMaxTries_ && !submission.accepted_) {
+      sendRequest(request->node_, request->submission_, request->tries_ + 1);
+      return;
+    }
+  }
+  LOG(INFO) << "submit block latency of " << node.rpcAddr_ << ", " << node.latency_.toString();
+
+  if (submission.callback_) {
+    Result result;
+    result.node_ = request->node_;
+    result.accepted_ = success;
+    result.tries_ = request->tries_;
+    result.latencyUs_ = latencyUs;
+    result.response_ = std::move(response);
+    submission.callback_(result);
+  }
+}
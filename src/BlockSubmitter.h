@@ -0,0 +1,154 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) [2016] [BTC.COM]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+#ifndef BLOCK_SUBMITTER_H_
+#define BLOCK_SUBMITTER_H_
+
+#include "Common.h"
+#include "BlockMaker.h"
+
+#include <chrono>
+#include <functional>
+
+#include <event2/event.h>
+#include <event2/http.h>
+
+///////////////////////////////// LatencyHistogram /////////////////////////////////
+// Latencies counted in buckets of powers of 2 microseconds. Thread-safe.
+class LatencyHistogram {
+public:
+  // bucket i counts latencies in [2^(i-1), 2^i) us, the last one is unbounded
+  static const size_t kBuckets_ = 32;
+
+private:
+  atomic<uint64_t> buckets_[kBuckets_];
+  atomic<uint64_t> count_;
+  atomic<uint64_t> sumUs_;
+  atomic<uint64_t> maxUs_;
+
+public:
+  LatencyHistogram();
+
+  void add(uint64_t latencyUs);
+
+  uint64_t count() const { return count_; }
+  uint64_t maxUs() const { return maxUs_; }
+  uint64_t avgUs() const { return count_ == 0 ? 0 : sumUs_ / count_; }
+  // the upper bound of the bucket holding the p-th percentile, p: (0, 100]
+  uint64_t percentileUs(double p) const;
+
+  string toString() const;
+};
+
+///////////////////////////////// BlockSubmitter /////////////////////////////////
+// Submits blocks to all blockchain nodes at once.
+//
+// It has its own event loop thread and a keep-alive HTTP connection to every
+// node, so a found block is sent to all nodes in parallel without creating
+// threads or connecting. The connections are kept warm by sending
+// keepAliveRequest to idle nodes every kKeepAliveInterval_ seconds.
+//
+// A failed submission is retried up to kMaxTries_ times, unless another node
+// has accepted the block already. The latency of every try is recorded in
+// the histogram of the node.
+//
+// Only plain http:// rpc addresses are supported.
+class BlockSubmitter {
+public:
+  struct Result {
+    size_t node_;
+    bool accepted_;
+    uint32_t tries_;
+    uint64_t latencyUs_;  // of the last try
+    string response_;
+  };
+  using Callback = std::function<void(const Result &result)>;
+
+  static const uint32_t kMaxTries_ = 3;
+  static const uint32_t kKeepAliveInterval_ = 10;
+
+private:
+  struct Node {
+    string rpcAddr_;
+    string host_;
+    uint16_t port_;
+    string path_;
+    string authorization_;
+    struct evhttp_connection *conn_;
+    uint32_t pendingRequests_;
+    LatencyHistogram latency_;
+  };
+
+  struct Submission {
+    shared_ptr<const string> request_;
+    Callback callback_;
+    bool accepted_;  // by any node
+  };
+
+  struct Request {
+    BlockSubmitter *submitter_;
+    size_t node_;
+    shared_ptr<Submission> submission_;  // nullptr if it's a keep-alive request
+    uint32_t tries_;
+    std::chrono::steady_clock::time_point start_;
+  };
+
+  const string keepAliveRequest_;
+  const uint32_t timeoutMs_;
+  vector<unique_ptr<Node>> nodes_;
+
+  struct event_base *base_;
+  struct event *submitEvent_;
+  struct event *keepAliveTimer_;
+  thread thread_;
+
+  mutex lock_;
+  std::deque<shared_ptr<Submission>> newSubmissions_;
+
+  void sendRequest(size_t node, shared_ptr<Submission> submission, uint32_t tries);
+  void requestDone(Request *request, struct evhttp_request *req);
+  void sendKeepAliveRequests();
+
+  static void submitCallback(evutil_socket_t fd, short events, void *ptr);
+  static void keepAliveCallback(evutil_socket_t fd, short events, void *ptr);
+  static void requestDoneCallback(struct evhttp_request *req, void *ptr);
+
+public:
+  BlockSubmitter(const vector<NodeDefinition> &nodes,
+                 const string &keepAliveRequest, uint32_t timeoutMs = 5000);
+  ~BlockSubmitter();
+
+  // return false if any rpc address is not supported
+  bool init();
+  void stop();
+
+  // Send the json-rpc request to all nodes, doesn't wait for the responses.
+  // callback is called once for every node in the event loop thread.
+  // Thread-safe.
+  void submit(shared_ptr<const string> request, Callback callback = nullptr);
+
+  size_t getNodesCount() const { return nodes_.size(); }
+  const LatencyHistogram &getLatency(size_t node) const { return nodes_[node]->latency_; }
+};
+
+#endif // BLOCK_SUBMITTER_H_
@@ -16,7 +16,7 @@ Server* createStratumServer(const std::string &type, const int32_t shareAvgSecon
 #endif
     return new ServerBitcoin(shareAvgSeconds, config);
   else if ("ETH" == type)
-    return new ServerEth(shareAvgSeconds);
+    return new ServerEth(shareAvgSeconds, config);
   else if ("SIA" == type)
     return new ServerSia(shareAvgSeconds);
   else if ("BTM" == type) 
@@ -204,6 +204,26 @@ rd_kafka_message_t *KafkaConsumer::consumer(int timeout_ms) {
   return rd_kafka_consume(topic_, partition_, timeout_ms);
 }
 
+ssize_t KafkaConsumer::consumeBatch(int timeout_ms, size_t maxMessages,
+                                    std::function<void(rd_kafka_message_t *)> callback) {
+  if (batchMessages_.size() < maxMessages) {
+    batchMessages_.resize(maxMessages);
+  }
+
+  const ssize_t count = rd_kafka_consume_batch(topic_, partition_, timeout_ms,
+                                               batchMessages_.data(), maxMessages);
+  if (count < 0) {
+    LOG(ERROR) << "kafka consume batch failure: " << rd_kafka_err2str(rd_kafka_last_error());
+    return -1;
+  }
+
+  for (ssize_t i = 0; i < count; i++) {
+    callback(batchMessages_[i]);
+    rd_kafka_message_destroy(batchMessages_[i]);  /* Return message to rdkafka */
+  }
+  return count;
+}
+
 
 
 //////////////////////////// KafkaHighLevelConsumer ////////////////////////////
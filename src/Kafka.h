@@ -76,6 +76,8 @@ class KafkaConsumer {
   rd_kafka_t       *consumer_;
   rd_kafka_topic_t *topic_;
 
+  vector<rd_kafka_message_t *> batchMessages_;  // for consumeBatch()
+
 public:
   KafkaConsumer(const char *brokers, const char *topic, int partition);
   ~KafkaConsumer();
@@ -94,6 +96,14 @@ public:
   // don't forget to call rd_kafka_message_destroy() after consumer()
   //
   rd_kafka_message_t *consumer(int timeout_ms);
+  //
+  // consume up to `maxMessages` messages in one call, waiting at most
+  // `timeout_ms`. `callback` gets every message (including the error ones,
+  // like consumer() returns), which is destroyed after the callback returns.
+  // return the number of messages, -1 if failed.
+  //
+  ssize_t consumeBatch(int timeout_ms, size_t maxMessages,
+                       std::function<void(rd_kafka_message_t *)> callback);
 };
 
 
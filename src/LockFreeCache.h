@@ -0,0 +1,108 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) [2016] [BTC.COM]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+#ifndef POOL_LOCK_FREE_CACHE_H_
+#define POOL_LOCK_FREE_CACHE_H_
+
+#include "Common.h"
+
+#include <string.h>
+#include <type_traits>
+
+//////////////////////////////// LockFreeCache ////////////////////////////////
+// A fixed-size, direct-mapped cache of small values keyed by uint64_t, safe to
+// share between threads without locks. Meant for results of pure functions
+// with a handful of hot inputs.
+//
+// Every slot is guarded by a sequence number, odd while a writer is writing.
+// A reader that sees the slot being written or changed just misses, and a
+// writer that finds another writer in the slot gives up. Keys hashed to the
+// same slot evict each other.
+template <typename Value, size_t kSlots>
+class LockFreeCache {
+  static_assert((kSlots & (kSlots - 1)) == 0, "kSlots should be a power of 2");
+  static_assert(sizeof(Value) % sizeof(uint64_t) == 0, "Value should be in 64-bit words");
+  static_assert(std::is_trivially_copyable<Value>::value, "Value is copied as raw words");
+  static const size_t kWords = sizeof(Value) / sizeof(uint64_t);
+
+  struct Slot {
+    atomic<uint64_t> seq_;  // 0: empty, odd: being written
+    atomic<uint64_t> key_;
+    atomic<uint64_t> words_[kWords];
+  };
+  Slot slots_[kSlots];
+
+  static size_t index(uint64_t key) {
+    return (size_t)((key * 0x9e3779b97f4a7c15ull) >> 32) & (kSlots - 1);
+  }
+
+public:
+  LockFreeCache() {
+    for (auto &slot : slots_) {
+      slot.seq_ = 0;
+      slot.key_ = 0;
+      for (auto &word : slot.words_) {
+        word = 0;
+      }
+    }
+  }
+
+  bool get(uint64_t key, Value &value) const {
+    const Slot &slot = slots_[index(key)];
+    const uint64_t seq = slot.seq_.load(std::memory_order_acquire);
+    if (seq == 0 || (seq & 1) || slot.key_.load(std::memory_order_relaxed) != key) {
+      return false;
+    }
+
+    uint64_t words[kWords];
+    for (size_t i = 0; i < kWords; i++) {
+      words[i] = slot.words_[i].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.seq_.load(std::memory_order_relaxed) != seq) {
+      return false;
+    }
+
+    memcpy((void *)&value, words, sizeof(Value));
+    return true;
+  }
+
+  void put(uint64_t key, const Value &value) {
+    Slot &slot = slots_[index(key)];
+    uint64_t seq = slot.seq_.load(std::memory_order_relaxed);
+    if ((seq & 1) || !slot.seq_.compare_exchange_strong(seq, seq + 1, std::memory_order_relaxed)) {
+      return;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+
+    uint64_t words[kWords];
+    memcpy(words, (const void *)&value, sizeof(Value));
+    slot.key_.store(key, std::memory_order_relaxed);
+    for (size_t i = 0; i < kWords; i++) {
+      slot.words_[i].store(words[i], std::memory_order_relaxed);
+    }
+    slot.seq_.store(seq + 2, std::memory_order_release);
+  }
+};
+
+#endif // POOL_LOCK_FREE_CACHE_H_
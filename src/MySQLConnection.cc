@@ -18,6 +18,9 @@
 #include "MySQLConnection.h"
 #include "Utils.h"
 
+#include <string.h>
+#include <algorithm>
+
 #include <mysql.h>
 #include <glog/logging.h>
 
@@ -57,6 +60,33 @@ char ** MySQLResult::nextRow() {
   return mysql_fetch_row(result);
 }
 
+//
+// LOCAL INFILE is enabled for loadData(), but a server must not be able to
+// read the client's files with it, so every other LOAD DATA LOCAL request
+// is refused by these callbacks.
+//
+static int refuseLocalInfileInit(void **ptr, const char *filename, void *userdata) {
+  *ptr = nullptr;
+  return 1;
+}
+
+static int refuseLocalInfileRead(void *ptr, char *buf, unsigned int len) {
+  return -1;
+}
+
+static void refuseLocalInfileEnd(void *ptr) {
+}
+
+static int refuseLocalInfileError(void *ptr, char *errorMsg, unsigned int errorMsgLen) {
+  snprintf(errorMsg, errorMsgLen, "LOAD DATA LOCAL INFILE is only allowed by loadData()");
+  return 2000;  // CR_UNKNOWN_ERROR
+}
+
+static void setRefusingLocalInfileHandler(MYSQL *conn) {
+  mysql_set_local_infile_handler(conn, refuseLocalInfileInit, refuseLocalInfileRead,
+                                 refuseLocalInfileEnd, refuseLocalInfileError, nullptr);
+}
+
 MySQLConnection::MySQLConnection(const MysqlConnectInfo &connectInfo):
 host_(connectInfo.host_.c_str()),
 port_(connectInfo.port_), username_(connectInfo.username_.c_str()),
@@ -76,6 +106,12 @@ bool MySQLConnection::open() {
   if (!conn) {
     LOG(ERROR) << "create MYSQL failed";
   }
+  {
+    // for loadData(), which is the only one reading "files"
+    unsigned int enable = 1;
+    mysql_options(conn, MYSQL_OPT_LOCAL_INFILE, &enable);
+    setRefusingLocalInfileHandler(conn);
+  }
   if (mysql_real_connect(conn, host_.c_str(), username_.c_str(), password_.c_str(),
                          dbName_.c_str(), port_, nullptr, 0) == nullptr) {
     LOG(ERROR) << "mysql_real_connect failed: " << mysql_error(conn);
@@ -221,6 +257,131 @@ string MySQLConnection::getVariable(const char *name) {
   return string(row[1]);
 }
 
+//
+// The rows given to loadData() are read by the client library through these
+// callbacks when the server asks for the "file".
+//
+struct LoadDataStream {
+  const vector<string> *rows_;
+  size_t row_;
+  size_t offset_;  // offset in rows_[row_], == size() for the '\n'
+};
+
+static int loadDataInit(void **ptr, const char *filename, void *userdata) {
+  LoadDataStream *stream = (LoadDataStream *)userdata;
+  // the query may be sent again after reconnecting
+  stream->row_    = 0;
+  stream->offset_ = 0;
+  *ptr = stream;
+  return 0;
+}
+
+static int loadDataRead(void *ptr, char *buf, unsigned int len) {
+  LoadDataStream *stream = (LoadDataStream *)ptr;
+  const vector<string> &rows = *stream->rows_;
+  unsigned int size = 0;
+
+  while (size < len && stream->row_ < rows.size()) {
+    const string &row = rows[stream->row_];
+    if (stream->offset_ < row.size()) {
+      const size_t n = std::min((size_t)(len - size), row.size() - stream->offset_);
+      memcpy(buf + size, row.data() + stream->offset_, n);
+      stream->offset_ += n;
+      size += n;
+      continue;
+    }
+    buf[size++] = '\n';
+    stream->row_++;
+    stream->offset_ = 0;
+  }
+  return size;  // 0 for EOF
+}
+
+static void loadDataEnd(void *ptr) {
+}
+
+static int loadDataError(void *ptr, char *errorMsg, unsigned int errorMsgLen) {
+  snprintf(errorMsg, errorMsgLen, "loadData: read rows failed");
+  return 2000;  // CR_UNKNOWN_ERROR
+}
+
+int64_t MySQLConnection::loadData(const string &table, const string &fields,
+                                  const vector<string> &rows) {
+  const string sql = Strings::Format("LOAD DATA LOCAL INFILE 'rows' INTO TABLE `%s` (%s)",
+                                     table.c_str(), fields.c_str());
+  LoadDataStream stream = {&rows, 0, 0};
+  uint32_t error_no;
+  int queryTimes = 0;
+
+query:
+  if (!conn) { open(); }
+  if (!conn) {
+    return -1;
+  }
+  queryTimes++;
+
+  mysql_set_local_infile_handler(conn, loadDataInit, loadDataRead,
+                                 loadDataEnd, loadDataError, &stream);
+  const int res = mysql_query(conn, sql.c_str());
+  setRefusingLocalInfileHandler(conn);
+  if (res == 0) {
+    return mysql_affected_rows(conn);
+  }
+
+  error_no = mysql_errno(conn);
+  LOG(ERROR) << "load data failure, error_no: " << error_no
+  << ", error_info: " << mysql_error(conn) << " , sql: " << sql;
+
+  // 2006: MySQL server has gone away
+  // 2013: Lost connection to MySQL server
+  // reconnect and load the rows again, the same as execute()
+  if (queryTimes <= 3 && (error_no == 2006 || error_no == 2013)) {
+    sleep(10);  // rds switch master-slave usually take about 20 seconds
+    if (mysql_ping(conn) == 0) {
+      LOG(ERROR) << "reconnect success";
+    } else {
+      LOG(ERROR) << "reconnect failure, close conn and try open conn again";
+      close();
+    }
+    goto query;
+  }
+  return -1;
+}
+
+bool multiLoadData(MySQLConnection &db, const string &table,
+                   const string &fields, const vector<string> &rows) {
+  if (rows.size() == 0 || fields.length() == 0 || table.length() == 0) {
+    return false;
+  }
+
+  if (db.getVariable("local_infile") == "ON") {
+    return db.loadData(table, fields, rows) >= 0;
+  }
+
+  LOG(WARNING) << "local_infile is disabled by the server, insert `" << table
+               << "` with multiInsert()";
+
+  // every field becomes a quoted string, mysql converts it to the column type
+  vector<string> values;
+  values.reserve(rows.size());
+  for (const auto &row : rows) {
+    string value = "'";
+    for (char c : row) {
+      if (c == '\t') {
+        value += "','";
+      } else {
+        if (c == '\'') {
+          value += '\'';
+        }
+        value += c;
+      }
+    }
+    value += "'";
+    values.push_back(std::move(value));
+  }
+  return multiInsert(db, table, fields, values);
+}
+
 bool multiInsert(MySQLConnection &db, const string &table,
                  const string &fields, const vector<string> &values) {
   string sqlPrefix = Strings::Format("INSERT INTO `%s`(%s) VALUES ",
@@ -128,9 +128,22 @@ public:
   uint64_t getInsertId();
 
   string getVariable(const char *name);
+
+  // LOAD DATA LOCAL INFILE, the rows are streamed from memory by a
+  // local infile handler, no file is written. Each row is a line without
+  // the '\n', fields are separated by '\t' and must not contain tabs,
+  // newlines or backslashes.
+  // return -1 on failure, the number of loaded rows otherwise
+  int64_t loadData(const string &table, const string &fields,
+                   const vector<string> &rows);
 };
 
 bool multiInsert(MySQLConnection &db, const string &table,
                  const string &fields, const vector<string> &values);
 
+// Same as multiInsert() but the rows are tab separated, see loadData().
+// Falls back to multiInsert() if the server disabled `local_infile`.
+bool multiLoadData(MySQLConnection &db, const string &table,
+                   const string &fields, const vector<string> &rows);
+
 #endif
@@ -0,0 +1,142 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) [2016] [BTC.COM]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+#include "QuiescentState.h"
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+//////////////////////////////// QuiescentState ////////////////////////////////
+thread_local QuiescentState::Reader *QuiescentState::current_ = nullptr;
+
+mutex &QuiescentState::readersLock() {
+  static mutex lock;
+  return lock;
+}
+
+vector<shared_ptr<QuiescentState::Reader>> &QuiescentState::readers() {
+  static vector<shared_ptr<Reader>> readers;
+  return readers;
+}
+
+QuiescentState::Token QuiescentState::retire() {
+  // pairs with the fence of online() / quiescent(): a reader which is not
+  // seen online here will load the new snapshot pointer
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  Token token;
+  ScopeLock sl(readersLock());
+  for (const auto &reader : readers()) {
+    const uint64_t epoch = reader->epoch_.load(std::memory_order_acquire);
+    if (epoch & 1) {
+      token.emplace_back(reader, epoch);
+    }
+  }
+  return token;
+}
+
+bool QuiescentState::passed(const Token &token) {
+  for (const auto &itr : token) {
+    if (itr.first->epoch_.load(std::memory_order_acquire) == itr.second) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void QuiescentState::quiescent() {
+  Reader *reader = current_;
+  if (reader == nullptr) {
+    return;
+  }
+  const uint64_t epoch = reader->epoch_.load(std::memory_order_relaxed);
+  if (epoch & 1) {
+    // the reads of the snapshots happen before the writer sees the new epoch
+    reader->epoch_.store(epoch + 2, std::memory_order_release);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+}
+
+void QuiescentState::offline() {
+  Reader *reader = current_;
+  if (reader == nullptr) {
+    return;
+  }
+  const uint64_t epoch = reader->epoch_.load(std::memory_order_relaxed);
+  if (epoch & 1) {
+    reader->epoch_.store(epoch + 1, std::memory_order_release);
+  }
+}
+
+void QuiescentState::online() {
+  Reader *reader = current_;
+  if (reader == nullptr) {
+    return;
+  }
+  const uint64_t epoch = reader->epoch_.load(std::memory_order_relaxed);
+  if (!(epoch & 1)) {
+    reader->epoch_.store(epoch + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+}
+
+size_t QuiescentState::getReadersCount() {
+  ScopeLock sl(readersLock());
+  return readers().size();
+}
+
+shared_ptr<QuiescentState::Reader> QuiescentState::registerReader() {
+  // a writer retiring before the lock is taken here swapped the snapshot
+  // before, so the new reader only sees the new one
+  auto reader = std::make_shared<Reader>();
+  ScopeLock sl(readersLock());
+  readers().push_back(reader);
+  return reader;
+}
+
+void QuiescentState::unregisterReader(const shared_ptr<Reader> &reader) {
+  // the tokens holding it see it offline
+  const uint64_t epoch = reader->epoch_.load(std::memory_order_relaxed);
+  if (epoch & 1) {
+    reader->epoch_.store(epoch + 1, std::memory_order_release);
+  }
+
+  ScopeLock sl(readersLock());
+  auto &list = readers();
+  list.erase(std::remove(list.begin(), list.end(), reader), list.end());
+}
+
+//////////////////////////////// QuiescentReader ////////////////////////////////
+QuiescentReader::QuiescentReader() {
+  if (QuiescentState::current_ != nullptr) {
+    LOG(FATAL) << "the thread is already a quiescent state reader";
+  }
+  reader_ = QuiescentState::registerReader();
+  QuiescentState::current_ = reader_.get();
+}
+
+QuiescentReader::~QuiescentReader() {
+  QuiescentState::current_ = nullptr;
+  QuiescentState::unregisterReader(reader_);
+}
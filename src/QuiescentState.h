@@ -0,0 +1,87 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) [2016] [BTC.COM]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+#ifndef POOL_QUIESCENT_STATE_H_
+#define POOL_QUIESCENT_STATE_H_
+
+#include "Common.h"
+
+//////////////////////////////// QuiescentState ////////////////////////////////
+// Quiescent-state-based reclamation (QSBR) of the snapshots which are read
+// without locks, eg. the jobs of JobRepository and the users of UserInfo.
+//
+// Every thread reading the snapshots keeps a QuiescentReader alive, calls
+// quiescent() at points where it holds no snapshot pointer (eg. between two
+// callbacks of its event loop) and goes offline() before blocking. The
+// writer swaps in a new snapshot, takes a retire() token, and frees the old
+// snapshot once passed(token): every reader online at retire() time has been
+// quiescent or offline since then, so no one can see the old one any more.
+//
+// A thread reading the snapshots without a QuiescentReader is not waited for.
+class QuiescentState {
+  // odd: online, even: offline. Only the reader changes it.
+  struct Reader {
+    atomic<uint64_t> epoch_;
+    Reader() : epoch_(1) {}
+  };
+
+public:
+  using Token = std::vector<std::pair<shared_ptr<Reader>, uint64_t>>;
+
+  // called by the writer after the snapshot pointer has been swapped
+  static Token retire();
+  static bool passed(const Token &token);
+
+  // called by the reader, no-op in a thread without a QuiescentReader
+  static void quiescent();
+  static void offline();
+  static void online();
+
+  // for tests
+  static size_t getReadersCount();
+
+private:
+  static thread_local Reader *current_;
+
+  // function statics, so readers can be registered by other static objects
+  static mutex &readersLock();
+  static vector<shared_ptr<Reader>> &readers();
+
+  static shared_ptr<Reader> registerReader();
+  static void unregisterReader(const shared_ptr<Reader> &reader);
+
+  friend class QuiescentReader;
+};
+
+// Registers the current thread as an online reader while it's alive.
+class QuiescentReader {
+  shared_ptr<QuiescentState::Reader> reader_;
+
+public:
+  QuiescentReader();
+  ~QuiescentReader();
+  QuiescentReader(const QuiescentReader &) = delete;
+  QuiescentReader &operator=(const QuiescentReader &) = delete;
+};
+
+#endif // POOL_QUIESCENT_STATE_H_
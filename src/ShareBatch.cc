@@ -0,0 +1,83 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) [2016] [BTC.COM]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+#include "ShareBatch.h"
+
+#include <string.h>
+
+//////////////////////////////// ShareBatch ////////////////////////////////
+ShareBatch::ShareBatch() {
+  clear();
+}
+
+void ShareBatch::add(const uint8_t *share, uint32_t size) {
+  buffer_.append((const char *)&size, sizeof(uint32_t));
+  buffer_.append((const char *)share, size);
+
+  count_++;
+  memcpy(&buffer_[sizeof(uint32_t)], &count_, sizeof(uint32_t));
+}
+
+void ShareBatch::clear() {
+  const uint32_t header[2] = {kMagic_, 0};
+  buffer_.assign((const char *)header, sizeof(header));
+  count_ = 0;
+}
+
+bool ShareBatch::isBatch(const uint8_t *data, size_t len) {
+  uint32_t magic;
+  if (len < kHeaderSize_) {
+    return false;
+  }
+  memcpy(&magic, data, sizeof(uint32_t));
+  return magic == kMagic_;
+}
+
+bool ShareBatch::forEachShare(const uint8_t *data, size_t len,
+                              const std::function<void(const uint8_t *, uint32_t)> &fn) {
+  if (!isBatch(data, len)) {
+    fn(data, (uint32_t)len);
+    return true;
+  }
+
+  uint32_t count;
+  memcpy(&count, data + sizeof(uint32_t), sizeof(uint32_t));
+
+  size_t offset = kHeaderSize_;
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t size;
+    if (offset + sizeof(uint32_t) > len) {
+      return false;
+    }
+    memcpy(&size, data + offset, sizeof(uint32_t));
+    offset += sizeof(uint32_t);
+
+    if (size > len - offset) {
+      return false;
+    }
+    fn(data + offset, size);
+    offset += size;
+  }
+
+  return offset == len;
+}
@@ -0,0 +1,64 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) [2016] [BTC.COM]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+#ifndef SHARE_BATCH_H_
+#define SHARE_BATCH_H_
+
+#include "Common.h"
+
+//////////////////////////////// ShareBatch ////////////////////////////////
+//
+// Several shares packed in one Kafka message of the share topic:
+//
+//   uint32_t kMagic_, uint32_t count, count * (uint32_t size, share[size])
+//
+// where a share is the output of SerializeToArrayWithVersion(). A message
+// with a single share (version + protobuf) is still valid, share versions
+// are below 0x01000000 so they never equal kMagic_.
+//
+class ShareBatch {
+  string buffer_;
+  uint32_t count_;
+
+public:
+  static const uint32_t kMagic_ = 0x48534221u;  // "!BSH"
+  static const size_t kHeaderSize_ = sizeof(uint32_t) * 2;
+
+  ShareBatch();
+
+  void add(const uint8_t *share, uint32_t size);
+  void clear();
+
+  uint32_t count() const { return count_; }
+  const uint8_t *data() const { return (const uint8_t *)buffer_.data(); }
+  size_t size() const { return buffer_.size(); }
+
+  static bool isBatch(const uint8_t *data, size_t len);
+  // Call `fn` for each share of a Kafka message, batched or not. Returns
+  // false if a batch is truncated, `fn` has been called for the shares
+  // before the broken one.
+  static bool forEachShare(const uint8_t *data, size_t len,
+                           const std::function<void(const uint8_t *, uint32_t)> &fn);
+};
+
+#endif
@@ -27,6 +27,9 @@
 
 #include "MySQLConnection.h"
 #include "Statistics.h"
+#include "ShareBatch.h"
+#include "ShareLogZstd.h"
+#include "WorkerPool.h"
 #include "zlibstream/zstr.hpp"
 
 
@@ -53,7 +56,9 @@ class ShareLogDumperT : public ShareLogDumper {
   bool isDumpAll_;
 
   void parseShareLog(const uint8_t *buf, size_t len);
+  void parseRawShareLog(const uint8_t *buf, size_t len);
   void parseShare(const SHARE *share);
+  void dumpRawShareLog();
 
 public:
   ShareLogDumperT(const char *chainType, const string &dataDir, time_t timestamp, const std::set<int32_t> &uids);
@@ -79,9 +84,11 @@ public:
 //
 template <class SHARE>
 class ShareLogParserT : public ShareLogParser {
-  pthread_rwlock_t rwlock_;
   // key: WorkerKey, value: share stats
-  std::unordered_map<WorkerKey/* userID + workerID */, shared_ptr<ShareStatsDay<SHARE>>> workersStats_;
+  using WorkerStatsMap = std::unordered_map<WorkerKey/* userID + workerID */, shared_ptr<ShareStatsDay<SHARE>>>;
+
+  pthread_rwlock_t rwlock_;
+  WorkerStatsMap workersStats_;
 
   time_t date_;      // date_ % 86400 == 0
   string filePath_;  // sharelog data file path
@@ -97,17 +104,39 @@ class ShareLogParserT : public ShareLogParser {
   size_t incompleteShareSize_;
   uint32_t bufferlength_ ;
 
+  // for the raw format, see ShareLogZstd.h
+  unique_ptr<ShareLogZstdReader> rawReader_;
+  string rawRecords_;        // decompressed frame
+  uint32_t startTimestamp_;  // shares before it are skipped, see seekToHour()
+
+  //
+  // for processUnchangedShareLog() with more than one parse thread:
+  // the calling thread reads and decompresses chunks of whole records, the
+  // parse threads decode them and aggregate into their own WorkerStatsMap,
+  // which are merged into workersStats_ once all chunks are done.
+  //
+  const uint32_t parseThreads_;
+  static const size_t kParseChunkSize_ = 4 * 1024 * 1024;
+
   MySQLConnection  poolDB_;  // save stats data
   
-  shared_ptr<DuplicateShareChecker<SHARE>> dupShareChecker_; // Used to detect duplicate share attacks.
-
-  inline int32_t getHourIdx(uint32_t ts) {
-    // %H	Hour in 24h format (00-23)
-    return atoi(date("%H", ts).c_str());
-  }
+  // Used to detect duplicate share attacks, it's shared by the parse threads
+  shared_ptr<DuplicateShareChecker<SHARE>> dupShareChecker_;
 
   void parseShareLog(const uint8_t *buf, size_t len);
+  // returns the number of shares in the record
+  uint32_t parseRawShareLog(const uint8_t *buf, size_t len);
   void parseShare(SHARE &share);
+  bool checkShare(SHARE &share);  // false if the share should be ignored
+
+  bool openRawShareLog();
+  int64_t processRawShareFrame();  // return processed shares number
+
+  bool processUnchangedShareLogParallel();
+  bool readShareLogChunks(BoundedQueue<string> &chunks);
+  bool readRawShareLogChunks(BoundedQueue<string> &chunks);
+  void parseChunk(const string &chunk, bool isRaw, WorkerStatsMap &stats);
+  void mergeWorkerStats(WorkerStatsMap &stats);
 
   void generateDailyData(shared_ptr<ShareStatsDay<SHARE>> stats,
                          const int32_t userId, const int64_t workerId,
@@ -127,22 +156,35 @@ class ShareLogParserT : public ShareLogParser {
 public:
   ShareLogParserT(const char *chainType, const string &dataDir,
                  time_t timestamp, const MysqlConnectInfo &poolDBInfo,
-                 shared_ptr<DuplicateShareChecker<SHARE>> dupShareChecker);
+                 shared_ptr<DuplicateShareChecker<SHARE>> dupShareChecker,
+                 const uint32_t parseThreads);
   ~ShareLogParserT();
 
   bool init();
 
+  // same as atoi(date("%H", ts)) but without strftime(): share log files
+  // and date() are both in UTC, which has no DST, and POSIX timestamps
+  // have no leap seconds, so every day is 86400 seconds.
+  static inline int32_t getHourIdx(uint32_t ts) {
+    return (ts % 86400) / 3600;
+  }
+
   // flush data to DB
   bool flushToDB();
 
   // get share stats day handler
   shared_ptr<ShareStatsDay<SHARE>> getShareStatsDayHandler(const WorkerKey &key);
 
-  // read unchanged share data bin file, for example yestoday's file. it will
-  // use mmap() to get high performance. call only once will process
+  // read unchanged share data bin file, for example yestoday's file. the
+  // shares are parsed by `parseThreads` threads. call only once will process
   // the whole bin file
   bool processUnchangedShareLog();
 
+  // only process the shares from the hour (0-23) of the day. The frame index
+  // of the raw format is used to skip the earlier shares, so it should be
+  // called before processing, and fails with the other formats.
+  bool seekToHour(int32_t hour);
+
   // today's file is still growing, return processed shares number.
   int64_t processGrowingShareLog();
   bool isReachEOF();  // only for growing file
@@ -43,6 +43,11 @@ template <class SHARE>ShareLogDumperT<SHARE>::~ShareLogDumperT() {
 
 template <class SHARE>
 void ShareLogDumperT<SHARE>::dump2stdout() {
+  if (ShareLogZstdReader::isZstdFile(filePath_)) {
+    dumpRawShareLog();
+    return;
+  }
+
   try {
     // open file (auto-detecting compression format or non-compression)
     LOG(INFO) << "open file: " << filePath_;
@@ -87,6 +92,23 @@ void ShareLogDumperT<SHARE>::dump2stdout() {
   }
 }
 
+template <class SHARE>
+void ShareLogDumperT<SHARE>::dumpRawShareLog() {
+  LOG(INFO) << "open raw share log: " << filePath_;
+  ShareLogZstdReader reader(filePath_);
+  if (!reader.open()) {
+    LOG(ERROR) << "open file fail: " << filePath_;
+    return;
+  }
+
+  string records;
+  while (reader.readFrame(records)) {
+    ShareLogZstdReader::forEachRecord(records, [this](const uint8_t *buf, uint32_t len) {
+      parseRawShareLog(buf, len);
+    });
+  }
+}
+
 template <class SHARE>
 void ShareLogDumperT<SHARE>::parseShareLog(const uint8_t *buf, size_t len) {
   SHARE share;
@@ -97,6 +119,22 @@ void ShareLogDumperT<SHARE>::parseShareLog(const uint8_t *buf, size_t len) {
   parseShare(&share);
 }
 
+template <class SHARE>
+void ShareLogDumperT<SHARE>::parseRawShareLog(const uint8_t *buf, size_t len) {
+  // a record is a kafka message, it may be a batch of shares
+  bool res = ShareBatch::forEachShare(buf, len, [this](const uint8_t *data, uint32_t size) {
+    SHARE share;
+    if (!share.UnserializeWithVersion(data, size)) {
+      LOG(INFO) << "parse share from raw message failed! ";
+      return;
+    }
+    parseShare(&share);
+  });
+  if (!res) {
+    LOG(ERROR) << "truncated share batch, size: " << len;
+  }
+}
+
 template <class SHARE>
 void ShareLogDumperT<SHARE>::parseShare(const SHARE *share) {
   if (!share->isValid()) {
@@ -114,9 +152,10 @@ void ShareLogDumperT<SHARE>::parseShare(const SHARE *share) {
 template <class SHARE>
 ShareLogParserT<SHARE>::ShareLogParserT(const char *chainType, const string &dataDir,
                                time_t timestamp, const MysqlConnectInfo &poolDBInfo,
-                               shared_ptr<DuplicateShareChecker<SHARE>> dupShareChecker)
+                               shared_ptr<DuplicateShareChecker<SHARE>> dupShareChecker,
+                               const uint32_t parseThreads)
 : date_(timestamp), chainType_(chainType), f_(nullptr), buf_(nullptr)
-, incompleteShareSize_(0), poolDB_(poolDBInfo)
+, incompleteShareSize_(0), startTimestamp_(0), parseThreads_(parseThreads), poolDB_(poolDBInfo)
 , dupShareChecker_(dupShareChecker)
 {
   pthread_rwlock_init(&rwlock_, nullptr);
@@ -166,14 +205,46 @@ void ShareLogParserT<SHARE>::parseShareLog(const uint8_t *buf, size_t len) {
 }
 
 template <class SHARE>
-void ShareLogParserT<SHARE>::parseShare(SHARE &share) {
+uint32_t ShareLogParserT<SHARE>::parseRawShareLog(const uint8_t *buf, size_t len) {
+  uint32_t count = 0;
+  // a record is a kafka message, it may be a batch of shares
+  bool res = ShareBatch::forEachShare(buf, len, [this, &count](const uint8_t *data, uint32_t size) {
+    count++;
+    SHARE share;
+    if (!share.UnserializeWithVersion(data, size)) {
+      LOG(INFO) << "parse share from raw message failed! " ;
+      return;
+    }
+    if (share.timestamp() < startTimestamp_) {
+      return;
+    }
+    parseShare(share);
+  });
+  if (!res) {
+    LOG(ERROR) << "truncated share batch, size: " << len;
+  }
+  return count;
+}
+
+template <class SHARE>
+bool ShareLogParserT<SHARE>::checkShare(SHARE &share) {
   if (!share.isValid()) {
     LOG(ERROR) << "invalid share: " << share.toString();
-    return;
+    return false;
   }
-  if (dupShareChecker_ && !dupShareChecker_->addShare(share)) {
-    LOG(INFO) << "duplicate share attack: " << share.toString();
-    share.set_status(StratumStatus::DUPLICATE_SHARE);
+  if (dupShareChecker_) {
+    if (!dupShareChecker_->addShare(share)) {
+      LOG(INFO) << "duplicate share attack: " << share.toString();
+      share.set_status(StratumStatus::DUPLICATE_SHARE);
+    }
+  }
+  return true;
+}
+
+template <class SHARE>
+void ShareLogParserT<SHARE>::parseShare(SHARE &share) {
+  if (!checkShare(share)) {
+    return;
   }
 
   WorkerKey wkey(share.userid(), share.workerhashid());
@@ -195,8 +266,243 @@ void ShareLogParserT<SHARE>::parseShare(SHARE &share) {
   workersStats_[pkey]->processShare(hourIdx, share);
 }
 
+template <class SHARE>
+bool ShareLogParserT<SHARE>::openRawShareLog() {
+  if (rawReader_)
+    return true;
+
+  LOG(INFO) << "open raw share log: " << filePath_;
+  rawReader_.reset(new ShareLogZstdReader(filePath_));
+  if (!rawReader_->open()) {
+    rawReader_.reset();
+    return false;
+  }
+  return true;
+}
+
+template <class SHARE>
+int64_t ShareLogParserT<SHARE>::processRawShareFrame() {
+  if (!rawReader_->readFrame(rawRecords_)) {
+    return 0;
+  }
+
+  int64_t parsedShareNum = 0;
+  bool res = ShareLogZstdReader::forEachRecord(rawRecords_,
+    [this, &parsedShareNum](const uint8_t *buf, uint32_t len) {
+      parsedShareNum += parseRawShareLog(buf, len);
+    });
+  if (!res) {
+    LOG(ERROR) << "broken records in frame, file: " << filePath_;
+  }
+  return parsedShareNum;
+}
+
+template <class SHARE>
+bool ShareLogParserT<SHARE>::seekToHour(int32_t hour) {
+  if (!ShareLogZstdReader::isZstdFile(filePath_)) {
+    LOG(ERROR) << "only the raw share log can be seeked: " << filePath_;
+    return false;
+  }
+  if (!openRawShareLog())
+    return false;
+
+  startTimestamp_ = date_ + hour * 3600;
+  return rawReader_->seek(startTimestamp_);
+}
+
+template <class SHARE>
+void ShareLogParserT<SHARE>::parseChunk(const string &chunk, bool isRaw, WorkerStatsMap &stats) {
+  auto processShare = [this, &stats](SHARE &share) {
+    if (!checkShare(share)) {
+      return;
+    }
+
+    // no lock, the map belongs to the calling thread
+    const uint32_t hourIdx = getHourIdx(share.timestamp());
+    const WorkerKey keys[] = {WorkerKey(share.userid(), share.workerhashid()),
+                              WorkerKey(share.userid(), 0),
+                              WorkerKey(0, 0)};
+    for (const auto &key : keys) {
+      auto &keyStats = stats[key];
+      if (!keyStats) {
+        keyStats = std::make_shared<ShareStatsDay<SHARE>>();
+      }
+      keyStats->processShare(hourIdx, share);
+    }
+  };
+
+  ShareLogZstdReader::forEachRecord(chunk, [this, isRaw, &processShare](const uint8_t *buf, uint32_t len) {
+    if (!isRaw) {
+      SHARE share;
+      if (!share.ParseFromArray(buf, len)) {
+        LOG(INFO) << "parse share from base message failed! ";
+        return;
+      }
+      processShare(share);
+      return;
+    }
+
+    // a raw record is a kafka message, it may be a batch of shares
+    bool res = ShareBatch::forEachShare(buf, len, [this, &processShare](const uint8_t *data, uint32_t size) {
+      SHARE share;
+      if (!share.UnserializeWithVersion(data, size)) {
+        LOG(INFO) << "parse share from raw message failed! ";
+        return;
+      }
+      if (share.timestamp() < startTimestamp_) {
+        return;
+      }
+      processShare(share);
+    });
+    if (!res) {
+      LOG(ERROR) << "truncated share batch, size: " << len;
+    }
+  });
+}
+
+template <class SHARE>
+void ShareLogParserT<SHARE>::mergeWorkerStats(WorkerStatsMap &stats) {
+  pthread_rwlock_wrlock(&rwlock_);
+  for (auto &itr : stats) {
+    auto &keyStats = workersStats_[itr.first];
+    if (!keyStats) {
+      keyStats = std::move(itr.second);
+    } else {
+      keyStats->merge(*itr.second);
+    }
+  }
+  pthread_rwlock_unlock(&rwlock_);
+  stats.clear();
+}
+
+template <class SHARE>
+bool ShareLogParserT<SHARE>::readShareLogChunks(BoundedQueue<string> &chunks) {
+  try {
+    LOG(INFO) << "open file: " << filePath_;
+    zstr::ifstream f(filePath_, std::ios::binary);
+
+    if (!f) {
+      LOG(ERROR) << "open file fail: " << filePath_;
+      return false;
+    }
+
+    string chunk;
+    while (f.peek() != EOF) {
+      // the incomplete record of the last chunk is at the beginning
+      const size_t incompleteSize = chunk.size();
+      chunk.resize(incompleteSize + kParseChunkSize_);
+      f.read((char *)chunk.data() + incompleteSize, kParseChunkSize_);
+      chunk.resize(incompleteSize + f.gcount());
+
+      // only split the records here, they are parsed by the parse threads
+      size_t pos = 0;
+      while (pos + sizeof(uint32_t) <= chunk.size()) {
+        const uint32_t shareLength = *(const uint32_t *)(chunk.data() + pos);
+        if (pos + sizeof(uint32_t) + shareLength > chunk.size()) {
+          break;
+        }
+        pos += sizeof(uint32_t) + shareLength;
+      }
+
+      string incomplete = chunk.substr(pos);
+      chunk.resize(pos);
+      if (!chunk.empty() && !chunks.push(std::move(chunk))) {
+        return false;
+      }
+      chunk = std::move(incomplete);
+    }
+
+    if (!chunk.empty()) {
+      LOG(INFO) << "incompleteShareSize_ " << chunk.size();
+    }
+    return true;
+  } catch (...) {
+    LOG(ERROR) << "open file fail: " << filePath_;
+    return false;
+  }
+}
+
+template <class SHARE>
+bool ShareLogParserT<SHARE>::readRawShareLogChunks(BoundedQueue<string> &chunks) {
+  if (!openRawShareLog()) {
+    LOG(ERROR) << "open file fail: " << filePath_;
+    return false;
+  }
+
+  // frames are small, join them into chunks
+  string chunk;
+  while (rawReader_->readFrame(rawRecords_)) {
+    chunk.append(rawRecords_);
+    if (chunk.size() >= kParseChunkSize_) {
+      if (!chunks.push(std::move(chunk))) {
+        return false;
+      }
+      chunk.clear();
+    }
+  }
+  if (!chunk.empty() && !chunks.push(std::move(chunk))) {
+    return false;
+  }
+
+  // an incomplete frame is left if sharelogger was killed while writing
+  if (rawReader_->offset() < rawReader_->fileSize()) {
+    LOG(WARNING) << "ignore the broken data from offset " << rawReader_->offset()
+                 << ", file: " << filePath_;
+  }
+  return true;
+}
+
+template <class SHARE>
+bool ShareLogParserT<SHARE>::processUnchangedShareLogParallel() {
+  const bool isRaw = rawReader_ || ShareLogZstdReader::isZstdFile(filePath_);
+
+  // two chunks per thread keep the parse threads busy while bounding memory
+  BoundedQueue<string> chunks(parseThreads_ * 2);
+  vector<WorkerStatsMap> threadsStats(parseThreads_);
+  vector<thread> threads;
+
+  for (uint32_t i = 0; i < parseThreads_; i++) {
+    threads.push_back(thread([this, &chunks, &threadsStats, i, isRaw]() {
+      string chunk;
+      while (chunks.pop(chunk)) {
+        parseChunk(chunk, isRaw, threadsStats[i]);
+      }
+    }));
+  }
+
+  const bool res = isRaw ? readRawShareLogChunks(chunks) : readShareLogChunks(chunks);
+  chunks.close();
+
+  for (uint32_t i = 0; i < parseThreads_; i++) {
+    threads[i].join();
+    mergeWorkerStats(threadsStats[i]);
+  }
+
+  LOG(INFO) << "processed share log with " << parseThreads_ << " threads: " << filePath_;
+  return res;
+}
+
 template <class SHARE>
 bool ShareLogParserT<SHARE>::processUnchangedShareLog() {
+  if (parseThreads_ > 1) {
+    return processUnchangedShareLogParallel();
+  }
+
+  if (rawReader_ || ShareLogZstdReader::isZstdFile(filePath_)) {
+    if (!openRawShareLog()) {
+      LOG(ERROR) << "open file fail: " << filePath_;
+      return false;
+    }
+    while (processRawShareFrame() > 0) {
+    }
+    // an incomplete frame is left if sharelogger was killed while writing
+    if (rawReader_->offset() < rawReader_->fileSize()) {
+      LOG(WARNING) << "ignore the broken data from offset " << rawReader_->offset()
+                   << ", file: " << filePath_;
+    }
+    return true;
+  }
+
   try {
     // open file
     LOG(INFO) << "open file: " << filePath_;
@@ -246,6 +552,20 @@ bool ShareLogParserT<SHARE>::processUnchangedShareLog() {
 
 template <class SHARE>
 int64_t ShareLogParserT<SHARE>::processGrowingShareLog() {
+  if (f_ == nullptr && !rawReader_) {
+    // the format is unknown until the first bytes were written
+    if (!fileNonEmpty(filePath_.c_str())) {
+      return fileExists(filePath_.c_str()) ? 0 : -1;
+    }
+    if (ShareLogZstdReader::isZstdFile(filePath_) && !openRawShareLog()) {
+      return -1;
+    }
+  }
+
+  if (rawReader_) {
+    return processRawShareFrame();
+  }
+
   if(f_ == nullptr)
   {
     bool fileOpened = true;
@@ -334,6 +654,10 @@ int64_t ShareLogParserT<SHARE>::processGrowingShareLog() {
 
 template <class SHARE>
 bool ShareLogParserT<SHARE>::isReachEOF() {
+  if (rawReader_) {
+    return rawReader_->isEOF();
+  }
+
   if (f_ == nullptr || !*f_) {
     // if error we consider as EOF
     return true;
@@ -356,12 +680,12 @@ void ShareLogParserT<SHARE>::generateHoursData(shared_ptr<ShareStatsDay<SHARE>>
   string table, extraValues;
   // worker
   if (userId != 0 && workerId != 0) {
-    extraValues = Strings::Format("% " PRId64",%d,", workerId, userId);
+    extraValues = Strings::Format("%" PRId64"\t%d\t", workerId, userId);
     table = "stats_workers_hour";
   }
   // user
   else if (userId != 0 && workerId == 0) {
-    extraValues = Strings::Format("%d,", userId);
+    extraValues = Strings::Format("%d\t", userId);
     table = "stats_users_hour";
   }
   // pool
@@ -394,8 +718,8 @@ void ShareLogParserT<SHARE>::generateHoursData(shared_ptr<ShareStatsDay<SHARE>>
       const string scoreStr = score2Str(stats->score1h_[i]);
       const double earn    = stats->earn1h_[i];
 
-      valuesStr = Strings::Format("%s %d,%" PRIu64",%" PRIu64","
-                                  "  %lf,'%s',%0.0lf,'%s','%s'",
+      valuesStr = Strings::Format("%s%d\t%" PRIu64"\t%" PRIu64"\t"
+                                  "%lf\t%s\t%0.0lf\t%s\t%s",
                                   extraValues.c_str(),
                                   hour, accept, reject, rejectRate, scoreStr.c_str(),
                                   earn, nowStr.c_str(), nowStr.c_str());
@@ -455,8 +779,8 @@ void ShareLogParserT<SHARE>::flushHourOrDailyData(const vector<string> values,
   fields = Strings::Format("%s `share_accept`,`share_reject`,`reject_rate`,"
                            "`score`,`earn`,`created_at`,`updated_at`", extraFields.c_str());
 
-  if (!multiInsert(poolDB_, tmpTableName, fields, values)) {
-    LOG(ERROR) << "multi-insert table." << tmpTableName << " failure";
+  if (!multiLoadData(poolDB_, tmpTableName, fields, values)) {
+    LOG(ERROR) << "load data into table." << tmpTableName << " failure";
     return;
   }
 
@@ -493,12 +817,12 @@ void ShareLogParserT<SHARE>::generateDailyData(shared_ptr<ShareStatsDay<SHARE>>
   string table, extraValues;
   // worker
   if (userId != 0 && workerId != 0) {
-    extraValues = Strings::Format("% " PRId64",%d,", workerId, userId);
+    extraValues = Strings::Format("%" PRId64"\t%d\t", workerId, userId);
     table = "stats_workers_day";
   }
   // user
   else if (userId != 0 && workerId == 0) {
-    extraValues = Strings::Format("%d,", userId);
+    extraValues = Strings::Format("%d\t", userId);
     table = "stats_users_day";
   }
   // pool
@@ -524,8 +848,8 @@ void ShareLogParserT<SHARE>::generateDailyData(shared_ptr<ShareStatsDay<SHARE>>
     const string scoreStr = score2Str(stats->score1d_);
     const double earn    = stats->earn1d_;
 
-    valuesStr = Strings::Format("%s %d,%" PRIu64",%" PRIu64","
-                                "  %lf,'%s',%0.0lf,'%s','%s'",
+    valuesStr = Strings::Format("%s%d\t%" PRIu64"\t%" PRIu64"\t"
+                                "%lf\t%s\t%0.0lf\t%s\t%s",
                                 extraValues.c_str(),
                                 day, accept, reject, rejectRate, scoreStr.c_str(),
                                 earn, nowStr.c_str(), nowStr.c_str());
@@ -739,7 +1063,8 @@ bool ShareLogParserServerT<SHARE>::initShareLogParser(time_t datets) {
 
   // set new obj
   shared_ptr<ShareLogParserT<SHARE>> parser = std::make_shared<ShareLogParserT<SHARE>>(
-    chainType_.c_str(), dataDir_, date_, poolDBInfo_, dupShareChecker_);
+    chainType_.c_str(), dataDir_, date_, poolDBInfo_, dupShareChecker_,
+    1/* the growing file is parsed in threadShareLogParser_ */);
   
   if (!parser->init()) {
     LOG(ERROR) << "parser check failure, date: " << date("%F", date_);
@@ -0,0 +1,397 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) [2016] [BTC.COM]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+#include "ShareLogZstd.h"
+#include "Utils.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <zstd_errors.h>
+
+#include <algorithm>
+#include <cstddef>
+
+#include <glog/logging.h>
+
+static_assert(sizeof(ShareLogFrameIndex) == 32, "unexpected ShareLogFrameIndex padding");
+
+// the index frame: | uint32 skippable magic | uint32 size | ShareLogFrameIndex |
+static const uint32_t kIndexFrameMagic = 0x184D2A5BU;  // ZSTD_MAGIC_SKIPPABLE_START + 0xB
+static const size_t kIndexFrameHeaderSize = sizeof(uint32_t) * 2;
+static const size_t kIndexFrameSize = kIndexFrameHeaderSize + sizeof(ShareLogFrameIndex);
+
+static bool readIndexFrame(const uint8_t *p, ShareLogFrameIndex &frameIndex) {
+  if (*(const uint32_t *)p != kIndexFrameMagic ||
+      *(const uint32_t *)(p + sizeof(uint32_t)) != sizeof(ShareLogFrameIndex)) {
+    return false;
+  }
+  memcpy(&frameIndex, p + kIndexFrameHeaderSize, sizeof(ShareLogFrameIndex));
+  return frameIndex.checkSum_ == frameIndex.computeCheckSum();
+}
+
+//////////////////////////////  ShareLogFrameIndex  //////////////////////////////
+uint32_t ShareLogFrameIndex::computeCheckSum() const {
+  // FNV-1a
+  const uint8_t *p = (const uint8_t *)this;
+  uint32_t hash = 2166136261U;
+  for (size_t i = 0; i < offsetof(ShareLogFrameIndex, checkSum_); i++) {
+    hash = (hash ^ p[i]) * 16777619U;
+  }
+  return hash;
+}
+
+//////////////////////////////  ShareLogZstdWriter  //////////////////////////////
+ShareLogZstdWriter::ShareLogZstdWriter(const string &filePath, int compressionLevel)
+: filePath_(filePath), f_(nullptr), fileSize_(0)
+, compressionLevel_(compressionLevel), cctx_(ZSTD_createCCtx())
+, count_(0), minTimestamp_(UINT32_MAX), maxTimestamp_(0)
+{
+}
+
+ShareLogZstdWriter::~ShareLogZstdWriter() {
+  if (f_ != nullptr) {
+    flush();
+    fclose(f_);
+  }
+  ZSTD_freeCCtx(cctx_);
+}
+
+bool ShareLogZstdWriter::open() {
+  size_t validSize = 0;
+
+  if (fileNonEmpty(filePath_.c_str())) {
+    if (!ShareLogZstdReader::isZstdFile(filePath_)) {
+      LOG(ERROR) << "not a raw share log file, can't append to it: " << filePath_;
+      return false;
+    }
+
+    ShareLogZstdReader reader(filePath_);
+    vector<ShareLogFrameIndex> index;
+    if (!reader.open() || !reader.readIndex(index)) {
+      return false;
+    }
+    if (!index.empty()) {
+      validSize = index.back().offset_ + index.back().size_ + kIndexFrameSize;
+    }
+
+    struct stat st;
+    if (stat(filePath_.c_str(), &st) == 0 && (size_t)st.st_size > validSize) {
+      LOG(WARNING) << "truncate the broken tail of " << filePath_
+                   << ", size: " << st.st_size << " -> " << validSize;
+      if (truncate(filePath_.c_str(), validSize) != 0) {
+        LOG(ERROR) << "truncate file fail: " << filePath_ << ", " << strerror(errno);
+        return false;
+      }
+    }
+  }
+
+  f_ = fopen(filePath_.c_str(), "ab");
+  if (f_ == nullptr) {
+    LOG(ERROR) << "fopen file fail: " << filePath_ << ", " << strerror(errno);
+    return false;
+  }
+  fileSize_ = validSize;
+  return true;
+}
+
+void ShareLogZstdWriter::append(const uint8_t *payload, uint32_t size, uint32_t timestamp) {
+  records_.append((const char *)&size, sizeof(uint32_t));
+  records_.append((const char *)payload, size);
+
+  count_++;
+  minTimestamp_ = std::min(minTimestamp_, timestamp);
+  maxTimestamp_ = std::max(maxTimestamp_, timestamp);
+}
+
+bool ShareLogZstdWriter::flush() {
+  if (count_ == 0) {
+    return true;
+  }
+  if (f_ == nullptr) {
+    LOG(ERROR) << "file is not opened: " << filePath_;
+    return false;
+  }
+
+  frame_.resize(ZSTD_compressBound(records_.size()) + kIndexFrameSize);
+  const size_t frameSize = ZSTD_compressCCtx(cctx_, (char *)frame_.data(), frame_.size(),
+                                             records_.data(), records_.size(),
+                                             compressionLevel_);
+  if (ZSTD_isError(frameSize)) {
+    LOG(ERROR) << "zstd compress fail: " << ZSTD_getErrorName(frameSize);
+    return false;
+  }
+
+  ShareLogFrameIndex frameIndex;
+  frameIndex.offset_       = fileSize_;
+  frameIndex.size_         = frameSize;
+  frameIndex.count_        = count_;
+  frameIndex.minTimestamp_ = minTimestamp_;
+  frameIndex.maxTimestamp_ = maxTimestamp_;
+  frameIndex.reserved_     = 0;
+  frameIndex.checkSum_     = frameIndex.computeCheckSum();
+
+  uint8_t *p = (uint8_t *)frame_.data() + frameSize;
+  *(uint32_t *)p = kIndexFrameMagic;
+  *(uint32_t *)(p + sizeof(uint32_t)) = sizeof(ShareLogFrameIndex);
+  memcpy(p + kIndexFrameHeaderSize, &frameIndex, sizeof(ShareLogFrameIndex));
+
+  // the data frame and its index are written together, readers skip
+  // the incomplete one at the end of the file.
+  const size_t writeSize = frameSize + kIndexFrameSize;
+  if (fwrite(frame_.data(), 1, writeSize, f_) != writeSize || fflush(f_) != 0) {
+    LOG(ERROR) << "write file fail: " << filePath_ << ", " << strerror(errno);
+    // drop the partial frame, the records will be written by the next flush
+    clearerr(f_);
+    if (ftruncate(fileno(f_), fileSize_) != 0) {
+      LOG(ERROR) << "truncate file fail: " << filePath_ << ", " << strerror(errno);
+    }
+    return false;
+  }
+  fileSize_ += writeSize;
+
+  records_.clear();
+  count_ = 0;
+  minTimestamp_ = UINT32_MAX;
+  maxTimestamp_ = 0;
+  return true;
+}
+
+//////////////////////////////  ShareLogZstdReader  //////////////////////////////
+ShareLogZstdReader::ShareLogZstdReader(const string &filePath)
+: filePath_(filePath), fd_(-1), size_(0), offset_(0)
+, dctx_(ZSTD_createDCtx())
+{
+}
+
+ShareLogZstdReader::~ShareLogZstdReader() {
+  if (fd_ != -1) {
+    close(fd_);
+  }
+  ZSTD_freeDCtx(dctx_);
+}
+
+bool ShareLogZstdReader::open() {
+  fd_ = ::open(filePath_.c_str(), O_RDONLY);
+  if (fd_ == -1) {
+    LOG(WARNING) << "open file fail: " << filePath_ << ", " << strerror(errno);
+    return false;
+  }
+  return updateSize();
+}
+
+bool ShareLogZstdReader::updateSize() {
+  struct stat st;
+  if (fd_ == -1 || fstat(fd_, &st) != 0) {
+    return false;
+  }
+  size_ = st.st_size;
+  return true;
+}
+
+bool ShareLogZstdReader::readAt(size_t offset, size_t size, string &buf) {
+  buf.resize(size);
+  size_t done = 0;
+  while (done < size) {
+    const ssize_t n = pread(fd_, (char *)buf.data() + done, size - done, offset + done);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      LOG(ERROR) << "read file fail: " << filePath_ << ", " << strerror(errno);
+      return false;
+    }
+    if (n == 0) {
+      return false;  // truncated
+    }
+    done += n;
+  }
+  return true;
+}
+
+bool ShareLogZstdReader::parseFrame(size_t offset, ShareLogFrameIndex &frameIndex, size_t &next) {
+  // the compressed size is known only after all blocks of the frame are
+  // read, so read a little first and more if the frame is incomplete.
+  size_t readSize = kMinReadSize_;
+  size_t frameSize = 0;
+  while (true) {
+    if (offset + sizeof(uint32_t) > size_) {
+      return false;
+    }
+    readSize = std::min(readSize, size_ - offset);
+    if (!readAt(offset, readSize, frame_) ||
+        *(const uint32_t *)frame_.data() != ZSTD_MAGICNUMBER) {
+      return false;
+    }
+
+    frameSize = ZSTD_findFrameCompressedSize(frame_.data(), frame_.size());
+    if (!ZSTD_isError(frameSize)) {
+      break;
+    }
+    // broken, or the incomplete frame at the end of the file
+    if (ZSTD_getErrorCode(frameSize) != ZSTD_error_srcSize_wrong || readSize == size_ - offset) {
+      return false;
+    }
+    readSize *= 2;
+  }
+
+  const size_t indexOffset = offset + frameSize;
+  if (indexOffset + kIndexFrameSize > size_) {
+    return false;
+  }
+  if (frame_.size() < frameSize + kIndexFrameSize &&
+      !readAt(offset, frameSize + kIndexFrameSize, frame_)) {
+    return false;
+  }
+  if (!readIndexFrame((const uint8_t *)frame_.data() + frameSize, frameIndex) ||
+      frameIndex.offset_ != offset || frameIndex.size_ != frameSize) {
+    return false;
+  }
+
+  frame_.resize(frameSize);
+  next = indexOffset + kIndexFrameSize;
+  return true;
+}
+
+bool ShareLogZstdReader::readIndex(vector<ShareLogFrameIndex> &index) {
+  index.clear();
+  if (!updateSize()) {
+    return false;
+  }
+
+  // walk backward from the end of the file
+  size_t pos = size_;
+  string buf;
+  while (pos >= kIndexFrameSize) {
+    ShareLogFrameIndex frameIndex;
+    if (!readAt(pos - kIndexFrameSize, kIndexFrameSize, buf) ||
+        !readIndexFrame((const uint8_t *)buf.data(), frameIndex) ||
+        frameIndex.offset_ + frameIndex.size_ + kIndexFrameSize != pos) {
+      break;
+    }
+    index.push_back(frameIndex);
+    pos = frameIndex.offset_;
+  }
+  if (pos == 0) {
+    std::reverse(index.begin(), index.end());
+    return true;
+  }
+
+  // the tail is broken, scan from the beginning
+  LOG(WARNING) << "the end of the file is broken, scanning all frames: " << filePath_;
+  index.clear();
+  size_t offset = 0, next = 0;
+  ShareLogFrameIndex frameIndex;
+  while (parseFrame(offset, frameIndex, next)) {
+    index.push_back(frameIndex);
+    offset = next;
+  }
+  return true;
+}
+
+bool ShareLogZstdReader::seek(uint32_t timestamp) {
+  vector<ShareLogFrameIndex> index;
+  if (!readIndex(index)) {
+    return false;
+  }
+
+  // the frames are written in order, so skip the frames before the first one
+  // which could contain the timestamp.
+  offset_ = 0;
+  for (const auto &frameIndex : index) {
+    if (frameIndex.maxTimestamp_ + kTimestampSlack_ >= timestamp) {
+      break;
+    }
+    offset_ = frameIndex.offset_ + frameIndex.size_ + kIndexFrameSize;
+  }
+  return true;
+}
+
+bool ShareLogZstdReader::readFrame(string &records, ShareLogFrameIndex *frameIndex) {
+  ShareLogFrameIndex index;
+  size_t next = 0;
+  if (!parseFrame(offset_, index, next)) {
+    // check whether the file has grown
+    if (!updateSize() || !parseFrame(offset_, index, next)) {
+      return false;
+    }
+  }
+
+  const unsigned long long contentSize = ZSTD_getFrameContentSize(frame_.data(), frame_.size());
+  if (contentSize == ZSTD_CONTENTSIZE_UNKNOWN || contentSize == ZSTD_CONTENTSIZE_ERROR) {
+    LOG(ERROR) << "unknown frame content size, offset: " << offset_ << ", file: " << filePath_;
+    return false;
+  }
+
+  records.resize(contentSize);
+  const size_t size = ZSTD_decompressDCtx(dctx_, (char *)records.data(), records.size(),
+                                          frame_.data(), frame_.size());
+  if (ZSTD_isError(size) || size != contentSize) {
+    LOG(ERROR) << "zstd decompress fail, offset: " << offset_ << ", file: " << filePath_;
+    return false;
+  }
+
+  if (frameIndex != nullptr) {
+    *frameIndex = index;
+  }
+  offset_ = next;
+  return true;
+}
+
+bool ShareLogZstdReader::isEOF() {
+  ShareLogFrameIndex index;
+  size_t next = 0;
+  updateSize();
+  return !parseFrame(offset_, index, next);
+}
+
+bool ShareLogZstdReader::isZstdFile(const string &filePath) {
+  FILE *f = fopen(filePath.c_str(), "rb");
+  if (f == nullptr) {
+    return false;
+  }
+  uint32_t magic = 0;
+  const bool res = fread(&magic, sizeof(magic), 1, f) == 1 && magic == ZSTD_MAGICNUMBER;
+  fclose(f);
+  return res;
+}
+
+bool ShareLogZstdReader::forEachRecord(const string &records,
+                                       std::function<void(const uint8_t *, uint32_t)> callback) {
+  const uint8_t *p = (const uint8_t *)records.data();
+  const uint8_t *end = p + records.size();
+
+  while (p < end) {
+    if (p + sizeof(uint32_t) > end) {
+      return false;
+    }
+    const uint32_t size = *(const uint32_t *)p;
+    p += sizeof(uint32_t);
+    if (size > (size_t)(end - p)) {
+      return false;
+    }
+    callback(p, size);
+    p += size;
+  }
+  return true;
+}
@@ -0,0 +1,156 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) [2016] [BTC.COM]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+#ifndef SHARELOG_ZSTD_H_
+#define SHARELOG_ZSTD_H_
+
+#include "Common.h"
+
+#include <zstd.h>
+
+//
+// Raw share log file format.
+//
+// The Kafka payloads (version + protobuf, see SerializeToArrayWithVersion(),
+// or a ShareBatch of them) are stored without being parsed, each record is:
+//
+//   | uint32 payload length | payload |
+//
+// Records are grouped into independent zstd frames, one frame per flush, and
+// every data frame is followed by a zstd skippable frame which indexes it:
+//
+//   | data frame | index frame | data frame | index frame | ...
+//
+// So the whole file can still be decompressed by the `zstd` tool, and readers
+// can walk the index frames backward from the end of the file to seek
+// without decompressing anything.
+//
+
+//////////////////////////////  ShareLogFrameIndex  //////////////////////////////
+struct ShareLogFrameIndex {
+  uint64_t offset_;        // offset of the data frame in the file
+  uint32_t size_;          // compressed size of the data frame
+  uint32_t count_;         // number of records in the data frame
+  uint32_t minTimestamp_;
+  uint32_t maxTimestamp_;
+  uint32_t reserved_;
+  uint32_t checkSum_;      // checksum of the fields above
+
+  uint32_t computeCheckSum() const;
+};
+
+//////////////////////////////  ShareLogZstdWriter  //////////////////////////////
+class ShareLogZstdWriter {
+  string filePath_;
+  FILE *f_;
+  uint64_t fileSize_;
+  int compressionLevel_;
+  ZSTD_CCtx *cctx_;
+
+  // records of the next frame
+  string records_;
+  uint32_t count_;
+  uint32_t minTimestamp_;
+  uint32_t maxTimestamp_;
+
+  string frame_;  // compression buffer
+
+public:
+  ShareLogZstdWriter(const string &filePath, int compressionLevel);
+  ~ShareLogZstdWriter();
+
+  // open for appending, a broken frame at the end of the file (e.g. the
+  // process was killed while writing) will be truncated.
+  bool open();
+
+  void append(const uint8_t *payload, uint32_t size, uint32_t timestamp);
+  uint32_t pendingCount() const { return count_; }
+
+  // write the pending records as a new frame
+  bool flush();
+};
+
+//////////////////////////////  ShareLogZstdReader  //////////////////////////////
+//
+// The file is read by pread() rather than mmap(): sharelogger may truncate
+// the broken tail of the file while it's being read, reading a truncated
+// page of a mapping raises SIGBUS, while pread() just returns less data.
+//
+class ShareLogZstdReader {
+  string filePath_;
+  int fd_;
+  size_t size_;    // file size of the last check
+  size_t offset_;  // offset of the next data frame
+  ZSTD_DCtx *dctx_;
+  string frame_;   // the data frame read by parseFrame()
+
+  // the first read of a frame, doubled until the frame is complete
+  static const size_t kMinReadSize_ = 64 * 1024;
+
+  bool updateSize();  // check the file for new data
+  // read [offset, offset + size) of the file into `buf`,
+  // false if the file is shorter (e.g. it has been truncated)
+  bool readAt(size_t offset, size_t size, string &buf);
+  // try to read a data frame and its index frame at `offset` into frame_,
+  // the offset of the next data frame is returned by `next`.
+  bool parseFrame(size_t offset, ShareLogFrameIndex &frameIndex, size_t &next);
+
+public:
+  // the timestamps of the index are Kafka message timestamps, they could be
+  // a little different from the share timestamps.
+  static const uint32_t kTimestampSlack_ = 60;
+
+  explicit ShareLogZstdReader(const string &filePath);
+  ~ShareLogZstdReader();
+
+  bool open();
+
+  // all the complete frames of the file. The index frames are walked backward
+  // from the end of the file, the file will be scanned from its beginning if
+  // the tail is broken.
+  bool readIndex(vector<ShareLogFrameIndex> &index);
+
+  // the next readFrame() returns the first frame which may contain shares
+  // at or after `timestamp`
+  bool seek(uint32_t timestamp);
+
+  // decompress the next complete frame into `records`, return false if there
+  // is no complete frame (yet) or the frame is broken.
+  bool readFrame(string &records, ShareLogFrameIndex *frameIndex = nullptr);
+
+  // check the file for new data, then return true if there is no complete
+  // frame left. A broken frame at the end of the file is ignored.
+  bool isEOF();
+
+  size_t offset() const { return offset_; }
+  size_t fileSize() const { return size_; }
+
+  // whether the file begins with a zstd frame, false if it does not exist
+  static bool isZstdFile(const string &filePath);
+
+  // split decompressed records, return false if they are broken
+  static bool forEachRecord(const string &records,
+                            std::function<void(const uint8_t *, uint32_t)> callback);
+};
+
+#endif // SHARELOG_ZSTD_H_
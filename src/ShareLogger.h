@@ -27,6 +27,8 @@
 #include "Common.h"
 #include "Kafka.h"
 #include "Utils.h"
+#include "ShareBatch.h"
+#include "ShareLogZstd.h"
 
 #include "zlibstream/zstr.hpp"
 
@@ -58,18 +60,33 @@ class ShareLogWriterT : public ShareLogWriter {
   std::map<uint32_t, zstr::ofstream *> fileHandlers_;
   std::vector<SHARE> shares_;
 
+  // write the Kafka messages as they are, without parsing them.
+  // see ShareLogZstd.h for the file format.
+  bool rawFormat_;
+  int zstdCompressionLevel_;  // 1 to 19
+  // key:   timestamp - (timestamp % 86400)
+  // value: ShareLogZstdWriter *
+  std::map<uint32_t, ShareLogZstdWriter *> rawFileHandlers_;
+
   const string chainType_;
   KafkaHighLevelConsumer hlConsumer_;  // consume topic: shareLogTopic
 
   zstr::ofstream* getFileHandler(uint32_t ts);
+  ShareLogZstdWriter* getRawFileHandler(uint32_t ts);
   void consumeShareLog(rd_kafka_message_t *rkmessage);
+  void consumeRawShareLog(rd_kafka_message_t *rkmessage);
+  void appendRawShareLog(const uint8_t *data, size_t len, uint32_t ts);
+  bool hasPendingShares();
   bool flushToDisk();
+  bool flushRawToDisk();
   void tryCloseOldHanders();
 
 public:
   ShareLogWriterT(const char *chainType, const char *kafkaBrokers, const string &dataDir,
                   const string &kafkaGroupID, const char *shareLogTopic,
-                  const int compressionLevel = Z_DEFAULT_COMPRESSION);
+                  const int compressionLevel = Z_DEFAULT_COMPRESSION,
+                  const bool rawFormat = false,
+                  const int zstdCompressionLevel = 3);
   ~ShareLogWriterT();
 
   void stop();
@@ -31,9 +31,12 @@ ShareLogWriterT<SHARE>::ShareLogWriterT(const char *chainType,
                                         const string &dataDir,
                                         const string &kafkaGroupID,
                                         const char *shareLogTopic,
-                                        const int compressionLevel)
+                                        const int compressionLevel,
+                                        const bool rawFormat,
+                                        const int zstdCompressionLevel)
 :running_(true), dataDir_(dataDir),
-compressionLevel_(compressionLevel), chainType_(chainType),
+compressionLevel_(compressionLevel), rawFormat_(rawFormat),
+zstdCompressionLevel_(zstdCompressionLevel), chainType_(chainType),
 hlConsumer_(kafkaBrokers, shareLogTopic, 0/* patition */, kafkaGroupID)
 {
 }
@@ -46,6 +49,13 @@ ShareLogWriterT<SHARE>::~ShareLogWriterT() {
     delete itr.second;
   }
   fileHandlers_.clear();
+
+  // pending records will be flushed by the destructor
+  for (auto & itr : rawFileHandlers_) {
+    LOG(INFO) << "fclose file handler, date: " << date("%F", itr.first);
+    delete itr.second;
+  }
+  rawFileHandlers_.clear();
 }
 
 template<class SHARE>
@@ -83,6 +93,29 @@ zstr::ofstream * ShareLogWriterT<SHARE>::getFileHandler(uint32_t ts) {
   }
 }
 
+template<class SHARE>
+ShareLogZstdWriter * ShareLogWriterT<SHARE>::getRawFileHandler(uint32_t ts) {
+  auto itr = rawFileHandlers_.find(ts);
+  if (itr != rawFileHandlers_.end()) {
+    return itr->second;
+  }
+
+  const string filePath = getStatsFilePath(chainType_.c_str(), dataDir_, ts);
+  LOG(INFO) << "fopen: " << filePath;
+
+  ShareLogZstdWriter *w = new ShareLogZstdWriter(filePath, zstdCompressionLevel_);
+  if (!w->open()) {
+    delete w;
+    // the formats can't be mixed in one file, switch raw_format at the
+    // beginning of a day.
+    LOG(FATAL) << "fopen file fail: " << filePath;
+    return nullptr;
+  }
+
+  rawFileHandlers_[ts] = w;
+  return w;
+}
+
 template<class SHARE>
 void ShareLogWriterT<SHARE>::consumeShareLog(rd_kafka_message_t *rkmessage) {
   // check error
@@ -108,7 +141,10 @@ void ShareLogWriterT<SHARE>::consumeShareLog(rd_kafka_message_t *rkmessage) {
     return;
   }
 
-  SHARE share;
+  if (rawFormat_) {
+    consumeRawShareLog(rkmessage);
+    return;
+  }
 
   // if (rkmessage->len < sizeof(uint32_t)) {
   //   LOG(ERROR) << "invalid share , share size : "<< rkmessage->len ;
@@ -129,20 +165,82 @@ void ShareLogWriterT<SHARE>::consumeShareLog(rd_kafka_message_t *rkmessage) {
   //   return;
   // }
 
-  if (!share.UnserializeWithVersion((const uint8_t *)(rkmessage->payload), rkmessage->len)) {
-    LOG(ERROR) << "parse share from kafka message failed rkmessage->len = "<< rkmessage->len ;
+  // a message may be a batch of shares
+  bool res = ShareBatch::forEachShare((const uint8_t *)(rkmessage->payload), rkmessage->len,
+                                      [this](const uint8_t *data, uint32_t size) {
+    SHARE share;
+    if (!share.UnserializeWithVersion(data, size)) {
+      LOG(ERROR) << "parse share from kafka message failed, share size = " << size;
+      return;
+    }
+
+    DLOG(INFO) << share.toString();
+    // LOG(INFO) << share.toString();
+    if (!share.isValid()) {
+      LOG(ERROR) << "invalid share";
+      return;
+    }
+    shares_.push_back(share);
+  });
+  if (!res) {
+    LOG(ERROR) << "truncated share batch, rkmessage->len = " << rkmessage->len;
+  }
+}
+
+template<class SHARE>
+void ShareLogWriterT<SHARE>::consumeRawShareLog(rd_kafka_message_t *rkmessage) {
+  if (rkmessage->len < sizeof(uint32_t)) {
+    LOG(ERROR) << "invalid share, kafka message size: " << rkmessage->len;
     return;
   }
 
-  shares_.push_back(share);
+  rd_kafka_timestamp_type_t tsType;
+  const int64_t tsMs = rd_kafka_message_timestamp(rkmessage, &tsType);
+  uint32_t ts = (tsType == RD_KAFKA_TIMESTAMP_NOT_AVAILABLE || tsMs < 0) ? 0 : tsMs / 1000;
+
+  // The Kafka timestamp is a little later than the share's one. Only parse
+  // the share if it's unknown or close to midnight, so the share goes to
+  // the same day file as it would in the parsed format. The shares of a
+  // batch may belong to two days, so they're appended one by one.
+  if (ts % 86400 < ShareLogZstdReader::kTimestampSlack_) {
+    bool res = ShareBatch::forEachShare((const uint8_t *)(rkmessage->payload), rkmessage->len,
+                                        [this](const uint8_t *data, uint32_t size) {
+      SHARE share;
+      if (!share.UnserializeWithVersion(data, size)) {
+        LOG(ERROR) << "parse share from kafka message failed, share size = " << size;
+        return;
+      }
+      appendRawShareLog(data, size, share.timestamp());
+    });
+    if (!res) {
+      LOG(ERROR) << "truncated share batch, rkmessage->len = " << rkmessage->len;
+    }
+    return;
+  }
+
+  // a batch is kept as one record, the parser unpacks it
+  appendRawShareLog((const uint8_t *)(rkmessage->payload), rkmessage->len, ts);
+}
 
-  DLOG(INFO) << share.toString();
-  // LOG(INFO) << share.toString();
-  if (!share.isValid()) {
-    LOG(ERROR) << "invalid share";
-    shares_.pop_back();
+template<class SHARE>
+void ShareLogWriterT<SHARE>::appendRawShareLog(const uint8_t *data, size_t len, uint32_t ts) {
+  ShareLogZstdWriter *w = getRawFileHandler(ts - (ts % 86400));
+  if (w == nullptr)
     return;
+
+  w->append(data, len, ts);
+}
+
+template<class SHARE>
+bool ShareLogWriterT<SHARE>::hasPendingShares() {
+  if (shares_.size() > 0)
+    return true;
+
+  for (const auto & itr : rawFileHandlers_) {
+    if (itr.second->pendingCount() > 0)
+      return true;
   }
+  return false;
 }
 
 template<class SHARE>
@@ -157,10 +255,38 @@ void ShareLogWriterT<SHARE>::tryCloseOldHanders() {
 
     fileHandlers_.erase(itr);
   }
+
+  while (rawFileHandlers_.size() > 3) {
+    auto itr = rawFileHandlers_.begin();
+
+    LOG(INFO) << "fclose file handler, date: " << date("%F", itr->first);
+    delete itr->second;
+
+    rawFileHandlers_.erase(itr);
+  }
+}
+
+template<class SHARE>
+bool ShareLogWriterT<SHARE>::flushRawToDisk() {
+  bool res = true;
+
+  // one zstd frame per file and flush
+  for (auto & itr : rawFileHandlers_) {
+    if (!itr.second->flush())
+      res = false;
+  }
+
+  // should call this after write data
+  tryCloseOldHanders();
+
+  return res;
 }
 
 template<class SHARE>
 bool ShareLogWriterT<SHARE>::flushToDisk() {
+  if (rawFormat_)
+    return flushRawToDisk();
+
   if(shares_.empty())
     return true;
 
@@ -223,7 +349,7 @@ void ShareLogWriterT<SHARE>::run() {
     //
     // flush data to disk
     //
-    if (shares_.size() > 0 &&
+    if (hasPendingShares() &&
         time(nullptr) > kFlushDiskInterval + lastFlushTime) {
       flushToDisk();
       lastFlushTime = time(nullptr);
@@ -249,6 +375,6 @@ void ShareLogWriterT<SHARE>::run() {
   }
 
   // flush left shares
-  if (shares_.size() > 0)
+  if (hasPendingShares())
     flushToDisk();
 }
@@ -26,8 +26,27 @@
 
 #include "Common.h"
 
+#include <string.h>
+#include <type_traits>
 #include "glog/logging.h"
 
+//////////////////////////////// binary helpers ////////////////////////////////
+// Used by snapshots of the statistics, values are in native byte order.
+template <typename T>
+inline void writeBinary(string &buf, const T &val) {
+  buf.append((const char *)&val, sizeof(val));
+}
+
+template <typename T>
+inline bool readBinary(const uint8_t *&data, const uint8_t *end, T &val) {
+  if (end - data < (ptrdiff_t)sizeof(val)) {
+    return false;
+  }
+  memcpy(&val, data, sizeof(val));
+  data += sizeof(val);
+  return true;
+}
+
 ////////////////////////////////// StatsWindow /////////////////////////////////
 // none thread safe
 template <typename T>
@@ -38,9 +57,11 @@ class StatsWindow {
 
 public:
   StatsWindow(const int windowSize);
-  // TODO
-//  bool unserialize(const ...);
-//  void serialize(...);
+
+  // only non-zero elements are written
+  void serialize(string &buf) const;
+  // the window size must be the same as the serialized one
+  bool unserialize(const uint8_t *&data, const uint8_t *end);
 
   void clear();
 
@@ -55,6 +76,62 @@ public:
   int32_t getWindowSize() const { return windowSize_; }
 };
 
+/////////////////////////////  HierarchicalStatsWindow  //////////////////////////
+// none thread safe
+//
+// Sums of the last 1 ~ 60 minutes in O(1) time and 744 bytes of memory
+// (T = uint64_t), indexed by seconds. The last 60 seconds are kept per
+// second, so the sum of the last minute is exact. Older values are kept as
+// prefix sums of minutes for windows up to 15 minutes, and of 5 minutes for
+// the longer ones. The oldest bucket of a window is partly counted by
+// interpolation, so the sum is exact when `now` is the last second of a
+// bucket (a minute, or 5 minutes for windows longer than 15 minutes).
+//
+// T should be an unsigned integer, the prefix sums may overflow and wrap.
+template <typename T>
+class HierarchicalStatsWindow {
+  static_assert(std::is_unsigned<T>::value, "T should be an unsigned integer");
+
+  static const int32_t kSeconds_      = 60;
+  static const int32_t kMinutes_      = 15;  // windows served by the minutes
+  static const int32_t kMaxMinutes_   = 60;
+  // a window needs two more buckets for interpolation
+  static const int32_t kMinuteSlots_  = kMinutes_ + 2;
+  static const int32_t kFiveMinutesSlots_ = kMaxMinutes_ / 5 + 2;
+
+  int64_t maxSecond_;  // -1: empty
+  T secondsSum_;       // sum of (maxSecond_ - kSeconds_, maxSecond_]
+  T seconds_[kSeconds_];
+  // sum of all values in minutes <= m is minutesPrefix_[m % kMinuteSlots_]
+  T minutesPrefix_[kMinuteSlots_];
+  // sum of all values in 5 minutes <= f is fiveMinutesPrefix_[f % kFiveMinutesSlots_]
+  T fiveMinutesPrefix_[kFiveMinutesSlots_];
+
+  void advance(const int64_t second);
+  // the prefix sums of buckets of `bucketSeconds`
+  static void advancePrefix(T *prefix, const int32_t slots, const int32_t bucketSeconds,
+                            const int64_t maxSecond, const int64_t second);
+  static void addToPrefix(T *prefix, const int32_t slots, const int32_t bucketSeconds,
+                          const int64_t maxSecond, const int64_t second, const T val);
+  static T sumOfPrefix(const T *prefix, const int32_t slots, const int32_t bucketSeconds,
+                       const int64_t maxSecond, const int32_t minutes);
+
+public:
+  HierarchicalStatsWindow();
+
+  void clear();
+
+  bool insert(const int64_t second, const T val);
+
+  // sum of (now - 60, now]
+  T sumLastMinute(const int64_t now);
+  // sum of (now - minutes * 60, now], minutes: [1, 60]
+  T sum(const int64_t now, const int32_t minutes);
+
+  void serialize(string &buf) const;
+  bool unserialize(const uint8_t *&data, const uint8_t *end);
+};
+
 //////////////////////////////////  WorkerKey  /////////////////////////////////
 class WorkerKey {
 public:
@@ -131,6 +208,8 @@ public:
   ShareStatsDay &operator=(const ShareStatsDay &r) = default;
 
   void processShare(uint32_t hourIdx, const SHARE &share);
+  // add the stats of `r`, which must not be used by other threads
+  void merge(const ShareStatsDay &r);
   void getShareStatsHour(uint32_t hourIdx, ShareStats *stats);
   void getShareStatsDay(ShareStats *stats);
 };
@@ -142,15 +221,21 @@ template <class SHARE>
 class DuplicateShareChecker {
 public:
   virtual ~DuplicateShareChecker() {}
+  // must be thread safe, see ShareLogParserT::processUnchangedShareLogParallel()
   virtual bool addShare(const SHARE &share) = 0;
 };
 
 ///////////////////////////////  DuplicateShareCheckerT  ////////////////////////////////
 // Used to detect duplicate share attacks on ETH mining.
+//
+// Thread safe: the shares are sharded by GSHARE::shard(), every shard has its
+// own lock and tracks its own heights, so shares of different shards can be
+// added by different threads at the same time.
 template <class SHARE, class GSHARE>
 class DuplicateShareCheckerT : public DuplicateShareChecker<SHARE> {
 public:
   using GShareSet = std::set<GSHARE>;
+  using GShareSetMap = std::map<uint32_t /*height*/, GShareSet>;
 
   DuplicateShareCheckerT(uint32_t trackingHeightNumber)
     : trackingHeightNumber_(trackingHeightNumber)
@@ -161,7 +246,9 @@ public:
   }
 
   bool addGShare(uint32_t height, const GSHARE &gshare) {
-    GShareSet &gset = gshareSetMap_[height];
+    Shard &shard = shards_[gshare.shard() % kShards_];
+    ScopeLock sl(shard.lock_);
+    GShareSet &gset = shard.gshareSetMap_[height];
 
     auto itr = gset.find(gshare);
     if (itr != gset.end()) {
@@ -170,8 +257,8 @@ public:
 
     gset.insert(gshare);
 
-    if (gshareSetMap_.size() > trackingHeightNumber_) {
-      clearExcessGShareSet();
+    if (shard.gshareSetMap_.size() > trackingHeightNumber_) {
+      clearExcessGShareSet(shard.gshareSetMap_);
     }
 
     return true;
@@ -181,20 +268,33 @@ public:
     return addGShare(share.height(), GSHARE(share));
   }
 
+  // the most heights tracked by a shard
   size_t gshareSetMapSize() {
-    return gshareSetMap_.size();
+    size_t size = 0;
+    for (auto &shard : shards_) {
+      ScopeLock sl(shard.lock_);
+      size = std::max(size, shard.gshareSetMap_.size());
+    }
+    return size;
   }
 
 private:
-  inline void clearExcessGShareSet() {
+  static const uint32_t kShards_ = 16;
+
+  struct Shard {
+    mutex lock_;
+    GShareSetMap gshareSetMap_;
+  };
+
+  inline void clearExcessGShareSet(GShareSetMap &gshareSetMap) {
     for (
-      auto itr = gshareSetMap_.begin();
-      gshareSetMap_.size() > trackingHeightNumber_;
-      itr = gshareSetMap_.erase(itr)
+      auto itr = gshareSetMap.begin();
+      gshareSetMap.size() > trackingHeightNumber_;
+      itr = gshareSetMap.erase(itr)
     );
   }
 
-  std::map<uint32_t /*height*/, GShareSet> gshareSetMap_;
+  Shard shards_[kShards_];
   const uint32_t trackingHeightNumber_; // if set to 3, max(gshareSetMap_.size()) == 3
 };
 
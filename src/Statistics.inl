@@ -95,7 +95,227 @@ T StatsWindow<T>::sum(int64_t beginRingIdx) {
   return sum(beginRingIdx, windowSize_);
 }
 
+template <typename T>
+void StatsWindow<T>::serialize(string &buf) const {
+  writeBinary(buf, maxRingIdx_);
+  writeBinary(buf, windowSize_);
+
+  // elements are saved as (distance to maxRingIdx_, value)
+  const int32_t len = (int32_t)std::min<int64_t>(windowSize_, maxRingIdx_ + 1);
+  uint32_t count = 0;
+  for (int32_t i = 0; i < len; i++) {
+    if (elements_[(maxRingIdx_ - i) % windowSize_] != 0) {
+      count++;
+    }
+  }
+  writeBinary(buf, count);
+
+  for (int32_t i = 0; i < len; i++) {
+    const T &val = elements_[(maxRingIdx_ - i) % windowSize_];
+    if (val != 0) {
+      writeBinary(buf, i);
+      writeBinary(buf, val);
+    }
+  }
+}
+
+template <typename T>
+bool StatsWindow<T>::unserialize(const uint8_t *&data, const uint8_t *end) {
+  int64_t maxRingIdx;
+  int32_t windowSize;
+  uint32_t count;
+  if (!readBinary(data, end, maxRingIdx) ||
+      !readBinary(data, end, windowSize) ||
+      !readBinary(data, end, count)) {
+    return false;
+  }
+  if (windowSize != windowSize_ || maxRingIdx < -1 || count > (uint32_t)windowSize_) {
+    return false;
+  }
+
+  clear();
+  maxRingIdx_ = maxRingIdx;
+  for (uint32_t i = 0; i < count; i++) {
+    int32_t distance;
+    T val;
+    if (!readBinary(data, end, distance) || !readBinary(data, end, val)) {
+      return false;
+    }
+    if (distance < 0 || distance >= windowSize_ || distance > maxRingIdx_) {
+      return false;
+    }
+    elements_[(maxRingIdx_ - distance) % windowSize_] = val;
+  }
+  return true;
+}
+
+/////////////////////////////  HierarchicalStatsWindow  //////////////////////////
+template <typename T>
+HierarchicalStatsWindow<T>::HierarchicalStatsWindow() {
+  clear();
+}
+
+template <typename T>
+void HierarchicalStatsWindow<T>::clear() {
+  maxSecond_  = -1;
+  secondsSum_ = 0;
+  std::fill(std::begin(seconds_), std::end(seconds_), 0);
+  std::fill(std::begin(minutesPrefix_), std::end(minutesPrefix_), 0);
+  std::fill(std::begin(fiveMinutesPrefix_), std::end(fiveMinutesPrefix_), 0);
+}
+
+template <typename T>
+void HierarchicalStatsWindow<T>::advancePrefix(T *prefix, const int32_t slots, const int32_t bucketSeconds,
+                                               const int64_t maxSecond, const int64_t second) {
+  // new buckets have nothing, their prefix sums are the same as the last one
+  const int64_t maxBucket = maxSecond / bucketSeconds;
+  const int64_t newBucket = second / bucketSeconds;
+  const T total = prefix[maxBucket % slots];
+  for (int64_t i = std::max(maxBucket + 1, newBucket - slots + 1); i <= newBucket; i++) {
+    prefix[i % slots] = total;
+  }
+}
+
+template <typename T>
+void HierarchicalStatsWindow<T>::addToPrefix(T *prefix, const int32_t slots, const int32_t bucketSeconds,
+                                             const int64_t maxSecond, const int64_t second, const T val) {
+  // late values need to update the following prefix sums still kept
+  const int64_t maxBucket = maxSecond / bucketSeconds;
+  for (int64_t i = std::max(second / bucketSeconds, maxBucket - slots + 1); i <= maxBucket; i++) {
+    prefix[i % slots] += val;
+  }
+}
+
+template <typename T>
+T HierarchicalStatsWindow<T>::sumOfPrefix(const T *prefix, const int32_t slots, const int32_t bucketSeconds,
+                                          const int64_t maxSecond, const int32_t minutes) {
+  auto prefixOf = [&](const int64_t bucket) -> T {
+    // nothing before the second 0
+    return bucket < 0 ? 0 : prefix[bucket % slots];
+  };
+
+  // buckets (firstBucket, curBucket] are fully in the window, and the
+  // seconds [start, end of firstBucket] of firstBucket.
+  const int64_t curBucket = maxSecond / bucketSeconds;
+  const int64_t start = maxSecond - minutes * 60 + 1;
+  if (start <= 0) {
+    return prefixOf(curBucket);
+  }
+  const int64_t firstBucket = start / bucketSeconds;
+
+  T full  = prefixOf(curBucket) - prefixOf(firstBucket);
+  T first = prefixOf(firstBucket) - prefixOf(firstBucket - 1);
+  return full + first * ((firstBucket + 1) * bucketSeconds - start) / bucketSeconds;
+}
+
+template <typename T>
+void HierarchicalStatsWindow<T>::advance(const int64_t second) {
+  if (maxSecond_ == -1) {
+    maxSecond_ = second;
+    return;
+  }
+  if (second <= maxSecond_) {
+    return;
+  }
+
+  // reset the seconds out of the window
+  if (second - maxSecond_ >= kSeconds_) {
+    std::fill(std::begin(seconds_), std::end(seconds_), 0);
+    secondsSum_ = 0;
+  } else {
+    for (int64_t i = maxSecond_ + 1; i <= second; i++) {
+      secondsSum_ -= seconds_[i % kSeconds_];
+      seconds_[i % kSeconds_] = 0;
+    }
+  }
+
+  advancePrefix(minutesPrefix_, kMinuteSlots_, 60, maxSecond_, second);
+  advancePrefix(fiveMinutesPrefix_, kFiveMinutesSlots_, 300, maxSecond_, second);
+  maxSecond_ = second;
+}
+
+template <typename T>
+bool HierarchicalStatsWindow<T>::insert(const int64_t second, const T val) {
+  if (second < 0) {
+    return false;
+  }
+  // too old, drop it
+  if (maxSecond_ != -1 && second / 300 <= maxSecond_ / 300 - kFiveMinutesSlots_) {
+    return false;
+  }
+
+  advance(second);
+
+  if (second > maxSecond_ - kSeconds_) {
+    seconds_[second % kSeconds_] += val;
+    secondsSum_ += val;
+  }
+
+  addToPrefix(minutesPrefix_, kMinuteSlots_, 60, maxSecond_, second, val);
+  addToPrefix(fiveMinutesPrefix_, kFiveMinutesSlots_, 300, maxSecond_, second, val);
+  return true;
+}
+
+template <typename T>
+T HierarchicalStatsWindow<T>::sumLastMinute(const int64_t now) {
+  if (maxSecond_ == -1) {
+    return 0;
+  }
+  advance(now);
+  return secondsSum_;
+}
+
+template <typename T>
+T HierarchicalStatsWindow<T>::sum(const int64_t now, const int32_t minutes) {
+  if (maxSecond_ == -1 || minutes <= 0) {
+    return 0;
+  }
+  assert(minutes <= kMaxMinutes_);
+  advance(now);
+
+  if (minutes <= kMinutes_) {
+    return sumOfPrefix(minutesPrefix_, kMinuteSlots_, 60, maxSecond_, minutes);
+  }
+  return sumOfPrefix(fiveMinutesPrefix_, kFiveMinutesSlots_, 300, maxSecond_, minutes);
+}
+
+template <typename T>
+void HierarchicalStatsWindow<T>::serialize(string &buf) const {
+  writeBinary(buf, maxSecond_);
+  writeBinary(buf, secondsSum_);
+  writeBinary(buf, seconds_);
+  writeBinary(buf, minutesPrefix_);
+  writeBinary(buf, fiveMinutesPrefix_);
+}
+
+template <typename T>
+bool HierarchicalStatsWindow<T>::unserialize(const uint8_t *&data, const uint8_t *end) {
+  return readBinary(data, end, maxSecond_) &&
+         readBinary(data, end, secondsSum_) &&
+         readBinary(data, end, seconds_) &&
+         readBinary(data, end, minutesPrefix_) &&
+         readBinary(data, end, fiveMinutesPrefix_);
+}
+
 ///////////////////////////////  ShareStatsDay  ////////////////////////////////
+template <class SHARE>
+void ShareStatsDay<SHARE>::merge(const ShareStatsDay &r) {
+  ScopeLock sl(lock_);
+
+  for (size_t i = 0; i < 24; i++) {
+    shareAccept1h_[i] += r.shareAccept1h_[i];
+    shareReject1h_[i] += r.shareReject1h_[i];
+    score1h_[i]       += r.score1h_[i];
+    earn1h_[i]        += r.earn1h_[i];
+  }
+  shareAccept1d_ += r.shareAccept1d_;
+  shareReject1d_ += r.shareReject1d_;
+  score1d_       += r.score1d_;
+  earn1d_        += r.earn1d_;
+
+  modifyHoursFlag_ |= r.modifyHoursFlag_;
+}
+
 template <class SHARE>
 void ShareStatsDay<SHARE>::getShareStatsHour(uint32_t hourIdx, ShareStats *stats) {
   ScopeLock sl(lock_);
@@ -30,6 +30,7 @@
 #include "RedisConnection.h"
 #include "Statistics.h"
 #include "Network.h"
+#include "ShareBatch.h"
 
 #include <event2/event.h>
 
@@ -60,6 +61,28 @@ public:
   WorkerStatus() = default;
   WorkerStatus(const WorkerStatus &r) = default;
   WorkerStatus &operator=(const WorkerStatus &r) = default;
+
+  bool operator==(const WorkerStatus &r) const {
+    return accept1m_ == r.accept1m_ && accept5m_ == r.accept5m_ &&
+           accept15m_ == r.accept15m_ && reject15m_ == r.reject15m_ &&
+           accept1h_ == r.accept1h_ && reject1h_ == r.reject1h_ &&
+           acceptCount_ == r.acceptCount_ &&
+           lastShareIP_.addrUint64[0] == r.lastShareIP_.addrUint64[0] &&
+           lastShareIP_.addrUint64[1] == r.lastShareIP_.addrUint64[1] &&
+           lastShareTime_ == r.lastShareTime_;
+  }
+  bool operator!=(const WorkerStatus &r) const { return !(*this == r); }
+};
+
+
+//////////////////////////////  WorkerFlushState  //////////////////////////////
+// What was written to redis for a worker (or user) by the last flush.
+// Only touched by the redis flushing thread that owns the item.
+struct WorkerFlushState {
+  bool flushed_ = false;
+  uint64_t version_ = 0;
+  int32_t workerCount_ = 0;
+  WorkerStatus status_;
 };
 
 
@@ -68,6 +91,7 @@ public:
 template <class SHARE>
 class WorkerShares {
   mutex lock_;
+  atomic<uint64_t> version_;  // bumped by every processed share
   int64_t workerId_;
   int32_t userId_;
 
@@ -76,18 +100,21 @@ class WorkerShares {
   IpAddress lastShareIP_;
   uint64_t lastShareTime_;
 
-  StatsWindow<uint64_t> acceptShareSec_;
+  HierarchicalStatsWindow<uint64_t> acceptShare_;
   StatsWindow<uint64_t> rejectShareMin_;
 
 public:
+  WorkerFlushState redisFlushState_;
+
   WorkerShares(const int64_t workerId, const int32_t userId);
 
-//  void serialize(...);
-//  bool unserialize(const ...);
+  void serialize(string &buf);
+  bool unserialize(const uint8_t *&data, const uint8_t *end);
 
   void processShare(const SHARE &share);
   WorkerStatus getWorkerStatus();
   void getWorkerStatus(WorkerStatus &status);
+  uint64_t getVersion() const { return version_; }
   bool isExpired();
 };
 
@@ -139,6 +166,22 @@ class StatsServerT : public StatsServer {
     REDIS_INDEX_MINER_AGENT     = 1024
   };
 
+  // Snapshot file: header + body. The body contains the pool's, all workers'
+  // and all users' WorkerShares, which is the state after consuming the share
+  // with offset `offset_` in kafka.
+  struct SnapshotHeader {
+    uint32_t magic_;
+    uint32_t version_;
+    int64_t  offset_;
+    uint64_t time_;
+    uint64_t workerCount_;
+    uint64_t userCount_;
+    uint64_t bodySize_;
+    uint64_t checkSum_;
+  };
+  static const uint32_t kSnapshotMagic_   = 0x50534253;  // "SBSP"
+  static const uint32_t kSnapshotVersion_ = 3;
+
   struct WorkerIndexBuffer {
     size_t size_;
 
@@ -153,15 +196,34 @@ class StatsServerT : public StatsServer {
     std::vector<string> lastShareTime_;
   };
 
+  // A worker or a user (workerId_ is 0) copied out of the shards, so the
+  // flushes can work on them without holding any lock.
+  struct WorkerItem {
+    int32_t userId_;
+    int64_t workerId_;
+    int32_t workerCount_;  // users only
+    shared_ptr<WorkerShares<SHARE>> shares_;
+  };
+
+  // The workers and users are split into shards with their own locks, so a
+  // flush or a query only blocks the shares of one shard at a time.
+  // A worker lives in the shard of its WorkerKey, a user and its worker
+  // count in the shard of its userId.
+  struct Shard {
+    pthread_rwlock_t rwlock_;
+    std::unordered_map<WorkerKey/* userId + workerId */, shared_ptr<WorkerShares<SHARE>> > workerSet_;
+    std::unordered_map<int32_t/* userId*/, shared_ptr<WorkerShares<SHARE>> > userSet_;
+    std::unordered_map<int32_t/* userId */, int32_t/* workerNum */> userWorkerCount_;
+  };
+  static const size_t kShardBits_  = 6;
+  static const size_t kShardCount_ = 1 << kShardBits_;
+
   atomic<bool> running_;
   atomic<int64_t> totalWorkerCount_;
   atomic<int64_t> totalUserCount_;
   time_t uptime_;
 
-  pthread_rwlock_t rwlock_;  // for workerSet_
-  std::unordered_map<WorkerKey/* userId + workerId */, shared_ptr<WorkerShares<SHARE>> > workerSet_;
-  std::unordered_map<int32_t/* userId*/, shared_ptr<WorkerShares<SHARE>> > userSet_;
-  std::unordered_map<int32_t/* userId */, int32_t/* workerNum */> userWorkerCount_;
+  Shard shards_[kShardCount_];
   WorkerShares<SHARE> poolWorker_;  // worker status for the pool
 
   KafkaConsumer kafkaConsumer_;  // consume topic: 'ShareLog'
@@ -180,6 +242,9 @@ class StatsServerT : public StatsServer {
   int redisKeyExpire_;
   uint32_t redisPublishPolicy_; // @see statshttpd.cfg
   uint32_t redisIndexPolicy_;   // @see statshttpd.cfg
+  bool redisIncrementalFlush_;  // only rewrite the workers changed since the last flush
+  std::vector<WorkerItem> redisFlushWorkers_;
+  std::vector<WorkerItem> redisFlushUsers_;
 
   time_t kFlushDBInterval_;
   atomic<bool> isInserting_;     // flag mark if we are flushing db
@@ -193,6 +258,14 @@ class StatsServerT : public StatsServer {
 
   shared_ptr<DuplicateShareChecker<SHARE>> dupShareChecker_; // Used to detect duplicate share attacks.
 
+  // Restoring workers from the snapshot at startup rather than
+  // consuming the history shares in the last hour.
+  string fileSnapshot_;        // empty: snapshot disabled
+  time_t kSnapshotInterval_;   // seconds between two snapshots
+  atomic<bool> isSavingSnapshot_;
+  thread threadSaveSnapshot_;  // started and joined by the consume thread
+  int64_t lastShareOffset_;    // the offset of the last consumed share, -1 if none
+
   // httpd
   struct event_base *base_;
   string httpdHost_;
@@ -210,8 +283,20 @@ class StatsServerT : public StatsServer {
   void updateWorkerStatusIndexToRedis(const int32_t userId, const string &key,
                                       const string &score, const string &value);
 
+  static size_t getShardIndex(const size_t hash) {
+    // std::hash of integers is the identity, mix the bits first
+    return ((uint64_t)hash * 0x9E3779B97F4A7C15ULL) >> (64 - kShardBits_);
+  }
+  Shard &getWorkerShard(const WorkerKey &key) {
+    return shards_[getShardIndex(std::hash<WorkerKey>()(key))];
+  }
+  Shard &getUserShard(const int32_t userId) {
+    return shards_[getShardIndex(std::hash<int32_t>()(userId))];
+  }
+  // copy all workers and users, locking one shard at a time
+  void getWorkersAndUsers(std::vector<WorkerItem> &workers, std::vector<WorkerItem> &users);
+
   void _processShare(WorkerKey &key, const SHARE &share);
-  void processShare(const SHARE &share);
   void getWorkerStatusBatch(const vector<WorkerKey> &keys,
                             vector<WorkerStatus> &workerStatus);
   WorkerStatus mergeWorkerStatus(const vector<WorkerStatus> &workerStatus);
@@ -229,11 +314,23 @@ class StatsServerT : public StatsServer {
   // and the second thread is responsible for the next 3.
   void flushWorkersToRedis(uint32_t threadStep);
   void flushUsersToRedis(uint32_t threadStep);
+  // Fill `status` and return true if the item must be rewritten, false if
+  // only its TTL needs to be refreshed.
+  bool updateRedisFlushState(const WorkerItem &item, WorkerStatus &status);
+  void executeRedisReplies(RedisConnection *redis, uint32_t threadStep,
+                           const std::vector<WorkerItem> &items,
+                           const std::vector<std::pair<size_t, WorkerStatus>> &changed,
+                           const std::vector<size_t> &unchanged, const bool publish);
   void addIndexToBuffer(WorkerIndexBuffer &buffer, const int64_t workerId, const WorkerStatus &status);
   void flushIndexToRedis(RedisConnection *redis, std::unordered_map<int32_t /*userId*/, WorkerIndexBuffer> &indexBufferMap);
   void flushIndexToRedis(RedisConnection *redis, WorkerIndexBuffer &buffer, const int32_t userId);
   void flushIndexToRedis(RedisConnection *redis, const std::vector<string> &commandVector);
 
+  void saveSnapshotNonBlocking();
+  void serializeSnapshot(string &buf, const int64_t offset);
+  static bool writeSnapshotFile(const string &file, const string &buf);
+  static uint64_t computeSnapshotCheckSum(const uint8_t *data, size_t len);
+
   void removeExpiredWorkers();
   bool setupThreadConsume();
   void runHttpd();
@@ -252,14 +349,30 @@ public:
                const MysqlConnectInfo *poolDBInfo, const RedisConnectInfo *redisInfo,
                const uint32_t redisConcurrency, const string &redisKeyPrefix, const int redisKeyExpire,
                const int redisPublishPolicy, const int redisIndexPolicy,
+               const bool redisIncrementalFlush,
                const time_t kFlushDBInterval, const string &fileLastFlushTime,
-               shared_ptr<DuplicateShareChecker<SHARE>> dupShareChecker);
+               shared_ptr<DuplicateShareChecker<SHARE>> dupShareChecker,
+               const string &fileSnapshot, const time_t kSnapshotInterval);
   ~StatsServerT();
 
   bool init();
   void stop();
   void run();
 
+  void processShare(const SHARE &share);
+  // parse the shares of a kafka message, batched or not, and process them
+  void consumeShares(const uint8_t *data, size_t len);
+
+  // Save all workers and users to `file`, `offset` is the kafka offset
+  // of the last share they contain.
+  bool saveSnapshot(const string &file, const int64_t offset);
+  // Replace all workers and users with the ones in `file`.
+  // Returns false if the file is missing or corrupt.
+  bool loadSnapshot(const string &file, int64_t &offset);
+
+  // Flush all workers and users to redis, returns after the flush completed.
+  void flushToRedis();
+
 
   ServerStatus getServerStatus();
 
@@ -27,6 +27,8 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/thread.hpp>
 
+#include <fstream>
+
 #include <event2/http.h>
 #include <event2/buffer.h>
 #include <event2/keyvalq_struct.h>
@@ -34,9 +36,8 @@
 ////////////////////////////////  WorkerShares  ////////////////////////////////
 template <class SHARE>
 WorkerShares<SHARE>::WorkerShares(const int64_t workerId, const int32_t userId):
-workerId_(workerId), userId_(userId), acceptCount_(0),
+version_(0), workerId_(workerId), userId_(userId), acceptCount_(0),
 lastShareIP_(0), lastShareTime_(0),
-acceptShareSec_(STATS_SLIDING_WINDOW_SECONDS),
 rejectShareMin_(STATS_SLIDING_WINDOW_SECONDS/60)
 {
   assert(STATS_SLIDING_WINDOW_SECONDS >= 3600);
@@ -52,13 +53,14 @@ void WorkerShares<SHARE>::processShare(const SHARE &share) {
 
   if (StratumStatus::isAccepted(share.status())) {
     acceptCount_++;
-    acceptShareSec_.insert(share.timestamp(),    share.sharediff());
+    acceptShare_.insert(share.timestamp(), share.sharediff());
   } else {
     rejectShareMin_.insert(share.timestamp()/60, share.sharediff());
   }
 
-  lastShareIP_.fromString(share.ip());
+  lastShareIP_ = share.getIp();
   lastShareTime_ = share.timestamp();
+  version_++;
 }
 
 template <class SHARE>
@@ -67,12 +69,12 @@ WorkerStatus WorkerShares<SHARE>::getWorkerStatus() {
   const time_t now = time(nullptr);
   WorkerStatus s;
 
-  s.accept1m_  = acceptShareSec_.sum(now, 60);
-  s.accept5m_  = acceptShareSec_.sum(now, 300);
-  s.accept15m_ = acceptShareSec_.sum(now, 900);
+  s.accept1m_  = acceptShare_.sumLastMinute(now);
+  s.accept5m_  = acceptShare_.sum(now, 5);
+  s.accept15m_ = acceptShare_.sum(now, 15);
   s.reject15m_ = rejectShareMin_.sum(now/60, 15);
 
-  s.accept1h_ = acceptShareSec_.sum(now, 3600);
+  s.accept1h_ = acceptShare_.sum(now, 60);
   s.reject1h_ = rejectShareMin_.sum(now/60, 60);
 
   s.acceptCount_   = acceptCount_;
@@ -87,12 +89,12 @@ void WorkerShares<SHARE>::getWorkerStatus(WorkerStatus &s) {
   ScopeLock sl(lock_);
   const time_t now = time(nullptr);
 
-  s.accept1m_  = acceptShareSec_.sum(now, 60);
-  s.accept5m_  = acceptShareSec_.sum(now, 300);
-  s.accept15m_ = acceptShareSec_.sum(now, 900);
+  s.accept1m_  = acceptShare_.sumLastMinute(now);
+  s.accept5m_  = acceptShare_.sum(now, 5);
+  s.accept15m_ = acceptShare_.sum(now, 15);
   s.reject15m_ = rejectShareMin_.sum(now/60, 15);
 
-  s.accept1h_ = acceptShareSec_.sum(now, 3600);
+  s.accept1h_ = acceptShare_.sum(now, 60);
   s.reject1h_ = rejectShareMin_.sum(now/60, 60);
 
   s.acceptCount_   = acceptCount_;
@@ -100,6 +102,30 @@ void WorkerShares<SHARE>::getWorkerStatus(WorkerStatus &s) {
   s.lastShareTime_ = lastShareTime_;
 }
 
+template <class SHARE>
+void WorkerShares<SHARE>::serialize(string &buf) {
+  ScopeLock sl(lock_);
+  writeBinary(buf, workerId_);
+  writeBinary(buf, userId_);
+  writeBinary(buf, acceptCount_);
+  writeBinary(buf, lastShareIP_);
+  writeBinary(buf, lastShareTime_);
+  acceptShare_.serialize(buf);
+  rejectShareMin_.serialize(buf);
+}
+
+template <class SHARE>
+bool WorkerShares<SHARE>::unserialize(const uint8_t *&data, const uint8_t *end) {
+  ScopeLock sl(lock_);
+  return readBinary(data, end, workerId_) &&
+         readBinary(data, end, userId_) &&
+         readBinary(data, end, acceptCount_) &&
+         readBinary(data, end, lastShareIP_) &&
+         readBinary(data, end, lastShareTime_) &&
+         acceptShare_.unserialize(data, end) &&
+         rejectShareMin_.unserialize(data, end);
+}
+
 template <class SHARE>
 bool WorkerShares<SHARE>::isExpired() {
   ScopeLock sl(lock_);
@@ -114,8 +140,10 @@ StatsServerT<SHARE>::StatsServerT(const char *kafkaBrokers, const char *kafkaSha
                                   const MysqlConnectInfo *poolDBInfo, const RedisConnectInfo *redisInfo,
                                   const uint32_t redisConcurrency, const string &redisKeyPrefix,
                                   const int redisKeyExpire, const int redisPublishPolicy, const int redisIndexPolicy,
+                                  const bool redisIncrementalFlush,
                                   const time_t kFlushDBInterval, const string &fileLastFlushTime,
-                                  shared_ptr<DuplicateShareChecker<SHARE>> dupShareChecker):
+                                  shared_ptr<DuplicateShareChecker<SHARE>> dupShareChecker,
+                                  const string &fileSnapshot, const time_t kSnapshotInterval):
 running_(true), totalWorkerCount_(0), totalUserCount_(0), uptime_(time(nullptr)),
 poolWorker_(0u/* worker id */, 0/* user id */),
 kafkaConsumer_(kafkaBrokers, kafkaShareTopic, 0/* patition */),
@@ -124,10 +152,13 @@ poolDB_(nullptr), poolDBCommonEvents_(nullptr),
 redisCommonEvents_(nullptr), redisConcurrency_(redisConcurrency),
 redisKeyPrefix_(redisKeyPrefix), redisKeyExpire_(redisKeyExpire),
 redisPublishPolicy_(redisPublishPolicy), redisIndexPolicy_(redisIndexPolicy),
+redisIncrementalFlush_(redisIncrementalFlush),
 kFlushDBInterval_(kFlushDBInterval),
 isInserting_(false), isUpdateRedis_(false),
 lastShareTime_(0), isInitializing_(true), lastFlushTime_(0),
 fileLastFlushTime_(fileLastFlushTime), dupShareChecker_(dupShareChecker),
+fileSnapshot_(fileSnapshot), kSnapshotInterval_(kSnapshotInterval),
+isSavingSnapshot_(false), lastShareOffset_(-1),
 base_(nullptr), httpdHost_(httpdHost), httpdPort_(httpdPort),
 requestCount_(0), responseBytes_(0)
 {
@@ -145,7 +176,9 @@ requestCount_(0), responseBytes_(0)
     }
   }
 
-  pthread_rwlock_init(&rwlock_, nullptr);
+  for (auto &shard : shards_) {
+    pthread_rwlock_init(&shard.rwlock_, nullptr);
+  }
 }
 
 template <class SHARE>
@@ -154,6 +187,9 @@ StatsServerT<SHARE>::~StatsServerT() {
 
   if (threadConsume_.joinable())
     threadConsume_.join();
+
+  if (threadSaveSnapshot_.joinable())
+    threadSaveSnapshot_.join();
  
   if (threadConsumeCommonEvents_.joinable())
     threadConsumeCommonEvents_.join();
@@ -185,7 +221,9 @@ StatsServerT<SHARE>::~StatsServerT() {
     redisGroup_.pop_back();
   }
 
-  pthread_rwlock_destroy(&rwlock_);
+  for (auto &shard : shards_) {
+    pthread_rwlock_destroy(&shard.rwlock_);
+  }
 }
 
 template <class SHARE>
@@ -283,40 +321,75 @@ void StatsServerT<SHARE>::processShare(const SHARE &share) {
 template <class SHARE>
 void StatsServerT<SHARE>::_processShare(WorkerKey &key, const SHARE &share) {
   const  int32_t userId = key.userId_;
-
-  pthread_rwlock_rdlock(&rwlock_);
-  auto workerItr = workerSet_.find(key);
-  auto userItr = userSet_.find(userId);
-  pthread_rwlock_unlock(&rwlock_);
+  Shard &workerShard = getWorkerShard(key);
+  Shard &userShard   = getUserShard(userId);
 
   shared_ptr<WorkerShares<SHARE>> workerShare = nullptr, userShare = nullptr;
 
-  if (workerItr != workerSet_.end()) {
-    workerItr->second->processShare(share);
-  } else {
+  pthread_rwlock_rdlock(&workerShard.rwlock_);
+  auto workerItr = workerShard.workerSet_.find(key);
+  if (workerItr != workerShard.workerSet_.end()) {
+    workerShare = workerItr->second;
+  }
+  pthread_rwlock_unlock(&workerShard.rwlock_);
+
+  if (workerShare == nullptr) {
     workerShare = make_shared<WorkerShares<SHARE>>(share.workerhashid(), share.userid());
-    workerShare->processShare(share);
+
+    pthread_rwlock_wrlock(&workerShard.rwlock_);    // write lock
+    auto result = workerShard.workerSet_.emplace(key, workerShare);
+    // another thread may have inserted it
+    workerShare = result.first->second;
+    pthread_rwlock_unlock(&workerShard.rwlock_);
+
+    if (result.second) {
+      totalWorkerCount_++;
+      pthread_rwlock_wrlock(&userShard.rwlock_);
+      userShard.userWorkerCount_[userId]++;
+      pthread_rwlock_unlock(&userShard.rwlock_);
+    }
   }
+  workerShare->processShare(share);
 
-  if (userItr != userSet_.end()) {
-    userItr->second->processShare(share);
-  } else {
+  pthread_rwlock_rdlock(&userShard.rwlock_);
+  auto userItr = userShard.userSet_.find(userId);
+  if (userItr != userShard.userSet_.end()) {
+    userShare = userItr->second;
+  }
+  pthread_rwlock_unlock(&userShard.rwlock_);
+
+  if (userShare == nullptr) {
     userShare = make_shared<WorkerShares<SHARE>>(share.workerhashid(), share.userid());
-    userShare->processShare(share);
+
+    pthread_rwlock_wrlock(&userShard.rwlock_);    // write lock
+    auto result = userShard.userSet_.emplace(userId, userShare);
+    userShare = result.first->second;
+    pthread_rwlock_unlock(&userShard.rwlock_);
+
+    if (result.second) {
+      totalUserCount_++;
+    }
   }
+  userShare->processShare(share);
+}
 
-  if (workerShare != nullptr || userShare != nullptr) {
-    pthread_rwlock_wrlock(&rwlock_);    // write lock
-    if (workerShare != nullptr) {
-      workerSet_[key] = workerShare;
-      totalWorkerCount_++;
-      userWorkerCount_[key.userId_]++;
+template <class SHARE>
+void StatsServerT<SHARE>::getWorkersAndUsers(std::vector<WorkerItem> &workers,
+                                             std::vector<WorkerItem> &users) {
+  workers.reserve(workers.size() + totalWorkerCount_);
+  users.reserve(users.size() + totalUserCount_);
+
+  for (auto &shard : shards_) {
+    pthread_rwlock_rdlock(&shard.rwlock_);
+    for (const auto &itr : shard.workerSet_) {
+      workers.push_back({itr.first.userId_, itr.first.workerId_, 0, itr.second});
     }
-    if (userShare != nullptr) {
-      userSet_[userId] = userShare;
-      totalUserCount_++;
+    for (const auto &itr : shard.userSet_) {
+      auto countItr = shard.userWorkerCount_.find(itr.first);
+      const int32_t workerCount = (countItr != shard.userWorkerCount_.end()) ? countItr->second : 0;
+      users.push_back({itr.first, 0, workerCount, itr.second});
     }
-    pthread_rwlock_unlock(&rwlock_);
+    pthread_rwlock_unlock(&shard.rwlock_);
   }
 }
 
@@ -334,8 +407,17 @@ void StatsServerT<SHARE>::flushWorkersAndUsersToRedis() {
 
 template <class SHARE>
 void StatsServerT<SHARE>::_flushWorkersAndUsersToRedisThread() {
+  flushToRedis();
+  isUpdateRedis_ = false;
+}
+
+template <class SHARE>
+void StatsServerT<SHARE>::flushToRedis() {
   std::vector<boost::thread> threadPool;
 
+  // take a flat copy of the shards, the flushing threads will not lock them
+  getWorkersAndUsers(redisFlushWorkers_, redisFlushUsers_);
+
   assert(redisGroup_.size() == redisConcurrency_);
   for (uint32_t i=0; i<redisConcurrency_; i++) {
     threadPool.push_back(
@@ -349,11 +431,11 @@ void StatsServerT<SHARE>::_flushWorkersAndUsersToRedisThread() {
     }
   }
 
-  pthread_rwlock_rdlock(&rwlock_);
-  LOG(INFO) << "flush to redis... done, " << workerSet_.size() << " workers, " << userSet_.size() << " users";
-  pthread_rwlock_unlock(&rwlock_);
+  LOG(INFO) << "flush to redis... done, " << redisFlushWorkers_.size() << " workers, "
+            << redisFlushUsers_.size() << " users";
 
-  isUpdateRedis_ = false;
+  redisFlushWorkers_.clear();
+  redisFlushUsers_.clear();
 }
 
 template <class SHARE>
@@ -385,37 +467,123 @@ bool StatsServerT<SHARE>::checkRedis(uint32_t threadStep) {
   return true;
 }
 
+template <class SHARE>
+bool StatsServerT<SHARE>::updateRedisFlushState(const WorkerItem &item, WorkerStatus &status) {
+  const uint64_t version = item.shares_->getVersion();
+  item.shares_->getWorkerStatus(status);
+
+  if (!redisIncrementalFlush_) {
+    return true;
+  }
+
+  // The sliding windows decay without new shares, so an unchanged
+  // version alone does not mean the status in redis is still current.
+  WorkerFlushState &state = item.shares_->redisFlushState_;
+  if (state.flushed_ && state.version_ == version &&
+      state.workerCount_ == item.workerCount_ && state.status_ == status) {
+    return false;
+  }
+
+  state.flushed_     = true;
+  state.version_     = version;
+  state.workerCount_ = item.workerCount_;
+  state.status_      = status;
+  return true;
+}
+
+template <class SHARE>
+void StatsServerT<SHARE>::executeRedisReplies(RedisConnection *redis, uint32_t threadStep,
+                                              const std::vector<WorkerItem> &items,
+                                              const std::vector<std::pair<size_t, WorkerStatus>> &changed,
+                                              const std::vector<size_t> &unchanged, const bool publish) {
+  for (size_t i=0; i<changed.size(); i++) {
+    // update info
+    {
+      RedisResult r = redis->execute();
+      if (r.type() != REDIS_REPLY_STATUS || r.str() != "OK") {
+        LOG(INFO) << "redis (thread " << threadStep << ") HMSET failed, "
+                               << "item index: " << i << ", "
+                               << "reply type: " << r.type() << ", "
+                               << "reply str: " << r.str();
+        // write it again next time
+        items[changed[i].first].shares_->redisFlushState_.flushed_ = false;
+      }
+    }
+    // set key expire
+    if (redisKeyExpire_ > 0) {
+      RedisResult r = redis->execute();
+      if (r.type() != REDIS_REPLY_INTEGER || r.integer() != 1) {
+        LOG(INFO) << "redis (thread " << threadStep << ") EXPIRE failed, "
+                                 << "item index: " << i << ", "
+                                 << "reply type: " << r.type() << ", "
+                                 << "reply integer: " << r.integer() << ","
+                                 << "reply str: " << r.str();
+      }
+    }
+    // publish notification
+    if (publish) {
+      RedisResult r = redis->execute();
+      if (r.type() != REDIS_REPLY_INTEGER) {
+        LOG(INFO) << "redis (thread " << threadStep << ") PUBLISH failed, "
+                                 << "item index: " << i << ", "
+                                 << "reply type: " << r.type() << ", "
+                                 << "reply str: " << r.str();
+      }
+    }
+  }
+
+  // refresh the TTL of unchanged items
+  size_t missing = 0;
+  for (size_t i=0; i<unchanged.size(); i++) {
+    RedisResult r = redis->execute();
+    if (r.type() != REDIS_REPLY_INTEGER || r.integer() != 1) {
+      // the key is gone (e.g. redis was restarted), write it again next time
+      items[unchanged[i]].shares_->redisFlushState_.flushed_ = false;
+      missing++;
+    }
+  }
+  if (missing > 0) {
+    LOG(WARNING) << "redis (thread " << threadStep << "): " << missing
+                 << " unchanged keys are missing, they will be rewritten next time";
+  }
+}
+
 template <class SHARE>
 void StatsServerT<SHARE>::flushWorkersToRedis(uint32_t threadStep) {
   RedisConnection *redis = redisGroup_[threadStep];
-  size_t workerCounter = 0;
   std::unordered_map<int32_t /*userId*/, WorkerIndexBuffer> indexBufferMap;
+  std::vector<std::pair<size_t /*item index*/, WorkerStatus>> changed;
+  std::vector<size_t /*item index*/> unchanged;
 
-  pthread_rwlock_rdlock(&rwlock_);  // read lock
-  LOG(INFO) << "redis (thread " << threadStep << "): flush workers, rd locked";
-  
-  size_t stepSize = workerSet_.size() / redisConcurrency_;
-  if (workerSet_.size() % redisConcurrency_ != 0) {
+  size_t stepSize = redisFlushWorkers_.size() / redisConcurrency_;
+  if (redisFlushWorkers_.size() % redisConcurrency_ != 0) {
     // +1 to avoid missing the last few items.
     // Example: 5 / 2 = 2. Each thread handles 2 items and the fifth was missing.
     stepSize++;
   }
 
-  size_t offsetBegin = stepSize * threadStep;
+  const size_t offsetBegin = std::min(stepSize * threadStep, redisFlushWorkers_.size());
+  const size_t offsetEnd   = std::min(offsetBegin + stepSize, redisFlushWorkers_.size());
 
-  auto itr = workerSet_.begin();
-
-  // move to the beginning position
-  for (size_t i=0; i<offsetBegin && itr!=workerSet_.end(); i++, itr++);
+  if (offsetBegin == offsetEnd) {
+    LOG(INFO) << "redis (thread " << threadStep << "): no active workers";
+    return;
+  }
 
-  // flush all workes status in a stepSize
-  for (size_t i=0; i<stepSize && itr!=workerSet_.end(); i++, itr++) {
-    workerCounter++;
+  for (size_t i=offsetBegin; i<offsetEnd; i++) {
+    WorkerStatus status;
+    if (updateRedisFlushState(redisFlushWorkers_[i], status)) {
+      changed.emplace_back(i, status);
+    } else {
+      unchanged.push_back(i);
+    }
+  }
 
-    const int32_t userId   = itr->first.userId_;
-    const int64_t workerId = itr->first.workerId_;
-    shared_ptr<WorkerShares<SHARE>> workerShare = itr->second;
-    const WorkerStatus status = workerShare->getWorkerStatus();
+  // flush the changed workers
+  for (const auto &itr : changed) {
+    const int32_t userId   = redisFlushWorkers_[itr.first].userId_;
+    const int64_t workerId = redisFlushWorkers_[itr.first].workerId_;
+    const WorkerStatus &status = itr.second;
 
     string key = getRedisKeyMiningWorker(userId, workerId);
 
@@ -447,57 +615,30 @@ void StatsServerT<SHARE>::flushWorkersToRedis(uint32_t threadStep) {
     }
   }
 
-  pthread_rwlock_unlock(&rwlock_); // unlock
-  LOG(INFO) << "redis (thread " << threadStep << "): flush workers, rd unlock";
-
-  if (workerCounter == 0) {
-    LOG(INFO) << "redis (thread " << threadStep << "): no active workers";
-    return;
+  // the unchanged workers only need their TTL refreshed
+  if (redisKeyExpire_ <= 0) {
+    unchanged.clear();
   }
-
-  for (size_t i=0; i<workerCounter; i++) {
-    // update info
-    {
-      RedisResult r = redis->execute();
-      if (r.type() != REDIS_REPLY_STATUS || r.str() != "OK") {
-        LOG(INFO) << "redis (thread " << threadStep << ") HMSET failed, "
-                               << "item index: " << i << ", "
-                               << "reply type: " << r.type() << ", "
-                               << "reply str: " << r.str();
-      }
-    }
-    // set key expire
-    if (redisKeyExpire_ > 0) {
-      RedisResult r = redis->execute();
-      if (r.type() != REDIS_REPLY_INTEGER || r.integer() != 1) {
-        LOG(INFO) << "redis (thread " << threadStep << ") EXPIRE failed, "
-                                 << "item index: " << i << ", "
-                                 << "reply type: " << r.type() << ", "
-                                 << "reply integer: " << r.integer() << ","
-                                 << "reply str: " << r.str();
-      }
-    }
-    // notification
-    if (redisPublishPolicy_ & REDIS_PUBLISH_WORKER_UPDATE) {
-      RedisResult r = redis->execute();
-      if (r.type() != REDIS_REPLY_INTEGER) {
-        LOG(INFO) << "redis (thread " << threadStep << ") PUBLISH failed, "
-                                 << "item index: " << i << ", "
-                                 << "reply type: " << r.type() << ", "
-                                 << "reply str: " << r.str();
-      }
-    }
+  for (size_t i : unchanged) {
+    const WorkerItem &item = redisFlushWorkers_[i];
+    redis->prepare({"EXPIRE", getRedisKeyMiningWorker(item.userId_, item.workerId_),
+                    std::to_string(redisKeyExpire_)});
   }
 
+  executeRedisReplies(redis, threadStep, redisFlushWorkers_, changed, unchanged,
+                      redisPublishPolicy_ & REDIS_PUBLISH_WORKER_UPDATE);
+
   // flush indexes
   if (redisIndexPolicy_ != REDIS_INDEX_NONE) {
     flushIndexToRedis(redis, indexBufferMap);
   }
 
-  LOG(INFO) << "flush workers to redis (thread " << threadStep << ") done, workers: " << workerCounter;
+  LOG(INFO) << "flush workers to redis (thread " << threadStep << ") done, workers: "
+            << (offsetEnd - offsetBegin) << ", changed: " << changed.size();
   return;
 }
 
+
 template <class SHARE>
 void StatsServerT<SHARE>::flushIndexToRedis(RedisConnection *redis,
                     std::unordered_map<int32_t /*userId*/, WorkerIndexBuffer> &indexBufferMap) {
@@ -623,33 +764,38 @@ void StatsServerT<SHARE>::flushIndexToRedis(RedisConnection *redis, const std::v
 template <class SHARE>
 void StatsServerT<SHARE>::flushUsersToRedis(uint32_t threadStep) {
   RedisConnection *redis = redisGroup_[threadStep];
-  size_t userCounter = 0;
-
-  pthread_rwlock_rdlock(&rwlock_);  // read lock
-  LOG(INFO) << "redis (thread " << threadStep << "): flush users, rd locked";
+  std::vector<std::pair<size_t /*item index*/, WorkerStatus>> changed;
+  std::vector<size_t /*item index*/> unchanged;
 
-  size_t stepSize = userSet_.size() / redisConcurrency_;
-  if (userSet_.size() % redisConcurrency_ != 0) {
+  size_t stepSize = redisFlushUsers_.size() / redisConcurrency_;
+  if (redisFlushUsers_.size() % redisConcurrency_ != 0) {
     // +1 to avoid missing the last few items.
     // Example: 5 / 2 = 2. Each thread handles 2 items and the fifth was missing.
     stepSize++;
   }
 
-  size_t offsetBegin = stepSize * threadStep;
+  const size_t offsetBegin = std::min(stepSize * threadStep, redisFlushUsers_.size());
+  const size_t offsetEnd   = std::min(offsetBegin + stepSize, redisFlushUsers_.size());
 
-  auto itr = userSet_.begin();
-
-  // move to the beginning position
-  for (size_t i=0; i<offsetBegin && itr!=userSet_.end(); i++, itr++);
+  if (offsetBegin == offsetEnd) {
+    LOG(INFO) << "redis (thread " << threadStep << "): no active users";
+    return;
+  }
 
-  // flush all users status in a stepSize
-  for (size_t i=0; i<stepSize && itr!=userSet_.end(); i++, itr++) {
-    userCounter++;
+  for (size_t i=offsetBegin; i<offsetEnd; i++) {
+    WorkerStatus status;
+    if (updateRedisFlushState(redisFlushUsers_[i], status)) {
+      changed.emplace_back(i, status);
+    } else {
+      unchanged.push_back(i);
+    }
+  }
 
-    const int32_t userId   = itr->first;
-    shared_ptr<WorkerShares<SHARE>> workerShare = itr->second;
-    const WorkerStatus status = workerShare->getWorkerStatus();
-    const int32_t workerCount = userWorkerCount_[userId];
+  // flush the changed users
+  for (const auto &itr : changed) {
+    const int32_t userId      = redisFlushUsers_[itr.first].userId_;
+    const int32_t workerCount = redisFlushUsers_[itr.first].workerCount_;
+    const WorkerStatus &status = itr.second;
 
     string key = getRedisKeyMiningWorker(userId);
 
@@ -677,52 +823,24 @@ void StatsServerT<SHARE>::flushUsersToRedis(uint32_t threadStep) {
     }
   }
 
-  pthread_rwlock_unlock(&rwlock_); // unlock
-  LOG(INFO) << "redis (thread " << threadStep << "): flush users, rd unlock";
-
-  if (userCounter == 0) {
-    LOG(INFO) << "redis (thread " << threadStep << "): no active users";
-    return;
+  // the unchanged users only need their TTL refreshed
+  if (redisKeyExpire_ <= 0) {
+    unchanged.clear();
   }
-
-  for (size_t i=0; i<userCounter; i++) {
-    // update info
-    {
-      RedisResult r = redis->execute();
-      if (r.type() != REDIS_REPLY_STATUS || r.str() != "OK") {
-        LOG(INFO) << "redis (thread " << threadStep << ") HMSET failed, "
-                               << "item index: " << i << ", "
-                               << "reply type: " << r.type() << ", "
-                               << "reply str: " << r.str();
-      }
-    }
-    // set key expire
-    if (redisKeyExpire_ > 0) {
-      RedisResult r = redis->execute();
-      if (r.type() != REDIS_REPLY_INTEGER || r.integer() != 1) {
-        LOG(INFO) << "redis (thread " << threadStep << ") EXPIRE failed, "
-                                 << "item index: " << i << ", "
-                                 << "reply type: " << r.type() << ", "
-                                 << "reply integer: " << r.integer() << ","
-                                 << "reply str: " << r.str();
-      }
-    }
-    // publish notification
-    if (redisPublishPolicy_ & REDIS_PUBLISH_USER_UPDATE) {
-      RedisResult r = redis->execute();
-      if (r.type() != REDIS_REPLY_INTEGER) {
-        LOG(INFO) << "redis (thread " << threadStep << ") PUBLISH failed, "
-                                 << "item index: " << i << ", "
-                                 << "reply type: " << r.type() << ", "
-                                 << "reply str: " << r.str();
-      }
-    }
+  for (size_t i : unchanged) {
+    redis->prepare({"EXPIRE", getRedisKeyMiningWorker(redisFlushUsers_[i].userId_),
+                    std::to_string(redisKeyExpire_)});
   }
 
-  LOG(INFO) << "flush users to redis (thread " << threadStep << ") done, users: " << userCounter;
+  executeRedisReplies(redis, threadStep, redisFlushUsers_, changed, unchanged,
+                      redisPublishPolicy_ & REDIS_PUBLISH_USER_UPDATE);
+
+  LOG(INFO) << "flush users to redis (thread " << threadStep << ") done, users: "
+            << (offsetEnd - offsetBegin) << ", changed: " << changed.size();
   return;
 }
 
+
 template <class SHARE>
 void StatsServerT<SHARE>::flushWorkersAndUsersToDB() {
   LOG(INFO) << "flush to DB...";
@@ -759,73 +877,43 @@ void StatsServerT<SHARE>::_flushWorkersAndUsersToDBThread() {
   const string fields = "`worker_id`,`puid`,`group_id`,`accept_1m`, `accept_5m`,"
   "`accept_15m`, `reject_15m`, `accept_1h`,`reject_1h`, `accept_count`, `last_share_ip`,"
   " `last_share_time`, `created_at`, `updated_at`";
-  // values for multi-insert sql
+  std::vector<WorkerItem> workers, users;
+  // tab separated rows for LOAD DATA
   vector<string> values;
   size_t workerCounter = 0;
   size_t userCounter = 0;
+  string nowStr;
 
   if (!poolDB_->ping()) {
     LOG(ERROR) << "can't connect to pool DB";
     goto finish;
   }
 
-  pthread_rwlock_rdlock(&rwlock_);  // read lock
-  LOG(INFO) << "flush DB: rd locked";
-
-  // get all workes status
-  for (auto itr = workerSet_.begin(); itr != workerSet_.end(); itr++) {
-    workerCounter++;
-
-    const int32_t userId   = itr->first.userId_;
-    const int64_t workerId = itr->first.workerId_;
-    shared_ptr<WorkerShares<SHARE>> workerShare = itr->second;
-    const WorkerStatus status = workerShare->getWorkerStatus();
-
-    const string nowStr = date("%F %T", time(nullptr));
-
-    values.push_back(Strings::Format("%" PRId64",%d,%d,%" PRIu64",%" PRIu64","
-                                     "%" PRIu64",%" PRIu64","  // accept_15m, reject_15m
-                                     "%" PRIu64",%" PRIu64","  // accept_1h,  reject_1h
-                                     "%d,\"%s\","
-                                     "\"%s\",\"%s\",\"%s\"",
-                                     workerId, userId,
-                                     -1 * userId,  /* default group id */
-                                     status.accept1m_, status.accept5m_,
-                                     status.accept15m_, status.reject15m_,
-                                     status.accept1h_, status.reject1h_,
-                                     status.acceptCount_, status.lastShareIP_.toString().c_str(),
-                                     date("%F %T", status.lastShareTime_).c_str(),
-                                     nowStr.c_str(), nowStr.c_str()));
-  }
-
-  // get all users status
-  for (auto itr = userSet_.begin(); itr != userSet_.end(); itr++) {
-    userCounter++;
-
-    const int32_t userId   = itr->first;
-    const int64_t workerId = 0;
-    shared_ptr<WorkerShares<SHARE>> workerShare = itr->second;
-    const WorkerStatus status = workerShare->getWorkerStatus();
-
-    const string nowStr = date("%F %T", time(nullptr));
-
-    values.push_back(Strings::Format("%" PRId64",%d,%d,%" PRIu64",%" PRIu64","
-                                     "%" PRIu64",%" PRIu64","  // accept_15m, reject_15m
-                                     "%" PRIu64",%" PRIu64","  // accept_1h,  reject_1h
-                                     "%d,\"%s\","
-                                     "\"%s\",\"%s\",\"%s\"",
-                                     workerId, userId,
-                                     -1 * userId,  /* default group id */
-                                     status.accept1m_, status.accept5m_,
-                                     status.accept15m_, status.reject15m_,
-                                     status.accept1h_, status.reject1h_,
-                                     status.acceptCount_, status.lastShareIP_.toString().c_str(),
-                                     date("%F %T", status.lastShareTime_).c_str(),
-                                     nowStr.c_str(), nowStr.c_str()));
-  }
-
-  pthread_rwlock_unlock(&rwlock_);
-  LOG(INFO) << "flush DB: rd unlock";
+  getWorkersAndUsers(workers, users);
+  workerCounter = workers.size();
+  userCounter   = users.size();
+  nowStr = date("%F %T", time(nullptr));
+
+  // get all workers and users status, the worker id of users is 0
+  for (const auto *items : {&workers, &users}) {
+    for (const auto &item : *items) {
+      const WorkerStatus status = item.shares_->getWorkerStatus();
+
+      values.push_back(Strings::Format("%" PRId64"\t%d\t%d\t%" PRIu64"\t%" PRIu64"\t"
+                                       "%" PRIu64"\t%" PRIu64"\t"  // accept_15m, reject_15m
+                                       "%" PRIu64"\t%" PRIu64"\t"  // accept_1h,  reject_1h
+                                       "%d\t%s\t"
+                                       "%s\t%s\t%s",
+                                       item.workerId_, item.userId_,
+                                       -1 * item.userId_,  /* default group id */
+                                       status.accept1m_, status.accept5m_,
+                                       status.accept15m_, status.reject15m_,
+                                       status.accept1h_, status.reject1h_,
+                                       status.acceptCount_, status.lastShareIP_.toString().c_str(),
+                                       date("%F %T", status.lastShareTime_).c_str(),
+                                       nowStr.c_str(), nowStr.c_str()));
+    }
+  }
 
   if (values.size() == 0) {
     LOG(INFO) << "flush to DB: no active workers";
@@ -843,8 +931,8 @@ void StatsServerT<SHARE>::_flushWorkersAndUsersToDBThread() {
     goto finish;
   }
 
-  if (!multiInsert(*poolDB_, "mining_workers_tmp", fields, values)) {
-    LOG(ERROR) << "mul-insert table.mining_workers_tmp failure";
+  if (!multiLoadData(*poolDB_, "mining_workers_tmp", fields, values)) {
+    LOG(ERROR) << "load data into table.mining_workers_tmp failure";
     goto finish;
   }
 
@@ -864,49 +952,265 @@ finish:
   isInserting_ = false;
 }
 
+template <class SHARE>
+uint64_t StatsServerT<SHARE>::computeSnapshotCheckSum(const uint8_t *data, size_t len) {
+  // FNV-1a
+  uint64_t checkSum = 14695981039346656037ULL;
+  for (size_t i = 0; i < len; i++) {
+    checkSum ^= data[i];
+    checkSum *= 1099511628211ULL;
+  }
+  return checkSum;
+}
+
+template <class SHARE>
+void StatsServerT<SHARE>::serializeSnapshot(string &buf, const int64_t offset) {
+  std::vector<WorkerItem> workers, users;
+
+  // only hold the locks when copying pointers
+  getWorkersAndUsers(workers, users);
+
+  SnapshotHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic_       = kSnapshotMagic_;
+  header.version_     = kSnapshotVersion_;
+  header.offset_      = offset;
+  header.time_        = (uint64_t)time(nullptr);
+  header.workerCount_ = workers.size();
+  header.userCount_   = users.size();
+
+  buf.clear();
+  buf.append((const char *)&header, sizeof(header));
+
+  poolWorker_.serialize(buf);
+  for (const auto &item : workers) {
+    writeBinary(buf, item.userId_);
+    writeBinary(buf, item.workerId_);
+    item.shares_->serialize(buf);
+  }
+  for (const auto &item : users) {
+    writeBinary(buf, item.userId_);
+    item.shares_->serialize(buf);
+  }
+
+  // fill in the header
+  header.bodySize_ = buf.size() - sizeof(header);
+  header.checkSum_ = computeSnapshotCheckSum((const uint8_t *)buf.data() + sizeof(header), header.bodySize_);
+  buf.replace(0, sizeof(header), (const char *)&header, sizeof(header));
+}
+
+template <class SHARE>
+bool StatsServerT<SHARE>::writeSnapshotFile(const string &file, const string &buf) {
+  // write to a temporary file then rename it, so a broken
+  // snapshot will never replace the last good one.
+  const string tmpFile = file + ".tmp";
+  std::ofstream f(tmpFile, std::ios::binary | std::ios::trunc);
+  if (!f) {
+    LOG(ERROR) << "create snapshot file " << tmpFile << " failed";
+    return false;
+  }
+  f.write(buf.data(), buf.size());
+  f.close();
+  if (!f) {
+    LOG(ERROR) << "write snapshot file " << tmpFile << " failed";
+    return false;
+  }
+
+  if (rename(tmpFile.c_str(), file.c_str()) != 0) {
+    LOG(ERROR) << "rename " << tmpFile << " to " << file << " failed: " << strerror(errno);
+    return false;
+  }
+  return true;
+}
+
+template <class SHARE>
+bool StatsServerT<SHARE>::saveSnapshot(const string &file, const int64_t offset) {
+  string buf;
+  serializeSnapshot(buf, offset);
+  if (!writeSnapshotFile(file, buf)) {
+    return false;
+  }
+  LOG(INFO) << "save snapshot to " << file << ", offset: " << offset << ", size: " << buf.size();
+  return true;
+}
+
+template <class SHARE>
+void StatsServerT<SHARE>::saveSnapshotNonBlocking() {
+  if (isSavingSnapshot_) {
+    LOG(WARNING) << "last snapshot saving is not finish yet, ignore";
+    return;
+  }
+  isSavingSnapshot_ = true;
+  // the last one has finished
+  if (threadSaveSnapshot_.joinable()) {
+    threadSaveSnapshot_.join();
+  }
+
+  // serialize in the consume thread so the snapshot matches lastShareOffset_,
+  // and write it to disk in another thread.
+  auto buf = std::make_shared<string>();
+  serializeSnapshot(*buf, lastShareOffset_);
+  const int64_t offset = lastShareOffset_;
+
+  threadSaveSnapshot_ = thread([this, buf, offset]() {
+    if (writeSnapshotFile(fileSnapshot_, *buf)) {
+      LOG(INFO) << "save snapshot to " << fileSnapshot_ << ", offset: " << offset << ", size: " << buf->size();
+    }
+    isSavingSnapshot_ = false;
+  });
+}
+
+template <class SHARE>
+bool StatsServerT<SHARE>::loadSnapshot(const string &file, int64_t &offset) {
+  std::ifstream f(file, std::ios::binary);
+  if (!f) {
+    LOG(WARNING) << "cannot read snapshot file " << file;
+    return false;
+  }
+  const string buf((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+  f.close();
+
+  SnapshotHeader header;
+  if (buf.size() < sizeof(header)) {
+    LOG(WARNING) << "snapshot " << file << " is too small: " << buf.size() << " bytes";
+    return false;
+  }
+  memcpy(&header, buf.data(), sizeof(header));
+
+  if (header.magic_ != kSnapshotMagic_ || header.version_ != kSnapshotVersion_) {
+    LOG(WARNING) << "snapshot " << file << " has a wrong magic number or version";
+    return false;
+  }
+  if (header.bodySize_ != buf.size() - sizeof(header)) {
+    LOG(WARNING) << "snapshot " << file << " is truncated, body size should be " << header.bodySize_
+                 << " but is " << buf.size() - sizeof(header);
+    return false;
+  }
+  const uint8_t *data = (const uint8_t *)buf.data() + sizeof(header);
+  const uint8_t *end  = data + header.bodySize_;
+  if (computeSnapshotCheckSum(data, header.bodySize_) != header.checkSum_) {
+    LOG(WARNING) << "snapshot " << file << " checkSum mis-matched";
+    return false;
+  }
+
+  if (header.time_ + STATS_SLIDING_WINDOW_SECONDS < (uint64_t)time(nullptr)) {
+    LOG(WARNING) << "snapshot " << file << " is too old, it was saved at " << date("%F %T", header.time_);
+    return false;
+  }
+
+  // the pool worker will be unserialized again after the whole body was parsed
+  const uint8_t *poolWorkerData = data;
+  WorkerShares<SHARE> poolWorker(0u/* worker id */, 0/* user id */);
+  // the maps of each shard
+  vector<std::unordered_map<WorkerKey, shared_ptr<WorkerShares<SHARE>>>> workerSets(kShardCount_);
+  vector<std::unordered_map<int32_t, shared_ptr<WorkerShares<SHARE>>>> userSets(kShardCount_);
+  vector<std::unordered_map<int32_t, int32_t>> userWorkerCounts(kShardCount_);
+
+  if (!poolWorker.unserialize(data, end)) {
+    LOG(WARNING) << "snapshot " << file << ": parse pool worker failed";
+    return false;
+  }
+
+  for (uint64_t i = 0; i < header.workerCount_; i++) {
+    int32_t userId;
+    int64_t workerId;
+    auto workerShare = std::make_shared<WorkerShares<SHARE>>(0, 0);
+    if (!readBinary(data, end, userId) || !readBinary(data, end, workerId) ||
+        !workerShare->unserialize(data, end)) {
+      LOG(WARNING) << "snapshot " << file << ": parse worker " << i << " failed";
+      return false;
+    }
+    const WorkerKey key(userId, workerId);
+    workerSets[getShardIndex(std::hash<WorkerKey>()(key))][key] = workerShare;
+    userWorkerCounts[getShardIndex(std::hash<int32_t>()(userId))][userId]++;
+  }
+
+  for (uint64_t i = 0; i < header.userCount_; i++) {
+    int32_t userId;
+    auto userShare = std::make_shared<WorkerShares<SHARE>>(0, 0);
+    if (!readBinary(data, end, userId) || !userShare->unserialize(data, end)) {
+      LOG(WARNING) << "snapshot " << file << ": parse user " << i << " failed";
+      return false;
+    }
+    userSets[getShardIndex(std::hash<int32_t>()(userId))][userId] = userShare;
+  }
+
+  if (data != end) {
+    LOG(WARNING) << "snapshot " << file << ": " << (end - data) << " bytes left after parsing";
+    return false;
+  }
+
+  poolWorker_.unserialize(poolWorkerData, end);
+
+  int64_t workerCount = 0, userCount = 0;
+  for (size_t i = 0; i < kShardCount_; i++) {
+    Shard &shard = shards_[i];
+    pthread_rwlock_wrlock(&shard.rwlock_);
+    shard.workerSet_.swap(workerSets[i]);
+    shard.userSet_.swap(userSets[i]);
+    shard.userWorkerCount_.swap(userWorkerCounts[i]);
+    workerCount += shard.workerSet_.size();
+    userCount   += shard.userSet_.size();
+    pthread_rwlock_unlock(&shard.rwlock_);
+  }
+  totalWorkerCount_ = workerCount;
+  totalUserCount_   = userCount;
+
+  offset = header.offset_;
+  LOG(INFO) << "load snapshot from " << file << ", offset: " << offset
+            << ", time: " << date("%F %T", header.time_)
+            << ", workers: " << header.workerCount_ << ", users: " << header.userCount_;
+  return true;
+}
+
 template <class SHARE>
 void StatsServerT<SHARE>::removeExpiredWorkers() {
   size_t expiredWorkerCount = 0;
   size_t expiredUserCount = 0;
 
-  pthread_rwlock_wrlock(&rwlock_);  // write lock
+  for (auto &shard : shards_) {
+    std::vector<int32_t> expiredWorkerUsers;
 
-  // delete all expired workers
-  for (auto itr = workerSet_.begin(); itr != workerSet_.end(); ) {
-    const int32_t userId   = itr->first.userId_;
-    shared_ptr<WorkerShares<SHARE>> workerShare = itr->second;
+    pthread_rwlock_wrlock(&shard.rwlock_);  // write lock
 
-    if (workerShare->isExpired()) {
-      itr = workerSet_.erase(itr);
-
-      expiredWorkerCount++;
-      totalWorkerCount_--;
-      userWorkerCount_[userId]--;
-      
-      if (userWorkerCount_[userId] <= 0) {
-        userWorkerCount_.erase(userId);
+    // delete all expired workers
+    for (auto itr = shard.workerSet_.begin(); itr != shard.workerSet_.end(); ) {
+      if (itr->second->isExpired()) {
+        expiredWorkerUsers.push_back(itr->first.userId_);
+        itr = shard.workerSet_.erase(itr);
+      } else {
+        itr++;
       }
-    } else {
-      itr++;
     }
-  }
 
-  // delete all expired users
-  for (auto itr = userSet_.begin(); itr != userSet_.end(); ) {
-    shared_ptr<WorkerShares<SHARE>> workerShare = itr->second;
+    // delete all expired users
+    for (auto itr = shard.userSet_.begin(); itr != shard.userSet_.end(); ) {
+      if (itr->second->isExpired()) {
+        itr = shard.userSet_.erase(itr);
+
+        expiredUserCount++;
+        totalUserCount_--;
+      } else {
+        itr++;
+      }
+    }
 
-    if (workerShare->isExpired()) {
-      itr = userSet_.erase(itr);
+    pthread_rwlock_unlock(&shard.rwlock_);
 
-      expiredUserCount++;
-      totalUserCount_--;
-    } else {
-      itr++;
+    // the worker counts are in the users' shards
+    for (const int32_t userId : expiredWorkerUsers) {
+      Shard &userShard = getUserShard(userId);
+      pthread_rwlock_wrlock(&userShard.rwlock_);
+      auto countItr = userShard.userWorkerCount_.find(userId);
+      if (countItr != userShard.userWorkerCount_.end() && --countItr->second <= 0) {
+        userShard.userWorkerCount_.erase(countItr);
+      }
+      pthread_rwlock_unlock(&userShard.rwlock_);
     }
+    expiredWorkerCount += expiredWorkerUsers.size();
+    totalWorkerCount_ -= expiredWorkerUsers.size();
   }
 
-  pthread_rwlock_unlock(&rwlock_);
-
   LOG(INFO) << "removed expired workers: " << expiredWorkerCount << ", users: " << expiredUserCount;
 }
 
@@ -919,27 +1223,31 @@ void StatsServerT<SHARE>::getWorkerStatusBatch(const vector<WorkerKey> &keys,
   ptrs.resize(keys.size());
 
   // find all shared pointer
-  pthread_rwlock_rdlock(&rwlock_);
   for (size_t i = 0; i < keys.size(); i++) {
     if (keys[i].workerId_ == 0) {
       // find user
-      auto itr = userSet_.find(keys[i].userId_);
-      if (itr == userSet_.end()) {
+      Shard &shard = getUserShard(keys[i].userId_);
+      pthread_rwlock_rdlock(&shard.rwlock_);
+      auto itr = shard.userSet_.find(keys[i].userId_);
+      if (itr == shard.userSet_.end()) {
         ptrs[i] = nullptr;
       } else {
         ptrs[i] = itr->second;
       }
+      pthread_rwlock_unlock(&shard.rwlock_);
     } else {
       // find worker
-      auto itr = workerSet_.find(keys[i]);
-      if (itr == workerSet_.end()) {
+      Shard &shard = getWorkerShard(keys[i]);
+      pthread_rwlock_rdlock(&shard.rwlock_);
+      auto itr = shard.workerSet_.find(keys[i]);
+      if (itr == shard.workerSet_.end()) {
         ptrs[i] = nullptr;
       } else {
         ptrs[i] = itr->second;
       }
+      pthread_rwlock_unlock(&shard.rwlock_);
     }
   }
-  pthread_rwlock_unlock(&rwlock_);
 
   // foreach get worker status
   for (size_t i = 0; i < ptrs.size(); i++) {
@@ -997,23 +1305,35 @@ void StatsServerT<SHARE>::consumeShareLog(rd_kafka_message_t *rkmessage) {
     return;
   }
 
-  SHARE share;
+  lastShareOffset_ = rkmessage->offset;
 
-  if (!share.UnserializeWithVersion((const uint8_t *)(rkmessage->payload), rkmessage->len)) {
-    LOG(ERROR) << "parse share from kafka message failed rkmessage->len = "<< rkmessage->len ;
-    return;
-  }
+  consumeShares((const uint8_t *)(rkmessage->payload), rkmessage->len);
+}
 
-  if (!share.isValid()) {
-    LOG(ERROR) << "invalid share: " << share.toString();
-    return;
-  }
-  if (dupShareChecker_ && !dupShareChecker_->addShare(share)) {
-    LOG(INFO) << "duplicate share attack: " << share.toString();
-    share.set_status(StratumStatus::DUPLICATE_SHARE);
-  }
+template <class SHARE>
+void StatsServerT<SHARE>::consumeShares(const uint8_t *data, size_t len) {
+  bool res = ShareBatch::forEachShare(data, len, [this](const uint8_t *shareData, uint32_t size) {
+    SHARE share;
+
+    if (!share.UnserializeWithVersion(shareData, size)) {
+      LOG(ERROR) << "parse share from kafka message failed, share size = " << size;
+      return;
+    }
+
+    if (!share.isValid()) {
+      LOG(ERROR) << "invalid share: " << share.toString();
+      return;
+    }
+    if (dupShareChecker_ && !dupShareChecker_->addShare(share)) {
+      LOG(INFO) << "duplicate share attack: " << share.toString();
+      share.set_status(StratumStatus::DUPLICATE_SHARE);
+    }
 
-  processShare(share);
+    processShare(share);
+  });
+  if (!res) {
+    LOG(ERROR) << "truncated share batch, message size = " << len;
+  }
 }
 
 template <class SHARE>
@@ -1026,14 +1346,24 @@ bool StatsServerT<SHARE>::setupThreadConsume() {
     // data size will be 36,000,000 * sizeof(SHARE) = 1,728,000,000 Bytes.
     //
     const int32_t kConsumeLatestN = 100000/10*3600;  // 36,000,000
+    int64_t offset = RD_KAFKA_OFFSET_TAIL(kConsumeLatestN);
+
+    // continue from the snapshot if it's available
+    int64_t snapshotOffset = -1;
+    if (!fileSnapshot_.empty() && loadSnapshot(fileSnapshot_, snapshotOffset)) {
+      offset = snapshotOffset + 1;
+      lastShareOffset_ = snapshotOffset;
+      LOG(INFO) << "consume shares from offset " << offset << " of the snapshot";
+    } else {
+      LOG(INFO) << "consume the latest " << kConsumeLatestN << " shares";
+    }
 
     map<string, string> consumerOptions;
     // fetch.wait.max.ms:
     // Maximum time the broker may wait to fill the response with fetch.min.bytes.
     consumerOptions["fetch.wait.max.ms"] = "200";
 
-    if (kafkaConsumer_.setup(RD_KAFKA_OFFSET_TAIL(kConsumeLatestN),
-                             &consumerOptions) == false) {
+    if (kafkaConsumer_.setup(offset, &consumerOptions) == false) {
       LOG(INFO) << "setup consumer fail";
       return false;
     }
@@ -1078,22 +1408,27 @@ void StatsServerT<SHARE>::runThreadConsume() {
   LOG(INFO) << "start sharelog consume thread";
   time_t lastCleanTime     = time(nullptr);
   time_t lastFlushDBTime   = 0; // Set to 0 to log lastShareTime_ of the first share
+  time_t lastSnapshotTime  = time(nullptr);
 
   const time_t kExpiredCleanInterval = 60*30;
-  const int32_t kTimeoutMs = 1000;  // consumer timeout
+  // rd_kafka_consume_batch() returns when the batch is full or the timeout
+  // expires, so the timeout is also the max delay of a share when idle.
+  const int32_t kTimeoutMs = 100;  // consumer timeout
+  const size_t kConsumeBatchSize = 10000;
+
+  auto consumeShareLogCallback = [this](rd_kafka_message_t *rkmessage) {
+    // consume share log (lastShareTime_ will be updated)
+    consumeShareLog(rkmessage);
+  };
 
   // consuming history shares
   while (running_) {
-    rd_kafka_message_t *rkmessage;
-    rkmessage = kafkaConsumer_.consumer(kTimeoutMs);
+    const ssize_t count = kafkaConsumer_.consumeBatch(kTimeoutMs, kConsumeBatchSize,
+                                                      consumeShareLogCallback);
 
-    if (rkmessage != nullptr) {
+    if (count > 0) {
       // record the latest time that got a non-empty message
       lastCleanTime = time(nullptr);
-
-      // consume share log (lastShareTime_ will be updated)
-      consumeShareLog(rkmessage);
-      rd_kafka_message_destroy(rkmessage);  /* Return message to rdkafka */
     }
 
     if (lastFlushDBTime + kFlushDBInterval_ < time(nullptr)) {
@@ -1112,7 +1447,7 @@ void StatsServerT<SHARE>::runThreadConsume() {
 
     // the initialization state ends after no shares in 5 minutes
     // LastCleanTime is used here because it records the latest time that got a non-empty message
-    if (rkmessage == nullptr && lastCleanTime + 300 < time(nullptr)) {
+    if (count <= 0 && lastCleanTime + 300 < time(nullptr)) {
       isInitializing_ = false;
       break;
     }
@@ -1120,14 +1455,7 @@ void StatsServerT<SHARE>::runThreadConsume() {
 
   // consuming recent shares
   while (running_) {
-    rd_kafka_message_t *rkmessage;
-    rkmessage = kafkaConsumer_.consumer(kTimeoutMs);
-
-    if (rkmessage != nullptr) {
-      // consume share log (lastShareTime_ will be updated)
-      consumeShareLog(rkmessage);
-      rd_kafka_message_destroy(rkmessage);  /* Return message to rdkafka */
-    }
+    kafkaConsumer_.consumeBatch(kTimeoutMs, kConsumeBatchSize, consumeShareLogCallback);
 
     //
     // try to remove expired workers
@@ -1152,9 +1480,26 @@ void StatsServerT<SHARE>::runThreadConsume() {
       }
       lastFlushDBTime = time(nullptr);
     }
+
+    //
+    // save workers to the snapshot file
+    //
+    if (!fileSnapshot_.empty() && lastSnapshotTime + kSnapshotInterval_ < time(nullptr)) {
+      saveSnapshotNonBlocking();
+      lastSnapshotTime = time(nullptr);
+    }
   }
   LOG(INFO) << "stop sharelog consume thread";
 
+  // it writes the same tmp file, and must not rename an older snapshot
+  // over the final one
+  if (threadSaveSnapshot_.joinable()) {
+    threadSaveSnapshot_.join();
+  }
+  if (!fileSnapshot_.empty() && lastShareOffset_ >= 0) {
+    saveSnapshot(fileSnapshot_, lastShareOffset_);
+  }
+
   stop();  // if thread exit, we must call server to stop
 }
 
@@ -1578,9 +1923,15 @@ void StatsServerT<SHARE>::getWorkerStatus(struct evbuffer *evb, const char *pUse
     // extra infomations
     string extraInfo;
     if (!isMerge && keys[i].workerId_ == 0) {  // all workers of this user
-      pthread_rwlock_rdlock(&rwlock_);
-      extraInfo = Strings::Format(",\"workers\":%d", userWorkerCount_[userId]);
-      pthread_rwlock_unlock(&rwlock_);
+      Shard &shard = getUserShard(userId);
+      int32_t workerCount = 0;
+      pthread_rwlock_rdlock(&shard.rwlock_);
+      auto countItr = shard.userWorkerCount_.find(userId);
+      if (countItr != shard.userWorkerCount_.end()) {
+        workerCount = countItr->second;
+      }
+      pthread_rwlock_unlock(&shard.rwlock_);
+      extraInfo = Strings::Format(",\"workers\":%d", workerCount);
     }
 
     evbuffer_add_printf(evb,
@@ -179,3 +179,72 @@ StratumJob::~StratumJob()
 {
   
 }
+
+//////////////////////////////// LocalShareSet ////////////////////////////////
+uint64_t LocalShareSet::hash(const LocalShare &share) {
+  // seeded per process, miners choose the nonces
+  static const uint64_t kSeed = ((uint64_t)std::random_device()() << 32) | std::random_device()();
+
+  uint64_t h = kSeed ^ share.exNonce2_;
+  h = (h ^ (h >> 33)) * 0xff51afd7ed558ccdULL;
+  h ^= ((uint64_t)share.nonce_ << 32) | share.time_;
+  h = (h ^ (h >> 33)) * 0xc4ceb9fe1a85ec53ULL;
+  h ^= share.versionMask_;
+  h = (h ^ (h >> 33)) * 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+
+  return h == 0 ? 1 : h;  // zero means an empty slot
+}
+
+void LocalShareSet::grow() {
+  vector<Slot> old(slots_.size() == 0 ? kInitialSlots_ : slots_.size() * 2);
+  old.swap(slots_);
+
+  const size_t mask = slots_.size() - 1;
+  for (const auto &slot : old) {
+    if (slot.hash_ == 0) {
+      continue;
+    }
+    size_t i = slot.hash_ & mask;
+    while (slots_[i].hash_ != 0) {
+      i = (i + 1) & mask;
+    }
+    slots_[i] = slot;
+  }
+}
+
+bool LocalShareSet::insert(const LocalShare &share) {
+  if ((size_ + 1) * 4 > slots_.size() * 3) {
+    grow();
+  }
+
+  const uint64_t h = hash(share);
+  const size_t mask = slots_.size() - 1;
+  size_t i = h & mask;
+  while (slots_[i].hash_ != 0) {
+    if (slots_[i].hash_ == h && slots_[i].share_ == share) {
+      return false;
+    }
+    i = (i + 1) & mask;
+  }
+
+  slots_[i].hash_ = h;
+  slots_[i].share_ = share;
+  size_++;
+  return true;
+}
+
+bool LocalShareSet::contains(const LocalShare &share) const {
+  if (size_ == 0) {
+    return false;
+  }
+
+  const uint64_t h = hash(share);
+  const size_t mask = slots_.size() - 1;
+  for (size_t i = h & mask; slots_[i].hash_ != 0; i = (i + 1) & mask) {
+    if (slots_[i].hash_ == h && slots_[i].share_ == share) {
+      return true;
+    }
+  }
+  return false;
+}
@@ -185,6 +185,8 @@ struct LocalShare {
   LocalShare(uint64_t exNonce2, uint32_t nonce, uint32_t time):
       exNonce2_(exNonce2), nonce_(nonce), time_(time), versionMask_(0) {}
 
+  LocalShare(): exNonce2_(0), nonce_(0), time_(0), versionMask_(0) {}
+
   LocalShare & operator=(const LocalShare &other) {
     exNonce2_ = other.exNonce2_;
     nonce_    = other.nonce_;
@@ -202,11 +204,44 @@ struct LocalShare {
     }
     return false;
   }
+
+  bool operator==(const LocalShare &r) const {
+    return exNonce2_ == r.exNonce2_ && nonce_ == r.nonce_ &&
+           time_ == r.time_ && versionMask_ == r.versionMask_;
+  }
+};
+
+// A set of LocalShare for the duplicate share check. Every submitted share
+// goes through it, so it's an open addressing hash table (linear probing)
+// in one array instead of a std::set with a node per share. The array is
+// allocated with the first share and doubles when it's 3/4 full.
+class LocalShareSet {
+  struct Slot {
+    uint64_t hash_;  // 0: empty slot
+    LocalShare share_;
+
+    Slot(): hash_(0) {}
+  };
+  vector<Slot> slots_;
+  size_t size_;
+
+  static const size_t kInitialSlots_ = 64;
+
+  static uint64_t hash(const LocalShare &share);
+  void grow();
+
+public:
+  LocalShareSet(): size_(0) {}
+
+  // return false if the share is already in the set
+  bool insert(const LocalShare &share);
+  bool contains(const LocalShare &share) const;
+  size_t size() const { return size_; }
 };
 
 struct LocalJob {
   uint64_t jobId_;
-  std::set<LocalShare> submitShares_;
+  LocalShareSet submitShares_;
 
   LocalJob(uint64_t jobId)
       : jobId_(jobId)
@@ -214,7 +249,7 @@ struct LocalJob {
   }
 
   bool addLocalShare(const LocalShare &localShare) {
-    return submitShares_.insert(localShare).second;
+    return submitShares_.insert(localShare);
   }
 };
 
@@ -29,6 +29,7 @@
 #include <netinet/in.h>
 #include <signal.h>
 
+#include <algorithm>
 #include <random>
 
 static map<string, StratumClient::Factory> gStratumClientFactories;
@@ -42,6 +43,7 @@ StratumClient::StratumClient(struct event_base* base,
                              const string &workerFullName,
                              const string &workerPasswd)
 : workerFullName_(workerFullName), workerPasswd_(workerPasswd), isMining_(false)
+, acceptedShares_(0), rejectedShares_(0)
 {
   inBuf_ = evbuffer_new();
   bev_ = bufferevent_socket_new(base, -1, BEV_OPT_CLOSE_ON_FREE|BEV_OPT_THREADSAFE);
@@ -147,6 +149,9 @@ void StratumClient::handleLine(const string &line) {
         jresult.type() != Utilities::JS::type::Bool ||
         jresult.boolean() != true) {
 //      LOG(ERROR) << "json result is null, err: " << jerror.str() << ", line: " << line;
+      rejectedShares_++;
+    } else {
+      acceptedShares_++;
     }
     return;
   }
@@ -226,8 +231,11 @@ StratumClientWrapper::StratumClientWrapper(const char *host,
                                            const string &minerNamePrefix,
                                            const string &passwd,
                                            const string &type)
-    : running_(true), base_(event_base_new()), numConnections_(numConnections),
-      userName_(userName), minerNamePrefix_(minerNamePrefix), passwd_(passwd), type_(type)
+    : running_(true), base_(event_base_new()),
+      timer_(nullptr), sigterm_(nullptr), sigint_(nullptr),
+      numConnections_(numConnections),
+      userName_(userName), minerNamePrefix_(minerNamePrefix), passwd_(passwd), type_(type),
+      shareIntervalMs_(15000), sharesPerTick_(1)
 {
   memset(&sin_, 0, sizeof(sin_));
   sin_.sin_family = AF_INET;
@@ -241,9 +249,12 @@ StratumClientWrapper::StratumClientWrapper(const char *host,
 StratumClientWrapper::~StratumClientWrapper() {
   stop();
 
-  event_free(sigint_);
-  event_free(sigterm_);
-  event_free(timer_);
+  if (sigint_ != nullptr)
+    event_free(sigint_);
+  if (sigterm_ != nullptr)
+    event_free(sigterm_);
+  if (timer_ != nullptr)
+    event_free(timer_);
 
   // It has to be cleared here to free client events before event base
   connections_.clear();
@@ -314,7 +325,15 @@ void StratumClientWrapper::run() {
   timer_ = event_new(base_, -1, EV_PERSIST, StratumClientWrapper::timerCallback, this);
   // Submit a share every 15 seconds (in probability) for each connection.
   // After the timer is triggered, a connection will be randomly selected to submit a share.
-  int sleepTime = 15000000 / connections_.size();
+  // The timer won't fire more than once per millisecond, several connections
+  // will be selected per tick if the total share rate is higher than that.
+  const int kMinSleepTime = 1000;
+  int sleepTime = (int)((uint64_t)shareIntervalMs_ * 1000 / connections_.size());
+  sharesPerTick_ = 1;
+  if (sleepTime < kMinSleepTime) {
+    sharesPerTick_ = kMinSleepTime / std::max(sleepTime, 1);
+    sleepTime = kMinSleepTime;
+  }
   struct timeval interval{sleepTime / 1000000, sleepTime % 1000000};
   event_add(timer_, &interval);
 
@@ -332,12 +351,31 @@ void StratumClientWrapper::run() {
 
 void StratumClientWrapper::submitShares() {
   // randomly select a connection to submit a share.
-  static std::random_device rd;
-  static std::mt19937 gen(rd());
-  static std::uniform_int_distribution<size_t> dis(0, connections_.size()-1);
+  // several wrappers may run in their own threads
+  static thread_local std::random_device rd;
+  static thread_local std::mt19937 gen(rd());
+  std::uniform_int_distribution<size_t> dis(0, connections_.size()-1);
+
+  for (uint32_t n = 0; n < sharesPerTick_; n++) {
+    size_t i = dis(gen);
+    connections_[i]->submitShare();
+  }
+}
 
-  size_t i = dis(gen);
-  connections_[i]->submitShare();
+uint64_t StratumClientWrapper::getAcceptedShares() const {
+  uint64_t shares = 0;
+  for (auto &conn : connections_) {
+    shares += conn->getAcceptedShares();
+  }
+  return shares;
+}
+
+uint64_t StratumClientWrapper::getRejectedShares() const {
+  uint64_t shares = 0;
+  for (auto &conn : connections_) {
+    shares += conn->getRejectedShares();
+  }
+  return shares;
 }
 
 unique_ptr<StratumClient> StratumClientWrapper::createClient(struct event_base *base, const string &workerFullName, const string &workerPasswd)
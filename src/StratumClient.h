@@ -57,6 +57,8 @@ class StratumClient {
   bool isMining_;
   string   latestJobId_;
   uint64_t latestDiff_;
+  uint64_t acceptedShares_;
+  uint64_t rejectedShares_;
 
   bool tryReadLine(string &line);
   virtual void handleLine(const string &line);
@@ -95,6 +97,9 @@ public:
   void readBuf(struct evbuffer *buf);
   void submitShare();
   virtual string constructShare();
+
+  uint64_t getAcceptedShares() const { return acceptedShares_; }
+  uint64_t getRejectedShares() const { return rejectedShares_; }
 };
 
 ////////////////////////////// StratumClientWrapper ////////////////////////////
@@ -110,6 +115,8 @@ class StratumClientWrapper {
   string minerNamePrefix_;
   string passwd_; // miner password, used to set difficulty
   string type_;
+  uint32_t shareIntervalMs_;  // each connection submits a share every N ms (in probability)
+  uint32_t sharesPerTick_;
   std::vector<unique_ptr<StratumClient>> connections_;
 
   void submitShares();
@@ -130,6 +137,12 @@ public:
   void stop();
   void run();
 
+  // should be called before run(), default: 15000 ms
+  void setShareInterval(uint32_t shareIntervalMs) { shareIntervalMs_ = shareIntervalMs; }
+  // should be called after run() returned
+  uint64_t getAcceptedShares() const;
+  uint64_t getRejectedShares() const;
+
   unique_ptr<StratumClient> createClient(struct event_base *base, const string &workerFullName, const string &workerPasswd);
 };
 
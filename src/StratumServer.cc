@@ -26,6 +26,7 @@
 #include "DiffController.h"
 #include "CreateStratumServerTemp.h"
 
+#include <algorithm>
 #include <boost/thread.hpp>
 
 using namespace std;
@@ -108,11 +109,15 @@ JobRepository::JobRepository(const char *kafkaBrokers, const char *consumerTopic
   , lastJobSendTime_(0)
 {
   assert(kMiningNotifyInterval_ < kMaxJobsLifeTime_);
+  jobsSnapshot_ = nullptr;
 }
 
 JobRepository::~JobRepository() {
   if (threadConsume_.joinable())
     threadConsume_.join();
+
+  freeRetiredSnapshots(true);
+  delete jobsSnapshot_.exchange(nullptr);
 }
 
 void JobRepository::setMaxJobDelay (const time_t maxJobDelay) {
@@ -121,23 +126,51 @@ void JobRepository::setMaxJobDelay (const time_t maxJobDelay) {
 }
 
 shared_ptr<StratumJobEx> JobRepository::getStratumJobEx(const uint64_t jobId) {
-  ScopeLock sl(lock_);
-  auto itr = exJobs_.find(jobId);
-  if (itr != exJobs_.end()) {
-    return itr->second;
+  const JobsSnapshot *snapshot = jobsSnapshot_.load(std::memory_order_acquire);
+  if (snapshot == nullptr) {
+    return nullptr;
+  }
+  const auto &ids = snapshot->jobIds_;
+  auto itr = std::lower_bound(ids.begin(), ids.end(), jobId);
+  if (itr != ids.end() && *itr == jobId) {
+    return snapshot->jobs_[itr - ids.begin()];
   }
   return nullptr;
 }
 
 shared_ptr<StratumJobEx> JobRepository::getLatestStratumJobEx() {
-  ScopeLock sl(lock_);
-  if (exJobs_.size()) {
-    return exJobs_.rbegin()->second;
+  const JobsSnapshot *snapshot = jobsSnapshot_.load(std::memory_order_acquire);
+  if (snapshot != nullptr && snapshot->jobs_.size()) {
+    return snapshot->jobs_.back();
   }
   LOG(WARNING) << "getLatestStratumJobEx fail";
   return nullptr;
 }
 
+void JobRepository::updateJobsSnapshot() {
+  auto snapshot = new JobsSnapshot;
+  snapshot->jobIds_.reserve(exJobs_.size());
+  snapshot->jobs_.reserve(exJobs_.size());
+  for (const auto &itr : exJobs_) {
+    snapshot->jobIds_.push_back(itr.first);
+    snapshot->jobs_.push_back(itr.second);
+  }
+
+  const JobsSnapshot *old = jobsSnapshot_.exchange(snapshot, std::memory_order_acq_rel);
+  if (old != nullptr) {
+    // someone may still be searching in it
+    retiredSnapshots_.emplace_back(QuiescentState::retire(), old);
+  }
+}
+
+void JobRepository::freeRetiredSnapshots(bool all) {
+  while (retiredSnapshots_.size() &&
+         (all || QuiescentState::passed(retiredSnapshots_.front().first))) {
+    delete retiredSnapshots_.front().second;
+    retiredSnapshots_.pop_front();
+  }
+}
+
 void JobRepository::stop() {
   if (!running_) {
     return;
@@ -241,8 +274,7 @@ void JobRepository::consumeStratumJob(rd_kafka_message_t *rkmessage) {
     LOG(ERROR) << "too large delay from kafka to receive topic 'StratumJob' job time=" << sjob->jobTime() << ", max delay=" << kMaxJobsLifeTime_ << ", now=" << now;
     return;
   }
-  // here you could use Map.find() without lock, it's sure
-  // that everyone is using this Map readonly now
+  // only this thread changes exJobs_, so the snapshot is up to date
   auto existingJob = getStratumJobEx(sjob->jobId_);
   if(existingJob != nullptr)
   {
@@ -295,23 +327,31 @@ void JobRepository::tryCleanExpiredJobs() {
   ScopeLock sl(lock_);
 
   const uint32_t nowTs = (uint32_t)time(nullptr);
+  bool removed = false;
   // Keep at least one job to keep normal mining when the jobmaker fails
   while (exJobs_.size() > 1) {
     // Maps (and sets) are sorted, so the first element is the smallest,
     // and the last element is the largest.
     auto itr = exJobs_.begin();
 
-    const time_t jobTime = (time_t)(itr->first >> 32);
+    const uint64_t jobId = itr->first;
+    const time_t jobTime = (time_t)(jobId >> 32);
     if (nowTs < jobTime + kMaxJobsLifeTime_) {
       break;  // not expired
     }
 
     // remove expired job
     exJobs_.erase(itr);
+    removed = true;
 
-    LOG(INFO) << "remove expired stratum job, id: " << itr->first
+    LOG(INFO) << "remove expired stratum job, id: " << jobId
     << ", time: " << date("%F %T", jobTime);
   }
+
+  if (removed) {
+    updateJobsSnapshot();
+  }
+  freeRetiredSnapshots(false);
 }
 
 
@@ -323,7 +363,10 @@ UserInfo::UserInfo(const string &apiUrl, Server *server):
 running_(true), apiUrl_(apiUrl), lastMaxUserId_(0),
 server_(server)
 {
-  pthread_rwlock_init(&rwlock_, nullptr);
+#ifdef USER_DEFINED_COINBASE
+  lastTime_ = 0;
+#endif
+  usersSnapshot_ = new UsersSnapshot;
 }
 
 UserInfo::~UserInfo() {
@@ -335,7 +378,8 @@ UserInfo::~UserInfo() {
   if (threadInsertWorkerName_.joinable())
     threadInsertWorkerName_.join();
 
-  pthread_rwlock_destroy(&rwlock_);
+  freeRetiredSnapshots(true);
+  delete usersSnapshot_.exchange(nullptr);
 }
 
 void UserInfo::stop() {
@@ -346,32 +390,43 @@ void UserInfo::stop() {
 }
 
 int32_t UserInfo::getUserId(const string userName) {
-  pthread_rwlock_rdlock(&rwlock_);
-  auto itr = nameIds_.find(userName);
-  pthread_rwlock_unlock(&rwlock_);
-
-  if (itr != nameIds_.end()) {
+  const UsersSnapshot *snapshot = usersSnapshot_.load(std::memory_order_acquire);
+  auto itr = snapshot->nameIds_.find(userName);
+  if (itr != snapshot->nameIds_.end()) {
     return itr->second;
   }
   return 0;  // not found
 }
 
+void UserInfo::updateUsersSnapshot(const UsersSnapshot *snapshot) {
+  const UsersSnapshot *old = usersSnapshot_.exchange(snapshot, std::memory_order_acq_rel);
+  // someone may still be looking up in it
+  retiredSnapshots_.emplace_back(QuiescentState::retire(), old);
+  freeRetiredSnapshots(false);
+}
+
+void UserInfo::freeRetiredSnapshots(bool all) {
+  while (retiredSnapshots_.size() &&
+         (all || QuiescentState::passed(retiredSnapshots_.front().first))) {
+    delete retiredSnapshots_.front().second;
+    retiredSnapshots_.pop_front();
+  }
+}
+
 #ifdef USER_DEFINED_COINBASE
 ////////////////////// User defined coinbase enabled //////////////////////
 
 // getCoinbaseInfo
 string UserInfo::getCoinbaseInfo(int32_t userId) {
-  pthread_rwlock_rdlock(&rwlock_);
-  auto itr = idCoinbaseInfos_.find(userId);
-  pthread_rwlock_unlock(&rwlock_);
-
-  if (itr != idCoinbaseInfos_.end()) {
+  const UsersSnapshot *snapshot = usersSnapshot_.load(std::memory_order_acquire);
+  auto itr = snapshot->idCoinbaseInfos_.find(userId);
+  if (itr != snapshot->idCoinbaseInfos_.end()) {
     return itr->second;
   }
   return "";  // not found
 }
 
-int32_t UserInfo::incrementalUpdateUsers() {
+int32_t UserInfo::incrementalUpdateUsers(UsersSnapshot *&snapshot) {
   //
   // WARNING: The API is incremental update, we use `?last_id=` to make sure
   //          always get the new data. Make sure you have use `last_id` in API.
@@ -400,7 +455,10 @@ int32_t UserInfo::incrementalUpdateUsers() {
   }
   lastTime_ = data["time"].int64();
 
-  pthread_rwlock_wrlock(&rwlock_);
+  // only this thread changes the snapshot, copy it once for all pages
+  if (snapshot == nullptr) {
+    snapshot = new UsersSnapshot(*usersSnapshot_.load(std::memory_order_acquire));
+  }
   for (JsonNode &itr : *vUser) {
 
     const string  userName(itr.key_start(), itr.key_end() - itr.key_start());
@@ -426,14 +484,13 @@ int32_t UserInfo::incrementalUpdateUsers() {
     if (userId > lastMaxUserId_) {
       lastMaxUserId_ = userId;
     }
-    nameIds_[userName] = userId;
+    snapshot->nameIds_[userName] = userId;
 
     // get user's coinbase info
     LOG(INFO) << "user id: " << userId << ", coinbase info: " << coinbaseInfo;
-    idCoinbaseInfos_[userId] = coinbaseInfo;
+    snapshot->idCoinbaseInfos_[userId] = coinbaseInfo;
 
   }
-  pthread_rwlock_unlock(&rwlock_);
 
   return vUser->size();
 }
@@ -442,7 +499,7 @@ int32_t UserInfo::incrementalUpdateUsers() {
 #else
 ////////////////////// User defined coinbase disabled //////////////////////
 
-int32_t UserInfo::incrementalUpdateUsers() {
+int32_t UserInfo::incrementalUpdateUsers(UsersSnapshot *&snapshot) {
   //
   // WARNING: The API is incremental update, we use `?last_id=` to make sure
   //          always get the new data. Make sure you have use `last_id` in API.
@@ -468,16 +525,18 @@ int32_t UserInfo::incrementalUpdateUsers() {
     return 0;
   }
 
-  pthread_rwlock_wrlock(&rwlock_);
+  // only this thread changes the snapshot, copy it once for all pages
+  if (snapshot == nullptr) {
+    snapshot = new UsersSnapshot(*usersSnapshot_.load(std::memory_order_acquire));
+  }
   for (const auto &itr : *vUser) {
     const string  userName(itr.key_start(), itr.key_end() - itr.key_start());
     const int32_t userId   = itr.int32();
     if (userId > lastMaxUserId_) {
       lastMaxUserId_ = userId;
     }
-    nameIds_.insert(std::make_pair(userName, userId));
+    snapshot->nameIds_.insert(std::make_pair(userName, userId));
   }
-  pthread_rwlock_unlock(&rwlock_);
 
   return vUser->size();
 }
@@ -485,17 +544,41 @@ int32_t UserInfo::incrementalUpdateUsers() {
 /////////////////// End of user defined coinbase disabled ///////////////////
 #endif
 
+int32_t UserInfo::updateUsers() {
+  // the pages are applied to one copy, so a poll copies the users once
+  UsersSnapshot *snapshot = nullptr;
+  int32_t count = 0;
+  int32_t res = 0;
+
+  while (running_) {
+    res = incrementalUpdateUsers(snapshot);
+    if (res <= 0) {
+      break;
+    }
+    count += res;
+  }
+
+  // a page may fail after some users have been applied
+  if (snapshot != nullptr) {
+    updateUsersSnapshot(snapshot);
+  }
+  return res == -1 ? -1 : count;
+}
+
 void UserInfo::runThreadUpdate() {
   const time_t updateInterval = 10;  // seconds
   time_t lastUpdateTime = time(nullptr);
 
   while (running_) {
+    // the readers may have been quiescent since the last update
+    freeRetiredSnapshots(false);
+
     if (lastUpdateTime + updateInterval > time(nullptr)) {
       usleep(500000);  // 500ms
       continue;
     }
 
-    int32_t res = incrementalUpdateUsers();
+    int32_t res = updateUsers();
     lastUpdateTime = time(nullptr);
 
     if (res > 0)
@@ -507,22 +590,16 @@ bool UserInfo::setupThreads() {
   //
   // get all user list, incremental update model.
   //
-  // We use `offset` in incrementalUpdateUsers(), will keep update uitl no more
-  // new users. Most of http API have timeout limit, so can't return lots of
-  // data in one request.
+  // We use `offset` in incrementalUpdateUsers(), updateUsers() will keep update
+  // uitl no more new users. Most of http API have timeout limit, so can't
+  // return lots of data in one request.
   //
-  while (1) {
-    int32_t res = incrementalUpdateUsers();
-    if (res == 0)
-      break;
-
-    if (res == -1) {
-      LOG(ERROR) << "update user list failure";
-      return false;
-    }
-
-    LOG(INFO) << "update users count: " << res;
+  int32_t res = updateUsers();
+  if (res == -1) {
+    LOG(ERROR) << "update user list failure";
+    return false;
   }
+  LOG(INFO) << "update users count: " << res;
 
   threadUpdate_ = thread(&UserInfo::runThreadUpdate, this);
   threadInsertWorkerName_ = thread(&UserInfo::runThreadInsertWorkerName, this);
@@ -632,7 +709,9 @@ StratumServer::StratumServer(const char *ip, const unsigned short port,
                              shared_ptr<DiffController> defaultDifficultyController,
                              const string& solvedShareTopic,
                              const string& shareTopic,
-                             const string& commonEventsTopic)
+                             const string& commonEventsTopic,
+                             uint32_t eventLoopThreads,
+                             uint32_t shareBatchSize)
     : running_(true),
       ip_(ip), port_(port), serverId_(serverId),
       fileLastNotifyTime_(fileLastNotifyTime),
@@ -644,7 +723,9 @@ StratumServer::StratumServer(const char *ip, const unsigned short port,
       defaultDifficultyController_(defaultDifficultyController),
       solvedShareTopic_(solvedShareTopic),
       shareTopic_(shareTopic),
-      commonEventsTopic_(commonEventsTopic)
+      commonEventsTopic_(commonEventsTopic),
+      eventLoopThreads_(eventLoopThreads),
+      shareBatchSize_(shareBatchSize)
 {
 }
 
@@ -679,9 +760,242 @@ void StratumServer::run() {
   server_->run();
 }
 
+/////////////////////////////////// ServerEventLoop //////////////////////////////
+thread_local ServerEventLoop *ServerEventLoop::current_ = nullptr;
+
+ServerEventLoop::ServerEventLoop(Server &server)
+  : server_(server), base_(nullptr), listener_(nullptr), notifyEvent_(nullptr)
+  , shareBatchTimer_(nullptr), quiescentTimer_(nullptr)
+{
+}
+
+ServerEventLoop::~ServerEventLoop() {
+  // It has to be cleared here to free session's bufferevents before event base
+  connections_.clear();
+  context_.reset();
+
+  if (notifyEvent_ != nullptr) {
+    event_free(notifyEvent_);
+  }
+  if (shareBatchTimer_ != nullptr) {
+    event_free(shareBatchTimer_);
+  }
+  if (quiescentTimer_ != nullptr) {
+    event_free(quiescentTimer_);
+  }
+  if (listener_ != nullptr) {
+    evconnlistener_free(listener_);
+  }
+  if (base_ != nullptr) {
+    event_base_free(base_);
+  }
+}
+
+bool ServerEventLoop::setup(struct sockaddr_in &sin, bool reusePort) {
+  base_ = event_base_new();
+  if(!base_) {
+    LOG(ERROR) << "server: cannot create base";
+    return false;
+  }
+
+  // the event will be activated by event_active() from other threads
+  notifyEvent_ = event_new(base_, -1, 0, ServerEventLoop::notifyCallback, this);
+  if (!notifyEvent_) {
+    LOG(ERROR) << "server: cannot create notify event";
+    return false;
+  }
+
+  shareBatchTimer_ = evtimer_new(base_, ServerEventLoop::shareBatchTimerCallback, this);
+  if (!shareBatchTimer_) {
+    LOG(ERROR) << "server: cannot create share batch timer";
+    return false;
+  }
+
+  quiescentTimer_ = event_new(base_, -1, EV_PERSIST, ServerEventLoop::quiescentTimerCallback, this);
+  const struct timeval interval = {0, kQuiescentIntervalMs_ * 1000};
+  if (!quiescentTimer_ || event_add(quiescentTimer_, &interval) != 0) {
+    LOG(ERROR) << "server: cannot create quiescent state timer";
+    return false;
+  }
+
+  context_ = server_.createEventLoopContext(*this);
+
+  unsigned flags = LEV_OPT_REUSEABLE|LEV_OPT_CLOSE_ON_FREE;
+  if (reusePort) {
+    flags |= LEV_OPT_REUSEABLE_PORT;
+  }
+  listener_ = evconnlistener_new_bind(base_,
+                                      ServerEventLoop::listenerCallback,
+                                      (void*)this,
+                                      flags,
+                                      -1, (struct sockaddr*)&sin, sizeof(sin));
+  if(!listener_) {
+    return false;
+  }
+  return true;
+}
+
+void ServerEventLoop::run() {
+  if(base_ != NULL) {
+    current_ = this;
+    QuiescentReader reader;
+    //    event_base_loop(base_, EVLOOP_NONBLOCK);
+    event_base_dispatch(base_);
+
+    flushShareBatch();
+    current_ = nullptr;
+  }
+}
+
+void ServerEventLoop::stop() {
+  event_base_loopexit(base_, NULL);
+}
+
+void ServerEventLoop::postMiningNotify(shared_ptr<StratumJobEx> exJobPtr) {
+  {
+    ScopeLock sl(pendingJobsLock_);
+    pendingJobs_.push_back(exJobPtr);
+  }
+  // thread-safe since evthread_use_pthreads() was called
+  event_active(notifyEvent_, EV_READ, 0);
+}
+
+void ServerEventLoop::notifyCallback(evutil_socket_t fd, short events, void *ptr) {
+  auto loop = static_cast<ServerEventLoop *>(ptr);
+  loop->sendPendingMiningNotify();
+}
+
+void ServerEventLoop::addShare(const uint8_t *data, size_t len) {
+  shareBatch_.add(data, (uint32_t)len);
+
+  if (shareBatch_.size() >= server_.shareBatchSize_) {
+    flushShareBatch();
+  } else if (shareBatch_.count() == 1) {
+    const struct timeval interval = {0, kShareBatchIntervalMs_ * 1000};
+    evtimer_add(shareBatchTimer_, &interval);
+  }
+}
+
+void ServerEventLoop::flushShareBatch() {
+  if (shareBatchTimer_ != nullptr) {
+    evtimer_del(shareBatchTimer_);
+  }
+  if (shareBatch_.count() == 0) {
+    return;
+  }
+  server_.kafkaProducerShareLog_->produce(shareBatch_.data(), shareBatch_.size());
+  shareBatch_.clear();
+}
+
+void ServerEventLoop::shareBatchTimerCallback(evutil_socket_t fd, short events, void *ptr) {
+  auto loop = static_cast<ServerEventLoop *>(ptr);
+  loop->flushShareBatch();
+}
+
+void ServerEventLoop::quiescentTimerCallback(evutil_socket_t fd, short events, void *ptr) {
+  // no snapshot pointer is kept between callbacks
+  QuiescentState::quiescent();
+}
+
+void ServerEventLoop::sendPendingMiningNotify() {
+  std::vector<shared_ptr<StratumJobEx>> jobs;
+  {
+    ScopeLock sl(pendingJobsLock_);
+    jobs.swap(pendingJobs_);
+  }
+  if (jobs.empty()) {
+    return;
+  }
+
+  //
+  // http://www.sgi.com/tech/stl/Map.html
+  //
+  // Map has the important property that inserting a new element into a map
+  // does not invalidate iterators that point to existing elements. Erasing
+  // an element from a map also does not invalidate any iterators, except,
+  // of course, for iterators that actually point to the element that is
+  // being erased.
+  //
+
+  ScopeLock sl(connsLock_);
+  auto itr = connections_.begin();
+  while (itr != connections_.end()) {
+    auto &conn = *itr;
+    if (conn->isDead()) {
+      // the session is still referenced by tasks running in other threads
+      if (conn->hasAsyncTasks()) {
+        ++itr;
+        continue;
+      }
+#ifndef WORK_WITH_STRATUM_SWITCHER
+      server_.sessionIDManager_->freeSessionId(conn->getSessionId());
+#endif
+      itr = connections_.erase(itr);
+    } else {
+      // jobs are sent in the order they were posted
+      for (auto &exJobPtr : jobs) {
+        conn->sendMiningNotify(exJobPtr);
+      }
+      ++itr;
+    }
+  }
+}
+
+void ServerEventLoop::addConnection(unique_ptr<StratumSession> connection) {
+  ScopeLock sl(connsLock_);
+  connections_.insert(move(connection));
+}
+
+size_t ServerEventLoop::getConnectionsCount() {
+  ScopeLock sl(connsLock_);
+  return connections_.size();
+}
+
+void ServerEventLoop::listenerCallback(struct evconnlistener* listener,
+                                       evutil_socket_t fd,
+                                       struct sockaddr *saddr,
+                                       int socklen, void* data)
+{
+  ServerEventLoop *loop = static_cast<ServerEventLoop *>(data);
+  Server *server = &loop->server_;
+  struct event_base  *base = loop->base_;
+  struct bufferevent *bev;
+  uint32_t sessionID = 0u;
+
+#ifndef WORK_WITH_STRATUM_SWITCHER
+  // can't alloc session Id
+  if (server->sessionIDManager_->allocSessionId(&sessionID) == false) {
+    close(fd);
+    return;
+  }
+#endif
+
+  bev = bufferevent_socket_new(base, fd, BEV_OPT_CLOSE_ON_FREE|BEV_OPT_THREADSAFE);
+  if(bev == nullptr) {
+    LOG(ERROR) << "error constructing bufferevent!";
+    server->stop();
+    return;
+  }
+
+  // create stratum session
+  auto conn = server->createConnection(bev, saddr, sessionID);
+  if (!conn->initialize())
+  {
+    return;
+  }
+  // set callback functions
+  bufferevent_setcb(bev,
+                    Server::readCallback, nullptr,
+                    Server::eventCallback, conn.get());
+  // By default, a newly created bufferevent has writing enabled.
+  bufferevent_enable(bev, EV_READ|EV_WRITE);
+
+  loop->addConnection(move(conn));
+}
+
 ///////////////////////////////////// Server ///////////////////////////////////
 Server::Server(const int32_t shareAvgSeconds)
-  : base_(nullptr), signal_event_(nullptr), listener_(nullptr)
+  : signal_event_(nullptr)
   , kafkaProducerShareLog_(nullptr)
   , kafkaProducerSolvedShare_(nullptr)
   , kafkaProducerCommonEvents_(nullptr)
@@ -693,6 +1007,7 @@ Server::Server(const int32_t shareAvgSeconds)
   , isDevModeEnable_(false)
   , devFixedDifficulty_(1.0)
   , kShareAvgSeconds_(shareAvgSeconds)
+  , shareBatchSize_(0)
   , jobRepository_(nullptr)
   , userInfo_(nullptr)
   , serverId_(0)
@@ -703,12 +1018,9 @@ Server::~Server() {
   if (signal_event_ != nullptr) {
     event_free(signal_event_);
   }
-  if (listener_ != nullptr) {
-    evconnlistener_free(listener_);
-  }
-  if (base_ != nullptr) {
-    event_base_free(base_);
-  }
+  // sessions should be freed before the kafka producers & job repository
+  eventLoops_.clear();
+
   if (kafkaProducerShareLog_ != nullptr) {
     delete kafkaProducerShareLog_;
   }
@@ -738,6 +1050,11 @@ bool Server::setup(StratumServer* sserver) {
   LOG(INFO) << "WORK_WITH_STRATUM_SWITCHER enabled, miners can only connect to the sserver via a stratum switcher.";
 #endif
 
+  shareBatchSize_ = sserver->shareBatchSize_;
+  if (shareBatchSize_ > 0) {
+    LOG(INFO) << "shares are sent to kafka in batches of up to " << shareBatchSize_ << " bytes";
+  }
+
   if (sserver->isEnableSimulator_) {
     isEnableSimulator_ = true;
     LOG(WARNING) << "Simulator is enabled, all share will be accepted. "
@@ -769,6 +1086,32 @@ bool Server::setup(StratumServer* sserver) {
                                                  sserver->commonEventsTopic_.c_str(),
                                                  RD_KAFKA_PARTITION_UA);
 
+  memset(&sin_, 0, sizeof(sin_));
+  sin_.sin_family = AF_INET;
+  sin_.sin_port   = htons(sserver->port_);
+  sin_.sin_addr.s_addr = htonl(INADDR_ANY);
+  const char* ip = sserver->ip_.c_str();
+  if (ip && inet_pton(AF_INET, ip, &sin_.sin_addr) == 0) {
+    LOG(ERROR) << "invalid ip: " << ip;
+    return false;
+  }
+
+  // every loop binds its own listener to ip:port, SO_REUSEPORT is
+  // required if there is more than one of them.
+  // The loops are created before the job repository and user info threads,
+  // which walk eventLoops_ without a lock.
+  const uint32_t loopsNum = std::max(sserver->eventLoopThreads_, 1u);
+  for (uint32_t i = 0; i < loopsNum; i++) {
+    auto loop = std::unique_ptr<ServerEventLoop>(new ServerEventLoop(*this));
+    if (!loop->setup(sin_, loopsNum > 1)) {
+      LOG(ERROR) << "cannot create listener: " << ip << ":" << sserver->port_;
+      return false;
+    }
+    eventLoops_.push_back(move(loop));
+  }
+  LOG(INFO) << "stratum server listening on " << ip << ":" << sserver->port_
+            << " with " << loopsNum << " event loop(s)";
+
   // job repository
   jobRepository_ = createJobRepository(sserver->kafkaBrokers_.c_str(), sserver->consumerTopic_.c_str(), \
                                        sserver->fileLastNotifyTime_);
@@ -840,81 +1183,44 @@ bool Server::setup(StratumServer* sserver) {
     }
   }
 
-  base_ = event_base_new();
-  if(!base_) {
-    LOG(ERROR) << "server: cannot create base";
-    return false;
-  }
+  return setupInternal(sserver);
+}
 
-  memset(&sin_, 0, sizeof(sin_));
-  sin_.sin_family = AF_INET;
-  sin_.sin_port   = htons(sserver->port_);
-  sin_.sin_addr.s_addr = htonl(INADDR_ANY);
-  const char* ip = sserver->ip_.c_str();
-  if (ip && inet_pton(AF_INET, ip, &sin_.sin_addr) == 0) {
-    LOG(ERROR) << "invalid ip: " << ip;
-    return false;
+void Server::run() {
+  if (eventLoops_.empty()) {
+    return;
   }
 
-  listener_ = evconnlistener_new_bind(base_,
-                                      Server::listenerCallback,
-                                      (void*)this,
-                                      LEV_OPT_REUSEABLE|LEV_OPT_CLOSE_ON_FREE,
-                                      -1, (struct sockaddr*)&sin_, sizeof(sin_));
-  if(!listener_) {
-    LOG(ERROR) << "cannot create listener: " << ip << ":" << sserver->port_;
-    return false;
+  // the first loop runs in the caller's thread
+  for (size_t i = 1; i < eventLoops_.size(); i++) {
+    eventLoopThreads_.push_back(thread(&ServerEventLoop::run, eventLoops_[i].get()));
   }
-  return setupInternal(sserver);
-}
+  eventLoops_[0]->run();
 
-void Server::run() {
-  if(base_ != NULL) {
-    //    event_base_loop(base_, EVLOOP_NONBLOCK);
-    event_base_dispatch(base_);
+  for (auto &t : eventLoopThreads_) {
+    if (t.joinable())
+      t.join();
   }
+  eventLoopThreads_.clear();
 }
 
 void Server::stop() {
-  LOG(INFO) << "stop tcp server event loop";
-  event_base_loopexit(base_, NULL);
+  LOG(INFO) << "stop tcp server event loops";
+  for (auto &loop : eventLoops_) {
+    loop->stop();
+  }
 
   jobRepository_->stop();
   userInfo_->stop();
 }
 
 void Server::sendMiningNotifyToAll(shared_ptr<StratumJobEx> exJobPtr) {
-  //
-  // http://www.sgi.com/tech/stl/Map.html
-  //
-  // Map has the important property that inserting a new element into a map
-  // does not invalidate iterators that point to existing elements. Erasing
-  // an element from a map also does not invalidate any iterators, except,
-  // of course, for iterators that actually point to the element that is
-  // being erased.
-  //
-
-  ScopeLock sl(connsLock_);
-  auto itr = connections_.begin();
-  while (itr != connections_.end()) {
-    auto &conn = *itr;
-    if (conn->isDead()) {
-#ifndef WORK_WITH_STRATUM_SWITCHER
-      sessionIDManager_->freeSessionId(conn->getSessionId());
-#endif
-      itr = connections_.erase(itr);
-    } else {
-      conn->sendMiningNotify(exJobPtr);
-      ++itr;
-    }
+  // each loop walks its own sessions in its own thread
+  for (auto &loop : eventLoops_) {
+    loop->postMiningNotify(exJobPtr);
   }
 }
 
-void Server::addConnection(unique_ptr<StratumSession> connection) {
-  ScopeLock sl(connsLock_);
-  connections_.insert(move(connection));
-}
-
 void Server::removeConnection(StratumSession &connection) {
   //
   // if we are here, means the related evbuffer has already been locked.
@@ -923,50 +1229,10 @@ void Server::removeConnection(StratumSession &connection) {
   connection.markAsDead();
 }
 
-void Server::listenerCallback(struct evconnlistener* listener,
-                              evutil_socket_t fd,
-                              struct sockaddr *saddr,
-                              int socklen, void* data)
-{
-  Server *server = static_cast<Server *>(data);
-  struct event_base  *base = (struct event_base*)server->base_;
-  struct bufferevent *bev;
-  uint32_t sessionID = 0u;
-
-#ifndef WORK_WITH_STRATUM_SWITCHER
-  // can't alloc session Id
-  if (server->sessionIDManager_->allocSessionId(&sessionID) == false) {
-    close(fd);
-    return;
-  }
-#endif
-
-  bev = bufferevent_socket_new(base, fd, BEV_OPT_CLOSE_ON_FREE|BEV_OPT_THREADSAFE);
-  if(bev == nullptr) {
-    LOG(ERROR) << "error constructing bufferevent!";
-    server->stop();
-    return;
-  }
-
-  // create stratum session
-  auto conn = server->createConnection(bev, saddr, sessionID);
-  if (!conn->initialize())
-  {
-    return;
-  }
-  // set callback functions
-  bufferevent_setcb(bev,
-                    Server::readCallback, nullptr,
-                    Server::eventCallback, conn.get());
-  // By default, a newly created bufferevent has writing enabled.
-  bufferevent_enable(bev, EV_READ|EV_WRITE);
-
-  server->addConnection(move(conn));
-}
-
 void Server::readCallback(struct bufferevent* bev, void *connection) {
   auto conn = static_cast<StratumSession *>(connection);
   conn->readBuf(bufferevent_get_input(bev));
+  QuiescentState::quiescent();
 }
 
 void Server::eventCallback(struct bufferevent* bev, short events,
@@ -995,6 +1261,12 @@ void Server::eventCallback(struct bufferevent* bev, short events,
 
 
 void Server::sendShare2Kafka(const uint8_t *data, size_t len) {
+  // shares of the sessions are batched by their event loop
+  ServerEventLoop *loop = ServerEventLoop::current();
+  if (shareBatchSize_ > 0 && loop != nullptr) {
+    loop->addShare(data, len);
+    return;
+  }
   kafkaProducerShareLog_->produce(data, len);
 }
 
@@ -27,6 +27,8 @@
 #include "Common.h"
 
 #include "Kafka.h"
+#include "QuiescentState.h"
+#include "ShareBatch.h"
 #include "Stratum.h"
 
 #include <bitset>
@@ -116,6 +118,19 @@ protected:
   mutex lock_;
   std::map<uint64_t /* jobId */, shared_ptr<StratumJobEx>> exJobs_;
 
+  // A read-only copy of exJobs_, it's looked up by getStratumJobEx() for
+  // every share, so readers must not wait for lock_. The consume thread
+  // builds a new snapshot whenever exJobs_ changes and swaps the pointer
+  // (RCU). A replaced snapshot is freed when all readers (the event loops
+  // and share checking threads) have passed a quiescent state since then,
+  // see QuiescentState.
+  struct JobsSnapshot {
+    vector<uint64_t> jobIds_;  // sorted
+    vector<shared_ptr<StratumJobEx>> jobs_;
+  };
+  atomic<const JobsSnapshot *> jobsSnapshot_;
+  std::deque<std::pair<QuiescentState::Token, const JobsSnapshot *>> retiredSnapshots_;
+
   KafkaConsumer kafkaConsumer_; // consume topic: 'StratumJob'
   Server *server_;              // call server to send new job
 
@@ -131,8 +146,13 @@ protected:
 private:
   void runThreadConsume();
   void consumeStratumJob(rd_kafka_message_t *rkmessage);
-  void tryCleanExpiredJobs();
   void checkAndSendMiningNotify();
+  void freeRetiredSnapshots(bool all);
+
+protected:
+  void tryCleanExpiredJobs();
+  // must be called with lock_ held after exJobs_ has been changed
+  void updateJobsSnapshot();
 
 protected:
   JobRepository(const char *kafkaBrokers, const char *consumerTopic, const string &fileLastNotifyTime, Server *server);
@@ -192,17 +212,27 @@ class UserInfo {
   };
 
   //--------------------
-  pthread_rwlock_t rwlock_;
   atomic<bool> running_;
   string apiUrl_;
 
-  // username -> userId
-  std::unordered_map<string, int32_t> nameIds_;
+  // getUserId() is called for every authorize and submit, so readers look up
+  // a read-only snapshot without locking. All API deltas of a poll are applied
+  // to one copy of the current snapshot and the pointer is swapped (RCU). A replaced
+  // snapshot is freed when all readers (the event loops) have passed a
+  // quiescent state since then, see QuiescentState.
+  struct UsersSnapshot {
+    // username -> userId
+    std::unordered_map<string, int32_t> nameIds_;
+#ifdef USER_DEFINED_COINBASE
+    // userId -> userCoinbaseInfo
+    std::unordered_map<int32_t, string> idCoinbaseInfos_;
+#endif
+  };
+  atomic<const UsersSnapshot *> usersSnapshot_;
+  std::deque<std::pair<QuiescentState::Token, const UsersSnapshot *>> retiredSnapshots_;
+
   int32_t lastMaxUserId_;
-  
 #ifdef USER_DEFINED_COINBASE
-  // userId -> userCoinbaseInfo
-  std::unordered_map<int32_t, string> idCoinbaseInfos_;
   int64_t lastTime_;
 #endif
 
@@ -217,7 +247,12 @@ class UserInfo {
 
   thread threadUpdate_;
   void runThreadUpdate();
-  int32_t incrementalUpdateUsers();
+  // fetches a page of the new users and applies them to `snapshot`, which is
+  // copied from the current one on the first new user. Returns the count of
+  // them or -1 on failure.
+  int32_t incrementalUpdateUsers(UsersSnapshot *&snapshot);
+  void updateUsersSnapshot(const UsersSnapshot *snapshot);
+  void freeRetiredSnapshots(bool all);
 
 public:
   UserInfo(const string &apiUrl, Server *server);
@@ -226,6 +261,13 @@ public:
   void stop();
   bool setupThreads();
 
+  // fetches the new users from the API page by page until no more, and
+  // publishes them as one snapshot. Returns the count of them or -1 on
+  // failure, the pages fetched before a failure are still applied.
+  // Must not be called by two threads at once, it's called by the update
+  // thread after setupThreads().
+  int32_t updateUsers();
+
   int32_t getUserId(const string userName);
 
 #ifdef USER_DEFINED_COINBASE
@@ -258,15 +300,93 @@ public:
 };
 
 
+/////////////////////////////////// EventLoopContext /////////////////////////////
+// Per-loop state of a coin's server, only used in the loop's thread.
+// Created by Server::createEventLoopContext() when the loop is set up
+// and freed with the loop.
+class EventLoopContext {
+public:
+  virtual ~EventLoopContext() {}
+};
+
+/////////////////////////////////// ServerEventLoop //////////////////////////////
+//
+// A Server runs one or more event loops, each one in its own thread.
+// Every loop owns a listener bound to the same ip:port with SO_REUSEPORT,
+// so the kernel spreads new connections across the loops. A session only
+// runs on the loop which accepted it, so the loops share nothing on the
+// read / submit path.
+//
+class ServerEventLoop {
+  Server &server_;
+  struct event_base* base_;
+  struct evconnlistener* listener_;
+  struct event* notifyEvent_;
+  std::set<unique_ptr<StratumSession>> connections_;
+  mutex connsLock_;
+
+  // jobs posted by the job repository thread, sent by this loop's thread
+  std::vector<shared_ptr<StratumJobEx>> pendingJobs_;
+  mutex pendingJobsLock_;
+
+  // shares of this loop's sessions, sent to kafka as one message when it
+  // reaches Server::shareBatchSize_ bytes or kShareBatchIntervalMs_ after
+  // the first share. Only accessed in this loop's thread.
+  ShareBatch shareBatch_;
+  struct event *shareBatchTimer_;
+  static const int32_t kShareBatchIntervalMs_ = 5;
+
+  unique_ptr<EventLoopContext> context_;
+
+  // the loop's thread reads the snapshots of JobRepository and UserInfo, it
+  // is quiescent after every session's read callback and, while idle, every
+  // kQuiescentIntervalMs_
+  struct event *quiescentTimer_;
+  static const int32_t kQuiescentIntervalMs_ = 100;
+
+  // the loop running in the current thread
+  static thread_local ServerEventLoop *current_;
+
+  void sendPendingMiningNotify();
+  void flushShareBatch();
+
+public:
+  ServerEventLoop(Server &server);
+  ~ServerEventLoop();
+
+  bool setup(struct sockaddr_in &sin, bool reusePort);
+  void run();
+  void stop();
+
+  // thread-safe, wake up the loop and let it send the job to its sessions
+  void postMiningNotify(shared_ptr<StratumJobEx> exJobPtr);
+  void addConnection(unique_ptr<StratumSession> connection);
+  size_t getConnectionsCount();
+
+  static void listenerCallback(struct evconnlistener* listener,
+                               evutil_socket_t socket,
+                               struct sockaddr* saddr,
+                               int socklen, void* loop);
+  static void notifyCallback(evutil_socket_t fd, short events, void *loop);
+  static void shareBatchTimerCallback(evutil_socket_t fd, short events, void *loop);
+  static void quiescentTimerCallback(evutil_socket_t fd, short events, void *loop);
+
+  // nullptr if the current thread isn't running an event loop
+  static ServerEventLoop *current() { return current_; }
+  struct event_base *getBase() const { return base_; }
+  // nullptr if the server has no per-loop state
+  EventLoopContext *getContext() const { return context_.get(); }
+  void addShare(const uint8_t *data, size_t len);
+};
+
+
 ///////////////////////////////////// Server ///////////////////////////////////
 class Server {
   // NetIO
   struct sockaddr_in sin_;
-  struct event_base* base_;
   struct event* signal_event_;
-  struct evconnlistener* listener_;
-  std::set<unique_ptr<StratumSession>> connections_;
-  mutex connsLock_;
+  std::vector<unique_ptr<ServerEventLoop>> eventLoops_;
+  std::vector<thread> eventLoopThreads_;
 
 public:
   // kafka producers
@@ -299,6 +419,8 @@ public:
   //
   float devFixedDifficulty_;
   const int32_t kShareAvgSeconds_;
+  // max bytes of shares packed in one kafka message, 0: one share per message
+  uint32_t shareBatchSize_;
   JobRepository *jobRepository_;
   UserInfo *userInfo_;
   shared_ptr<DiffController> defaultDifficultyController_;
@@ -318,13 +440,9 @@ public:
 
   void sendMiningNotifyToAll(shared_ptr<StratumJobEx> exJobPtr);
 
-  void addConnection(unique_ptr<StratumSession> connection);
   void removeConnection(StratumSession &connection);
+  size_t getEventLoopsCount() const { return eventLoops_.size(); }
 
-  static void listenerCallback(struct evconnlistener* listener,
-                               evutil_socket_t socket,
-                               struct sockaddr* saddr,
-                               int socklen, void* server);
   static void readCallback (struct bufferevent *, void *connection);
   static void eventCallback(struct bufferevent *, short, void *connection);
 
@@ -332,6 +450,8 @@ public:
   void sendCommonEvents2Kafka(const string &message);
 
   virtual unique_ptr<StratumSession> createConnection(struct bufferevent *bev, struct sockaddr *saddr, uint32_t sessionID) = 0;
+  // called once for every event loop before it runs
+  virtual unique_ptr<EventLoopContext> createEventLoopContext(ServerEventLoop &loop) { return nullptr; }
 
 protected:
   virtual JobRepository* createJobRepository(const char *kafkaBrokers,
@@ -387,6 +507,11 @@ public:
   string shareTopic_;
   string commonEventsTopic_;
 
+  // number of event loop threads accepting & serving connections
+  uint32_t eventLoopThreads_;
+  // see Server::shareBatchSize_
+  uint32_t shareBatchSize_;
+
   StratumServer(const char *ip, const unsigned short port,
                 const char *kafkaBrokers,
                 const string &userAPIUrl,
@@ -400,7 +525,9 @@ public:
                 shared_ptr<DiffController> defaultDifficultyController,
                 const string& solvedShareTopic,
                 const string& shareTopic,
-                const string& commonEventsTopic);
+                const string& commonEventsTopic,
+                uint32_t eventLoopThreads,
+                uint32_t shareBatchSize);
   ~StratumServer();
   bool createServer(const string &type, const int32_t shareAvgSeconds, const libconfig::Config &config);
   bool init();
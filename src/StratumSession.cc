@@ -29,6 +29,7 @@
 #include "StratumServer.h"
 #include "Stratum.h"
 #include "DiffController.h"
+#include "WorkerPool.h"
 
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/split.hpp>
@@ -46,7 +47,8 @@ static const string BtccomAgentPrefix = "btccom-agent/";
 
 StratumSession::StratumSession(Server &server, struct bufferevent *bev, struct sockaddr *saddr, uint32_t extraNonce1)
     : server_(server), bev_(bev), extraNonce1_(extraNonce1), buffer_(evbuffer_new()), clientAgent_("unknown")
-    , isAgentClient_(false), isNiceHashClient_(false), state_(CONNECTED), isDead_(false), isLongTimeout_(false) {
+    , isAgentClient_(false), isNiceHashClient_(false), state_(CONNECTED), isDead_(false), isLongTimeout_(false)
+    , asyncTasks_(0) {
   assert(saddr->sa_family == AF_INET);
   auto ipv4 = reinterpret_cast<struct sockaddr_in *>(saddr);
   clientIpInt_ = ipv4->sin_addr.s_addr;
@@ -345,6 +347,16 @@ void StratumSession::markAsDead() {
   }
 }
 
+void StratumSession::finishAsyncTask(std::function<void()> callback) {
+  auto task = [this, callback]() {
+    callback();
+    asyncTasks_--;
+  };
+  if (!runInEventLoop(bufferevent_get_base(bev_), task)) {
+    LOG(ERROR) << "cannot finish async task of session " << extraNonce1_;
+  }
+}
+
 void StratumSession::sendData(const char *data, size_t len) {
   // add data to a bufferevent’s output buffer
   // it is automatically locked so we don't need to lock
@@ -352,6 +364,34 @@ void StratumSession::sendData(const char *data, size_t len) {
   DLOG(INFO) << "send(" << len << ") to " << worker_.fullName_ << " : " << data;
 }
 
+void StratumSession::sendData(const std::string &prefix, const char *data, size_t len,
+                              shared_ptr<const void> owner) {
+  // keep the two parts together if another thread is writing
+  bufferevent_lock(bev_);
+  bufferevent_write(bev_, prefix.data(), prefix.size());
+  if (!addDataReference(bufferevent_get_output(bev_), data, len, std::move(owner))) {
+    LOG(ERROR) << "add data reference to the output buffer of session " << extraNonce1_ << " failed";
+  }
+  bufferevent_unlock(bev_);
+  DLOG(INFO) << "send(" << prefix.size() + len << ") to " << worker_.fullName_ << " : "
+             << prefix << string(data, len);
+}
+
+static void releaseDataReference(const void *data, size_t len, void *owner) {
+  delete static_cast<shared_ptr<const void> *>(owner);
+}
+
+bool StratumSession::addDataReference(struct evbuffer *buf, const char *data, size_t len,
+                                      shared_ptr<const void> owner) {
+  // released by libevent when the data is drained or the buffer is freed
+  auto ownerRef = new shared_ptr<const void>(std::move(owner));
+  if (evbuffer_add_reference(buf, data, len, releaseDataReference, ownerRef) != 0) {
+    delete ownerRef;
+    return false;
+  }
+  return true;
+}
+
 void StratumSession::readBuf(struct evbuffer *buf) {
   // moves all data from src to the end of dst
   evbuffer_add_buffer(buffer_, buf);
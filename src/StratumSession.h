@@ -113,6 +113,8 @@ protected:
   StratumWorker worker_;
   std::atomic<bool> isDead_;
   bool isLongTimeout_;
+  // tasks running outside of the event loop, only accessed in the event loop
+  uint32_t asyncTasks_;
 
   void setup();
   void setReadTimeout(int32_t readTimeout);
@@ -146,10 +148,27 @@ public:
   State getState() const { return state_; }
   bool isDead() const;
   void markAsDead();
+
+  // A task running in another thread (eg. share checking) should be started
+  // by beginAsyncTask() and ended by finishAsyncTask(), then the callback will
+  // be run in the event loop of the session. A dead session will not be freed
+  // until all its async tasks are finished.
+  void beginAsyncTask() { asyncTasks_++; }
+  void finishAsyncTask(std::function<void()> callback);  // thread-safe
+  // ends a task which was run by the session's event loop itself
+  void endAsyncTask() { asyncTasks_--; }
+  bool hasAsyncTasks() const { return asyncTasks_ > 0; }
   void addWorker(const std::string &clientAgent, const std::string &workerName, int64_t workerId) override;
 
   void sendData(const char *data, size_t len) override;
   void sendData(const std::string &str) override { sendData(str.data(), str.size()); }
+  // Send `prefix` and then `len` bytes of `data`. `data` is not copied,
+  // `owner` keeps it alive until it has been written to the socket, so one
+  // buffer (eg. a part of mining.notify) can be shared by all sessions.
+  void sendData(const std::string &prefix, const char *data, size_t len,
+                shared_ptr<const void> owner);
+  static bool addDataReference(struct evbuffer *buf, const char *data, size_t len,
+                               shared_ptr<const void> owner);
   void readBuf(struct evbuffer *buf);
 
   void responseTrue(const std::string &idStr) override;
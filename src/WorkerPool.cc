@@ -0,0 +1,109 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) [2016] [BTC.COM]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+#include "WorkerPool.h"
+#include "QuiescentState.h"
+
+#include <glog/logging.h>
+
+
+///////////////////////////////// WorkerPool ///////////////////////////////////
+WorkerPool::WorkerPool(size_t threadsCount) : running_(true) {
+  for (size_t i = 0; i < threadsCount; i++) {
+    threads_.push_back(thread(&WorkerPool::runThread, this));
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  stop();
+}
+
+void WorkerPool::stop() {
+  {
+    ScopeLock sl(lock_);
+    if (!running_) {
+      return;
+    }
+    running_ = false;
+  }
+  cond_.notify_all();
+
+  for (auto &t : threads_) {
+    if (t.joinable()) {
+      t.join();
+    }
+  }
+  tasks_.clear();
+}
+
+bool WorkerPool::post(std::function<void()> task) {
+  {
+    ScopeLock sl(lock_);
+    if (!running_) {
+      return false;
+    }
+    tasks_.push_back(std::move(task));
+  }
+  cond_.notify_one();
+  return true;
+}
+
+void WorkerPool::runThread() {
+  // tasks may read the snapshots of the job repository
+  QuiescentReader reader;
+  while (true) {
+    std::function<void()> task;
+    {
+      UniqueLock ul(lock_);
+      if (tasks_.empty()) {
+        QuiescentState::offline();
+      }
+      cond_.wait(ul, [this] { return !running_ || !tasks_.empty(); });
+      if (!running_) {
+        return;
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    QuiescentState::online();
+    task();
+    QuiescentState::quiescent();
+  }
+}
+
+
+static void runInEventLoopCallback(evutil_socket_t fd, short events, void *ptr) {
+  std::unique_ptr<std::function<void()>> task(static_cast<std::function<void()> *>(ptr));
+  (*task)();
+}
+
+bool runInEventLoop(struct event_base *base, std::function<void()> task) {
+  auto ptr = new std::function<void()>(std::move(task));
+  struct timeval tv = {0, 0};
+  if (event_base_once(base, -1, EV_TIMEOUT, runInEventLoopCallback, ptr, &tv) != 0) {
+    LOG(ERROR) << "event_base_once failed";
+    delete ptr;
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,113 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) [2016] [BTC.COM]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+#ifndef WORKER_POOL_H_
+#define WORKER_POOL_H_
+
+#include "Common.h"
+
+#include <deque>
+#include <functional>
+
+#include <event2/event.h>
+
+
+///////////////////////////////// WorkerPool ///////////////////////////////////
+// A fixed number of threads running tasks from a shared queue.
+// Used to move CPU heavy work (eg. share checking) off the event loops.
+// The threads are QuiescentState readers, quiescent between tasks.
+class WorkerPool {
+  atomic<bool> running_;
+  mutex lock_;
+  Condition cond_;
+  std::deque<std::function<void()>> tasks_;
+  vector<thread> threads_;
+
+  void runThread();
+
+public:
+  explicit WorkerPool(size_t threadsCount);
+  ~WorkerPool();
+
+  // thread-safe, false if the pool has been stopped and `task` is dropped
+  bool post(std::function<void()> task);
+  // tasks not started yet will be dropped
+  void stop();
+
+  size_t getThreadsCount() const { return threads_.size(); }
+};
+
+///////////////////////////////// BoundedQueue ///////////////////////////////////
+// A blocking queue with a capacity, connects a producer thread to
+// consumer threads without buffering unlimited data.
+template <class T>
+class BoundedQueue {
+  const size_t capacity_;
+  bool closed_;
+  mutex lock_;
+  Condition notEmpty_;
+  Condition notFull_;
+  std::deque<T> items_;
+
+public:
+  explicit BoundedQueue(size_t capacity) : capacity_(capacity), closed_(false) {}
+
+  // blocks if the queue is full, false if the queue has been closed
+  bool push(T item) {
+    unique_lock<mutex> l(lock_);
+    notFull_.wait(l, [this] { return closed_ || items_.size() < capacity_; });
+    if (closed_)
+      return false;
+
+    items_.push_back(std::move(item));
+    notEmpty_.notify_one();
+    return true;
+  }
+
+  // blocks if the queue is empty, false if it has been closed and drained
+  bool pop(T &item) {
+    unique_lock<mutex> l(lock_);
+    notEmpty_.wait(l, [this] { return closed_ || !items_.empty(); });
+    if (items_.empty())
+      return false;
+
+    item = std::move(items_.front());
+    items_.pop_front();
+    notFull_.notify_one();
+    return true;
+  }
+
+  // the remaining items can still be popped
+  void close() {
+    lock_guard<mutex> l(lock_);
+    closed_ = true;
+    notEmpty_.notify_all();
+    notFull_.notify_all();
+  }
+};
+
+// Run `task` in the thread of `base`'s event loop, thread-safe.
+// Requires evthread_use_pthreads() to be called before `base` was created.
+bool runInEventLoop(struct event_base *base, std::function<void()> task);
+
+#endif
@@ -33,6 +33,25 @@ std::string EncodeHexBlock(const CBlock &block) {
   ssBlock << block;
   return HexStr(ssBlock.begin(), ssBlock.end());
 }
+std::string EncodeHexTxs(const std::vector<CTransactionRef> &vtxs) {
+  CDataStream ssTxs(SER_NETWORK, PROTOCOL_VERSION);
+  for (const auto &tx : vtxs) {
+    ssTxs << tx;
+  }
+  return HexStr(ssTxs.begin(), ssTxs.end());
+}
+std::string EncodeHexBlock(const CBlockHeader &header, const CTransactionRef &coinbaseTx,
+                           size_t txsCount, const std::string &txsHex) {
+  CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
+  ssBlock << header;
+  WriteCompactSize(ssBlock, txsCount + 1);  // with the coinbase tx
+  ssBlock << coinbaseTx;
+
+  std::string blockHex = HexStr(ssBlock.begin(), ssBlock.end());
+  blockHex.reserve(blockHex.size() + txsHex.size());
+  blockHex += txsHex;
+  return blockHex;
+}
 std::string EncodeHexBlockHeader(const CBlockHeader &blkHeader) {
   CDataStream ssBlkHeader(SER_NETWORK, PROTOCOL_VERSION);
   ssBlkHeader << blkHeader;
@@ -27,6 +27,7 @@
 #include <string>
 
 #include <core_io.h>
+#include <primitives/block.h>
 // #include <streams.h>
 #include <amount.h>
 #include <chainparams.h>
@@ -94,6 +95,13 @@
 #endif
 
 std::string EncodeHexBlock(const CBlock &block);
+// hex of the serialized transactions, in the same encoding as they are in a block
+std::string EncodeHexTxs(const std::vector<CTransactionRef> &vtxs);
+// the same as EncodeHexBlock(), but the transactions after the coinbase tx
+// are already encoded by EncodeHexTxs(), so only the header, the tx count and
+// the coinbase tx are encoded here.
+std::string EncodeHexBlock(const CBlockHeader &header, const CTransactionRef &coinbaseTx,
+                           size_t txsCount, const std::string &txsHex);
 std::string EncodeHexBlockHeader(const CBlockHeader &blkHeader);
 
 int64_t GetBlockReward(int nHeight, const Consensus::Params& consensusParams);
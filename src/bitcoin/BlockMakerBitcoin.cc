@@ -122,6 +122,16 @@ bool BlockMakerBitcoin::init() {
     return false;
   }
 
+  //
+  // Block Submitter
+  //
+  blockSubmitter_.reset(new BlockSubmitter(def()->nodes,
+    "{\"jsonrpc\":\"1.0\",\"id\":\"1\",\"method\":\"getblockcount\",\"params\":[]}"));
+  if (!blockSubmitter_->init()) {
+    LOG(WARNING) << "block submitter init failed, submit blocks with threads";
+    blockSubmitter_.reset();
+  }
+
   return true;
 }
 
@@ -201,24 +211,31 @@ void BlockMakerBitcoin::addRawgbt(const char *str, size_t len) {
     vtxs->push_back(MakeTransactionRef(std::move(tx)));
   }
 
-  LOG(INFO) << "insert rawgbt: " << gbtHash.ToString() << ", txs: " << vtxs->size();
-  insertRawGbt(gbtHash, vtxs);
+  // encode the txs now, it's too late when a block is found
+  auto vtxsHex = std::make_shared<const string>(EncodeHexTxs(*vtxs));
+
+  LOG(INFO) << "insert rawgbt: " << gbtHash.ToString() << ", txs: " << vtxs->size()
+            << ", txs size: " << vtxsHex->size() / 2;
+  insertRawGbt(gbtHash, vtxs, vtxsHex);
 }
 
 void BlockMakerBitcoin::insertRawGbt(const uint256 &gbtHash,
-                              shared_ptr<vector<CTransactionRef>> vtxs) {
+                              shared_ptr<vector<CTransactionRef>> vtxs,
+                              shared_ptr<const string> vtxsHex) {
   ScopeLock ls(rawGbtLock_);
 
   // insert rawgbt
   rawGbtMap_[gbtHash] = vtxs;
+  rawGbtTxsHexMap_[gbtHash] = vtxsHex;
   rawGbtQ_.push_back(gbtHash);
 
   // remove rawgbt if need
   while (rawGbtQ_.size() > kMaxRawGbtNum_) {
     const uint256 h = *rawGbtQ_.begin();
 
-    rawGbtMap_.erase(h);   // delete from map
-    rawGbtQ_.pop_front();  // delete from Q
+    rawGbtMap_.erase(h);       // delete from map
+    rawGbtTxsHexMap_.erase(h);
+    rawGbtQ_.pop_front();      // delete from Q
   }
 }
 
@@ -519,6 +536,7 @@ void BlockMakerBitcoin::processSolvedShare(rd_kafka_message_t *rkmessage) {
   // get gbtHash and rawgbt (vtxs)
   uint256 gbtHash;
   shared_ptr<vector<CTransactionRef>> vtxs;
+  shared_ptr<const string> vtxsHex;
   {
     ScopeLock sl(jobIdMapLock_);
     if (jobId2GbtHash_.find(foundBlock.jobId_) != jobId2GbtHash_.end()) {
@@ -546,7 +564,9 @@ void BlockMakerBitcoin::processSolvedShare(rd_kafka_message_t *rkmessage) {
       return;
     }
     vtxs = rawGbtMap_[gbtHash];
+    vtxsHex = rawGbtTxsHexMap_[gbtHash];
     assert(vtxs.get() != nullptr);
+    assert(vtxsHex.get() != nullptr);
   }
 
   //
@@ -563,13 +583,11 @@ void BlockMakerBitcoin::processSolvedShare(rd_kafka_message_t *rkmessage) {
     c >> newblk.vtx[newblk.vtx.size() - 1];
   }
 
-  // put other txs
-  if (vtxs && vtxs->size()) {
-    newblk.vtx.insert(newblk.vtx.end(), vtxs->begin(), vtxs->end());
-  }
-
   // submit to bitcoind
-  const string blockHex = EncodeHexBlock(newblk);
+  // other txs are already encoded in vtxsHex, the same as EncodeHexBlock(newblk)
+  // with vtxs put after the coinbase tx.
+  const string blockHex = vtxs ? EncodeHexBlock(newblk, newblk.vtx[0], vtxs->size(), *vtxsHex)
+                               : EncodeHexBlock(newblk);
 #ifdef CHAIN_TYPE_BCH
   if(lightVersion)
   {
@@ -654,6 +672,18 @@ bool BlockMakerBitcoin::checkBitcoinds() {
 }
 
 void BlockMakerBitcoin::submitBlockNonBlocking(const string &blockHex) {
+  if (blockSubmitter_) {
+    auto request = std::make_shared<string>();
+    request->reserve(blockHex.size() + 80);
+    *request = "{\"jsonrpc\":\"1.0\",\"id\":\"1\",\"method\":\"submitblock\",\"params\":[\"";
+    *request += blockHex;
+    *request += "\"]}";
+
+    LOG(INFO) << "submit block to " << blockSubmitter_->getNodesCount() << " nodes";
+    blockSubmitter_->submit(request);
+    return;
+  }
+
   for (const auto &itr : def()->nodes) {
     // use thread to submit
     boost::thread t(boost::bind(&BlockMakerBitcoin::_submitBlockThread, this,
@@ -688,6 +718,20 @@ void BlockMakerBitcoin::_submitBlockThread(const string &rpcAddress,
 
 #ifdef CHAIN_TYPE_BCH
 void BlockMakerBitcoin::submitBlockLightNonBlocking(const string &blockHex, const string& job_id) {
+  if (blockSubmitter_) {
+    auto request = std::make_shared<string>();
+    request->reserve(blockHex.size() + job_id.size() + 80);
+    *request = "{\"jsonrpc\":\"1.0\",\"id\":\"1\",\"method\":\"submitblocklight\",\"params\":[\"";
+    *request += blockHex;
+    *request += "\", \"";
+    *request += job_id;
+    *request += "\"]}";
+
+    LOG(INFO) << "submit block light to " << blockSubmitter_->getNodesCount() << " nodes";
+    blockSubmitter_->submit(request);
+    return;
+  }
+
   for (const auto &itr : def()->nodes) {
     // use thread to submit
     boost::thread t(boost::bind(&BlockMakerBitcoin::_submitBlockLightThread, this,
@@ -25,6 +25,7 @@
 #define BLOCK_MAKER_BITCOIN_H_
 
 #include "BlockMaker.h"
+#include "BlockSubmitter.h"
 #include "StratumBitcoin.h"
 
 #include <uint256.h>
@@ -99,6 +100,9 @@ protected:
   std::deque<uint256> rawGbtQ_;
   // key: gbthash, value: block template json
   std::map<uint256, shared_ptr<vector<CTransactionRef>>> rawGbtMap_;
+  // key: gbthash, value: EncodeHexTxs() of the transactions in rawGbtMap_,
+  // so only the header and the coinbase tx are encoded when a block is found.
+  std::map<uint256, shared_ptr<const string>> rawGbtTxsHexMap_;
 
   mutex jobIdMapLock_;
   size_t kMaxStratumJobNum_;
@@ -114,7 +118,8 @@ protected:
   KafkaConsumer kafkaConsumerRskSolvedShare_;
 
   void insertRawGbt(const uint256 &gbtHash,
-                    shared_ptr<vector<CTransactionRef>> vtxs);
+                    shared_ptr<vector<CTransactionRef>> vtxs,
+                    shared_ptr<const string> vtxsHex);
 
   thread threadConsumeRawGbt_;
   thread threadConsumeStratumJob_;
@@ -123,6 +128,10 @@ protected:
 
   std::map<std::string/*rpcaddr*/, bool/*isSupportSubmitAuxBlock*/> isAddrSupportSubmitAux_;
 
+  // submit blocks to all bitcoinds at once, nullptr if it's not supported
+  // by the rpc addresses, then a thread is started for every submission.
+  unique_ptr<BlockSubmitter> blockSubmitter_;
+
   void runThreadConsumeRawGbt();
   void runThreadConsumeStratumJob();
   void runThreadConsumeNamecoinSolvedShare();
@@ -23,6 +23,7 @@
  */
 
 #include "CommonBitcoin.h"
+#include "LockFreeCache.h"
 #include <arith_uint256.h>
 
 uint64_t TargetToDiff(uint256 &target) {
@@ -92,22 +93,35 @@ static std::array<uint256, 64> GenerateDiff2TargetTable() {
 
 static const auto kDiff2TargetTable = GenerateDiff2TargetTable();
 
+// Shared by all threads of sserver, statshttpd and slparser. Only a handful
+// of difficulties and nBits are seen at the same time, so 64 slots are enough.
+static LockFreeCache<uint256, 64> gDiff2TargetCache;
+static LockFreeCache<double, 64> gBits2DiffCache;
+
 void DiffToTarget(uint64_t diff, uint256 &target, bool useTable) {
   if (useTable) {
-    // try to find by table
-    const uint64_t p = (uint64_t)log2(diff);
-    if (p < (sizeof(kDiff2TargetTable)/sizeof(kDiff2TargetTable[0])) &&
-        diff == (1ull << p)) {
-      target = kDiff2TargetTable[p];
+    // vardiff only uses powers of 2, the shift table covers all of them
+    if (diff != 0 && (diff & (diff - 1)) == 0) {
+      target = kDiff2TargetTable[__builtin_ctzll(diff)];
+      return;
+    }
+    if (gDiff2TargetCache.get(diff, target)) {
       return;
     }
   }
 
-  // if we use the above table, it's big enough, we don't need to calc anymore
   BitsToTarget(_DiffToBits(diff), target);
+
+  if (useTable) {
+    gDiff2TargetCache.put(diff, target);
+  }
 }
 
-void BitsToDifficulty(uint32_t bits, double *difficulty) {
+void BitsToDifficulty(uint32_t bits, double *difficulty, bool useCache) {
+  if (useCache && gBits2DiffCache.get(bits, *difficulty)) {
+    return;
+  }
+
   uint32_t nShift = (bits >> 24) & 0xff;
   double dDiff = (double)0x0000ffff / (double)(bits & 0x00ffffff);
   while (nShift < SHIFTS_DIFF1) {
@@ -119,10 +133,14 @@ void BitsToDifficulty(uint32_t bits, double *difficulty) {
     nShift--;
   }
   *difficulty = dDiff;
+
+  if (useCache) {
+    gBits2DiffCache.put(bits, dDiff);
+  }
 }
 
-void BitsToDifficulty(uint32_t bits, uint64_t *difficulty) {
+void BitsToDifficulty(uint32_t bits, uint64_t *difficulty, bool useCache) {
   double diff;
-  BitsToDifficulty(bits, &diff);
+  BitsToDifficulty(bits, &diff, useCache);
   *difficulty = (uint64_t)diff;
 }
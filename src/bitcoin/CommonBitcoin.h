@@ -33,9 +33,11 @@ uint64_t TargetToDiff(uint256 &target);
 uint64_t TargetToDiff(const string &str);
 
 void BitsToTarget(uint32_t bits, uint256 & target);
+// useTable: look up the power-of-2 shift table and the process-wide cache
 void DiffToTarget(uint64_t diff, uint256 & target, bool useTable=true);
-void BitsToDifficulty(uint32_t bits, double *difficulty);
-void BitsToDifficulty(uint32_t bits, uint64_t *difficulty);
+// useCache: look up the process-wide cache
+void BitsToDifficulty(uint32_t bits, double *difficulty, bool useCache=true);
+void BitsToDifficulty(uint32_t bits, uint64_t *difficulty, bool useCache=true);
 
 ////////////////////////////// for Bitcoin //////////////////////////////
 
@@ -170,11 +170,13 @@ string GbtMaker::makeRawGbtMsg() {
       r["result"]["bits"].type()              != Utilities::JS::type::Str ||
       r["result"]["mintime"].type()           != Utilities::JS::type::Int ||
       r["result"]["curtime"].type()           != Utilities::JS::type::Int ||
-      r["result"]["version"].type()           != Utilities::JS::type::Int) {
+      r["result"]["version"].type()           != Utilities::JS::type::Int ||
+      r["result"]["transactions"].type()      != Utilities::JS::type::Array) {
     LOG(ERROR) << "gbt check fields failure";
     return "";
   }
   const uint256 gbtHash = Hash(gbt.begin(), gbt.end());
+  const uint32_t txCount = r["result"]["transactions"].array().size();
 
   LOG(INFO) << "gbt height: " << r["result"]["height"].uint32()
   << ", prev_hash: "          << r["result"]["previousblockhash"].str()
@@ -183,12 +185,25 @@ string GbtMaker::makeRawGbtMsg() {
   << ", mintime: " << r["result"]["mintime"].uint32()
   << ", version: " << r["result"]["version"].uint32()
   << "|0x" << Strings::Format("%08x", r["result"]["version"].uint32())
+  << ", tx_count: " << txCount
   << ", gbthash: " << gbtHash.ToString();
 
+  // the header fields let jobmaker select the best gbt
+  // without decoding and parsing the whole template.
   return Strings::Format("{\"created_at_ts\":%u,"
+                         "\"height\":%u,"
+                         "\"prevhash\":\"%s\","
+                         "\"bits\":\"%s\","
+                         "\"tx_count\":%u,"
+                         "\"is_empty_block\":%s,"
                          "\"block_template_base64\":\"%s\","
                          "\"gbthash\":\"%s\"}",
-                         (uint32_t)time(nullptr), EncodeBase64(gbt).c_str(),
+                         (uint32_t)time(nullptr),
+                         r["result"]["height"].uint32(),
+                         r["result"]["previousblockhash"].str().c_str(),
+                         r["result"]["bits"].str().c_str(),
+                         txCount, txCount == 0 ? "true" : "false",
+                         EncodeBase64(gbt).c_str(),
                          gbtHash.ToString().c_str());
 //  return Strings::Format("{\"created_at_ts\":%u,"
 //                         "\"gbthash\":\"%s\"}",
@@ -268,10 +283,21 @@ string GbtMaker::makeRawGbtLightMsg() {
             << "|0x" << Strings::Format("%08x", r["result"]["version"].uint32())
             << ", gbthash: " << gbtHash.ToString();
 
+  const bool isEmptyBlock = r["result"]["merkle"].type() != Utilities::JS::type::Array ||
+                            r["result"]["merkle"].array().size() == 0;
   string result = Strings::Format("{\"created_at_ts\":%u,"
+                         "\"height\":%u,"
+                         "\"prevhash\":\"%s\","
+                         "\"bits\":\"%s\","
+                         "\"is_empty_block\":%s,"
                          "\"block_template_base64\":\"%s\","
                          "\"gbthash\":\"%s\"}",
-                         (uint32_t)time(nullptr), EncodeBase64(gbt).c_str(),
+                         (uint32_t)time(nullptr),
+                         r["result"]["height"].uint32(),
+                         r["result"]["previousblockhash"].str().c_str(),
+                         r["result"]["bits"].str().c_str(),
+                         isEmptyBlock ? "true" : "false",
+                         EncodeBase64(gbt).c_str(),
                          gbtHash.ToString().c_str());
   LOG(INFO) << "makeRawGbtLightMsg result: " << result.c_str();
 
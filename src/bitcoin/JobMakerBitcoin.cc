@@ -44,6 +44,94 @@
 #include "utilities_js.hpp"
 #include "Utils.h"
 
+////////////////////////////////GbtTemplateBitcoin//////////////////////////////////
+GbtTemplateBitcoin::GbtTemplateBitcoin()
+  : parsed_(false)
+  , createdAt_(0)
+  , height_(0)
+  , isEmptyBlock_(false)
+  , hasHeader_(false)
+{
+}
+
+bool GbtTemplateBitcoin::initFromRawGbtMsg(const string &msg) {
+  JsonNode r;
+  if (!JsonNode::parse(msg.c_str(), msg.c_str() + msg.size(), r)) {
+    LOG(ERROR) << "parse rawgbt message to json fail";
+    return false;
+  }
+
+  if (r["created_at_ts"].type()         != Utilities::JS::type::Int ||
+      r["block_template_base64"].type() != Utilities::JS::type::Str ||
+      r["gbthash"].type()               != Utilities::JS::type::Str) {
+    LOG(ERROR) << "invalid rawgbt: missing fields";
+    return false;
+  }
+
+  gbtHash_   = uint256S(r["gbthash"].str());
+  createdAt_ = r["created_at_ts"].uint32();
+  gbtBase64_ = r["block_template_base64"].str();
+
+  // added by the new gbtmaker, so the template need not to be parsed here
+  if (r["height"].type()         == Utilities::JS::type::Int &&
+      r["is_empty_block"].type() == Utilities::JS::type::Bool) {
+    height_       = r["height"].uint32();
+    isEmptyBlock_ = r["is_empty_block"].boolean();
+    hasHeader_    = true;
+  }
+
+  return true;
+}
+
+bool GbtTemplateBitcoin::parse() {
+  if (parsed_) {
+    return true;
+  }
+
+  gbt_ = DecodeBase64(gbtBase64_);
+  if (gbt_.length() <= 64) {  // valid gbt string's len at least 64 bytes
+    LOG(ERROR) << "invalid gbt, length: " << gbt_.length();
+    return false;
+  }
+
+  if (!JsonNode::parse(gbt_.c_str(), gbt_.c_str() + gbt_.length(), json_)) {
+    LOG(ERROR) << "parse gbt message to json fail";
+    return false;
+  }
+
+  JsonNode jgbt = json_["result"];
+  if (jgbt["height"].type() != Utilities::JS::type::Int) {
+    LOG(ERROR) << "invalid gbt: missing height";
+    return false;
+  }
+  height_ = jgbt["height"].uint32();
+
+#ifdef CHAIN_TYPE_BCH
+  bool isLightVersion = jgbt["job_id"].type() == Utilities::JS::type::Str;
+  if(isLightVersion)
+  {
+    if (jgbt["merkle"].type() != Utilities::JS::type::Array) {
+      LOG(ERROR) << "invalid gbt light: missing merkle";
+      return false;
+    }
+    isEmptyBlock_ = jgbt["merkle"].array().size() == 0;
+  }
+  else
+#endif
+  {
+    if (jgbt["transactions"].type() != Utilities::JS::type::Array) {
+      LOG(ERROR) << "invalid gbt: missing transactions";
+      return false;
+    }
+    isEmptyBlock_ = jgbt["transactions"].array().size() == 0;
+  }
+
+  // the base64 string is useless now
+  string().swap(gbtBase64_);
+  parsed_ = true;
+  return true;
+}
+
 ////////////////////////////////JobMakerHandlerBitcoin//////////////////////////////////
 JobMakerHandlerBitcoin::JobMakerHandlerBitcoin() 
   : currBestHeight_(0)
@@ -165,20 +253,12 @@ bool JobMakerHandlerBitcoin::initConsumerHandlers(const string &kafkaBrokers, ve
 }
 
 bool JobMakerHandlerBitcoin::addRawGbt(const string &msg) {
-  JsonNode r;
-  if (!JsonNode::parse(msg.c_str(), msg.c_str() + msg.size(), r)) {
-    LOG(ERROR) << "parse rawgbt message to json fail";
-    return false;
-  }
-
-  if (r["created_at_ts"].type()         != Utilities::JS::type::Int ||
-      r["block_template_base64"].type() != Utilities::JS::type::Str ||
-      r["gbthash"].type()               != Utilities::JS::type::Str) {
-    LOG(ERROR) << "invalid rawgbt: missing fields";
+  auto gbtTemplate = std::make_shared<GbtTemplateBitcoin>();
+  if (!gbtTemplate->initFromRawGbtMsg(msg)) {
     return false;
   }
 
-  const uint256 gbtHash = uint256S(r["gbthash"].str());
+  const uint256 &gbtHash = gbtTemplate->gbtHash_;
   for (const auto &itr : lastestGbtHash_) {
     if (gbtHash == itr) {
       LOG(ERROR) << "duplicate gbt hash: " << gbtHash.ToString();
@@ -186,7 +266,7 @@ bool JobMakerHandlerBitcoin::addRawGbt(const string &msg) {
     }
   }
 
-  const uint32_t gbtTime = r["created_at_ts"].uint32();
+  const uint32_t gbtTime = gbtTemplate->createdAt_;
   const int64_t timeDiff = (int64_t)time(nullptr) - (int64_t)gbtTime;
   if (labs(timeDiff) >= 60) {
     LOG(WARNING) << "rawgbt diff time is more than 60, ignore it";
@@ -196,35 +276,12 @@ bool JobMakerHandlerBitcoin::addRawGbt(const string &msg) {
     LOG(WARNING) << "rawgbt diff time is too large: " << timeDiff << " seconds";
   }
 
-  const string gbt = DecodeBase64(r["block_template_base64"].str());
-  assert(gbt.length() > 64);  // valid gbt string's len at least 64 bytes
-
-  JsonNode nodeGbt;
-  if (!JsonNode::parse(gbt.c_str(), gbt.c_str() + gbt.length(), nodeGbt)) {
-    LOG(ERROR) << "parse gbt message to json fail";
+  // the rawgbt message from an old gbtmaker has no header fields
+  if (!gbtTemplate->hasHeader_ && !gbtTemplate->parse()) {
     return false;
   }
-  assert(nodeGbt["result"]["height"].type() == Utilities::JS::type::Int);
-  const uint32_t height = nodeGbt["result"]["height"].uint32();
-
-
-#ifdef CHAIN_TYPE_BCH
-  bool isLightVersion = nodeGbt["result"]["job_id"].type() == Utilities::JS::type::Str;
-  bool isEmptyBlock = false;
-  if(isLightVersion)
-  {
-    assert(nodeGbt["result"]["merkle"].type() == Utilities::JS::type::Array);
-    isEmptyBlock = nodeGbt["result"]["merkle"].array().size() == 0;
-  }
-  else
-  {
-    assert(nodeGbt["result"]["transactions"].type() == Utilities::JS::type::Array);
-    isEmptyBlock = nodeGbt["result"]["transactions"].array().size() == 0;
-  }
-#else
-  assert(nodeGbt["result"]["transactions"].type() == Utilities::JS::type::Array);
-  const bool isEmptyBlock = nodeGbt["result"]["transactions"].array().size() == 0;
-#endif
+  const uint32_t height = gbtTemplate->height_;
+  const bool isEmptyBlock = gbtTemplate->isEmptyBlock_;
 
   {
     ScopeLock sl(lock_);
@@ -250,7 +307,7 @@ bool JobMakerHandlerBitcoin::addRawGbt(const string &msg) {
 
     const uint64_t key = makeGbtKey(gbtTime, isEmptyBlock, height);
     if (rawgbtMap_.find(key) == rawgbtMap_.end()) {
-      rawgbtMap_.insert(std::make_pair(key, gbt));
+      rawgbtMap_.insert(std::make_pair(key, gbtTemplate));
     } else {
       LOG(ERROR) << "key already exist in rawgbtMap: " << key;
     }
@@ -262,13 +319,13 @@ bool JobMakerHandlerBitcoin::addRawGbt(const string &msg) {
   }
 
   LOG(INFO) << "add rawgbt, height: "<< height << ", gbthash: "
-  << r["gbthash"].str().substr(0, 16) << "..., gbtTime(UTC): " << date("%F %T", gbtTime)
+  << gbtHash.ToString().substr(0, 16) << "..., gbtTime(UTC): " << date("%F %T", gbtTime)
   << ", isEmpty:" << isEmptyBlock;
 
   return true;
 }
 
-bool JobMakerHandlerBitcoin::findBestRawGbt(string &bestRawGbt) {
+bool JobMakerHandlerBitcoin::findBestRawGbt(shared_ptr<GbtTemplateBitcoin> &bestRawGbt) {
   static uint64_t lastSendBestKey = 0;
 
   ScopeLock sl(lock_);
@@ -317,7 +374,7 @@ bool JobMakerHandlerBitcoin::findBestRawGbt(string &bestRawGbt) {
     lastSendBestKey     = bestKey;
     currBestHeight_     = bestHeight;
 
-    bestRawGbt = rawgbtMap_.rbegin()->second.c_str();
+    bestRawGbt = rawgbtMap_.rbegin()->second;
     return true;
   }
 
@@ -485,8 +542,16 @@ bool JobMakerHandlerBitcoin::processRskGwMsg(const string &rawGetWork) {
   return isMergedMiningUpdate_;
 }
 
-string JobMakerHandlerBitcoin::makeStratumJob(const string &gbt) {
-  DLOG(INFO) << "JobMakerHandlerBitcoin::makeStratumJob gbt: " << gbt;
+string JobMakerHandlerBitcoin::makeStratumJob(GbtTemplateBitcoin &gbt) {
+  // the rawgbt, auxpow and rsk threads may pick the same template,
+  // hold its lock until the job is made from the parsed json
+  ScopeLock gbtLock(gbt.lock());
+
+  // only the selected gbt is parsed, the others may never be
+  if (!gbt.parse()) {
+    return "";
+  }
+  DLOG(INFO) << "JobMakerHandlerBitcoin::makeStratumJob gbt: " << gbt.gbt();
   string latestNmcAuxBlockJson;
   {
     ScopeLock sl(auxJsonLock_);
@@ -502,7 +567,7 @@ string JobMakerHandlerBitcoin::makeStratumJob(const string &gbt) {
   }
 
   StratumJobBitcoin sjob;
-  if (!sjob.initFromGbt(gbt.c_str(), def()->coinbaseInfo_,
+  if (!sjob.initFromGbt(gbt.gbtHash_, gbt.json(), def()->coinbaseInfo_,
                                      poolPayoutAddr_,
                                      def()->blockVersion_,
                                      latestNmcAuxBlockJson,
@@ -531,11 +596,11 @@ string JobMakerHandlerBitcoin::makeStratumJob(const string &gbt) {
 }
 
 string JobMakerHandlerBitcoin::makeStratumJobMsg() {
-  string bestRawGbt;
+  shared_ptr<GbtTemplateBitcoin> bestRawGbt;
   if (!findBestRawGbt(bestRawGbt)) {
     return "";
   }
-  return makeStratumJob(bestRawGbt);
+  return makeStratumJob(*bestRawGbt);
 }
 
 uint64_t JobMakerHandlerBitcoin::makeGbtKey(uint32_t gbtTime, bool isEmptyBlock, uint32_t height) {
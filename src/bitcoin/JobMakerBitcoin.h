@@ -31,6 +31,50 @@
 #include <uint256.h>
 #include <base58.h>
 
+#include "utilities_js.hpp"
+
+//////////////////////////////// GbtTemplateBitcoin ////////////////////////////////
+// A block template received from gbtmaker.
+//
+// Only the small header fields of the rawgbt message are read when it arrives.
+// The template itself is decoded and parsed on the first call of parse(),
+// which happens when it is selected to make a stratum job, and the parsed
+// json is kept for the later jobs of the same template.
+//
+// Once the template is in rawgbtMap_ it is shared by the kafka consume threads,
+// so lock() must be held across parse() and the use of json().
+class GbtTemplateBitcoin
+{
+  mutex lock_;
+  string gbtBase64_;
+  string gbt_;
+  JsonNode json_;  // points into gbt_
+  bool parsed_;
+
+public:
+  uint256  gbtHash_;
+  uint32_t createdAt_;
+  uint32_t height_;
+  bool     isEmptyBlock_;
+  // false if the rawgbt message is made by an old gbtmaker,
+  // parse() must be called to get height_ and isEmptyBlock_.
+  bool     hasHeader_;
+
+  GbtTemplateBitcoin();
+  GbtTemplateBitcoin(const GbtTemplateBitcoin &) = delete;
+  GbtTemplateBitcoin &operator=(const GbtTemplateBitcoin &) = delete;
+
+  bool initFromRawGbtMsg(const string &msg);
+  // caller holds lock() unless the template is not shared yet
+  bool parse();
+
+  mutex &lock() { return lock_; }
+
+  bool isParsed() const { return parsed_; }
+  const string &gbt() const { return gbt_; }
+  JsonNode &json() { return json_; }
+};
+
 
 class JobMakerHandlerBitcoin : public JobMakerHandler
 {
@@ -43,7 +87,7 @@ class JobMakerHandlerBitcoin : public JobMakerHandler
   uint32_t currBestHeight_;
   uint32_t lastJobSendTime_;
   bool isLastJobEmptyBlock_;
-  std::map<uint64_t/* @see makeGbtKey() */, string> rawgbtMap_;  // sorted gbt by timestamp
+  std::map<uint64_t/* @see makeGbtKey() */, shared_ptr<GbtTemplateBitcoin>> rawgbtMap_;  // sorted gbt by timestamp
   deque<uint256> lastestGbtHash_;
 
   // merged mining for AuxPow blocks (example: Namecoin, ElastOS)
@@ -65,8 +109,8 @@ class JobMakerHandlerBitcoin : public JobMakerHandler
 
   // return false if there is no best rawGbt or
   // doesn't need to send a stratum job at current.
-  bool findBestRawGbt(string &bestRawGbt);
-  string makeStratumJob(const string &gbt);
+  bool findBestRawGbt(shared_ptr<GbtTemplateBitcoin> &bestRawGbt);
+  string makeStratumJob(GbtTemplateBitcoin &gbt);
 
   inline uint64_t makeGbtKey(uint32_t gbtTime, bool isEmptyBlock, uint32_t height);
   inline uint32_t gbtKeyGetTime     (uint64_t gbtKey);
@@ -0,0 +1,317 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) [2016] [BTC.COM]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+#include "Sha256.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#define SHA256_X86 1
+#endif
+
+// the backends, every one is in its own translation unit compiled with the
+// instruction set it needs. kEnabled is false if the compiler doesn't support it.
+namespace sha256_sse41 {
+extern const bool kEnabled;
+void TransformD64x4(uint8_t *out, const uint8_t *in);
+}
+namespace sha256_avx2 {
+extern const bool kEnabled;
+void TransformD64x8(uint8_t *out, const uint8_t *in);
+}
+namespace sha256_shani {
+extern const bool kEnabled;
+void Transform(uint32_t *s, const uint8_t *chunk, size_t blocks);
+}
+
+namespace {
+
+const uint32_t kInit[8] = {
+  0x6a09e667ul, 0xbb67ae85ul, 0x3c6ef372ul, 0xa54ff53aul,
+  0x510e527ful, 0x9b05688cul, 0x1f83d9abul, 0x5be0cd19ul
+};
+
+const uint32_t kRound[64] = {
+  0x428a2f98ul, 0x71374491ul, 0xb5c0fbcful, 0xe9b5dba5ul, 0x3956c25bul, 0x59f111f1ul, 0x923f82a4ul, 0xab1c5ed5ul,
+  0xd807aa98ul, 0x12835b01ul, 0x243185beul, 0x550c7dc3ul, 0x72be5d74ul, 0x80deb1feul, 0x9bdc06a7ul, 0xc19bf174ul,
+  0xe49b69c1ul, 0xefbe4786ul, 0x0fc19dc6ul, 0x240ca1ccul, 0x2de92c6ful, 0x4a7484aaul, 0x5cb0a9dcul, 0x76f988daul,
+  0x983e5152ul, 0xa831c66dul, 0xb00327c8ul, 0xbf597fc7ul, 0xc6e00bf3ul, 0xd5a79147ul, 0x06ca6351ul, 0x14292967ul,
+  0x27b70a85ul, 0x2e1b2138ul, 0x4d2c6dfcul, 0x53380d13ul, 0x650a7354ul, 0x766a0abbul, 0x81c2c92eul, 0x92722c85ul,
+  0xa2bfe8a1ul, 0xa81a664bul, 0xc24b8b70ul, 0xc76c51a3ul, 0xd192e819ul, 0xd6990624ul, 0xf40e3585ul, 0x106aa070ul,
+  0x19a4c116ul, 0x1e376c08ul, 0x2748774cul, 0x34b0bcb5ul, 0x391c0cb3ul, 0x4ed8aa4aul, 0x5b9cca4ful, 0x682e6ff3ul,
+  0x748f82eeul, 0x78a5636ful, 0x84c87814ul, 0x8cc70208ul, 0x90befffaul, 0xa4506cebul, 0xbef9a3f7ul, 0xc67178f2ul
+};
+
+inline uint32_t ReadBE32(const uint8_t *p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+inline void WriteBE32(uint8_t *p, uint32_t x) {
+  p[0] = (uint8_t)(x >> 24);
+  p[1] = (uint8_t)(x >> 16);
+  p[2] = (uint8_t)(x >> 8);
+  p[3] = (uint8_t)x;
+}
+
+inline void WriteBE64(uint8_t *p, uint64_t x) {
+  WriteBE32(p, (uint32_t)(x >> 32));
+  WriteBE32(p + 4, (uint32_t)x);
+}
+
+inline uint32_t Rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+inline uint32_t Ch(uint32_t x, uint32_t y, uint32_t z) { return z ^ (x & (y ^ z)); }
+inline uint32_t Maj(uint32_t x, uint32_t y, uint32_t z) { return (x & y) | (z & (x | y)); }
+inline uint32_t Sigma0(uint32_t x) { return Rotr(x, 2) ^ Rotr(x, 13) ^ Rotr(x, 22); }
+inline uint32_t Sigma1(uint32_t x) { return Rotr(x, 6) ^ Rotr(x, 11) ^ Rotr(x, 25); }
+inline uint32_t sigma0(uint32_t x) { return Rotr(x, 7) ^ Rotr(x, 18) ^ (x >> 3); }
+inline uint32_t sigma1(uint32_t x) { return Rotr(x, 17) ^ Rotr(x, 19) ^ (x >> 10); }
+
+void TransformGeneric(uint32_t *s, const uint8_t *chunk, size_t blocks) {
+  uint32_t w[64];
+  while (blocks--) {
+    for (int i = 0; i < 16; i++) {
+      w[i] = ReadBE32(chunk + 4 * i);
+    }
+    for (int i = 16; i < 64; i++) {
+      w[i] = sigma1(w[i - 2]) + w[i - 7] + sigma0(w[i - 15]) + w[i - 16];
+    }
+
+    uint32_t a = s[0], b = s[1], c = s[2], d = s[3];
+    uint32_t e = s[4], f = s[5], g = s[6], h = s[7];
+    for (int i = 0; i < 64; i++) {
+      const uint32_t t1 = h + Sigma1(e) + Ch(e, f, g) + kRound[i] + w[i];
+      const uint32_t t2 = Sigma0(a) + Maj(a, b, c);
+      h = g; g = f; f = e; e = d + t1;
+      d = c; c = b; b = a; a = t1 + t2;
+    }
+    s[0] += a; s[1] += b; s[2] += c; s[3] += d;
+    s[4] += e; s[5] += f; s[6] += g; s[7] += h;
+
+    chunk += 64;
+  }
+}
+
+typedef void (*TransformFunc)(uint32_t *s, const uint8_t *chunk, size_t blocks);
+typedef void (*TransformMultiFunc)(uint8_t *out, const uint8_t *in);
+
+// Constant initialized, so they are valid even before the static
+// initializer below picks the best backend.
+Sha256::Backend gBackend = Sha256::GENERIC;
+TransformFunc gTransform = TransformGeneric;
+TransformMultiFunc gTransformD64Multi = nullptr;
+size_t gLanes = 1;
+
+// the hash of the second block of a 64-byte message is fixed, its padding
+const uint8_t kPadding64[64] = {
+  0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x02, 0x00
+};
+
+// the second SHA256 of a double SHA256, in: the 32-byte first digest
+void HashSecond(uint8_t *out, const uint32_t *digest) {
+  uint8_t block[64] = {0};
+  for (int i = 0; i < 8; i++) {
+    WriteBE32(block + 4 * i, digest[i]);
+  }
+  block[32] = 0x80;
+  block[62] = 0x01;  // 256 bits
+
+  uint32_t s[8];
+  memcpy(s, kInit, sizeof(s));
+  gTransform(s, block, 1);
+  for (int i = 0; i < 8; i++) {
+    WriteBE32(out + 4 * i, s[i]);
+  }
+}
+
+void TransformD64(uint8_t *out, const uint8_t *in) {
+  uint32_t s[8];
+  memcpy(s, kInit, sizeof(s));
+  gTransform(s, in, 1);
+  gTransform(s, kPadding64, 1);
+  HashSecond(out, s);
+}
+
+#ifdef SHA256_X86
+void cpuid(uint32_t leaf, uint32_t subleaf,
+           uint32_t &a, uint32_t &b, uint32_t &c, uint32_t &d) {
+  __cpuid_count(leaf, subleaf, a, b, c, d);
+}
+
+uint64_t xgetbv() {
+  uint32_t a, d;
+  __asm__ ("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+  return ((uint64_t)d << 32) | a;
+}
+#endif
+
+bool detectSupported(Sha256::Backend backend) {
+  if (backend == Sha256::GENERIC) {
+    return true;
+  }
+#ifdef SHA256_X86
+  uint32_t a, b, c, d;
+  if (__get_cpuid_max(0, nullptr) < 7) {
+    return false;
+  }
+  cpuid(1, 0, a, b, c, d);
+  const bool hasSSE41 = (c >> 19) & 1;
+  // AVX needs the OS to save the YMM registers
+  const bool hasAVX = ((c >> 27) & 1) && ((c >> 28) & 1) && ((xgetbv() & 6) == 6);
+  cpuid(7, 0, a, b, c, d);
+  const bool hasAVX2 = hasAVX && ((b >> 5) & 1);
+  const bool hasSHA  = (b >> 29) & 1;
+
+  switch (backend) {
+    case Sha256::SSE41:
+      return sha256_sse41::kEnabled && hasSSE41;
+    case Sha256::AVX2:
+      return sha256_avx2::kEnabled && hasAVX2;
+    case Sha256::SHANI:
+      return sha256_shani::kEnabled && hasSHA && hasSSE41;
+    default:
+      return false;
+  }
+#else
+  return false;
+#endif
+}
+
+bool initBackend() {
+  for (int i = Sha256::kBackends_ - 1; i >= 0; i--) {
+    if (Sha256::setBackend((Sha256::Backend)i)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+const bool gInitialized = initBackend();
+
+} // namespace
+
+//////////////////////////////// Sha256 ////////////////////////////////
+const size_t Sha256::kBackends_;
+
+const char *Sha256::getBackendName(Backend backend) {
+  switch (backend) {
+    case GENERIC: return "generic";
+    case SSE41:   return "sse4.1(4-way)";
+    case AVX2:    return "avx2(8-way)";
+    case SHANI:   return "sha-ni";
+  }
+  return "unknown";
+}
+
+bool Sha256::isSupported(Backend backend) {
+  return detectSupported(backend);
+}
+
+Sha256::Backend Sha256::getBackend() {
+  return gBackend;
+}
+
+bool Sha256::setBackend(Backend backend) {
+  if (!detectSupported(backend)) {
+    return false;
+  }
+
+  gBackend = backend;
+  gTransform = TransformGeneric;
+  gTransformD64Multi = nullptr;
+  gLanes = 1;
+
+  switch (backend) {
+    case SSE41:
+      gTransformD64Multi = sha256_sse41::TransformD64x4;
+      gLanes = 4;
+      break;
+    case AVX2:
+      gTransformD64Multi = sha256_avx2::TransformD64x8;
+      gLanes = 8;
+      break;
+    case SHANI:
+      gTransform = sha256_shani::Transform;
+      // 8 lanes of AVX2 still beat the SHA extensions on batches
+      if (detectSupported(AVX2)) {
+        gTransformD64Multi = sha256_avx2::TransformD64x8;
+        gLanes = 8;
+      }
+      break;
+    default:
+      break;
+  }
+  return true;
+}
+
+void Sha256::hashD64(uint8_t *out, const uint8_t *in, size_t n) {
+  if (gTransformD64Multi != nullptr) {
+    while (n >= gLanes) {
+      gTransformD64Multi(out, in);
+      out += 32 * gLanes;
+      in  += 64 * gLanes;
+      n   -= gLanes;
+    }
+  }
+  while (n > 0) {
+    TransformD64(out, in);
+    out += 32;
+    in  += 64;
+    n--;
+  }
+}
+
+void Sha256::hashD80(uint8_t *out, const uint8_t *in) {
+  uint8_t block[64] = {0};
+  memcpy(block, in + 64, 16);
+  block[16] = 0x80;
+  block[62] = 0x02;
+  block[63] = 0x80;  // 640 bits
+
+  uint32_t s[8];
+  memcpy(s, kInit, sizeof(s));
+  gTransform(s, in, 1);
+  gTransform(s, block, 1);
+  HashSecond(out, s);
+}
+
+void Sha256::hashD(uint8_t *out, const uint8_t *in, size_t len) {
+  uint32_t s[8];
+  memcpy(s, kInit, sizeof(s));
+  const size_t blocks = len / 64;
+  gTransform(s, in, blocks);
+
+  // the tail and the padding, one or two blocks
+  uint8_t tail[128] = {0};
+  const size_t tailLen = len % 64;
+  memcpy(tail, in + blocks * 64, tailLen);
+  tail[tailLen] = 0x80;
+  const size_t tailBlocks = (tailLen + 9 > 64) ? 2 : 1;
+  WriteBE64(tail + tailBlocks * 64 - 8, (uint64_t)len * 8);
+  gTransform(s, tail, tailBlocks);
+
+  HashSecond(out, s);
+}
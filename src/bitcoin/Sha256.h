@@ -0,0 +1,69 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) [2016] [BTC.COM]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+#ifndef POOL_SHA256_H_
+#define POOL_SHA256_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+////////////////////////////////// Sha256 //////////////////////////////////
+// Double SHA256 for checking bitcoin shares and building merkle branches.
+//
+// The backend is chosen at startup by the CPU features:
+//   SHANI   - Intel SHA extensions, single lane, and AVX2 for batches if any
+//   AVX2    - 8 inputs at once
+//   SSE41   - 4 inputs at once
+//   GENERIC - plain C++, always available
+//
+// The multi-lane backends only help when there are independent inputs to hash,
+// e.g. the pairs of one level of a merkle tree. Single inputs, like the steps of
+// a share's merkle branch, always go through the fastest single-lane transform.
+class Sha256 {
+public:
+  enum Backend {
+    GENERIC = 0,
+    SSE41   = 1,
+    AVX2    = 2,
+    SHANI   = 3
+  };
+  static const size_t kBackends_ = 4;
+
+  static const char *getBackendName(Backend backend);
+  // compiled in and supported by the CPU
+  static bool isSupported(Backend backend);
+  static Backend getBackend();
+  // Not thread-safe, for tests and benchmarks only.
+  // Returns false if the backend is not supported.
+  static bool setBackend(Backend backend);
+
+  // double SHA256 of n independent 64-byte inputs, out[i*32] = H(in[i*64]).
+  // out may overlap in as long as out <= in, i.e. a merkle level in place.
+  static void hashD64(uint8_t *out, const uint8_t *in, size_t n);
+  // double SHA256 of an 80-byte block header
+  static void hashD80(uint8_t *out, const uint8_t *in);
+  // double SHA256 of any data, the same as bitcoin's Hash()
+  static void hashD(uint8_t *out, const uint8_t *in, size_t len);
+};
+
+#endif // POOL_SHA256_H_
@@ -0,0 +1,170 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) [2016] [BTC.COM]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+// 8-way double SHA256 of 64-byte inputs with AVX2, built with -mavx -mavx2.
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+namespace sha256_avx2 {
+
+extern const bool kEnabled = true;
+
+namespace {
+
+typedef __m256i Vec;
+
+inline Vec Add(Vec x, Vec y) { return _mm256_add_epi32(x, y); }
+inline Vec Xor(Vec x, Vec y) { return _mm256_xor_si256(x, y); }
+inline Vec Or(Vec x, Vec y) { return _mm256_or_si256(x, y); }
+inline Vec And(Vec x, Vec y) { return _mm256_and_si256(x, y); }
+inline Vec ShR(Vec x, int n) { return _mm256_srli_epi32(x, n); }
+inline Vec ShL(Vec x, int n) { return _mm256_slli_epi32(x, n); }
+inline Vec Set1(uint32_t x) { return _mm256_set1_epi32((int)x); }
+
+inline uint32_t ReadBE32(const uint8_t *p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+inline void WriteBE32(uint8_t *p, uint32_t x) {
+  p[0] = (uint8_t)(x >> 24);
+  p[1] = (uint8_t)(x >> 16);
+  p[2] = (uint8_t)(x >> 8);
+  p[3] = (uint8_t)x;
+}
+
+// word i of every lane, the inputs are 64 bytes apart
+inline Vec Load(const uint8_t *in, int i) {
+  return _mm256_set_epi32((int)ReadBE32(in + 448 + 4 * i), (int)ReadBE32(in + 384 + 4 * i),
+                          (int)ReadBE32(in + 320 + 4 * i), (int)ReadBE32(in + 256 + 4 * i),
+                          (int)ReadBE32(in + 192 + 4 * i), (int)ReadBE32(in + 128 + 4 * i),
+                          (int)ReadBE32(in +  64 + 4 * i), (int)ReadBE32(in + 4 * i));
+}
+
+// word i of every lane, the outputs are 32 bytes apart
+inline void Store(uint8_t *out, int i, Vec x) {
+  uint32_t lanes[8];
+  _mm256_storeu_si256((__m256i *)lanes, x);
+  for (int lane = 0; lane < 8; lane++) {
+    WriteBE32(out + 32 * lane + 4 * i, lanes[lane]);
+  }
+}
+
+const uint32_t kInit[8] = {
+  0x6a09e667ul, 0xbb67ae85ul, 0x3c6ef372ul, 0xa54ff53aul,
+  0x510e527ful, 0x9b05688cul, 0x1f83d9abul, 0x5be0cd19ul
+};
+
+const uint32_t kRound[64] = {
+  0x428a2f98ul, 0x71374491ul, 0xb5c0fbcful, 0xe9b5dba5ul, 0x3956c25bul, 0x59f111f1ul, 0x923f82a4ul, 0xab1c5ed5ul,
+  0xd807aa98ul, 0x12835b01ul, 0x243185beul, 0x550c7dc3ul, 0x72be5d74ul, 0x80deb1feul, 0x9bdc06a7ul, 0xc19bf174ul,
+  0xe49b69c1ul, 0xefbe4786ul, 0x0fc19dc6ul, 0x240ca1ccul, 0x2de92c6ful, 0x4a7484aaul, 0x5cb0a9dcul, 0x76f988daul,
+  0x983e5152ul, 0xa831c66dul, 0xb00327c8ul, 0xbf597fc7ul, 0xc6e00bf3ul, 0xd5a79147ul, 0x06ca6351ul, 0x14292967ul,
+  0x27b70a85ul, 0x2e1b2138ul, 0x4d2c6dfcul, 0x53380d13ul, 0x650a7354ul, 0x766a0abbul, 0x81c2c92eul, 0x92722c85ul,
+  0xa2bfe8a1ul, 0xa81a664bul, 0xc24b8b70ul, 0xc76c51a3ul, 0xd192e819ul, 0xd6990624ul, 0xf40e3585ul, 0x106aa070ul,
+  0x19a4c116ul, 0x1e376c08ul, 0x2748774cul, 0x34b0bcb5ul, 0x391c0cb3ul, 0x4ed8aa4aul, 0x5b9cca4ful, 0x682e6ff3ul,
+  0x748f82eeul, 0x78a5636ful, 0x84c87814ul, 0x8cc70208ul, 0x90befffaul, 0xa4506cebul, 0xbef9a3f7ul, 0xc67178f2ul
+};
+
+inline Vec Rotr(Vec x, int n) { return Or(ShR(x, n), ShL(x, 32 - n)); }
+inline Vec Ch(Vec x, Vec y, Vec z) { return Xor(z, And(x, Xor(y, z))); }
+inline Vec Maj(Vec x, Vec y, Vec z) { return Or(And(x, y), And(z, Or(x, y))); }
+inline Vec Sigma0(Vec x) { return Xor(Xor(Rotr(x, 2), Rotr(x, 13)), Rotr(x, 22)); }
+inline Vec Sigma1(Vec x) { return Xor(Xor(Rotr(x, 6), Rotr(x, 11)), Rotr(x, 25)); }
+inline Vec sigma0(Vec x) { return Xor(Xor(Rotr(x, 7), Rotr(x, 18)), ShR(x, 3)); }
+inline Vec sigma1(Vec x) { return Xor(Xor(Rotr(x, 17), Rotr(x, 19)), ShR(x, 10)); }
+
+// one block for every lane, w: the 16 message words, overwritten
+void TransformLanes(Vec *s, Vec *w) {
+  Vec a = s[0], b = s[1], c = s[2], d = s[3];
+  Vec e = s[4], f = s[5], g = s[6], h = s[7];
+  for (int i = 0; i < 64; i++) {
+    if (i >= 16) {
+      w[i % 16] = Add(Add(sigma1(w[(i - 2) % 16]), w[(i - 7) % 16]),
+                      Add(sigma0(w[(i - 15) % 16]), w[i % 16]));
+    }
+    const Vec t1 = Add(Add(Add(h, Sigma1(e)), Add(Ch(e, f, g), Set1(kRound[i]))), w[i % 16]);
+    const Vec t2 = Add(Sigma0(a), Maj(a, b, c));
+    h = g; g = f; f = e; e = Add(d, t1);
+    d = c; c = b; b = a; a = Add(t1, t2);
+  }
+  s[0] = Add(s[0], a); s[1] = Add(s[1], b); s[2] = Add(s[2], c); s[3] = Add(s[3], d);
+  s[4] = Add(s[4], e); s[5] = Add(s[5], f); s[6] = Add(s[6], g); s[7] = Add(s[7], h);
+}
+
+// double SHA256 of the 64-byte input of every lane
+void TransformD64Lanes(uint8_t *out, const uint8_t *in) {
+  Vec s[8], w[16];
+
+  // the input block
+  for (int i = 0; i < 8; i++) {
+    s[i] = Set1(kInit[i]);
+  }
+  for (int i = 0; i < 16; i++) {
+    w[i] = Load(in, i);
+  }
+  TransformLanes(s, w);
+
+  // the padding block, 512 bits
+  for (int i = 0; i < 16; i++) {
+    w[i] = Set1(0);
+  }
+  w[0]  = Set1(0x80000000ul);
+  w[15] = Set1(512);
+  TransformLanes(s, w);
+
+  // the second SHA256 of the 256-bit digest
+  for (int i = 0; i < 8; i++) {
+    w[i] = s[i];
+    s[i] = Set1(kInit[i]);
+  }
+  for (int i = 8; i < 16; i++) {
+    w[i] = Set1(0);
+  }
+  w[8]  = Set1(0x80000000ul);
+  w[15] = Set1(256);
+  TransformLanes(s, w);
+
+  for (int i = 0; i < 8; i++) {
+    Store(out, i, s[i]);
+  }
+}
+
+} // namespace
+
+void TransformD64x8(uint8_t *out, const uint8_t *in) {
+  TransformD64Lanes(out, in);
+}
+
+} // namespace sha256_avx2
+
+#else
+
+namespace sha256_avx2 {
+extern const bool kEnabled = false;
+void TransformD64x8(uint8_t *, const uint8_t *) {}
+}
+
+#endif
@@ -0,0 +1,106 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) [2016] [BTC.COM]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+// SHA256 transform with the Intel SHA extensions, built with -msse4.1 -msha.
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__SHA__) && defined(__SSE4_1__)
+#include <immintrin.h>
+
+namespace sha256_shani {
+
+extern const bool kEnabled = true;
+
+namespace {
+
+const uint32_t kRound[64] __attribute__((aligned(16))) = {
+  0x428a2f98ul, 0x71374491ul, 0xb5c0fbcful, 0xe9b5dba5ul, 0x3956c25bul, 0x59f111f1ul, 0x923f82a4ul, 0xab1c5ed5ul,
+  0xd807aa98ul, 0x12835b01ul, 0x243185beul, 0x550c7dc3ul, 0x72be5d74ul, 0x80deb1feul, 0x9bdc06a7ul, 0xc19bf174ul,
+  0xe49b69c1ul, 0xefbe4786ul, 0x0fc19dc6ul, 0x240ca1ccul, 0x2de92c6ful, 0x4a7484aaul, 0x5cb0a9dcul, 0x76f988daul,
+  0x983e5152ul, 0xa831c66dul, 0xb00327c8ul, 0xbf597fc7ul, 0xc6e00bf3ul, 0xd5a79147ul, 0x06ca6351ul, 0x14292967ul,
+  0x27b70a85ul, 0x2e1b2138ul, 0x4d2c6dfcul, 0x53380d13ul, 0x650a7354ul, 0x766a0abbul, 0x81c2c92eul, 0x92722c85ul,
+  0xa2bfe8a1ul, 0xa81a664bul, 0xc24b8b70ul, 0xc76c51a3ul, 0xd192e819ul, 0xd6990624ul, 0xf40e3585ul, 0x106aa070ul,
+  0x19a4c116ul, 0x1e376c08ul, 0x2748774cul, 0x34b0bcb5ul, 0x391c0cb3ul, 0x4ed8aa4aul, 0x5b9cca4ful, 0x682e6ff3ul,
+  0x748f82eeul, 0x78a5636ful, 0x84c87814ul, 0x8cc70208ul, 0x90befffaul, 0xa4506cebul, 0xbef9a3f7ul, 0xc67178f2ul
+};
+
+// 4 rounds, msg: the 4 message words of the rounds
+inline void QuadRound(__m128i &abef, __m128i &cdgh, __m128i msg, const uint32_t *k) {
+  msg = _mm_add_epi32(msg, _mm_load_si128((const __m128i *)k));
+  cdgh = _mm_sha256rnds2_epu32(cdgh, abef, msg);
+  abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(msg, 0x0e));
+}
+
+// the next 4 message words from the last 16
+inline __m128i Schedule(__m128i w0, __m128i w4, __m128i w8, __m128i w12) {
+  const __m128i t = _mm_add_epi32(_mm_sha256msg1_epu32(w0, w4), _mm_alignr_epi8(w12, w8, 4));
+  return _mm_sha256msg2_epu32(t, w12);
+}
+
+} // namespace
+
+void Transform(uint32_t *s, const uint8_t *chunk, size_t blocks) {
+  const __m128i kByteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bull, 0x0405060700010203ull);
+
+  // the state in the layout of the SHA instructions: ABEF and CDGH
+  __m128i t    = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)s), 0xB1);        // CDAB
+  __m128i cdgh = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)(s + 4)), 0x1B);  // EFGH
+  __m128i abef = _mm_alignr_epi8(t, cdgh, 8);
+  cdgh = _mm_blend_epi16(cdgh, t, 0xF0);
+
+  while (blocks--) {
+    const __m128i abefSave = abef;
+    const __m128i cdghSave = cdgh;
+
+    __m128i w[4];
+    for (int i = 0; i < 4; i++) {
+      w[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(chunk + 16 * i)), kByteSwap);
+      QuadRound(abef, cdgh, w[i], kRound + 4 * i);
+    }
+    for (int i = 4; i < 16; i++) {
+      w[i % 4] = Schedule(w[i % 4], w[(i + 1) % 4], w[(i + 2) % 4], w[(i + 3) % 4]);
+      QuadRound(abef, cdgh, w[i % 4], kRound + 4 * i);
+    }
+
+    abef = _mm_add_epi32(abef, abefSave);
+    cdgh = _mm_add_epi32(cdgh, cdghSave);
+    chunk += 64;
+  }
+
+  t    = _mm_shuffle_epi32(abef, 0x1B);  // FEBA
+  cdgh = _mm_shuffle_epi32(cdgh, 0xB1);  // DCHG
+  _mm_storeu_si128((__m128i *)s, _mm_blend_epi16(t, cdgh, 0xF0));           // DCBA
+  _mm_storeu_si128((__m128i *)(s + 4), _mm_alignr_epi8(cdgh, t, 8));        // HGFE
+}
+
+} // namespace sha256_shani
+
+#else
+
+namespace sha256_shani {
+extern const bool kEnabled = false;
+void Transform(uint32_t *, const uint8_t *, size_t) {}
+}
+
+#endif
@@ -34,6 +34,7 @@
 #include <streams.h>
 
 #include "Utils.h"
+#include "Sha256.h"
 #include <glog/logging.h>
 
 #include <boost/endian/buffers.hpp>
@@ -52,12 +53,10 @@ void makeMerkleBranch(const vector<uint256> &vtxhashs, vector<uint256> &steps) {
       // because we ignore the coinbase tx when make merkle branch.
       hashs.push_back(*hashs.rbegin());
     }
-    // ignore the first one than merge two
-    for (size_t i = 0; i < (hashs.size() - 1) / 2; i++) {
-      // Hash = Double SHA256
-      hashs[i] = Hash(BEGIN(hashs[i*2 + 1]), END(hashs[i*2 + 1]),
-                      BEGIN(hashs[i*2 + 2]), END(hashs[i*2 + 2]));
-    }
+    // ignore the first one than merge two, hashs[i] = Hash(hashs[i*2 + 1], hashs[i*2 + 2]).
+    // The pairs are independent and adjacent in memory, so they are hashed in lanes.
+    static_assert(sizeof(uint256) == 32, "uint256 should be 32 bytes");
+    Sha256::hashD64(hashs[0].begin(), hashs[1].begin(), (hashs.size() - 1) / 2);
     hashs.resize((hashs.size() - 1) / 2);
   }
   assert(hashs.size() == 1);
@@ -259,11 +258,24 @@ bool StratumJobBitcoin::initFromGbt(const char *gbt, const string &poolCoinbaseI
     LOG(ERROR) << "decode gbt json fail: >" << gbt << "<";
     return false;
   }
+  return initFromGbt(gbtHash, r, poolCoinbaseInfo, poolPayoutAddr, blockVersion,
+                     nmcAuxBlockJson, latestRskBlockJson, serverId, isMergedMiningUpdate);
+}
+
+bool StratumJobBitcoin::initFromGbt(const uint256 &gbtHash, JsonNode &r,
+                             const string &poolCoinbaseInfo,
+                             const CTxDestination &poolPayoutAddr,
+                             const uint32_t blockVersion,
+                             const string &nmcAuxBlockJson,
+                             const RskWork &latestRskBlockJson,
+                             const uint8_t serverId,
+                             const bool isMergedMiningUpdate)
+{
   JsonNode jgbt = r["result"];
 
   // jobId: timestamp + gbtHash, we need to make sure jobId is unique in a some time
   // jobId can convert to uint64_t
-  auto hash = reinterpret_cast<boost::endian::little_uint32_buf_t *>(gbtHash.begin());
+  auto hash = reinterpret_cast<const boost::endian::little_uint32_buf_t *>(gbtHash.begin());
   jobId_ = (static_cast<uint64_t>(time(nullptr)) << 32) | (hash->value() & 0xFFFFFF00) | serverId;
 
   gbtHash_ = gbtHash.ToString();
@@ -32,6 +32,7 @@
 #include "rsk/RskWork.h"
 #include "script/standard.h"
 #include "bitcoin/bitcoin.pb.h"
+#include "utilities_js.hpp"
 
 
 //
@@ -105,7 +106,6 @@ public:
       set_userid(0);
       set_status(0);
       set_timestamp(0);
-      set_ip("0.0.0.0");
       set_jobid(0);
       set_sharediff(0);
       set_blkbits(0);
@@ -117,6 +117,23 @@ public:
     ShareBitcoin(const ShareBitcoin &r) = default;
     ShareBitcoin&operator=(const ShareBitcoin &r) = default;
 
+    // The miner's IP is 16 bytes in ip_bin since version 5, shares
+    // of older versions have it as a string in ip.
+    IpAddress getIp() const {
+      IpAddress ip;
+      if (ip_bin().size() == sizeof(IpAddress)) {
+        memcpy(&ip, ip_bin().data(), sizeof(IpAddress));
+      } else if (has_ip()) {
+        ip.fromString(this->ip());
+      }
+      return ip;
+    }
+
+    void setIp(const IpAddress &ip) {
+      set_ip_bin(&ip, sizeof(IpAddress));
+      clear_ip();
+    }
+
     double score() const {
 
       if (sharediff() == 0 || blkbits() == 0)
@@ -138,7 +155,7 @@ public:
 
     bool isValid() const {
 
-        if (version() != CURRENT_VERSION) {
+        if (version() != CURRENT_VERSION && version() != STRING_IP_VERSION) {
             DLOG(INFO) << "share  version " << version();
             return false;
         }
@@ -167,7 +184,7 @@ public:
                              "workerId: %" PRId64 ", time: %u/%s, height: %u, "
                              "blkBits: %08x/%lf, shareDiff: %" PRIu64 ", "
                              "status: %d/%s)",
-                             jobid(), ip().c_str(), userid(),
+                             jobid(), getIp().toString().c_str(), userid(),
                              workerhashid(), timestamp(), date("%F %T", timestamp()).c_str(), height(),
                              blkbits(), networkDifficulty, sharediff(),
                              status(), StratumStatus::toString(status()));
@@ -192,7 +209,7 @@ public:
       const uint8_t * payload = data;
       uint32_t version = *((uint32_t*)payload);
 
-      if (version == CURRENT_VERSION) {
+      if (version == CURRENT_VERSION || version == STRING_IP_VERSION) {
         if (!ParseFromArray((const uint8_t *)(payload + sizeof(uint32_t)), size - sizeof(uint32_t))) {
           DLOG(INFO) << "share ParseFromArray failed!";
           return false;
@@ -211,7 +228,7 @@ public:
         set_userid(share->userId_);
         set_status(share->status_);
         set_timestamp(share->timestamp_);
-        set_ip(share->ip_.toString());
+        setIp(share->ip_);
         set_jobid(share->jobId_);
         set_sharediff(share->shareDiff_);
         set_blkbits(share->blkBits_);
@@ -266,7 +283,8 @@ public:
 public:
 
   const static uint32_t BYTES_VERSION = 0x00010003u;
-  const static uint32_t CURRENT_VERSION = 0x00010004u;
+  const static uint32_t STRING_IP_VERSION = 0x00010004u;  // the IP in `ip`, not `ip_bin`
+  const static uint32_t CURRENT_VERSION = 0x00010005u;
 };
 
 
@@ -322,6 +340,16 @@ public:
                     const RskWork &latestRskBlockJson,
                     const uint8_t serverId,
                     const bool isMergedMiningUpdate);
+  // the same as above, but with a gbt which is already parsed,
+  // gbtHash is the hash of the gbt string.
+  bool initFromGbt( const uint256 &gbtHash, JsonNode &gbt,
+                    const string &poolCoinbaseInfo,
+                    const CTxDestination &poolPayoutAddr,
+                    const uint32_t blockVersion,
+                    const string &nmcAuxBlockJson,
+                    const RskWork &latestRskBlockJson,
+                    const uint8_t serverId,
+                    const bool isMergedMiningUpdate);
   string serializeToJson() const override;
   bool unserializeFromJson(const char *s, size_t len) override;
   bool isEmptyBlock();
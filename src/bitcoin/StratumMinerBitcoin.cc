@@ -226,7 +226,7 @@ void StratumMinerBitcoin::handleRequest_Submit(const string &idStr,
   share.set_status(StratumStatus::REJECT_NO_REASON);
   IpAddress ip;
   ip.fromIpv4Int(session.getClientIp());
-  share.set_ip(ip.toString());
+  share.setIp(ip);
 
   // calc jobTarget
   uint256 jobTarget;
@@ -24,6 +24,7 @@
 #include "StratumServerBitcoin.h"
 #include "StratumSessionBitcoin.h"
 #include "StratumBitcoin.h"
+#include "Sha256.h"
 
 #include "rsk/RskSolvedShareData.h"
 
@@ -98,6 +99,7 @@ void JobRepositoryBitcoin::broadcastStratumJob(shared_ptr<StratumJob> sjobBase)
 
     // insert new job
     exJobs_[sjob->jobId_] = exJob;
+    updateJobsSnapshot();
   }
 
   // if job has clean flag, call server to send job
@@ -161,6 +163,11 @@ void StratumJobExBitcoin::init() {
   // so put it into a single variable.
   coinbase1_ = sjob->coinbase1_.c_str();
 
+  // binary coinbase template and the SHA256 state after coinbase1
+  Hex2Bin(sjob->coinbase1_.c_str(), sjob->coinbase1_.size(), coinbase1Bin_);
+  Hex2Bin(sjob->coinbase2_.c_str(), sjob->coinbase2_.size(), coinbase2Bin_);
+  coinbase1Hasher_.Reset().Write((const unsigned char *)coinbase1Bin_.data(), coinbase1Bin_.size());
+
   miningNotify3_ = Strings::Format("\",\"%s\""
                                    ",[%s]"
                                    ",\"%08x\",\"%08x\",\"%08x\",%s"
@@ -178,31 +185,53 @@ void StratumJobExBitcoin::init() {
                                    merkleBranchStr.c_str(),
                                    sjob->nVersion_, sjob->nBits_, sjob->nTime_);
 
+  miningNotifyTail_ = miningNotify2_ + coinbase1_ + miningNotify3_;
+  miningNotifyTailClean_ = miningNotify2_ + coinbase1_ + miningNotify3Clean_;
 }
 
 
 void StratumJobExBitcoin::generateCoinbaseTx(std::vector<char> *coinbaseBin,
-                                      const uint32_t extraNonce1,
-                                      const string &extraNonce2Hex,
-                                      string *userCoinbaseInfo) {
-  string coinbaseHex;
-  const string extraNonceStr = Strings::Format("%08x%s", extraNonce1, extraNonce2Hex.c_str());
-  auto sjob = std::static_pointer_cast<StratumJobBitcoin>(sjob_);
-  string coinbase1 = sjob->coinbase1_;
-
+                                             uint256 *coinbaseHash,
+                                             const uint32_t extraNonce1,
+                                             const string &extraNonce2Hex,
+                                             string *userCoinbaseInfo) {
+  // extraNonce1 is sent to miners as "%08x", so it's big-endian in coinbase
+  const uint8_t extraNonce1Bin[4] = {
+    (uint8_t)(extraNonce1 >> 24), (uint8_t)(extraNonce1 >> 16),
+    (uint8_t)(extraNonce1 >>  8), (uint8_t)(extraNonce1)
+  };
+  std::vector<char> extraNonce2Bin;
+  Hex2Bin(extraNonce2Hex.c_str(), extraNonce2Hex.size(), extraNonce2Bin);
+
+  coinbaseBin->clear();
+  coinbaseBin->reserve(coinbase1Bin_.size() + sizeof(extraNonce1Bin) +
+                       extraNonce2Bin.size() + coinbase2Bin_.size());
+  coinbaseBin->insert(coinbaseBin->end(), coinbase1Bin_.begin(), coinbase1Bin_.end());
+  coinbaseBin->insert(coinbaseBin->end(), (const char *)extraNonce1Bin,
+                      (const char *)extraNonce1Bin + sizeof(extraNonce1Bin));
+  coinbaseBin->insert(coinbaseBin->end(), extraNonce2Bin.begin(), extraNonce2Bin.end());
+  coinbaseBin->insert(coinbaseBin->end(), coinbase2Bin_.begin(), coinbase2Bin_.end());
+
+  CSHA256 hasher;
 #ifdef USER_DEFINED_COINBASE
-  if (userCoinbaseInfo != nullptr) {
-    string userCoinbaseHex;
-    Bin2Hex((uint8*)(*userCoinbaseInfo).c_str(), (*userCoinbaseInfo).size(), userCoinbaseHex);
-    // replace the last `userCoinbaseHex.size()` bytes to `userCoinbaseHex`
-    coinbase1.replace(coinbase1.size()-userCoinbaseHex.size(), userCoinbaseHex.size(), userCoinbaseHex);
-  }
+  if (userCoinbaseInfo != nullptr && userCoinbaseInfo->size() <= coinbase1Bin_.size()) {
+    // replace the last `userCoinbaseInfo->size()` bytes of coinbase1,
+    // the cached state can't be used because coinbase1 is changed.
+    memcpy(coinbaseBin->data() + coinbase1Bin_.size() - userCoinbaseInfo->size(),
+           userCoinbaseInfo->data(), userCoinbaseInfo->size());
+    hasher.Write((const unsigned char *)coinbaseBin->data(), coinbase1Bin_.size());
+  } else
 #endif
+  {
+    hasher = coinbase1Hasher_;
+  }
 
-  coinbaseHex.append(coinbase1);
-  coinbaseHex.append(extraNonceStr);
-  coinbaseHex.append(sjob->coinbase2_);
-  Hex2Bin((const char *)coinbaseHex.c_str(), *coinbaseBin);
+  // double SHA256, the same as Hash()
+  unsigned char hash[CSHA256::OUTPUT_SIZE];
+  hasher.Write((const unsigned char *)coinbaseBin->data() + coinbase1Bin_.size(),
+               coinbaseBin->size() - coinbase1Bin_.size())
+        .Finalize(hash);
+  CSHA256().Write(hash, sizeof(hash)).Finalize(coinbaseHash->begin());
 }
 
 void StratumJobExBitcoin::generateBlockHeader(CBlockHeader *header,
@@ -215,8 +244,6 @@ void StratumJobExBitcoin::generateBlockHeader(CBlockHeader *header,
                                        const uint32_t nTime, const uint32_t nonce,
                                        const uint32_t versionMask,
                                        string *userCoinbaseInfo) {
-  generateCoinbaseTx(coinbaseBin, extraNonce1, extraNonce2Hex, userCoinbaseInfo);
-
   header->hashPrevBlock = hashPrevBlock;
   header->nVersion      = (nVersion ^ versionMask);
   header->nBits         = nBits;
@@ -224,14 +251,17 @@ void StratumJobExBitcoin::generateBlockHeader(CBlockHeader *header,
   header->nNonce        = nonce;
 
   // hashMerkleRoot
-  header->hashMerkleRoot = Hash(coinbaseBin->begin(), coinbaseBin->end());
+  generateCoinbaseTx(coinbaseBin, &header->hashMerkleRoot,
+                     extraNonce1, extraNonce2Hex, userCoinbaseInfo);
 
+  // every step depends on the last one, so they go through the single-lane transform
+  uint8_t buf[64];
+  memcpy(buf, header->hashMerkleRoot.begin(), 32);
   for (const uint256 & step : merkleBranch) {
-    header->hashMerkleRoot = Hash(BEGIN(header->hashMerkleRoot),
-                                  END  (header->hashMerkleRoot),
-                                  BEGIN(step),
-                                  END  (step));
+    memcpy(buf + 32, step.begin(), 32);
+    Sha256::hashD64(buf, buf, 1);
   }
+  memcpy(header->hashMerkleRoot.begin(), buf, 32);
 }
 ////////////////////////////////// ServerBitcoin ///////////////////////////////
 ServerBitcoin::ServerBitcoin(const int32_t shareAvgSeconds, const libconfig::Config &config)
@@ -378,7 +408,10 @@ int ServerBitcoin::checkShare(const ShareBitcoin &share,
 #ifdef CHAIN_TYPE_LTC
     uint256 blkHash = header.GetPoWHash();
 #else
-  uint256 blkHash = header.GetHash();
+  // the same as header.GetHash(), CBlockHeader is laid out as it's serialized
+  static_assert(sizeof(CBlockHeader) == 80, "CBlockHeader should be 80 bytes");
+  uint256 blkHash;
+  Sha256::hashD80(blkHash.begin(), (const uint8_t *)&header);
 #endif
   arith_uint256 bnBlockHash     = UintToArith256(blkHash);
   arith_uint256 bnNetworkTarget = UintToArith256(sjob->networkTarget_);
@@ -26,6 +26,7 @@
 
 #include "StratumServer.h"
 #include <uint256.h>
+#include <crypto/sha256.h>
 
 class CBlockHeader;
 class FoundBlock;
@@ -82,7 +83,15 @@ public:
 
 class StratumJobExBitcoin : public StratumJobEx
 {
+  // binary coinbase template, built once per job
+  std::vector<char> coinbase1Bin_;
+  std::vector<char> coinbase2Bin_;
+  // SHA256 state after coinbase1: the midstate of all full 64-byte blocks
+  // plus the buffered tail, so only extra nonces and coinbase2 are hashed per share
+  CSHA256 coinbase1Hasher_;
+
   void generateCoinbaseTx(std::vector<char> *coinbaseBin,
+                          uint256 *coinbaseHash,
                           const uint32_t extraNonce1,
                           const string &extraNonce2Hex,
                           string *userCoinbaseInfo = nullptr);
@@ -94,6 +103,10 @@ public:
   string coinbase1_;
   string miningNotify3_;
   string miningNotify3Clean_;
+  // miningNotify2_ + coinbase1_ + miningNotify3_(Clean_), sent by reference
+  // to all sessions, only miningNotify1_ and the job id are copied per session
+  string miningNotifyTail_;
+  string miningNotifyTailClean_;
 
 public:
   StratumJobExBitcoin(shared_ptr<StratumJob> sjob, bool isClean);
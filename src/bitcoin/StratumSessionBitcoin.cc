@@ -71,7 +71,7 @@ void StratumSessionBitcoin::sendMiningNotify(shared_ptr<StratumJobEx> exJobPtr,
 #endif
 
   string notifyStr;
-  notifyStr.reserve(2048);
+  notifyStr.reserve(64);
 
   // notify1
   notifyStr.append(exJob->miningNotify1_);
@@ -88,17 +88,16 @@ void StratumSessionBitcoin::sendMiningNotify(shared_ptr<StratumJobEx> exJobPtr,
     notifyStr.append(Strings::Format("%u", ljob.shortJobId_));  // short jobId
   }
 
+#ifdef USER_DEFINED_COINBASE
   // notify2
   notifyStr.append(exJob->miningNotify2_);
 
   string coinbase1 = exJob->coinbase1_;
 
-#ifdef USER_DEFINED_COINBASE
   string userCoinbaseHex;
   Bin2Hex((const uint8_t *)ljob.userCoinbaseInfo_.c_str(), ljob.userCoinbaseInfo_.size(), userCoinbaseHex);
   // replace the last `userCoinbaseHex.size()` bytes to `userCoinbaseHex`
   coinbase1.replace(coinbase1.size()-userCoinbaseHex.size(), userCoinbaseHex.size(), userCoinbaseHex);
-#endif
 
   // coinbase1
   notifyStr.append(coinbase1);
@@ -110,6 +109,12 @@ void StratumSessionBitcoin::sendMiningNotify(shared_ptr<StratumJobEx> exJobPtr,
     notifyStr.append(exJob->miningNotify3_);
 
   sendData(notifyStr);  // send notify string
+#else
+  // notify2, coinbase1 and notify3 are the same for all sessions,
+  // send them without copying
+  const string &notifyTail = isFirstJob ? exJob->miningNotifyTailClean_ : exJob->miningNotifyTail_;
+  sendData(notifyStr, notifyTail.data(), notifyTail.size(), exJob);
+#endif
 
   // clear localJobs_
   clearLocalJobs();
@@ -141,10 +141,18 @@ bool ClientContainerBitcoin::sendEmptyGBT(const string &poolName,
   const uint256 gbtHash = Hash(gbt.begin(), gbt.end());
 
   string sjob = Strings::Format("{\"created_at_ts\":%u,"
+                                "\"height\":%d,"
+                                "\"prevhash\":\"%s\","
+                                "\"bits\":\"%08x\","
+                                "\"tx_count\":0,"
+                                "\"is_empty_block\":true,"
                                 "\"block_template_base64\":\"%s\","
                                 "\"gbthash\":\"%s\","
                                 "\"from_pool\":\"%s\"}",
                                 (uint32_t)time(nullptr),
+                                blockHeight,
+                                blockPrevHash.c_str(),
+                                nBits,
                                 EncodeBase64(gbt).c_str(),
                                 gbtHash.ToString().c_str(),
                                 poolName.c_str());
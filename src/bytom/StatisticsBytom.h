@@ -43,6 +43,9 @@ struct GlobalShareBytom {
 
   GlobalShareBytom& operator=(const GlobalShareBytom &r) = default;
 
+  // see DuplicateShareCheckerT, nonces are random enough
+  uint64_t shard() const { return combinedHeader_.nonce_; }
+
   bool operator<(const GlobalShareBytom &r) const {
     return std::memcmp(&combinedHeader_, &r.combinedHeader_, sizeof(BytomCombinedHeader)) < 0;
   }
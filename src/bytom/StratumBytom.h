@@ -135,6 +135,13 @@ public:
     return true;
   }
 
+  IpAddress getIp() const
+  {
+    IpAddress ip;
+    ip.fromString(this->ip());
+    return ip;
+  }
+
   string toString() const
   {
     uint64_t networkDifficulty = Bytom_TargetCompactToDifficulty(blkbits());
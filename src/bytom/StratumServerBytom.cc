@@ -70,6 +70,7 @@ void JobRepositoryBytom::broadcastStratumJob(shared_ptr<StratumJob> sjobBase)
 
     // insert new job
     exJobs_[sjob->jobId_] = exJob;
+    updateJobsSnapshot();
   }
   if (isClean) {
     sendMiningNotify(exJob);
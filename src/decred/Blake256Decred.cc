@@ -0,0 +1,250 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) [2016] [BTC.COM]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+#include "Blake256Decred.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#define BLAKE256_X86 1
+#endif
+
+// the SSE4.1 backend is in its own translation unit compiled with -msse4.1.
+// kEnabled is false if the compiler doesn't support it.
+namespace blake256_sse41 {
+extern const bool kEnabled;
+void Compress(uint32_t *h, const uint8_t *block, uint32_t counter);
+}
+
+namespace {
+
+const uint32_t kInit[8] = {
+  0x6a09e667ul, 0xbb67ae85ul, 0x3c6ef372ul, 0xa54ff53aul,
+  0x510e527ful, 0x9b05688cul, 0x1f83d9abul, 0x5be0cd19ul
+};
+
+const uint32_t kConst[16] = {
+  0x243f6a88ul, 0x85a308d3ul, 0x13198a2eul, 0x03707344ul,
+  0xa4093822ul, 0x299f31d0ul, 0x082efa98ul, 0xec4e6c89ul,
+  0x452821e6ul, 0x38d01377ul, 0xbe5466cful, 0x34e90c6cul,
+  0xc0ac29b7ul, 0xc97c50ddul, 0x3f84d5b5ul, 0xb5470917ul
+};
+
+const uint8_t kSigma[10][16] = {
+  {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+  { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+  { 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+  {  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+  {  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+  {  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+  { 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+  { 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+  {  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+  { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13 , 0 }
+};
+
+inline uint32_t ReadBE32(const uint8_t *p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+inline void WriteBE32(uint8_t *p, uint32_t x) {
+  p[0] = (uint8_t)(x >> 24);
+  p[1] = (uint8_t)(x >> 16);
+  p[2] = (uint8_t)(x >> 8);
+  p[3] = (uint8_t)x;
+}
+
+inline uint32_t Rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+// macros rather than functions, so everything is inlined, the state stays
+// in registers and the indexes of the message words are constants
+#define BLAKE256_G(r, i, a, b, c, d)                                     \
+  do {                                                                   \
+    v[a] = v[a] + v[b] + (m[kSigma[r][2 * i]] ^ kConst[kSigma[r][2 * i + 1]]); \
+    v[d] = Rotr(v[d] ^ v[a], 16);                                        \
+    v[c] = v[c] + v[d];                                                  \
+    v[b] = Rotr(v[b] ^ v[c], 12);                                        \
+    v[a] = v[a] + v[b] + (m[kSigma[r][2 * i + 1]] ^ kConst[kSigma[r][2 * i]]); \
+    v[d] = Rotr(v[d] ^ v[a], 8);                                         \
+    v[c] = v[c] + v[d];                                                  \
+    v[b] = Rotr(v[b] ^ v[c], 7);                                         \
+  } while (0)
+
+#define BLAKE256_ROUND(r)                 \
+  do {                                    \
+    BLAKE256_G(r, 0, 0, 4,  8, 12);       \
+    BLAKE256_G(r, 1, 1, 5,  9, 13);       \
+    BLAKE256_G(r, 2, 2, 6, 10, 14);       \
+    BLAKE256_G(r, 3, 3, 7, 11, 15);       \
+    BLAKE256_G(r, 4, 0, 5, 10, 15);       \
+    BLAKE256_G(r, 5, 1, 6, 11, 12);       \
+    BLAKE256_G(r, 6, 2, 7,  8, 13);       \
+    BLAKE256_G(r, 7, 3, 4,  9, 14);       \
+  } while (0)
+
+// one 64-byte block, counter: the bits hashed up to the end of the block.
+// The salt is always 0 and the counters are less than 2^32.
+void CompressGeneric(uint32_t *h, const uint8_t *block, uint32_t counter) {
+  uint32_t m[16];
+  for (int i = 0; i < 16; i++) {
+    m[i] = ReadBE32(block + 4 * i);
+  }
+
+  uint32_t v[16];
+  for (int i = 0; i < 8; i++) {
+    v[i] = h[i];
+    v[i + 8] = kConst[i];
+  }
+  v[12] ^= counter;
+  v[13] ^= counter;
+
+  BLAKE256_ROUND(0);
+  BLAKE256_ROUND(1);
+  BLAKE256_ROUND(2);
+  BLAKE256_ROUND(3);
+  BLAKE256_ROUND(4);
+  BLAKE256_ROUND(5);
+  BLAKE256_ROUND(6);
+  BLAKE256_ROUND(7);
+  BLAKE256_ROUND(8);
+  BLAKE256_ROUND(9);
+  BLAKE256_ROUND(0);
+  BLAKE256_ROUND(1);
+  BLAKE256_ROUND(2);
+  BLAKE256_ROUND(3);
+
+  for (int i = 0; i < 8; i++) {
+    h[i] ^= v[i] ^ v[i + 8];
+  }
+}
+
+#undef BLAKE256_ROUND
+#undef BLAKE256_G
+
+typedef void (*CompressFunc)(uint32_t *h, const uint8_t *block, uint32_t counter);
+
+// Constant initialized, so they are valid even before the static
+// initializer below picks the best backend.
+Blake256Decred::Backend gBackend = Blake256Decred::GENERIC;
+CompressFunc gCompress = CompressGeneric;
+
+bool detectSupported(Blake256Decred::Backend backend) {
+  if (backend == Blake256Decred::GENERIC) {
+    return true;
+  }
+#ifdef BLAKE256_X86
+  uint32_t a, b, c, d;
+  if (__get_cpuid_max(0, nullptr) < 1) {
+    return false;
+  }
+  __cpuid_count(1, 0, a, b, c, d);
+  const bool hasSSE41 = (c >> 19) & 1;
+
+  switch (backend) {
+    case Blake256Decred::SSE41:
+      return blake256_sse41::kEnabled && hasSSE41;
+    default:
+      return false;
+  }
+#else
+  return false;
+#endif
+}
+
+bool initBackend() {
+  for (int i = Blake256Decred::kBackends_ - 1; i >= 0; i--) {
+    if (Blake256Decred::setBackend((Blake256Decred::Backend)i)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+const bool gInitialized = initBackend();
+
+} // namespace
+
+/////////////////////////////// Blake256Decred ///////////////////////////////
+const size_t Blake256Decred::kBackends_;
+const size_t Blake256Decred::kHeaderSize_;
+const size_t Blake256Decred::kMidstateSize_;
+const size_t Blake256Decred::kHashSize_;
+
+const char *Blake256Decred::getBackendName(Backend backend) {
+  switch (backend) {
+    case GENERIC: return "generic";
+    case SSE41:   return "sse4.1";
+  }
+  return "unknown";
+}
+
+bool Blake256Decred::isSupported(Backend backend) {
+  return detectSupported(backend);
+}
+
+Blake256Decred::Backend Blake256Decred::getBackend() {
+  return gBackend;
+}
+
+bool Blake256Decred::setBackend(Backend backend) {
+  if (!detectSupported(backend)) {
+    return false;
+  }
+
+  gBackend = backend;
+  gCompress = CompressGeneric;
+  if (backend == SSE41) {
+    gCompress = blake256_sse41::Compress;
+  }
+  return true;
+}
+
+void Blake256Decred::getMidstate(Midstate &midstate, const uint8_t *header) {
+  memcpy(midstate.h_, kInit, sizeof(midstate.h_));
+  gCompress(midstate.h_, header, 512);
+  gCompress(midstate.h_, header + 64, 1024);
+}
+
+void Blake256Decred::hash(uint8_t *out, const Midstate &midstate, const uint8_t *header) {
+  // the last 52 bytes and the padding fit in one block
+  const size_t kTailSize = kHeaderSize_ - kMidstateSize_;
+  uint8_t block[64] = {0};
+  memcpy(block, header + kMidstateSize_, kTailSize);
+  block[kTailSize] = 0x80;
+  block[55] |= 0x01;  // the 256-bit digest
+  WriteBE32(block + 60, kHeaderSize_ * 8);
+
+  uint32_t h[8];
+  memcpy(h, midstate.h_, sizeof(h));
+  gCompress(h, block, kHeaderSize_ * 8);
+  for (int i = 0; i < 8; i++) {
+    WriteBE32(out + 4 * i, h[i]);
+  }
+}
+
+void Blake256Decred::hash(uint8_t *out, const uint8_t *header) {
+  Midstate midstate;
+  getMidstate(midstate, header);
+  hash(out, midstate, header);
+}
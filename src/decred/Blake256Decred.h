@@ -0,0 +1,74 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) [2016] [BTC.COM]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+#ifndef POOL_BLAKE256_DECRED_H_
+#define POOL_BLAKE256_DECRED_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/////////////////////////////// Blake256Decred ///////////////////////////////
+// The blake256 of decred's 180-byte block headers, the same as sph_blake256
+// of 3rdparty/libsph.
+//
+// A header is three blocks of the compression function. The first two, i.e.
+// the leading 128 bytes, don't change within a job, so their state can be
+// computed once per job and only the last block is hashed for every share.
+//
+// The backend of the compression function is chosen at startup by the CPU
+// features:
+//   SSE41   - the rows of the state in SSE registers
+//   GENERIC - plain C++, always available
+class Blake256Decred {
+public:
+  enum Backend {
+    GENERIC = 0,
+    SSE41   = 1
+  };
+  static const size_t kBackends_ = 2;
+
+  static const size_t kHeaderSize_   = 180;
+  static const size_t kMidstateSize_ = 128;
+  static const size_t kHashSize_     = 32;
+
+  // the state after the leading kMidstateSize_ bytes of a header
+  struct Midstate {
+    uint32_t h_[8];
+  };
+
+  static const char *getBackendName(Backend backend);
+  // compiled in and supported by the CPU
+  static bool isSupported(Backend backend);
+  static Backend getBackend();
+  // Not thread-safe, for tests and benchmarks only.
+  // Returns false if the backend is not supported.
+  static bool setBackend(Backend backend);
+
+  static void getMidstate(Midstate &midstate, const uint8_t *header);
+  // the hash of a header whose leading bytes have the midstate, only the
+  // bytes from kMidstateSize_ on are read
+  static void hash(uint8_t *out, const Midstate &midstate, const uint8_t *header);
+  static void hash(uint8_t *out, const uint8_t *header);
+};
+
+#endif // POOL_BLAKE256_DECRED_H_
@@ -0,0 +1,156 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) [2016] [BTC.COM]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+// blake256 compression with the rows of the state in SSE registers,
+// built with -msse4.1.
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+
+namespace blake256_sse41 {
+
+extern const bool kEnabled = true;
+
+namespace {
+
+typedef __m128i Vec;
+
+inline Vec Add(Vec x, Vec y) { return _mm_add_epi32(x, y); }
+inline Vec Xor(Vec x, Vec y) { return _mm_xor_si128(x, y); }
+
+// the rotations by 16 and 8 bits move whole bytes
+inline Vec Rotr16(Vec x) {
+  return _mm_shuffle_epi8(x, _mm_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13));
+}
+inline Vec Rotr8(Vec x) {
+  return _mm_shuffle_epi8(x, _mm_setr_epi8(1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12));
+}
+inline Vec Rotr12(Vec x) { return _mm_or_si128(_mm_srli_epi32(x, 12), _mm_slli_epi32(x, 20)); }
+inline Vec Rotr7(Vec x) { return _mm_or_si128(_mm_srli_epi32(x, 7), _mm_slli_epi32(x, 25)); }
+
+const uint32_t kConst[16] = {
+  0x243f6a88ul, 0x85a308d3ul, 0x13198a2eul, 0x03707344ul,
+  0xa4093822ul, 0x299f31d0ul, 0x082efa98ul, 0xec4e6c89ul,
+  0x452821e6ul, 0x38d01377ul, 0xbe5466cful, 0x34e90c6cul,
+  0xc0ac29b7ul, 0xc97c50ddul, 0x3f84d5b5ul, 0xb5470917ul
+};
+
+const uint8_t kSigma[10][16] = {
+  {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+  { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+  { 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+  {  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+  {  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+  {  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+  { 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+  { 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+  {  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+  { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13 , 0 }
+};
+
+// 4 G functions at once, one in every lane
+inline void G4(Vec &a, Vec &b, Vec &c, Vec &d, Vec x, Vec y) {
+  a = Add(Add(a, b), x);
+  d = Rotr16(Xor(d, a));
+  c = Add(c, d);
+  b = Rotr12(Xor(b, c));
+  a = Add(Add(a, b), y);
+  d = Rotr8(Xor(d, a));
+  c = Add(c, d);
+  b = Rotr7(Xor(b, c));
+}
+
+} // namespace
+
+void Compress(uint32_t *h, const uint8_t *block, uint32_t counter) {
+  // the message words are big endian
+  const Vec bswap = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+  uint32_t m[16];
+  for (int i = 0; i < 4; i++) {
+    const Vec words = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(block + 16 * i)), bswap);
+    _mm_storeu_si128((__m128i *)(m + 4 * i), words);
+  }
+
+  Vec row1 = _mm_loadu_si128((const __m128i *)h);
+  Vec row2 = _mm_loadu_si128((const __m128i *)(h + 4));
+  Vec row3 = _mm_loadu_si128((const __m128i *)kConst);
+  Vec row4 = Xor(_mm_loadu_si128((const __m128i *)(kConst + 4)),
+                 _mm_setr_epi32((int)counter, (int)counter, 0, 0));
+  const Vec h1 = row1, h2 = row2;
+
+  // macros rather than functions, so everything is inlined and the
+  // indexes of the message words are constants.
+  // The message words of 4 G functions, one in every lane
+#define BLAKE256_MESSAGE(r, first, second)                                  \
+  _mm_setr_epi32((int)(m[kSigma[r][first]]     ^ kConst[kSigma[r][second]]),     \
+                 (int)(m[kSigma[r][first + 2]] ^ kConst[kSigma[r][second + 2]]), \
+                 (int)(m[kSigma[r][first + 4]] ^ kConst[kSigma[r][second + 4]]), \
+                 (int)(m[kSigma[r][first + 6]] ^ kConst[kSigma[r][second + 6]]))
+
+#define BLAKE256_ROUND(r)                                                   \
+  do {                                                                      \
+    /* the columns */                                                       \
+    G4(row1, row2, row3, row4, BLAKE256_MESSAGE(r, 0, 1), BLAKE256_MESSAGE(r, 1, 0)); \
+    /* the diagonals, rotate the rows so they become columns */             \
+    row2 = _mm_shuffle_epi32(row2, _MM_SHUFFLE(0, 3, 2, 1));                \
+    row3 = _mm_shuffle_epi32(row3, _MM_SHUFFLE(1, 0, 3, 2));                \
+    row4 = _mm_shuffle_epi32(row4, _MM_SHUFFLE(2, 1, 0, 3));                \
+    G4(row1, row2, row3, row4, BLAKE256_MESSAGE(r, 8, 9), BLAKE256_MESSAGE(r, 9, 8)); \
+    row2 = _mm_shuffle_epi32(row2, _MM_SHUFFLE(2, 1, 0, 3));                \
+    row3 = _mm_shuffle_epi32(row3, _MM_SHUFFLE(1, 0, 3, 2));                \
+    row4 = _mm_shuffle_epi32(row4, _MM_SHUFFLE(0, 3, 2, 1));                \
+  } while (0)
+
+  BLAKE256_ROUND(0);
+  BLAKE256_ROUND(1);
+  BLAKE256_ROUND(2);
+  BLAKE256_ROUND(3);
+  BLAKE256_ROUND(4);
+  BLAKE256_ROUND(5);
+  BLAKE256_ROUND(6);
+  BLAKE256_ROUND(7);
+  BLAKE256_ROUND(8);
+  BLAKE256_ROUND(9);
+  BLAKE256_ROUND(0);
+  BLAKE256_ROUND(1);
+  BLAKE256_ROUND(2);
+  BLAKE256_ROUND(3);
+#undef BLAKE256_ROUND
+#undef BLAKE256_MESSAGE
+
+  _mm_storeu_si128((__m128i *)h, Xor(h1, Xor(row1, row3)));
+  _mm_storeu_si128((__m128i *)(h + 4), Xor(h2, Xor(row2, row4)));
+}
+
+} // namespace blake256_sse41
+
+#else
+
+namespace blake256_sse41 {
+extern const bool kEnabled = false;
+void Compress(uint32_t *, const uint8_t *, uint32_t) {}
+}
+
+#endif
@@ -40,6 +40,18 @@ uint256 BlockHeaderDecred::getHash() const
   return hash;
 }
 
+uint256 BlockHeaderDecred::getHash(const Blake256Decred::Midstate &midstate) const
+{
+  uint256 hash;
+  Blake256Decred::hash(hash.begin(), midstate, reinterpret_cast<const uint8_t *>(this));
+  return hash;
+}
+
+void BlockHeaderDecred::getMidstate(Blake256Decred::Midstate &midstate) const
+{
+  Blake256Decred::getMidstate(midstate, reinterpret_cast<const uint8_t *>(this));
+}
+
 const NetworkParamsDecred& NetworkParamsDecred::get(NetworkDecred network)
 {
   static NetworkParamsDecred mainnetParams{
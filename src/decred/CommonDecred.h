@@ -25,9 +25,12 @@
 #ifndef COMMON_DECRED_H_
 #define COMMON_DECRED_H_
 
+#include "Blake256Decred.h"
+
 #include <boost/endian/buffers.hpp>
 #include <arith_uint256.h>
 #include <uint256.h>
+#include <cstddef>
 #include <string>
 
 // Decred block header (https://docs.decred.org/advanced/block-header-specifications/)
@@ -53,9 +56,14 @@ struct BlockHeaderDecred {
   boost::endian::little_uint32_buf_t stakeVersion;
 
   uint256 getHash() const;
+  // the midstate of the leading bytes, which are the same for the shares of a job
+  uint256 getHash(const Blake256Decred::Midstate &midstate) const;
+  void getMidstate(Blake256Decred::Midstate &midstate) const;
 };
 
 static_assert(sizeof(BlockHeaderDecred) == 180, "Decred block header type is invalid");
+static_assert(offsetof(BlockHeaderDecred, height) == Blake256Decred::kMidstateSize_,
+              "The fields of a share should be after the midstate");
 
 // CMD_MAGIC_NUMBER number from the network type
 enum class NetworkDecred : uint32_t {
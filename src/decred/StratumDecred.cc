@@ -31,6 +31,7 @@ StratumJobDecred::StratumJobDecred()
   : StratumJob()
 {
   memset(&header_, 0, sizeof(BlockHeaderDecred));
+  header_.getMidstate(midstate_);
 }
 
 string StratumJobDecred::serializeToJson() const {
@@ -91,7 +92,8 @@ bool StratumJobDecred::unserializeFromJson(const char *s, size_t len) {
   UNSERIALIZE_SJOB_FIELD(version, &header_.version);
   UNSERIALIZE_SJOB_FIELD(target, target_.begin());
 #undef UNSERIALIZE_SJOB_FIELD
-  
+
+  header_.getMidstate(midstate_);
   return true;
 }
 
@@ -191,6 +191,13 @@ public:
     return true;
   }
 
+  IpAddress getIp() const
+  {
+    IpAddress ip;
+    ip.fromString(this->ip());
+    return ip;
+  }
+
   string toString() const
   {
     double networkDifficulty = NetworkParamsDecred::get((NetworkDecred)network()).powLimit.getdouble() / arith_uint256().SetCompact(blkbits()).getdouble();
@@ -307,6 +314,8 @@ public:
   static const size_t CoinBase1Size = offsetof(BlockHeaderDecred, extraData) - offsetof(BlockHeaderDecred, merkelRoot);
 
   BlockHeaderDecred header_;
+  // of the header's leading bytes, only the last block is hashed for a share
+  Blake256Decred::Midstate midstate_;
   uint256 target_;
   NetworkDecred network_;
 
@@ -90,6 +90,7 @@ void JobRepositoryDecred::broadcastStratumJob(shared_ptr<StratumJob> sjob)
 
     // insert new job
     exJobs_[jobDecred->jobId_] = jobEx;
+    updateJobsSnapshot();
   }
 
   // We want to update jobs immediately if there are more voters for the same height block
@@ -174,7 +175,8 @@ int ServerDecred::checkShare(ShareDecred &share, shared_ptr<StratumJobEx> exJobP
   header.nonce = nonce;
   protocol_->setExtraNonces(header, share.sessionid(), extraNonce2);
 
-  uint256 blkHash = header.getHash();
+  // only the timestamp, nonce and extra nonces changed, they are after the midstate
+  uint256 blkHash = header.getHash(sjob->midstate_);
   auto bnBlockHash = UintToArith256(blkHash);
   auto bnNetworkTarget = UintToArith256(sjob->target_);
 
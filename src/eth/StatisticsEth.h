@@ -44,6 +44,9 @@ struct GlobalShareEth {
 
   GlobalShareEth& operator=(const GlobalShareEth &r) = default;
 
+  // see DuplicateShareCheckerT, nonces are random enough
+  uint64_t shard() const { return nonce_; }
+
   bool operator<(const GlobalShareEth &r) const {
     if (headerHash_ < r.headerHash_ ||
         (headerHash_ == r.headerHash_ && nonce_ < r.nonce_)) {
@@ -101,6 +101,9 @@ void StratumClientEth::handleLine(const string &line) {
         jresult.type() != Utilities::JS::type::Bool ||
         jresult.boolean() != true) {
 //      LOG(ERROR) << "json result is null, err: " << jerror.str() << ", line: " << line;
+      rejectedShares_++;
+    } else {
+      acceptedShares_++;
     }
     return;
   }
@@ -189,6 +189,13 @@ public:
     return true;
   }
 
+  IpAddress getIp() const
+  {
+    IpAddress ip;
+    ip.fromString(this->ip());
+    return ip;
+  }
+
   string toString() const
   {
 
@@ -178,21 +178,21 @@ void StratumMinerEth::handleRequest_Submit(const string &idStr, const JsonNode &
   }
   auto &jobDiff = iter->second;
 
-  ShareEth share;
-  share.set_version(ShareEth::getVersion(chain));
-  share.set_headerhash(headerPrefix);
-  share.set_workerhashid(workerId_);
-  share.set_userid(worker.userId_);
-  share.set_sharediff(jobDiff.currentJobDiff_);
-  share.set_networkdiff(networkDiff);
-  share.set_timestamp((uint64_t) time(nullptr));
-  share.set_status(StratumStatus::REJECT_NO_REASON);
-  share.set_height(height);
-  share.set_nonce(nonce);
-  share.set_sessionid(extraNonce1); // TODO: fix it, set as real session id.
+  auto share = std::make_shared<ShareEth>();
+  share->set_version(ShareEth::getVersion(chain));
+  share->set_headerhash(headerPrefix);
+  share->set_workerhashid(workerId_);
+  share->set_userid(worker.userId_);
+  share->set_sharediff(jobDiff.currentJobDiff_);
+  share->set_networkdiff(networkDiff);
+  share->set_timestamp((uint64_t) time(nullptr));
+  share->set_status(StratumStatus::REJECT_NO_REASON);
+  share->set_height(height);
+  share->set_nonce(nonce);
+  share->set_sessionid(extraNonce1); // TODO: fix it, set as real session id.
   IpAddress ip;
   ip.fromIpv4Int(session.getClientIp());
-  share.set_ip(ip.toString());
+  share->set_ip(ip.toString());
 
   LocalShare localShare(nonce, 0, 0);
   // can't add local share
@@ -209,45 +209,54 @@ void StratumMinerEth::handleRequest_Submit(const string &idStr, const JsonNode &
   // by the miner is correct, because we recalculated it.
   // SolvedShare will be accepted correctly by the ETH node if
   // the difficulty is reached in our calculations.
-  uint256 shareMixHash;
-  share.set_status(server.checkShareAndUpdateDiff(share, localJob->jobId_, nonce, uint256S(sHeader),
-                                                 jobDiff.jobDiffs_, shareMixHash, worker.fullName_));
-
-  if (StratumStatus::isAccepted(share.status())) {
-    DLOG(INFO) << "share reached the diff: " << share.sharediff();
-  } else {
-    DLOG(INFO) << "share not reached the diff: " << share.sharediff();
-  }
-
-  // we send share to kafka by default, but if there are lots of invalid
-  // shares in a short time, we just drop them.
-  if (handleShare(idStr, share.status(), share.sharediff())) {
-    if (StratumStatus::isSolved(share.status())) {
-      server.sendSolvedShare2Kafka(sNonce, sHeader, shareMixHash.GetHex(), height, networkDiff, worker, chain);
+  //
+  // Light verification is slow, it runs out of the event loop and
+  // the following is done in the event loop when it's finished.
+  server.checkShareAndUpdateDiffAsync(session, share, localJob->jobId_, nonce, uint256S(sHeader),
+                                      jobDiff.jobDiffs_, worker.fullName_,
+                                      [this, idStr, share, sNonce, sHeader, height, networkDiff, chain, clientIp]
+                                      (int status, const uint256 &shareMixHash) {
+    auto &session = getSession();
+    auto &server = session.getServer();
+    auto &worker = session.getWorker();
+    share->set_status(status);
+
+    if (StratumStatus::isAccepted(share->status())) {
+      DLOG(INFO) << "share reached the diff: " << share->sharediff();
+    } else {
+      DLOG(INFO) << "share not reached the diff: " << share->sharediff();
     }
-  } else {
-    // check if there is invalid share spamming
-    int64_t invalidSharesNum = invalidSharesCounter_.sum(time(nullptr), INVALID_SHARE_SLIDING_WINDOWS_SIZE);
-    // too much invalid shares, don't send them to kafka
-    if (invalidSharesNum >= INVALID_SHARE_SLIDING_WINDOWS_MAX_LIMIT) {
-      LOG(WARNING) << "invalid share spamming, diff: "
-                   << share.sharediff() << ", uid: " << worker.userId_
-                   << ", uname: \"" << worker.userName_ << "\", ip: " << clientIp
-                   << "checkshare result: " << share.status();
-      return;
+
+    // we send share to kafka by default, but if there are lots of invalid
+    // shares in a short time, we just drop them.
+    if (handleShare(idStr, share->status(), share->sharediff())) {
+      if (StratumStatus::isSolved(share->status())) {
+        server.sendSolvedShare2Kafka(sNonce, sHeader, shareMixHash.GetHex(), height, networkDiff, worker, chain);
+      }
+    } else {
+      // check if there is invalid share spamming
+      int64_t invalidSharesNum = invalidSharesCounter_.sum(time(nullptr), INVALID_SHARE_SLIDING_WINDOWS_SIZE);
+      // too much invalid shares, don't send them to kafka
+      if (invalidSharesNum >= INVALID_SHARE_SLIDING_WINDOWS_MAX_LIMIT) {
+        LOG(WARNING) << "invalid share spamming, diff: "
+                     << share->sharediff() << ", uid: " << worker.userId_
+                     << ", uname: \"" << worker.userName_ << "\", ip: " << clientIp
+                     << "checkshare result: " << share->status();
+        return;
+      }
     }
-  }
 
-  DLOG(INFO) << share.toString();
+    DLOG(INFO) << share->toString();
 
-  std::string message;
-  uint32_t size = 0;
-  if (!share.SerializeToArrayWithVersion(message, size)) {
-    LOG(ERROR) << "share SerializeToBuffer failed!"<< share.toString();
-    return;
-  }
+    std::string message;
+    uint32_t size = 0;
+    if (!share->SerializeToArrayWithVersion(message, size)) {
+      LOG(ERROR) << "share SerializeToBuffer failed!"<< share->toString();
+      return;
+    }
 
-  server.sendShare2Kafka((const uint8_t *) message.data(), size);
+    server.sendShare2Kafka((const uint8_t *) message.data(), size);
+  });
 }
 
 void StratumMinerEth::responseError(const string &idStr, int code) {
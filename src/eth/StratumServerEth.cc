@@ -45,7 +45,8 @@ JobRepositoryEth::JobRepositoryEth(const char *kafkaBrokers, const char *consume
   : JobRepositoryBase(kafkaBrokers, consumerTopic, fileLastNotifyTime, server)
   , light_(nullptr)
   , nextLight_(nullptr)
-  , epochs_(0xffffffffffffffff)
+  , epochs_(kNoEpochs_)
+  , rebuildingLight_(false)
 {
   loadLightFromFile();
 }
@@ -82,6 +83,7 @@ void JobRepositoryEth::broadcastStratumJob(shared_ptr<StratumJob> sjob) {
 
     // insert new job
     exJobs_[sjobEth->jobId_] = exJob;
+    updateJobsSnapshot();
   }
 
   //send job first
@@ -95,9 +97,24 @@ JobRepositoryEth::~JobRepositoryEth() {
   deleteLight();
 }
 
-void JobRepositoryEth::rebuildLightNonBlocking(shared_ptr<StratumJobEth> job) {
-  epochs_ = 0;
-  newLightNonBlocking(job);
+bool JobRepositoryEth::rebuildLightNonBlocking(shared_ptr<StratumJobEth> job) {
+  if (!job) {
+    return false;
+  }
+  // every share fails while the light is missing, only one of them rebuilds it
+  bool expected = false;
+  if (!rebuildingLight_.compare_exchange_strong(expected, true)) {
+    return false;
+  }
+
+  epochs_ = kNoEpochs_;
+  const uint64_t height = job->height_;
+  boost::thread t([this, height]() {
+    _newLightThread(height);
+    rebuildingLight_ = false;
+  });
+  t.detach();
+  return true;
 }
 
 void JobRepositoryEth::newLightNonBlocking(shared_ptr<StratumJobEth> job) {
@@ -118,9 +135,15 @@ void JobRepositoryEth::_newLightThread(uint64_t height)
   }
 
   {
-    ScopeLock slLight(lightLock_);
+    // compute() is not blocked here, it keeps using the old light
+    // until the new one was set.
     ScopeLock slNextLight(nextLightLock_);
 
+    // the thread holding the lock before has just made it
+    if (newEpochs == epochs_ && getLight() != nullptr) {
+      return;
+    }
+
     // Update epochs_ immediately to prevent the next thread
     // blocking for waiting nextLightLock_.
     uint64_t oldEpochs = epochs_;
@@ -129,28 +152,26 @@ void JobRepositoryEth::_newLightThread(uint64_t height)
     LOG(INFO) << "creating light for blk height... " << height;
     time_t now = time(nullptr);
 
+    EthashLightPtr light;
     if (nullptr == nextLight_) {
-      light_ = ethash_light_new(height);
+      light = makeLightPtr(ethash_light_new(height));
     }
     else if (newEpochs == oldEpochs + 1) {
       //get pre-generated light if exists
-      ethash_light_delete(light_);
-      light_ =  nextLight_;
+      light = nextLight_;
       nextLight_ = nullptr;
     }
     else {
       // pre-generated light unavailable because of epochs jumping
-      ethash_light_delete(nextLight_);
       nextLight_ = nullptr;
-
-      ethash_light_delete(light_);
       // regenerate light with current epochs
-      light_ = ethash_light_new(height);
+      light = makeLightPtr(ethash_light_new(height));
     }
 
-    if (nullptr == light_) {
+    if (nullptr == light) {
       LOG(FATAL) << "create light for blk height: " << height << " failed";
     }
+    setLight(light);
 
     time_t elapse = time(nullptr) - now;
     // Note: The performance difference between Debug and Release builds is very large.
@@ -165,7 +186,7 @@ void JobRepositoryEth::_newLightThread(uint64_t height)
     uint64_t nextBlkNum = height + ETHASH_EPOCH_LENGTH;
     LOG(INFO) << "creating light for blk height... " << nextBlkNum;
 
-    nextLight_ = ethash_light_new(nextBlkNum);
+    nextLight_ = makeLightPtr(ethash_light_new(nextBlkNum));
 
     time_t elapse = time(nullptr) - now;
     // Note: The performance difference between Debug and Release builds is very large.
@@ -174,30 +195,33 @@ void JobRepositoryEth::_newLightThread(uint64_t height)
   }
 }
 
-void JobRepositoryEth::deleteLight()
-{
-  ScopeLock slLight(lightLock_);
-  ScopeLock slNextLight(nextLightLock_);
-  deleteLightNoLock();
+EthashLightPtr JobRepositoryEth::makeLightPtr(ethash_light_t light) {
+  if (light == nullptr) {
+    return nullptr;
+  }
+  return EthashLightPtr(light, ethash_light_delete);
 }
 
-void JobRepositoryEth::deleteLightNoLock() {
-  if (light_ != nullptr) {
-    ethash_light_delete(light_);
-    light_ = nullptr;
-  }
+EthashLightPtr JobRepositoryEth::getLight() const {
+  return std::atomic_load(&light_);
+}
 
-  if (nextLight_ != nullptr) {
-    ethash_light_delete(nextLight_);
-    nextLight_ = nullptr;
-  }
+void JobRepositoryEth::setLight(EthashLightPtr light) {
+  std::atomic_store(&light_, light);
+}
+
+void JobRepositoryEth::deleteLight()
+{
+  ScopeLock slNextLight(nextLightLock_);
+  setLight(nullptr);
+  nextLight_ = nullptr;
 }
 
 void JobRepositoryEth::saveLightToFile() {
-  ScopeLock slLight(lightLock_);
   ScopeLock slNextLight(nextLightLock_);
+  auto light = getLight();
 
-  if (light_ == nullptr && nextLight_ == nullptr) {
+  if (light == nullptr && nextLight_ == nullptr) {
     LOG(INFO) << "no DAG light can be cached";
     return;
   }
@@ -208,14 +232,14 @@ void JobRepositoryEth::saveLightToFile() {
     return;
   }
 
-  if (light_ != nullptr) {
+  if (light != nullptr) {
     LOG(INFO) << "cache DAG light of current epoch to file...";
-    saveLightToFile(light_, f);
+    saveLightToFile(light.get(), f);
   }
 
   if (nextLight_ != nullptr) {
     LOG(INFO) << "cache DAG light of next epoch to file...";
-    saveLightToFile(nextLight_, f);
+    saveLightToFile(nextLight_.get(), f);
   }
 
   f.close();
@@ -234,7 +258,6 @@ void JobRepositoryEth::saveLightToFile(const ethash_light_t &light, std::ofstrea
 }
 
 void JobRepositoryEth::loadLightFromFile() {
-  ScopeLock slLight(lightLock_);
   ScopeLock slNextLight(nextLightLock_);
 
   std::ifstream f(kLightCacheFilePath, std::ios::binary);
@@ -244,13 +267,14 @@ void JobRepositoryEth::loadLightFromFile() {
   }
 
   LOG(INFO) << "load DAG light of current epoch from file...";
-  light_ = loadLightFromFile(f);
+  auto light = makeLightPtr(loadLightFromFile(f));
 
   LOG(INFO) << "load DAG light of next epoch from file...";
-  nextLight_ = loadLightFromFile(f);
+  nextLight_ = makeLightPtr(loadLightFromFile(f));
 
-  if (light_ != nullptr) {
-    epochs_ = light_->block_number / ETHASH_EPOCH_LENGTH;
+  if (light != nullptr) {
+    epochs_ = light->block_number / ETHASH_EPOCH_LENGTH;
+    setLight(light);
   }
 
   f.close();
@@ -345,10 +369,12 @@ uint64_t JobRepositoryEth::computeLightCacheCheckSum(const LightCacheHeader &hea
 
 bool JobRepositoryEth::compute(ethash_h256_t const header, uint64_t nonce, ethash_return_value_t &r)
 {
-  ScopeLock sl(lightLock_);
-  if (light_ != nullptr)
+  // Holding a reference, the light will not be freed even if
+  // a new epoch's light is set during computing.
+  auto light = getLight();
+  if (light != nullptr)
   {
-    r = ethash_light_compute(light_, header, nonce);
+    r = ethash_light_compute(light.get(), header, nonce);
     // LOG(INFO) << "ethash_light_compute: " << r.success << ", result: ";
     // for (int i = 0; i < 32; ++i)
     //   LOG(INFO) << hex << (int)r.result.b[i];
@@ -359,12 +385,24 @@ bool JobRepositoryEth::compute(ethash_h256_t const header, uint64_t nonce, ethas
 
     return r.success;
   }
-  LOG(ERROR) << "light_ is nullptr, what's wrong?";
+  // being created, see rebuildLightNonBlocking()
   return false;
 }
 
 
 ////////////////////////////////// ServierEth ///////////////////////////////
+ServerEth::ServerEth(const int32_t shareAvgSeconds, const libconfig::Config &config)
+  : ServerBase(shareAvgSeconds)
+  , shareCheckThreads_(std::thread::hardware_concurrency())
+{
+  config.lookupValue("sserver.share_check_threads", shareCheckThreads_);
+}
+
+ServerEth::~ServerEth() {
+  // finish the running checks before the job repository and sessions go away
+  shareCheckPool_.reset();
+}
+
 bool ServerEth::setupInternal(StratumServer* sserver) {
   // TODO: WORK_WITH_STRATUM_SWITCHER only effects Bitcoin's sserver
   #ifndef WORK_WITH_STRATUM_SWITCHER
@@ -382,6 +420,11 @@ bool ServerEth::setupInternal(StratumServer* sserver) {
     sessionIDManager_->setAllocInterval(256);
   #endif
 
+  if (shareCheckThreads_ > 0) {
+    LOG(INFO) << "checking shares in " << shareCheckThreads_ << " threads";
+    shareCheckPool_ = boost::make_unique<WorkerPool>(shareCheckThreads_);
+  }
+
   return true;
 }
 
@@ -433,8 +476,9 @@ int ServerEth::checkShareAndUpdateDiff(ShareEth &share,
 
   if (!ret || !r.success)
   {
-    LOG(ERROR) << "light cache creation error, try re-create it";
-    jobRepo->rebuildLightNonBlocking(sjob);
+    if (jobRepo->rebuildLightNonBlocking(sjob)) {
+      LOG(ERROR) << "light cache is not ready or broken, try re-create it";
+    }
     return StratumStatus::INTERNAL_ERROR;
   }
 
@@ -486,6 +530,42 @@ int ServerEth::checkShareAndUpdateDiff(ShareEth &share,
   return StratumStatus::LOW_DIFFICULTY;
 }
 
+void ServerEth::checkShareAndUpdateDiffAsync(StratumSession &session,
+                                             shared_ptr<ShareEth> share,
+                                             const uint64_t jobId,
+                                             const uint64_t nonce,
+                                             const uint256 &header,
+                                             const std::set<uint64_t> &jobDiffs,
+                                             const string &workFullName,
+                                             std::function<void(int status, const uint256 &mixHash)> callback)
+{
+  if (!shareCheckPool_) {
+    uint256 mixHash;
+    int status = checkShareAndUpdateDiff(*share, jobId, nonce, header, jobDiffs, mixHash, workFullName);
+    callback(status, mixHash);
+    return;
+  }
+
+  session.beginAsyncTask();
+  // jobDiffs and workFullName may be changed by the session, copy them
+  bool posted = shareCheckPool_->post([this, &session, share, jobId, nonce, header, jobDiffs, workFullName, callback]() {
+    uint256 mixHash;
+    int status = checkShareAndUpdateDiff(*share, jobId, nonce, header, jobDiffs, mixHash, workFullName);
+    session.finishAsyncTask([callback, status, mixHash]() {
+      callback(status, mixHash);
+    });
+  });
+
+  if (!posted) {
+    // the pool has been stopped, otherwise the session could never be freed
+    session.endAsyncTask();
+    LOG(WARNING) << "share checking threads stopped, check the share in the event loop";
+    uint256 mixHash;
+    int status = checkShareAndUpdateDiff(*share, jobId, nonce, header, jobDiffs, mixHash, workFullName);
+    callback(status, mixHash);
+  }
+}
+
 void ServerEth::sendSolvedShare2Kafka(const string &strNonce, const string &strHeader, const string &strMix,
                                       const uint32_t height, const uint64_t networkDiff, const StratumWorker &worker,
                                       const EthConsensus::Chain chain)
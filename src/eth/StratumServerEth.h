@@ -29,13 +29,19 @@
 #include <set>
 #include "StratumServer.h"
 #include "StratumEth.h"
+#include "WorkerPool.h"
 
 class JobRepositoryEth;
 
+// ethash light (DAG cache) never changes after created, so it can be used by
+// many threads without locking. It will be freed when the last user released it.
+using EthashLightPtr = std::shared_ptr<struct ethash_light>;
+
 class ServerEth : public ServerBase<JobRepositoryEth>
 {
 public:
-  ServerEth(const int32_t shareAvgSeconds) : ServerBase(shareAvgSeconds) {}
+  ServerEth(const int32_t shareAvgSeconds, const libconfig::Config &config);
+  virtual ~ServerEth();
   bool setupInternal(StratumServer* sserver) override;
   int checkShareAndUpdateDiff(ShareEth &share,
                               const uint64_t jobId,
@@ -44,6 +50,17 @@ public:
                               const std::set<uint64_t> &jobDiffs,
                               uint256 &returnedMixHash,
                               const string &workFullName);
+  // Same as checkShareAndUpdateDiff() but running in the share checking threads,
+  // `callback` will be called in the event loop of `session` with the result.
+  // The session must not be freed before that.
+  void checkShareAndUpdateDiffAsync(StratumSession &session,
+                                    shared_ptr<ShareEth> share,
+                                    const uint64_t jobId,
+                                    const uint64_t nonce,
+                                    const uint256 &header,
+                                    const std::set<uint64_t> &jobDiffs,
+                                    const string &workFullName,
+                                    std::function<void(int status, const uint256 &mixHash)> callback);
   void sendSolvedShare2Kafka(const string& strNonce, const string& strHeader, const string& strMix,
                              const uint32_t height, const uint64_t networkDiff, const StratumWorker &worker,
                              const EthConsensus::Chain chain);
@@ -53,6 +70,12 @@ public:
                                      const string &fileLastNotifyTime) override;
 
   unique_ptr<StratumSession> createConnection(struct bufferevent *bev, struct sockaddr *saddr, const uint32_t sessionID) override;
+
+private:
+  // light verification is CPU heavy, it's done in these threads rather
+  // than the event loops. 0 means checking shares in the event loops.
+  uint32_t shareCheckThreads_;
+  unique_ptr<WorkerPool> shareCheckPool_;
 };
 
 class JobRepositoryEth : public JobRepositoryBase<ServerEth>
@@ -61,14 +84,21 @@ public:
   JobRepositoryEth(const char *kafkaBrokers, const char *consumerTopic, const string &fileLastNotifyTime, ServerEth *server);
   virtual ~JobRepositoryEth();
 
+  // thread-safe, the light is only locked while its pointer is copied
   bool compute(ethash_h256_t const header, uint64_t nonce, ethash_return_value_t& r);
 
+  // light of the current epoch, the old one is kept alive until
+  // all computing with it finished.
+  EthashLightPtr getLight() const;
+  void setLight(EthashLightPtr light);
+
   shared_ptr<StratumJob> createStratumJob() override { return std::make_shared<StratumJobEth>(); }
   shared_ptr<StratumJobEx> createStratumJobEx(shared_ptr<StratumJob> sjob, bool isClean) override;
   void broadcastStratumJob(shared_ptr<StratumJob> sjob) override;
 
-  // re-computing light when checking share failed.
-  void rebuildLightNonBlocking(shared_ptr<StratumJobEth> job);
+  // re-computing light when checking share failed, false if a rebuilding
+  // is already in flight (the shares fail until its light is set).
+  bool rebuildLightNonBlocking(shared_ptr<StratumJobEth> job);
 
 private:
   // TODO: move to configuration file
@@ -84,7 +114,6 @@ private:
   void newLightNonBlocking(shared_ptr<StratumJobEth> job);
   void _newLightThread(uint64_t height);
   void deleteLight();
-  void deleteLightNoLock();
 
   // Creating a new ethash_light_t (DAG cache) is so slow (in Debug build),
   // it may need more than 120 seconds for current Ethereum mainnet.
@@ -99,11 +128,19 @@ private:
   ethash_light_t loadLightFromFile(std::ifstream &f);
   uint64_t computeLightCacheCheckSum(const LightCacheHeader &header, const uint8_t *data);
 
-  ethash_light_t light_;
-  ethash_light_t nextLight_;
-  std::atomic<uint64_t> epochs_;
-  mutex lightLock_;
+  static EthashLightPtr makeLightPtr(ethash_light_t light);
+
+  // accessed only by std::atomic_load() / std::atomic_store(), which are not
+  // lock-free for shared_ptr: libstdc++ guards them with a pool of mutexes.
+  // It's cheap compared with ethash_light_compute() of every share.
+  EthashLightPtr light_;
+  // guarded by nextLightLock_, only one thread can create lights at the same time
+  EthashLightPtr nextLight_;
   mutex nextLightLock_;
+  std::atomic<uint64_t> epochs_;
+  // a rebuilding thread is queued or running
+  std::atomic<bool> rebuildingLight_;
+  static const uint64_t kNoEpochs_ = 0xffffffffffffffff;
 
   uint32_t lastHeight_;
 };
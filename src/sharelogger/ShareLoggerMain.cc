@@ -76,6 +76,10 @@ std::shared_ptr<ShareLogWriter> newShareLogWriter(const string &kafkaBrokers, co
   int compressionLevel = Z_DEFAULT_COMPRESSION;
   def.lookupValue("compression_level", compressionLevel);
 
+  bool rawFormat = false;
+  int zstdCompressionLevel = 3;
+  def.lookupValue("raw_format", rawFormat);
+  def.lookupValue("zstd_compression_level", zstdCompressionLevel);
 
 
 #if defined(CHAIN_TYPE_STR)
@@ -89,7 +93,7 @@ std::shared_ptr<ShareLogWriter> newShareLogWriter(const string &kafkaBrokers, co
                                               def.lookup("data_dir").c_str(),
                                               def.lookup("kafka_group_id").c_str(),
                                               def.lookup("share_topic"),
-                                              compressionLevel);
+                                              compressionLevel, rawFormat, zstdCompressionLevel);
   }
   else if (chainType == "ETH") {
     return make_shared<ShareLogWriterEth>(def.lookup("chain_type").c_str(),
@@ -97,7 +101,7 @@ std::shared_ptr<ShareLogWriter> newShareLogWriter(const string &kafkaBrokers, co
                                           def.lookup("data_dir").c_str(),
                                           def.lookup("kafka_group_id").c_str(),
                                           def.lookup("share_topic"),
-                                          compressionLevel);
+                                          compressionLevel, rawFormat, zstdCompressionLevel);
   }
   else if (chainType == "BTM") {
     return make_shared<ShareLogWriterBytom>(def.lookup("chain_type").c_str(),
@@ -105,7 +109,7 @@ std::shared_ptr<ShareLogWriter> newShareLogWriter(const string &kafkaBrokers, co
                                           def.lookup("data_dir").c_str(),
                                           def.lookup("kafka_group_id").c_str(),
                                           def.lookup("share_topic"),
-                                          compressionLevel);    
+                                          compressionLevel, rawFormat, zstdCompressionLevel);    
   }
   else if (chainType == "DCR") {
     return make_shared<ShareLogWriterDecred>(chainType.c_str(),
@@ -113,7 +117,7 @@ std::shared_ptr<ShareLogWriter> newShareLogWriter(const string &kafkaBrokers, co
                                              def.lookup("data_dir").c_str(),
                                              def.lookup("kafka_group_id").c_str(),
                                              def.lookup("share_topic"),
-                                             compressionLevel);
+                                             compressionLevel, rawFormat, zstdCompressionLevel);
   }
   else {
     LOG(FATAL) << "Unknown chain type " << chainType;
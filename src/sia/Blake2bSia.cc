@@ -0,0 +1,238 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) [2016] [BTC.COM]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+#include "Blake2bSia.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#define BLAKE2B_X86 1
+#endif
+
+// the AVX2 backend is in its own translation unit compiled with -mavx2.
+// kEnabled is false if the compiler doesn't support it.
+namespace blake2b_avx2 {
+extern const bool kEnabled;
+void Hash80x4(uint8_t *out, const uint8_t *in);
+}
+
+namespace {
+
+const uint64_t kInit[8] = {
+  0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+  0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+const uint8_t kSigma[12][16] = {
+  {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+  { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+  { 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+  {  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+  {  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+  {  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+  { 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+  { 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+  {  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+  { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13 , 0 },
+  {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+  { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 }
+};
+
+inline uint64_t ReadLE64(const uint8_t *p) {
+  uint64_t x;
+  memcpy(&x, p, 8);  // x86 and arm are little endian
+  return x;
+}
+
+inline void WriteLE64(uint8_t *p, uint64_t x) {
+  memcpy(p, &x, 8);
+}
+
+inline uint64_t Rotr(uint64_t x, int n) { return (x >> n) | (x << (64 - n)); }
+
+inline void G(uint64_t *v, const uint64_t *m, int r, int i, int a, int b, int c, int d) {
+  v[a] = v[a] + v[b] + m[kSigma[r][2 * i]];
+  v[d] = Rotr(v[d] ^ v[a], 32);
+  v[c] = v[c] + v[d];
+  v[b] = Rotr(v[b] ^ v[c], 24);
+  v[a] = v[a] + v[b] + m[kSigma[r][2 * i + 1]];
+  v[d] = Rotr(v[d] ^ v[a], 16);
+  v[c] = v[c] + v[d];
+  v[b] = Rotr(v[b] ^ v[c], 63);
+}
+
+// an 80-byte header is one block, the last one, with 48 bytes of zeros
+void Hash80Generic(uint8_t *out, const uint8_t *in) {
+  uint64_t m[16] = {0};
+  for (int i = 0; i < 10; i++) {
+    m[i] = ReadLE64(in + 8 * i);
+  }
+
+  // the parameter block: 32 bytes digest, no key, fanout 1, depth 1
+  const uint64_t h0 = kInit[0] ^ 0x01010020ULL;
+  uint64_t v[16];
+  v[0] = h0;
+  for (int i = 1; i < 8; i++) {
+    v[i] = kInit[i];
+  }
+  for (int i = 0; i < 8; i++) {
+    v[i + 8] = kInit[i];
+  }
+  v[12] ^= 80;    // the counter
+  v[14] = ~v[14]; // the last block
+
+  for (int r = 0; r < 12; r++) {
+    G(v, m, r, 0, 0, 4,  8, 12);
+    G(v, m, r, 1, 1, 5,  9, 13);
+    G(v, m, r, 2, 2, 6, 10, 14);
+    G(v, m, r, 3, 3, 7, 11, 15);
+    G(v, m, r, 4, 0, 5, 10, 15);
+    G(v, m, r, 5, 1, 6, 11, 12);
+    G(v, m, r, 6, 2, 7,  8, 13);
+    G(v, m, r, 7, 3, 4,  9, 14);
+  }
+
+  WriteLE64(out, h0 ^ v[0] ^ v[8]);
+  for (int i = 1; i < 4; i++) {
+    WriteLE64(out + 8 * i, kInit[i] ^ v[i] ^ v[i + 8]);
+  }
+}
+
+typedef void (*HashMultiFunc)(uint8_t *out, const uint8_t *in);
+
+// Constant initialized, so they are valid even before the static
+// initializer below picks the best backend.
+Blake2bSia::Backend gBackend = Blake2bSia::GENERIC;
+HashMultiFunc gHashMulti = nullptr;
+size_t gLanes = 1;
+
+#ifdef BLAKE2B_X86
+uint64_t xgetbv() {
+  uint32_t a, d;
+  __asm__ ("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+  return ((uint64_t)d << 32) | a;
+}
+#endif
+
+bool detectSupported(Blake2bSia::Backend backend) {
+  if (backend == Blake2bSia::GENERIC) {
+    return true;
+  }
+#ifdef BLAKE2B_X86
+  uint32_t a, b, c, d;
+  if (__get_cpuid_max(0, nullptr) < 7) {
+    return false;
+  }
+  __cpuid_count(1, 0, a, b, c, d);
+  // AVX needs the OS to save the YMM registers
+  const bool hasAVX = ((c >> 27) & 1) && ((c >> 28) & 1) && ((xgetbv() & 6) == 6);
+  __cpuid_count(7, 0, a, b, c, d);
+  const bool hasAVX2 = hasAVX && ((b >> 5) & 1);
+
+  switch (backend) {
+    case Blake2bSia::AVX2:
+      return blake2b_avx2::kEnabled && hasAVX2;
+    default:
+      return false;
+  }
+#else
+  return false;
+#endif
+}
+
+bool initBackend() {
+  for (int i = Blake2bSia::kBackends_ - 1; i >= 0; i--) {
+    if (Blake2bSia::setBackend((Blake2bSia::Backend)i)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+const bool gInitialized = initBackend();
+
+} // namespace
+
+//////////////////////////////// Blake2bSia ////////////////////////////////
+const size_t Blake2bSia::kBackends_;
+const size_t Blake2bSia::kHeaderSize_;
+const size_t Blake2bSia::kHashSize_;
+
+const char *Blake2bSia::getBackendName(Backend backend) {
+  switch (backend) {
+    case GENERIC: return "generic";
+    case AVX2:    return "avx2(4-way)";
+  }
+  return "unknown";
+}
+
+bool Blake2bSia::isSupported(Backend backend) {
+  return detectSupported(backend);
+}
+
+Blake2bSia::Backend Blake2bSia::getBackend() {
+  return gBackend;
+}
+
+bool Blake2bSia::setBackend(Backend backend) {
+  if (!detectSupported(backend)) {
+    return false;
+  }
+
+  gBackend = backend;
+  gHashMulti = nullptr;
+  gLanes = 1;
+
+  if (backend == AVX2) {
+    gHashMulti = blake2b_avx2::Hash80x4;
+    gLanes = 4;
+  }
+  return true;
+}
+
+void Blake2bSia::hash80(uint8_t *out, const uint8_t *in, size_t n) {
+  if (gHashMulti != nullptr) {
+    while (n >= gLanes) {
+      gHashMulti(out, in);
+      out += kHashSize_ * gLanes;
+      in  += kHeaderSize_ * gLanes;
+      n   -= gLanes;
+    }
+    // a partial batch still takes less time in the lanes than one by one
+    if (n >= 2) {
+      uint8_t headers[kHeaderSize_ * 4] = {0};
+      uint8_t hashes[kHashSize_ * 4];
+      memcpy(headers, in, kHeaderSize_ * n);
+      gHashMulti(hashes, headers);
+      memcpy(out, hashes, kHashSize_ * n);
+      return;
+    }
+  }
+  while (n > 0) {
+    Hash80Generic(out, in);
+    out += kHashSize_;
+    in  += kHeaderSize_;
+    n--;
+  }
+}
@@ -0,0 +1,64 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) [2016] [BTC.COM]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+#ifndef POOL_BLAKE2B_SIA_H_
+#define POOL_BLAKE2B_SIA_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+//////////////////////////////// Blake2bSia ////////////////////////////////
+// The blake2b-256 of sia's 80-byte block headers, the same as the reference
+// blake2b(out, 32, header, 80, nullptr, 0) of 3rdparty/libblake2.
+//
+// The backend is chosen at startup by the CPU features:
+//   AVX2    - 4 headers at once
+//   GENERIC - plain C++, always available
+//
+// The AVX2 backend only helps when several headers are hashed together,
+// see ShareVerifierSia.
+class Blake2bSia {
+public:
+  enum Backend {
+    GENERIC = 0,
+    AVX2    = 1
+  };
+  static const size_t kBackends_ = 2;
+
+  static const size_t kHeaderSize_ = 80;
+  static const size_t kHashSize_   = 32;
+
+  static const char *getBackendName(Backend backend);
+  // compiled in and supported by the CPU
+  static bool isSupported(Backend backend);
+  static Backend getBackend();
+  // Not thread-safe, for tests and benchmarks only.
+  // Returns false if the backend is not supported.
+  static bool setBackend(Backend backend);
+
+  // the hashes of n independent headers, out[i*32] = H(in[i*80])
+  static void hash80(uint8_t *out, const uint8_t *in, size_t n);
+  static void hash80(uint8_t *out, const uint8_t *in) { hash80(out, in, 1); }
+};
+
+#endif // POOL_BLAKE2B_SIA_H_
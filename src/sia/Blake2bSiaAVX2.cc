@@ -0,0 +1,164 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) [2016] [BTC.COM]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+// 4-way blake2b-256 of 80-byte headers with AVX2, built with -mavx -mavx2.
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+namespace blake2b_avx2 {
+
+extern const bool kEnabled = true;
+
+namespace {
+
+typedef __m256i Vec;
+
+inline Vec Add(Vec x, Vec y) { return _mm256_add_epi64(x, y); }
+inline Vec Xor(Vec x, Vec y) { return _mm256_xor_si256(x, y); }
+inline Vec Set1(uint64_t x) { return _mm256_set1_epi64x((long long)x); }
+
+inline uint64_t ReadLE64(const uint8_t *p) {
+  uint64_t x;
+  memcpy(&x, p, 8);
+  return x;
+}
+
+// word i of every lane, the headers are 80 bytes apart
+inline Vec Load(const uint8_t *in, int i) {
+  return _mm256_set_epi64x((long long)ReadLE64(in + 240 + 8 * i), (long long)ReadLE64(in + 160 + 8 * i),
+                           (long long)ReadLE64(in +  80 + 8 * i), (long long)ReadLE64(in + 8 * i));
+}
+
+// word i of every lane, the hashes are 32 bytes apart
+inline void Store(uint8_t *out, int i, Vec x) {
+  uint64_t lanes[4];
+  _mm256_storeu_si256((__m256i *)lanes, x);
+  for (int lane = 0; lane < 4; lane++) {
+    memcpy(out + 32 * lane + 8 * i, &lanes[lane], 8);
+  }
+}
+
+// the rotations by 32, 24 and 16 bits move whole bytes
+inline Vec Rotr32(Vec x) { return _mm256_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1)); }
+inline Vec Rotr24(Vec x) {
+  const Vec mask = _mm256_setr_epi8(3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10,
+                                    3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10);
+  return _mm256_shuffle_epi8(x, mask);
+}
+inline Vec Rotr16(Vec x) {
+  const Vec mask = _mm256_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9,
+                                    2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9);
+  return _mm256_shuffle_epi8(x, mask);
+}
+inline Vec Rotr63(Vec x) { return Xor(_mm256_srli_epi64(x, 63), Add(x, x)); }
+
+const uint64_t kInit[8] = {
+  0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+  0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+const uint8_t kSigma[12][16] = {
+  {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+  { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+  { 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+  {  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+  {  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+  {  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+  { 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+  { 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+  {  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+  { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13 , 0 },
+  {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+  { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 }
+};
+
+inline void G(Vec *v, const Vec *m, int r, int i, int a, int b, int c, int d) {
+  v[a] = Add(Add(v[a], v[b]), m[kSigma[r][2 * i]]);
+  v[d] = Rotr32(Xor(v[d], v[a]));
+  v[c] = Add(v[c], v[d]);
+  v[b] = Rotr24(Xor(v[b], v[c]));
+  v[a] = Add(Add(v[a], v[b]), m[kSigma[r][2 * i + 1]]);
+  v[d] = Rotr16(Xor(v[d], v[a]));
+  v[c] = Add(v[c], v[d]);
+  v[b] = Rotr63(Xor(v[b], v[c]));
+}
+
+void Hash80Lanes(uint8_t *out, const uint8_t *in) {
+  Vec m[16];
+  for (int i = 0; i < 10; i++) {
+    m[i] = Load(in, i);
+  }
+  for (int i = 10; i < 16; i++) {
+    m[i] = _mm256_setzero_si256();
+  }
+
+  // the same parameter block, counter and last block flag as the generic one
+  const uint64_t h0 = kInit[0] ^ 0x01010020ULL;
+  Vec v[16];
+  v[0] = Set1(h0);
+  for (int i = 1; i < 8; i++) {
+    v[i] = Set1(kInit[i]);
+  }
+  for (int i = 0; i < 8; i++) {
+    v[i + 8] = Set1(kInit[i]);
+  }
+  v[12] = Set1(kInit[4] ^ 80);
+  v[14] = Set1(~kInit[6]);
+
+  for (int r = 0; r < 12; r++) {
+    G(v, m, r, 0, 0, 4,  8, 12);
+    G(v, m, r, 1, 1, 5,  9, 13);
+    G(v, m, r, 2, 2, 6, 10, 14);
+    G(v, m, r, 3, 3, 7, 11, 15);
+    G(v, m, r, 4, 0, 5, 10, 15);
+    G(v, m, r, 5, 1, 6, 11, 12);
+    G(v, m, r, 6, 2, 7,  8, 13);
+    G(v, m, r, 7, 3, 4,  9, 14);
+  }
+
+  Store(out, 0, Xor(Set1(h0), Xor(v[0], v[8])));
+  for (int i = 1; i < 4; i++) {
+    Store(out, i, Xor(Set1(kInit[i]), Xor(v[i], v[i + 8])));
+  }
+}
+
+} // namespace
+
+void Hash80x4(uint8_t *out, const uint8_t *in) {
+  Hash80Lanes(out, in);
+}
+
+} // namespace blake2b_avx2
+
+#else
+
+namespace blake2b_avx2 {
+extern const bool kEnabled = false;
+void Hash80x4(uint8_t *, const uint8_t *) {}
+}
+
+#endif
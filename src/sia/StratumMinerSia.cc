@@ -28,7 +28,7 @@
 #include "DiffController.h"
 
 #include "StratumSia.h"
-#include "libblake2/blake2.h"
+#include "Blake2bSia.h"
 
 #include <arith_uint256.h>
 
@@ -81,25 +81,7 @@ void StratumMinerSia::handleRequest_Submit(const string &idStr, const JsonNode &
   uint8_t bHeader[80] = {0};
   for (int i = 0; i < 80; ++i)
     bHeader[i] = strtol(header.substr(i * 2, 2).c_str(), 0, 16);
-  // uint64_t nonce = strtoull(header.substr(64, 16).c_str(), nullptr, 16);
-  // uint64_t timestamp = strtoull(header.substr(80, 16).c_str(), nullptr, 16);
-  // DLOG(INFO) << "nonce=" << std::hex << nonce << ", timestamp=" << std::hex << timestamp; 
-  // //memcpy(bHeader + 32, &nonce, 8);
-  // memcpy(bHeader + 40, &timestamp, 8);
-  // for (int i = 48; i < 80; ++i)
-  //   bHeader[i] = strtol(header.substr(i * 2, 2).c_str(), 0, 16);
-  string str;
-  for (int i = 0; i < 80; ++i)
-    str += Strings::Format("%02x", bHeader[i]);
-  DLOG(INFO) << str;
-
-  uint8_t out[32] = {0};
-  int ret = blake2b(out, 32, bHeader, 80, nullptr, 0);
-  DLOG(INFO) << "blake2b return=" << ret;
-  //str = "";
-  for (int i = 0; i < 32; ++i)
-    str += Strings::Format("%02x", out[i]);
-  DLOG(INFO) << str;
+  DLOG(INFO) << header;
 
   uint8_t shortJobId = (uint8_t) atoi(params[1].str());
   LocalJob *localJob = session.findLocalJob(shortJobId);
@@ -158,25 +140,51 @@ void StratumMinerSia::handleRequest_Submit(const string &idStr, const JsonNode &
   share.set_timestamp((uint32_t) time(nullptr));
   share.set_status(StratumStatus::REJECT_NO_REASON);
 
-  arith_uint256 shareTarget(str);
-  arith_uint256 networkTarget = UintToArith256(sjob->networkTarget_);
-
-  if (shareTarget < networkTarget) {
-    //valid share
-    //submit share
-    server.sendSolvedShare2Kafka(bHeader, 80);
-    diffController_->addAcceptedShare(share.sharediff());
-    LOG(INFO) << "sia solution found";
-  }
-
-  session.rpc2ResponseTrue(idStr);
-
-  std::string message;
-  uint32_t size = 0;
-  if (!share.SerializeToArrayWithVersion(message, size)) {
-    LOG(ERROR) << "share SerializeToArray failed!"<< share.toString();
+  // the local job may be gone when the share is verified, copy what is needed
+  const arith_uint256 networkTarget = UintToArith256(sjob->networkTarget_);
+  const string headerBin((const char *) bHeader, 80);
+
+  auto verified = [this, &session, &server, idStr, share, networkTarget, headerBin](const uint8_t *hash) {
+    string str;
+    for (int i = 0; i < 32; ++i)
+      str += Strings::Format("%02x", hash[i]);
+    DLOG(INFO) << "blake2b: " << str;
+
+    arith_uint256 shareTarget(str);
+    if (shareTarget < networkTarget) {
+      //valid share
+      //submit share
+      server.sendSolvedShare2Kafka((uint8_t *) headerBin.data(), 80);
+      diffController_->addAcceptedShare(share.sharediff());
+      LOG(INFO) << "sia solution found";
+    }
+
+    session.rpc2ResponseTrue(idStr);
+
+    std::string message;
+    uint32_t size = 0;
+    if (!share.SerializeToArrayWithVersion(message, size)) {
+      LOG(ERROR) << "share SerializeToArray failed!"<< share.toString();
+      return;
+    }
+
+    server.sendShare2Kafka((const uint8_t *) message.data(), size);
+  };
+
+  // the shares of all sessions of the event loop are hashed together at
+  // the end of the loop's iteration
+  ShareVerifierSia *verifier = server.getShareVerifier();
+  if (verifier == nullptr) {
+    uint8_t out[32] = {0};
+    Blake2bSia::hash80(out, bHeader);
+    verified(out);
     return;
   }
 
-  server.sendShare2Kafka((const uint8_t *) message.data(), size);
+  // the session is kept until the share is verified
+  session.beginAsyncTask();
+  verifier->submit(bHeader, [&session, verified](const uint8_t *hash) {
+    verified(hash);
+    session.endAsyncTask();
+  });
 }
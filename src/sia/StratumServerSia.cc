@@ -26,11 +26,63 @@
 
 #include "StratumSessionSia.h"
 #include "DiffController.h"
+#include "Blake2bSia.h"
 
 #include <boost/make_unique.hpp>
 
 using namespace std;
 
+//////////////////////////////// ShareVerifierSia ////////////////////////////////
+ShareVerifierSia::ShareVerifierSia(struct event_base *base)
+  : verifyEvent_(nullptr)
+{
+  // the event is activated by the first share of an iteration and runs after
+  // the reads which are already active in the same iteration
+  verifyEvent_ = event_new(base, -1, 0, ShareVerifierSia::verifyCallback, this);
+  if (verifyEvent_ == nullptr) {
+    LOG(ERROR) << "cannot create sia share verify event, shares will be verified one by one";
+  }
+}
+
+ShareVerifierSia::~ShareVerifierSia() {
+  if (verifyEvent_ != nullptr) {
+    event_free(verifyEvent_);
+  }
+}
+
+void ShareVerifierSia::submit(const uint8_t *header, Callback callback) {
+  headers_.insert(headers_.end(), header, header + Blake2bSia::kHeaderSize_);
+  callbacks_.push_back(std::move(callback));
+
+  if (verifyEvent_ == nullptr) {
+    verify();
+  } else if (callbacks_.size() == 1) {
+    event_active(verifyEvent_, EV_READ, 0);
+  }
+}
+
+void ShareVerifierSia::verify() {
+  // the callbacks may submit again
+  std::vector<uint8_t> headers;
+  std::vector<Callback> callbacks;
+  headers.swap(headers_);
+  callbacks.swap(callbacks_);
+  if (callbacks.empty()) {
+    return;
+  }
+
+  std::vector<uint8_t> hashes(Blake2bSia::kHashSize_ * callbacks.size());
+  Blake2bSia::hash80(hashes.data(), headers.data(), callbacks.size());
+  for (size_t i = 0; i < callbacks.size(); i++) {
+    callbacks[i](hashes.data() + Blake2bSia::kHashSize_ * i);
+  }
+}
+
+void ShareVerifierSia::verifyCallback(evutil_socket_t fd, short events, void *ptr) {
+  auto verifier = static_cast<ShareVerifierSia *>(ptr);
+  verifier->verify();
+}
+
 //////////////////////////////////// JobRepositorySia /////////////////////////////////
 JobRepositorySia::JobRepositorySia(const char *kafkaBrokers, const char *consumerTopic, const string &fileLastNotifyTime, ServerSia *server) : 
   JobRepositoryBase(kafkaBrokers, consumerTopic, fileLastNotifyTime, server)
@@ -58,6 +110,7 @@ void JobRepositorySia::broadcastStratumJob(shared_ptr<StratumJob> sjob) {
 
     // insert new job
     exJobs_[sjob->jobId_] = exJob;
+    updateJobsSnapshot();
   }
 
   sendMiningNotify(exJob);
@@ -86,3 +139,15 @@ void ServerSia::sendSolvedShare2Kafka(uint8_t *buf, int len) {
    kafkaProducerSolvedShare_->produce(buf, len);
 }
 
+unique_ptr<EventLoopContext> ServerSia::createEventLoopContext(ServerEventLoop &loop) {
+  return boost::make_unique<ShareVerifierSia>(loop.getBase());
+}
+
+ShareVerifierSia *ServerSia::getShareVerifier() {
+  ServerEventLoop *loop = ServerEventLoop::current();
+  if (loop == nullptr) {
+    return nullptr;
+  }
+  return static_cast<ShareVerifierSia *>(loop->getContext());
+}
+
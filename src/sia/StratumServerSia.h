@@ -27,8 +27,35 @@
 #include "StratumServer.h"
 #include "StratumSia.h"
 
+#include <functional>
+
 class JobRepositorySia;
 
+//////////////////////////////// ShareVerifierSia ////////////////////////////////
+// Hashes the headers of all shares submitted in one iteration of an event
+// loop together, so the AVX2 backend of Blake2bSia gets full lanes. The
+// callbacks run at the end of the iteration, in the loop's thread and in the
+// order of submitting. Only used in the thread of its loop, which owns it.
+class ShareVerifierSia : public EventLoopContext {
+public:
+  using Callback = std::function<void(const uint8_t *hash)>;
+
+  explicit ShareVerifierSia(struct event_base *base);
+  ~ShareVerifierSia() override;
+
+  void submit(const uint8_t *header, Callback callback);
+  // hash the pending headers and run their callbacks now
+  void verify();
+  size_t getPendingCount() const { return callbacks_.size(); }
+
+private:
+  struct event *verifyEvent_;
+  std::vector<uint8_t> headers_;
+  std::vector<Callback> callbacks_;
+
+  static void verifyCallback(evutil_socket_t fd, short events, void *verifier);
+};
+
 class ServerSia : public ServerBase<JobRepositorySia>
 {
 public:
@@ -37,8 +64,13 @@ public:
 
 
   unique_ptr<StratumSession> createConnection(struct bufferevent *bev, struct sockaddr *saddr, const uint32_t sessionID) override;
-  
+  unique_ptr<EventLoopContext> createEventLoopContext(ServerEventLoop &loop) override;
+
   void sendSolvedShare2Kafka(uint8_t *buf, int len);
+  // the verifier of the event loop running in the current thread,
+  // nullptr if there isn't one
+  ShareVerifierSia *getShareVerifier();
+
 private:
   JobRepository* createJobRepository(const char *kafkaBrokers,
                                      const char *consumerTopic,     
@@ -131,6 +131,13 @@ public:
     return true;
   }
 
+  IpAddress getIp() const
+  {
+    IpAddress ip;
+    ip.fromString(this->ip());
+    return ip;
+  }
+
   string toString() const
   {
     double networkDifficulty = 0.0;
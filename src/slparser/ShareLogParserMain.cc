@@ -101,7 +101,8 @@ std::shared_ptr<ShareLogDumper> newShareLogDumper(const string &chainType, const
 
 std::shared_ptr<ShareLogParser> newShareLogParser(const string &chainType, const string &dataDir,
                                                   time_t timestamp, const MysqlConnectInfo &poolDBInfo,
-                                                  const int dupShareTrackingHeight)
+                                                  const int dupShareTrackingHeight,
+                                                  const uint32_t parseThreads)
 {
 #if defined(CHAIN_TYPE_STR)
   if (CHAIN_TYPE_STR == chainType)
@@ -109,18 +110,20 @@ std::shared_ptr<ShareLogParser> newShareLogParser(const string &chainType, const
   if (false)
 #endif  
 {
-    return std::make_shared<ShareLogParserBitcoin>(chainType.c_str(), dataDir, timestamp, poolDBInfo, nullptr);
+    return std::make_shared<ShareLogParserBitcoin>(chainType.c_str(), dataDir, timestamp, poolDBInfo, nullptr, parseThreads);
   }
   else if (chainType == "ETH") {
     return std::make_shared<ShareLogParserEth>(chainType.c_str(), dataDir, timestamp, poolDBInfo,
-                                               std::make_shared<DuplicateShareCheckerEth>(dupShareTrackingHeight));
+                                               std::make_shared<DuplicateShareCheckerEth>(dupShareTrackingHeight),
+                                               parseThreads);
   }
   else if (chainType == "BTM") {
     return std::make_shared<ShareLogParserBytom>(chainType.c_str(), dataDir, timestamp, poolDBInfo,
-                                               std::make_shared<DuplicateShareCheckerBytom>(dupShareTrackingHeight));
+                                               std::make_shared<DuplicateShareCheckerBytom>(dupShareTrackingHeight),
+                                               parseThreads);
   }
   else if (chainType == "DCR") {
-    return std::make_shared<ShareLogParserDecred>(chainType.c_str(), dataDir, timestamp, poolDBInfo, nullptr);
+    return std::make_shared<ShareLogParserDecred>(chainType.c_str(), dataDir, timestamp, poolDBInfo, nullptr, parseThreads);
   }
   else {
     LOG(FATAL) << "newShareLogParser: unknown chain type " << chainType;
@@ -294,10 +297,14 @@ int main(int argc, char **argv) {
                                           optDate/100 % 100, optDate % 100);
       const time_t ts = str2time(tsStr.c_str(), "%F %T");
 
+      uint32_t parseThreads = 1;
+      cfg.lookupValue("sharelog.parse_threads", parseThreads);
+
       std::shared_ptr<ShareLogParser> slparser = newShareLogParser(chainType,
                                                              cfg.lookup("sharelog.data_dir"),
                                                              ts, *poolDBInfo,
-                                                             dupShareTrackingHeight);
+                                                             dupShareTrackingHeight,
+                                                             parseThreads);
       do {
         if (slparser->init() == false) {
           LOG(ERROR) << "init failure";
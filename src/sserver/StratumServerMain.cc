@@ -207,6 +207,17 @@ int main(int argc, char **argv)
       return 1;
     }
 
+    uint32_t eventLoopThreads = 1;
+    cfg.lookupValue("sserver.event_loop_threads", eventLoopThreads);
+    if (eventLoopThreads == 0) {
+      LOG(FATAL) << "`event_loop_threads` should be at least 1";
+      return 1;
+    }
+
+    // 0: send each share as its own kafka message
+    uint32_t shareBatchSize = 0;
+    cfg.lookupValue("sserver.share_batch_size", shareBatchSize);
+
     shared_ptr<DiffController> dc = make_shared<DiffController>(defaultDifficulty, maxDifficulty, minDifficulty, shareAvgSeconds, diffAdjustPeriod);
     evthread_use_pthreads();
 
@@ -226,7 +237,9 @@ int main(int argc, char **argv)
                                        dc,
                                        cfg.lookup("sserver.solved_share_topic"),
                                        cfg.lookup("sserver.share_topic"),
-                                       cfg.lookup("sserver.common_events_topic"));
+                                       cfg.lookup("sserver.common_events_topic"),
+                                       eventLoopThreads,
+                                       shareBatchSize);
 
     if (!gStratumServer->createServer(cfg.lookup("sserver.type"), shareAvgSeconds, cfg))
     {
@@ -74,8 +74,10 @@ std::shared_ptr<StatsServer> newStatsServer(const string &chainType, const char
                                             const MysqlConnectInfo *poolDBInfo, const RedisConnectInfo *redisInfo,
                                             const uint32_t redisConcurrency, const string &redisKeyPrefix, const int redisKeyExpire,
                                             const int redisPublishPolicy, const int redisIndexPolicy,
+                                            const bool redisIncrementalFlush,
                                             const time_t kFlushDBInterval, const string &fileLastFlushTime,
-                                            const int dupShareTrackingHeight)
+                                            const int dupShareTrackingHeight,
+                                            const string &fileSnapshot, const time_t kSnapshotInterval)
 {
 #if defined(CHAIN_TYPE_STR)
   if (CHAIN_TYPE_STR == chainType)
@@ -87,30 +89,38 @@ std::shared_ptr<StatsServer> newStatsServer(const string &chainType, const char
                                                 httpdHost, httpdPort, poolDBInfo, redisInfo,
                                                 redisConcurrency, redisKeyPrefix, redisKeyExpire,
                                                 redisPublishPolicy, redisIndexPolicy,
-                                                kFlushDBInterval, fileLastFlushTime, nullptr);
+                                                redisIncrementalFlush,
+                                                kFlushDBInterval, fileLastFlushTime, nullptr,
+                                                fileSnapshot, kSnapshotInterval);
   }
   else if (chainType == "ETH") {
     return std::make_shared<StatsServerEth>(kafkaBrokers, kafkaShareTopic, kafkaCommonEventsTopic,
                                             httpdHost, httpdPort, poolDBInfo, redisInfo,
                                             redisConcurrency, redisKeyPrefix, redisKeyExpire,
                                             redisPublishPolicy, redisIndexPolicy,
+                                            redisIncrementalFlush,
                                             kFlushDBInterval, fileLastFlushTime,
-                                            std::make_shared<DuplicateShareCheckerEth>(dupShareTrackingHeight));
+                                            std::make_shared<DuplicateShareCheckerEth>(dupShareTrackingHeight),
+                                            fileSnapshot, kSnapshotInterval);
   }
   else if (chainType == "BTM") {
     return std::make_shared<StatsServerBytom>(kafkaBrokers, kafkaShareTopic, kafkaCommonEventsTopic,
                                             httpdHost, httpdPort, poolDBInfo, redisInfo,
                                             redisConcurrency, redisKeyPrefix, redisKeyExpire,
                                             redisPublishPolicy, redisIndexPolicy,
+                                            redisIncrementalFlush,
                                             kFlushDBInterval, fileLastFlushTime,
-                                            std::make_shared<DuplicateShareCheckerBytom>(dupShareTrackingHeight));
+                                            std::make_shared<DuplicateShareCheckerBytom>(dupShareTrackingHeight),
+                                            fileSnapshot, kSnapshotInterval);
   }
   else if (chainType == "DCR") {
     return std::make_shared<StatsServerDecred>(kafkaBrokers, kafkaShareTopic, kafkaCommonEventsTopic,
                                                httpdHost, httpdPort, poolDBInfo, redisInfo,
                                                redisConcurrency, redisKeyPrefix, redisKeyExpire,
                                                redisPublishPolicy, redisIndexPolicy,
-                                               kFlushDBInterval, fileLastFlushTime, nullptr);
+                                               redisIncrementalFlush,
+                                               kFlushDBInterval, fileLastFlushTime, nullptr,
+                                               fileSnapshot, kSnapshotInterval);
   }
   else {
     LOG(FATAL) << "newStatsServer: unknown chain type " << chainType;
@@ -203,6 +213,7 @@ int main(int argc, char **argv) {
     int redisKeyExpire = 0;
     int redisPublishPolicy = 0;
     int redisIndexPolicy = 0;
+    bool redisIncrementalFlush = true;
     uint32_t redisConcurrency = 1;
 
     if (useRedis) {
@@ -214,6 +225,7 @@ int main(int argc, char **argv) {
       cfg.lookupValue("redis.key_expire", redisKeyExpire);
       cfg.lookupValue("redis.publish_policy", redisPublishPolicy);
       cfg.lookupValue("redis.index_policy", redisIndexPolicy);
+      cfg.lookupValue("redis.incremental_flush", redisIncrementalFlush);
       cfg.lookupValue("redis.concurrency", redisConcurrency);
     }
     
@@ -222,10 +234,14 @@ int main(int argc, char **argv) {
     int32_t port = 8080;
     int32_t flushInterval = 20;
     int32_t dupShareTrackingHeight = 3;
+    string fileSnapshot;
+    int32_t snapshotInterval = 300;
     cfg.lookupValue("statshttpd.port", port);
     cfg.lookupValue("statshttpd.flush_db_interval", flushInterval);
     cfg.lookupValue("statshttpd.file_last_flush_time", fileLastFlushTime);
     cfg.lookupValue("dup_share_checker.tracking_height_number", dupShareTrackingHeight);
+    cfg.lookupValue("statshttpd.file_snapshot", fileSnapshot);
+    cfg.lookupValue("statshttpd.snapshot_interval", snapshotInterval);
     gStatsServer = newStatsServer(cfg.lookup("statshttpd.chain_type"),
                                   cfg.lookup("kafka.brokers").c_str(),
                                   cfg.lookup("statshttpd.share_topic").c_str(),
@@ -234,8 +250,10 @@ int main(int argc, char **argv) {
                                   (unsigned short)port, poolDBInfo,
                                   redisInfo, redisConcurrency, redisKeyPrefix,
                                   redisKeyExpire, redisPublishPolicy, redisIndexPolicy,
+                                  redisIncrementalFlush,
                                   (time_t)flushInterval, fileLastFlushTime,
-                                  dupShareTrackingHeight);
+                                  dupShareTrackingHeight,
+                                  fileSnapshot, (time_t)snapshotInterval);
     if (gStatsServer->init()) {
     	gStatsServer->run();
     }
@@ -24,9 +24,14 @@
 
 #include "gtest/gtest.h"
 #include "Common.h"
+#include "Utils.h"
 
 #include "bitcoin/BitcoinUtils.h"
 
+#include <script/script.h>
+
+#include <chrono>
+
 
 ////////////////////////////////  Block Rewards  /////////////////////////////////
 TEST(BitcoinUtils, GetBlockReward) {
@@ -130,3 +135,97 @@ TEST(BitcoinUtils, GetBlockReward) {
   reward = GetBlockReward(70000000, consensus);
   ASSERT_EQ(reward, 0);         // 0 satoshi
 }
+
+////////////////////////////////  Block Hex  /////////////////////////////////
+// a block with a coinbase tx and txCount other txs, about 230 bytes each
+static CBlock makeBlockForTest(size_t txCount) {
+  CBlock block;
+  block.nVersion = 0x20000000;
+  block.hashPrevBlock = uint256S("000000004f2ea239532b2e77bb46c03b86643caac3fe92959a31fd2d03979c34");
+  block.hashMerkleRoot = uint256S("bd36bd4fff574b573152e7d4f64adf2bb1c9ab0080a12f8544c351f65aca79ff");
+  block.nTime = 1469006933;
+  block.nBits = 0x1a018ae2;
+  block.nNonce = 0x12345678;
+
+  CMutableTransaction coinbaseTx;
+  coinbaseTx.vin.resize(1);
+  coinbaseTx.vin[0].prevout.SetNull();
+  coinbaseTx.vin[0].scriptSig = CScript() << 898487 << OP_0;
+  coinbaseTx.vout.resize(1);
+  coinbaseTx.vout[0].nValue = 312659655;
+  coinbaseTx.vout[0].scriptPubKey = CScript() << OP_TRUE;
+  block.vtx.push_back(MakeTransactionRef(std::move(coinbaseTx)));
+
+  for (size_t i = 0; i < txCount; i++) {
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout.hash = uint256S(Strings::Format("%064x", i + 1));
+    tx.vin[0].prevout.n = i % 4;
+    tx.vin[0].scriptSig = CScript() << vector<unsigned char>(72, 0x30) << vector<unsigned char>(33, 0x02);
+#ifndef CHAIN_TYPE_BCH
+    // segwit txs are serialized with their witness in a block
+    if (i % 2 == 1) {
+      tx.vin[0].scriptSig = CScript();
+      tx.vin[0].scriptWitness.stack.push_back(vector<unsigned char>(72, 0x30));
+      tx.vin[0].scriptWitness.stack.push_back(vector<unsigned char>(33, 0x02));
+    }
+#endif
+    tx.vout.resize(2);
+    tx.vout[0].nValue = 100000 + i;
+    tx.vout[0].scriptPubKey = CScript() << OP_DUP << OP_HASH160 << vector<unsigned char>(20, i & 0xff) << OP_EQUALVERIFY << OP_CHECKSIG;
+    tx.vout[1].nValue = 200000 + i;
+    tx.vout[1].scriptPubKey = CScript() << OP_HASH160 << vector<unsigned char>(20, 0xee) << OP_EQUAL;
+    block.vtx.push_back(MakeTransactionRef(std::move(tx)));
+  }
+
+  return block;
+}
+
+TEST(BitcoinUtils, EncodeHexBlockWithTxsHex) {
+  // 252 and 253 txs: the tx count changes from 1 byte to 3 bytes
+  for (size_t txCount : {0, 1, 2, 100, 251, 252, 253, 1000}) {
+    const CBlock block = makeBlockForTest(txCount);
+    const vector<CTransactionRef> vtxs(block.vtx.begin() + 1, block.vtx.end());
+
+    const string txsHex = EncodeHexTxs(vtxs);
+    ASSERT_EQ(EncodeHexBlock(block, block.vtx[0], vtxs.size(), txsHex), EncodeHexBlock(block))
+      << "txCount: " << txCount;
+  }
+}
+
+TEST(BitcoinUtils, DISABLED_EncodeHexBlockBenchmark) {
+  // about 2MB
+  const CBlock block = makeBlockForTest(9000);
+  const vector<CTransactionRef> vtxs(block.vtx.begin() + 1, block.vtx.end());
+  const string txsHex = EncodeHexTxs(vtxs);
+  const size_t kRounds = 20;
+
+  // what BlockMakerBitcoin::processSolvedShare() does between
+  // receiving a solved share and calling submitblock
+  auto begin = std::chrono::steady_clock::now();
+  size_t size1 = 0;
+  for (size_t i = 0; i < kRounds; i++) {
+    CBlock newblk(block.GetBlockHeader());
+    newblk.vtx.push_back(block.vtx[0]);
+    newblk.vtx.insert(newblk.vtx.end(), vtxs.begin(), vtxs.end());
+    size1 += EncodeHexBlock(newblk).size();
+  }
+  auto encodeAll = std::chrono::steady_clock::now() - begin;
+
+  begin = std::chrono::steady_clock::now();
+  size_t size2 = 0;
+  for (size_t i = 0; i < kRounds; i++) {
+    CBlock newblk(block.GetBlockHeader());
+    newblk.vtx.push_back(block.vtx[0]);
+    size2 += EncodeHexBlock(newblk, newblk.vtx[0], vtxs.size(), txsHex).size();
+  }
+  auto splice = std::chrono::steady_clock::now() - begin;
+
+  ASSERT_EQ(size1, size2);
+
+  using std::chrono::microseconds;
+  LOG(INFO) << "block size: " << size1 / kRounds / 2 << " bytes, encode the whole block: "
+            << std::chrono::duration_cast<microseconds>(encodeAll).count() / kRounds << " us, "
+            << "splice the encoded txs: "
+            << std::chrono::duration_cast<microseconds>(splice).count() / kRounds << " us";
+}
@@ -0,0 +1,187 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) [2016] [BTC.COM]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+#include "gtest/gtest.h"
+#include "Common.h"
+#include "Utils.h"
+
+#include "decred/Blake256Decred.h"
+#include "decred/CommonDecred.h"
+#include "decred/StratumDecred.h"
+
+extern "C" {
+#include "libsph/sph_blake.h"
+}
+
+#include <chrono>
+#include <random>
+
+// restores the backend chosen at startup
+class Blake256DecredBackendGuard {
+  Blake256Decred::Backend backend_;
+public:
+  Blake256DecredBackendGuard() : backend_(Blake256Decred::getBackend()) {}
+  ~Blake256DecredBackendGuard() { Blake256Decred::setBackend(backend_); }
+};
+
+static vector<Blake256Decred::Backend> supportedBackends() {
+  vector<Blake256Decred::Backend> backends;
+  for (size_t i = 0; i < Blake256Decred::kBackends_; i++) {
+    const Blake256Decred::Backend backend = (Blake256Decred::Backend)i;
+    if (Blake256Decred::isSupported(backend)) {
+      backends.push_back(backend);
+    } else {
+      LOG(INFO) << "blake256 backend " << Blake256Decred::getBackendName(backend) << " is not supported, skipped";
+    }
+  }
+  return backends;
+}
+
+static string sphBlake256(const uint8_t *header) {
+  uint8_t hash[32];
+  sph_blake256_context ctx;
+  sph_blake256_init(&ctx);
+  sph_blake256(&ctx, header, Blake256Decred::kHeaderSize_);
+  sph_blake256_close(&ctx, hash);
+  return HexStr(hash, hash + 32);
+}
+
+static void randomHeader(std::mt19937 &gen, BlockHeaderDecred &header) {
+  uint8_t *bytes = reinterpret_cast<uint8_t *>(&header);
+  for (size_t i = 0; i < sizeof(header); i++) {
+    bytes[i] = (uint8_t)gen();
+  }
+}
+
+////////////////////////////////  Equivalence  /////////////////////////////////
+TEST(Blake256Decred, Backends) {
+  ASSERT_TRUE(Blake256Decred::isSupported(Blake256Decred::GENERIC));
+  ASSERT_TRUE(Blake256Decred::isSupported(Blake256Decred::getBackend()));
+  LOG(INFO) << "blake256 backend: " << Blake256Decred::getBackendName(Blake256Decred::getBackend());
+}
+
+TEST(Blake256Decred, RandomHeaders) {
+  Blake256DecredBackendGuard guard;
+  std::mt19937 gen(12345);
+
+  for (const auto backend : supportedBackends()) {
+    SCOPED_TRACE(Blake256Decred::getBackendName(backend));
+    ASSERT_TRUE(Blake256Decred::setBackend(backend));
+
+    for (int i = 0; i < 1000; i++) {
+      BlockHeaderDecred header;
+      randomHeader(gen, header);
+      const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&header);
+
+      uint8_t out[32];
+      Blake256Decred::hash(out, bytes);
+      ASSERT_EQ(HexStr(out, out + 32), sphBlake256(bytes));
+      ASSERT_EQ(header.getHash(), uint256(vector<unsigned char>(out, out + 32)));
+    }
+  }
+}
+
+TEST(Blake256Decred, Midstate) {
+  Blake256DecredBackendGuard guard;
+  std::mt19937 gen(12345);
+
+  for (const auto backend : supportedBackends()) {
+    SCOPED_TRACE(Blake256Decred::getBackendName(backend));
+    ASSERT_TRUE(Blake256Decred::setBackend(backend));
+
+    for (int job = 0; job < 10; job++) {
+      BlockHeaderDecred header;
+      randomHeader(gen, header);
+      Blake256Decred::Midstate midstate;
+      header.getMidstate(midstate);
+
+      // the shares of a job
+      for (int i = 0; i < 100; i++) {
+        header.timestamp = gen();
+        header.nonce = gen();
+        for (auto &byte : header.extraData) {
+          byte = (uint8_t)gen();
+        }
+        ASSERT_EQ(header.getHash(midstate), header.getHash());
+      }
+    }
+  }
+}
+
+TEST(Blake256Decred, StratumJobMidstate) {
+  StratumJobDecred job;
+  Blake256Decred::Midstate midstate;
+  job.header_.getMidstate(midstate);
+  ASSERT_EQ(memcmp(&job.midstate_, &midstate, sizeof(midstate)), 0);
+
+  const string json = Strings::Format(
+    "{\"jobId\":1,\"prevHash\":\"%s\",\"coinBase1\":\"%s\",\"coinBase2\":\"05000000\","
+    "\"version\":\"05000000\",\"target\":\"%s\",\"network\":%" PRIu32 "}",
+    string(64, '1').c_str(), string(216, '2').c_str(), string(64, '3').c_str(),
+    static_cast<uint32_t>(NetworkDecred::MainNet));
+  ASSERT_TRUE(job.unserializeFromJson(json.c_str(), json.size()));
+
+  BlockHeaderDecred header = job.header_;
+  header.timestamp = 1545000000;
+  header.nonce = 0x12345678;
+  header.extraData.SetHex("deadbeef");
+  ASSERT_EQ(header.getHash(job.midstate_), header.getHash());
+}
+
+////////////////////////////////  Benchmark  /////////////////////////////////
+TEST(Blake256Decred, DISABLED_ShareLatencyBenchmark) {
+  Blake256DecredBackendGuard guard;
+  std::mt19937 gen(12345);
+  BlockHeaderDecred header;
+  randomHeader(gen, header);
+
+  const size_t kShares = 1000000;
+  uint256 hash;
+
+  // the whole header with sph
+  auto begin = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < kShares; i++) {
+    header.nonce = (uint32_t)i;
+    hash = header.getHash();
+    header.extraData.begin()[0] = *hash.begin();  // so nothing is optimized away
+  }
+  auto elapsed = std::chrono::steady_clock::now() - begin;
+  LOG(INFO) << "blake256 sph: " << std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / kShares
+            << " ns/share";
+
+  for (const auto backend : supportedBackends()) {
+    ASSERT_TRUE(Blake256Decred::setBackend(backend));
+
+    Blake256Decred::Midstate midstate;
+    header.getMidstate(midstate);
+    begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < kShares; i++) {
+      header.nonce = (uint32_t)i;
+      hash = header.getHash(midstate);
+      header.extraData.begin()[0] = *hash.begin();
+    }
+    elapsed = std::chrono::steady_clock::now() - begin;
+    LOG(INFO) << "blake256 backend " << Blake256Decred::getBackendName(backend) << " with the midstate: "
+              << std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / kShares << " ns/share";
+  }
+}
@@ -0,0 +1,220 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) [2016] [BTC.COM]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+#include "gtest/gtest.h"
+#include "Common.h"
+#include "Utils.h"
+
+#include "sia/Blake2bSia.h"
+#include "sia/StratumServerSia.h"
+#include "libblake2/blake2.h"
+
+#include <chrono>
+#include <random>
+
+// restores the backend chosen at startup
+class Blake2bSiaBackendGuard {
+  Blake2bSia::Backend backend_;
+public:
+  Blake2bSiaBackendGuard() : backend_(Blake2bSia::getBackend()) {}
+  ~Blake2bSiaBackendGuard() { Blake2bSia::setBackend(backend_); }
+};
+
+static vector<Blake2bSia::Backend> supportedBackends() {
+  vector<Blake2bSia::Backend> backends;
+  for (size_t i = 0; i < Blake2bSia::kBackends_; i++) {
+    const Blake2bSia::Backend backend = (Blake2bSia::Backend)i;
+    if (Blake2bSia::isSupported(backend)) {
+      backends.push_back(backend);
+    } else {
+      LOG(INFO) << "blake2b backend " << Blake2bSia::getBackendName(backend) << " is not supported, skipped";
+    }
+  }
+  return backends;
+}
+
+static vector<uint8_t> randomHeaders(size_t n) {
+  std::mt19937 gen(12345);
+  vector<uint8_t> headers(80 * n);
+  for (auto &byte : headers) {
+    byte = (uint8_t)gen();
+  }
+  return headers;
+}
+
+static vector<uint8_t> referenceHashes(const vector<uint8_t> &headers) {
+  vector<uint8_t> hashes(headers.size() / 80 * 32);
+  for (size_t i = 0; i < headers.size() / 80; i++) {
+    blake2b(hashes.data() + 32 * i, 32, headers.data() + 80 * i, 80, nullptr, 0);
+  }
+  return hashes;
+}
+
+////////////////////////////////  Known Answers  /////////////////////////////////
+TEST(Blake2bSia, Backends) {
+  ASSERT_TRUE(Blake2bSia::isSupported(Blake2bSia::GENERIC));
+  ASSERT_TRUE(Blake2bSia::isSupported(Blake2bSia::getBackend()));
+  LOG(INFO) << "blake2b backend: " << Blake2bSia::getBackendName(Blake2bSia::getBackend());
+}
+
+TEST(Blake2bSia, KnownAnswers) {
+  Blake2bSiaBackendGuard guard;
+
+  // 0x00, 0x01, ..., 0x4f
+  uint8_t counting[80];
+  for (size_t i = 0; i < sizeof(counting); i++) {
+    counting[i] = (uint8_t)i;
+  }
+  // a block of the sia mainnet
+  const vector<unsigned char> block = ParseHex(
+    "00000000000000021f3e8ede65495c4311ef59e5b7a4338542e573819f5979e982719d0366014155"
+    "e935aa5a00000000201929782a8fe3209b152520c51d2a82dc364e4a3eb6fb8131439835e278ff8b");
+  ASSERT_EQ(block.size(), 80u);
+
+  for (const auto backend : supportedBackends()) {
+    SCOPED_TRACE(Blake2bSia::getBackendName(backend));
+    ASSERT_TRUE(Blake2bSia::setBackend(backend));
+    ASSERT_EQ(Blake2bSia::getBackend(), backend);
+
+    uint8_t out[32];
+    Blake2bSia::hash80(out, counting);
+    ASSERT_EQ(HexStr(out, out + 32), "066de1009daca2b8390a9dc734bce547ac4e3cc4531645bb8b9cbc0070941d88");
+
+    Blake2bSia::hash80(out, block.data());
+    ASSERT_EQ(HexStr(out, out + 32), "0000000004dc841c49e7de9713483d265675f66568fde260f24745565d0c0651");
+
+    // the same headers in every lane
+    vector<uint8_t> headers;
+    for (int i = 0; i < 4; i++) {
+      headers.insert(headers.end(), block.begin(), block.end());
+    }
+    vector<uint8_t> hashes(32 * 4);
+    Blake2bSia::hash80(hashes.data(), headers.data(), 4);
+    for (int i = 0; i < 4; i++) {
+      ASSERT_EQ(HexStr(hashes.begin() + 32 * i, hashes.begin() + 32 * (i + 1)),
+                "0000000004dc841c49e7de9713483d265675f66568fde260f24745565d0c0651");
+    }
+  }
+}
+
+TEST(Blake2bSia, Reference) {
+  Blake2bSiaBackendGuard guard;
+
+  for (const auto backend : supportedBackends()) {
+    SCOPED_TRACE(Blake2bSia::getBackendName(backend));
+    ASSERT_TRUE(Blake2bSia::setBackend(backend));
+
+    // full and partial batches of the lanes
+    for (size_t n = 0; n <= 13; n++) {
+      const vector<uint8_t> headers = randomHeaders(n);
+      vector<uint8_t> hashes(32 * n);
+      Blake2bSia::hash80(hashes.data(), headers.data(), n);
+      ASSERT_EQ(hashes, referenceHashes(headers)) << n << " headers";
+    }
+  }
+}
+
+////////////////////////////////  ShareVerifierSia  /////////////////////////////////
+TEST(Blake2bSia, ShareVerifier) {
+  struct event_base *base = event_base_new();
+  ASSERT_NE(base, nullptr);
+  {
+    ShareVerifierSia verifier(base);
+    const size_t kShares = 7;
+    const vector<uint8_t> headers = randomHeaders(kShares);
+    const vector<uint8_t> expected = referenceHashes(headers);
+
+    vector<uint8_t> hashes;
+    vector<size_t> order;
+    for (size_t i = 0; i < kShares; i++) {
+      verifier.submit(headers.data() + 80 * i, [&hashes, &order, i](const uint8_t *hash) {
+        hashes.insert(hashes.end(), hash, hash + 32);
+        order.push_back(i);
+      });
+    }
+    // nothing is hashed until the end of the loop's iteration
+    ASSERT_EQ(verifier.getPendingCount(), kShares);
+    ASSERT_TRUE(hashes.empty());
+
+    event_base_loop(base, EVLOOP_NONBLOCK);
+    ASSERT_EQ(verifier.getPendingCount(), 0u);
+    ASSERT_EQ(hashes, expected);
+    for (size_t i = 0; i < kShares; i++) {
+      ASSERT_EQ(order[i], i);
+    }
+
+    // the next iteration
+    hashes.clear();
+    verifier.submit(headers.data(), [&hashes](const uint8_t *hash) {
+      hashes.insert(hashes.end(), hash, hash + 32);
+    });
+    event_base_loop(base, EVLOOP_NONBLOCK);
+    ASSERT_EQ(hashes, vector<uint8_t>(expected.begin(), expected.begin() + 32));
+  }
+  event_base_free(base);
+}
+
+////////////////////////////////  Benchmark  /////////////////////////////////
+TEST(Blake2bSia, DISABLED_SharesPerSecondBenchmark) {
+  Blake2bSiaBackendGuard guard;
+
+  const size_t kShares = 1 << 20;
+  const vector<uint8_t> headers = randomHeaders(1024);
+  uint8_t out[32];
+
+  // one share at a time with the reference implementation
+  auto begin = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < kShares; i++) {
+    blake2b(out, 32, headers.data() + 80 * (i % 1024), 80, nullptr, 0);
+  }
+  auto elapsed = std::chrono::steady_clock::now() - begin;
+  LOG(INFO) << "blake2b reference: " << (uint64_t)(kShares * 1000000.0 /
+    std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()) << " shares/s/core";
+
+  // the shares arriving in one iteration of the event loop
+  struct event_base *base = event_base_new();
+  ASSERT_NE(base, nullptr);
+  for (const auto backend : supportedBackends()) {
+    ASSERT_TRUE(Blake2bSia::setBackend(backend));
+
+    for (size_t batch : {1, 2, 4, 16, 64}) {
+      ShareVerifierSia verifier(base);
+      size_t verified = 0;
+      begin = std::chrono::steady_clock::now();
+      for (size_t i = 0; i < kShares; i += batch) {
+        for (size_t j = 0; j < batch; j++) {
+          verifier.submit(headers.data() + 80 * ((i + j) % 1024), [&verified](const uint8_t *hash) {
+            verified += hash[0];
+          });
+        }
+        event_base_loop(base, EVLOOP_NONBLOCK);
+      }
+      elapsed = std::chrono::steady_clock::now() - begin;
+      LOG(INFO) << "blake2b backend " << Blake2bSia::getBackendName(backend) << ", "
+                << batch << " shares per iteration: " << (uint64_t)(kShares * 1000000.0 /
+                   std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count())
+                << " shares/s/core (" << verified << ")";
+    }
+  }
+  event_base_free(base);
+}
@@ -0,0 +1,304 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) [2016] [BTC.COM]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+#include "gtest/gtest.h"
+#include "Common.h"
+#include "Utils.h"
+
+#include "BlockSubmitter.h"
+
+#include <event2/buffer.h>
+#include <event2/http.h>
+#include <event2/keyvalq_struct.h>
+#include <event2/listener.h>
+#include <event2/thread.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include <chrono>
+#include <condition_variable>
+
+/////////////////////////////// StubRpcServer ///////////////////////////////
+// A local HTTP server replying every request after a delay.
+class StubRpcServer {
+public:
+  struct Request {
+    string body_;
+    string authorization_;
+    uint16_t peerPort_;
+  };
+
+  uint32_t delayMs_;
+  int code_;
+
+private:
+  struct event_base *base_;
+  struct evhttp *httpd_;
+  uint16_t port_;
+  thread thread_;
+
+  mutable mutex lock_;
+  vector<Request> requests_;
+
+  struct DelayedReply {
+    StubRpcServer *server_;
+    struct evhttp_request *req_;
+  };
+
+  static void reply(evutil_socket_t fd, short events, void *ptr) {
+    DelayedReply *delayed = static_cast<DelayedReply *>(ptr);
+    struct evbuffer *evb = evbuffer_new();
+    evbuffer_add_printf(evb, "{\"result\":null,\"error\":null,\"id\":\"1\"}");
+    evhttp_send_reply(delayed->req_, delayed->server_->code_, "stub", evb);
+    evbuffer_free(evb);
+    delete delayed;
+  }
+
+  static void handle(struct evhttp_request *req, void *ptr) {
+    StubRpcServer *server = static_cast<StubRpcServer *>(ptr);
+
+    Request request;
+    struct evbuffer *input = evhttp_request_get_input_buffer(req);
+    request.body_.assign((const char *)evbuffer_pullup(input, -1), evbuffer_get_length(input));
+    const char *auth = evhttp_find_header(evhttp_request_get_input_headers(req), "Authorization");
+    request.authorization_ = auth != nullptr ? auth : "";
+    char *peerAddr = nullptr;
+    evhttp_connection_get_peer(evhttp_request_get_connection(req), &peerAddr, &request.peerPort_);
+    {
+      ScopeLock sl(server->lock_);
+      server->requests_.push_back(request);
+    }
+
+    DelayedReply *delayed = new DelayedReply{server, req};
+    struct timeval tv = {server->delayMs_ / 1000, (server->delayMs_ % 1000) * 1000};
+    event_base_once(server->base_, -1, EV_TIMEOUT, StubRpcServer::reply, delayed, &tv);
+  }
+
+public:
+  StubRpcServer(uint32_t delayMs, int code = HTTP_OK)
+    : delayMs_(delayMs), code_(code), port_(0)
+  {
+    // stopped from the test thread
+    evthread_use_pthreads();
+    base_ = event_base_new();
+    httpd_ = evhttp_new(base_);
+    evhttp_set_gencb(httpd_, StubRpcServer::handle, this);
+
+    struct evhttp_bound_socket *handle = evhttp_bind_socket_with_handle(httpd_, "127.0.0.1", 0);
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    getsockname(evhttp_bound_socket_get_fd(handle), (struct sockaddr *)&addr, &len);
+    port_ = ntohs(addr.sin_port);
+
+    thread_ = thread([this]() { event_base_dispatch(base_); });
+  }
+
+  ~StubRpcServer() {
+    event_base_loopexit(base_, nullptr);
+    thread_.join();
+    evhttp_free(httpd_);
+    event_base_free(base_);
+  }
+
+  string url() const { return Strings::Format("http://127.0.0.1:%u/", port_); }
+
+  vector<Request> requests() const {
+    ScopeLock sl(lock_);
+    return requests_;
+  }
+};
+
+// submit the request and wait for the results of all nodes
+static vector<BlockSubmitter::Result> submitAndWait(BlockSubmitter &submitter, const string &request) {
+  mutex lock;
+  std::condition_variable cond;
+  vector<BlockSubmitter::Result> results;
+
+  submitter.submit(std::make_shared<const string>(request), [&](const BlockSubmitter::Result &result) {
+    ScopeLock sl(lock);
+    results.push_back(result);
+    cond.notify_all();
+  });
+
+  std::unique_lock<mutex> l(lock);
+  cond.wait_for(l, std::chrono::seconds(10), [&]() { return results.size() == submitter.getNodesCount(); });
+  return results;
+}
+
+static const string kKeepAliveRequest = "{\"jsonrpc\":\"1.0\",\"id\":\"1\",\"method\":\"getblockcount\",\"params\":[]}";
+
+TEST(BlockSubmitter, LatencyHistogram) {
+  LatencyHistogram histogram;
+  ASSERT_EQ(histogram.count(), 0u);
+  ASSERT_EQ(histogram.percentileUs(50), 0u);
+
+  for (uint64_t i = 1; i <= 100; i++) {
+    histogram.add(i * 1000);  // 1ms ~ 100ms
+  }
+  ASSERT_EQ(histogram.count(), 100u);
+  ASSERT_EQ(histogram.maxUs(), 100000u);
+  ASSERT_EQ(histogram.avgUs(), 50500u);
+  // 50ms is in [32768, 65536)
+  ASSERT_EQ(histogram.percentileUs(50), 65536u);
+  // capped by the max
+  ASSERT_EQ(histogram.percentileUs(99), 100000u);
+  ASSERT_EQ(histogram.percentileUs(1), 1024u);
+
+  histogram.add(0);
+  histogram.add(UINT64_MAX);
+  ASSERT_EQ(histogram.maxUs(), UINT64_MAX);
+}
+
+TEST(BlockSubmitter, UnsupportedAddress) {
+  BlockSubmitter submitter({{"https://127.0.0.1:8332", "user:pass"}}, kKeepAliveRequest);
+  ASSERT_FALSE(submitter.init());
+
+  BlockSubmitter submitter2({{"127.0.0.1:8332", "user:pass"}}, kKeepAliveRequest);
+  ASSERT_FALSE(submitter2.init());
+}
+
+TEST(BlockSubmitter, SubmitInParallel) {
+  const uint32_t kDelayMs = 300;
+  vector<unique_ptr<StubRpcServer>> servers;
+  vector<NodeDefinition> nodes;
+  for (size_t i = 0; i < 4; i++) {
+    servers.emplace_back(new StubRpcServer(kDelayMs * (i + 1) / 4));
+    nodes.push_back({servers.back()->url(), Strings::Format("user%u:pass", (uint32_t)i)});
+  }
+
+  BlockSubmitter submitter(nodes, "");
+  ASSERT_TRUE(submitter.init());
+
+  const string request = "{\"jsonrpc\":\"1.0\",\"id\":\"1\",\"method\":\"submitblock\",\"params\":[\"" +
+                         string(2 * 1024 * 1024, 'a') + "\"]}";
+
+  auto begin = std::chrono::steady_clock::now();
+  auto results = submitAndWait(submitter, request);
+  auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now() - begin).count();
+
+  // one after another would take 750 ms
+  ASSERT_EQ(results.size(), servers.size());
+  ASSERT_GE(elapsedMs, kDelayMs);
+  ASSERT_LT(elapsedMs, kDelayMs * 2);
+
+  for (size_t i = 0; i < servers.size(); i++) {
+    auto requests = servers[i]->requests();
+    ASSERT_EQ(requests.size(), 1u);
+    ASSERT_EQ(requests[0].body_, request);
+    ASSERT_EQ(requests[0].authorization_, "Basic " + EncodeBase64(nodes[i].rpcUserPwd_));
+
+    // the latency is recorded
+    const LatencyHistogram &latency = submitter.getLatency(i);
+    ASSERT_EQ(latency.count(), 1u);
+    ASSERT_GE(latency.maxUs(), kDelayMs * (i + 1) / 4 * 1000);
+  }
+  for (const auto &result : results) {
+    ASSERT_TRUE(result.accepted_);
+    ASSERT_EQ(result.tries_, 1u);
+    ASSERT_EQ(result.response_, "{\"result\":null,\"error\":null,\"id\":\"1\"}");
+  }
+  // the slowest node completes last
+  ASSERT_EQ(results.back().node_, servers.size() - 1);
+}
+
+TEST(BlockSubmitter, KeepAlive) {
+  StubRpcServer server(0);
+  BlockSubmitter submitter({{server.url(), "user:pass"}}, kKeepAliveRequest);
+  ASSERT_TRUE(submitter.init());
+
+  // connected by the keep-alive request
+  for (size_t i = 0; i < 100 && server.requests().empty(); i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  ASSERT_EQ(server.requests().size(), 1u);
+  ASSERT_EQ(server.requests()[0].body_, kKeepAliveRequest);
+
+  for (size_t i = 0; i < 3; i++) {
+    auto results = submitAndWait(submitter, "{\"method\":\"submitblock\"}");
+    ASSERT_EQ(results.size(), 1u);
+    ASSERT_TRUE(results[0].accepted_);
+  }
+
+  // all requests are sent over the same connection
+  auto requests = server.requests();
+  ASSERT_EQ(requests.size(), 4u);
+  for (const auto &request : requests) {
+    ASSERT_EQ(request.peerPort_, requests[0].peerPort_);
+  }
+  ASSERT_EQ(submitter.getLatency(0).count(), 3u);
+}
+
+TEST(BlockSubmitter, Retry) {
+  // all nodes fail
+  {
+    StubRpcServer server1(0, HTTP_INTERNAL);
+    StubRpcServer server2(0, HTTP_INTERNAL);
+    BlockSubmitter submitter({{server1.url(), "user:pass"}, {server2.url(), "user:pass"}}, "");
+    ASSERT_TRUE(submitter.init());
+
+    auto results = submitAndWait(submitter, "{\"method\":\"submitblock\"}");
+    ASSERT_EQ(results.size(), 2u);
+    for (const auto &result : results) {
+      ASSERT_FALSE(result.accepted_);
+      ASSERT_EQ(result.tries_, BlockSubmitter::kMaxTries_);
+    }
+    ASSERT_EQ(server1.requests().size(), BlockSubmitter::kMaxTries_);
+    ASSERT_EQ(server2.requests().size(), BlockSubmitter::kMaxTries_);
+    ASSERT_EQ(submitter.getLatency(0).count(), BlockSubmitter::kMaxTries_);
+  }
+
+  // the failed node is not retried after the block is accepted by another node
+  {
+    StubRpcServer server1(0);
+    StubRpcServer server2(200, HTTP_INTERNAL);
+    BlockSubmitter submitter({{server1.url(), "user:pass"}, {server2.url(), "user:pass"}}, "");
+    ASSERT_TRUE(submitter.init());
+
+    auto results = submitAndWait(submitter, "{\"method\":\"submitblock\"}");
+    ASSERT_EQ(results.size(), 2u);
+    ASSERT_EQ(results[0].node_, 0u);
+    ASSERT_TRUE(results[0].accepted_);
+    ASSERT_EQ(results[1].node_, 1u);
+    ASSERT_FALSE(results[1].accepted_);
+    ASSERT_EQ(results[1].tries_, 1u);
+    ASSERT_EQ(server2.requests().size(), 1u);
+  }
+
+  // the node is unreachable
+  {
+    uint16_t port;
+    {
+      StubRpcServer server(0);
+      port = (uint16_t)atoi(server.url().substr(strlen("http://127.0.0.1:")).c_str());
+    }
+    BlockSubmitter submitter({{Strings::Format("http://127.0.0.1:%u/", port), "user:pass"}}, "");
+    ASSERT_TRUE(submitter.init());
+
+    auto results = submitAndWait(submitter, "{\"method\":\"submitblock\"}");
+    ASSERT_EQ(results.size(), 1u);
+    ASSERT_FALSE(results[0].accepted_);
+    ASSERT_EQ(results[0].tries_, BlockSubmitter::kMaxTries_);
+  }
+}
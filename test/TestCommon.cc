@@ -27,6 +27,8 @@
 #include "gtest/gtest.h"
 
 #include "Utils.h"
+#include "LockFreeCache.h"
+#include "QuiescentState.h"
 
 #include "bitcoin/CommonBitcoin.h"
 #include "eth/CommonEth.h"
@@ -35,6 +37,8 @@
 #include <uint256.h>
 #include <arith_uint256.h>
 
+#include <chrono>
+
 TEST(Common, score2Str) {
   // 10e-25
   ASSERT_EQ(score2Str(0.0000000000000000000000001), "0.0000000000000000000000001");
@@ -288,6 +292,199 @@ TEST(Common, BitsToDifficulty) {
   ASSERT_EQ((uint64_t)(d * 10000.0), 163074209ull);
 }
 
+TEST(Common, DiffToTargetCacheExactness) {
+  // vardiff starts from a power of 2 or from min_difficulty of the
+  // config, and goes up and down by x2 between kMinDiff_ and kMaxDiff_
+  const uint64_t kMaxDiff = 0x4000000000000000ull;
+  const vector<uint64_t> minDiffs = {1, 3, 5, 7, 10, 100, 1000, 4096, 16384, 65535, 100000, 1000000007ull};
+
+  for (int round = 0; round < 2; round++) {  // cache missed and hit
+    for (const uint64_t minDiff : minDiffs) {
+      for (uint64_t diff = minDiff; diff <= kMaxDiff; diff *= 2) {
+        uint256 expected, target;
+        DiffToTarget(diff, expected, false);
+        DiffToTarget(diff, target, true);
+        ASSERT_EQ(target, expected) << "diff: " << diff;
+      }
+    }
+  }
+  for (uint64_t diff = 0; diff < 10000; diff++) {
+    uint256 expected, target;
+    DiffToTarget(diff, expected, false);
+    DiffToTarget(diff, target, true);
+    ASSERT_EQ(target, expected) << "diff: " << diff;
+    DiffToTarget(diff, target, true);
+    ASSERT_EQ(target, expected) << "diff: " << diff;
+  }
+
+  uint256 target;
+  DiffToTarget(1ull << 63, target, true);
+  ASSERT_EQ(target, uint256S("000000000000000000000001fffe000000000000000000000000000000000000"));
+}
+
+TEST(Common, BitsToDifficultyCacheExactness) {
+  for (int round = 0; round < 2; round++) {  // cache missed and hit
+    for (uint32_t nbytes = 0x03; nbytes <= 0x20; nbytes++) {
+      for (const uint32_t value : {0x00ffffu, 0x0404cbu, 0x7fffffu, 0x123456u, 0x000001u}) {
+        const uint32_t bits = (nbytes << 24) | value;
+        double expected, diff;
+        BitsToDifficulty(bits, &expected, false);
+        BitsToDifficulty(bits, &diff, true);
+        ASSERT_EQ(diff, expected) << "bits: " << bits;
+
+        uint64_t expectedInt, diffInt;
+        BitsToDifficulty(bits, &expectedInt, false);
+        BitsToDifficulty(bits, &diffInt, true);
+        ASSERT_EQ(diffInt, expectedInt) << "bits: " << bits;
+      }
+    }
+  }
+}
+
+TEST(Common, LockFreeCache) {
+  LockFreeCache<uint256, 8> cache;
+  uint256 value;
+  ASSERT_FALSE(cache.get(0, value));
+  ASSERT_FALSE(cache.get(1, value));
+
+  cache.put(1, uint256S("01"));
+  ASSERT_TRUE(cache.get(1, value));
+  ASSERT_EQ(value, uint256S("01"));
+
+  // every value read by the readers should be the one of its key
+  LockFreeCache<uint256, 8> shared;
+  atomic<bool> running(true);
+  atomic<uint64_t> hits(0);
+  vector<thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&, t]() {
+      uint64_t myHits = 0;
+      for (uint64_t i = 0; running; i++) {
+        const uint64_t key = (i * 7 + t) % 32;
+        const uint256 expected = ArithToUint256(arith_uint256(key) * key + 1);
+        uint256 got;
+        if (shared.get(key, got)) {
+          ASSERT_EQ(got, expected);
+          myHits++;
+        } else {
+          shared.put(key, expected);
+        }
+      }
+      hits += myHits;
+    });
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  running = false;
+  for (auto &t : threads) {
+    t.join();
+  }
+  ASSERT_GT(hits, 0u);
+}
+
+TEST(Common, QuiescentState) {
+  QuiescentState::Token token;
+  {
+    QuiescentReader reader;
+    token = QuiescentState::retire();
+    ASSERT_FALSE(QuiescentState::passed(token));
+    QuiescentState::quiescent();
+    ASSERT_TRUE(QuiescentState::passed(token));
+
+    // offline readers are not waited for
+    QuiescentState::offline();
+    ASSERT_TRUE(QuiescentState::passed(QuiescentState::retire()));
+    QuiescentState::online();
+    token = QuiescentState::retire();
+    ASSERT_FALSE(QuiescentState::passed(token));
+    QuiescentState::offline();
+    ASSERT_TRUE(QuiescentState::passed(token));
+
+    QuiescentState::online();
+    token = QuiescentState::retire();
+    ASSERT_FALSE(QuiescentState::passed(token));
+  }
+  // the reader has gone
+  ASSERT_TRUE(QuiescentState::passed(token));
+
+  // a snapshot is poisoned right before it's freed,
+  // readers must never see a poisoned one
+  struct Snapshot {
+    uint64_t a_, b_;
+  };
+  atomic<Snapshot *> current(new Snapshot{0, 0});
+  atomic<bool> running(true);
+  atomic<uint64_t> poisoned(0);
+  vector<thread> readers;
+  for (int t = 0; t < 4; t++) {
+    readers.emplace_back([&]() {
+      QuiescentReader reader;
+      while (running) {
+        for (int i = 0; i < 64; i++) {
+          Snapshot *snapshot = current.load(std::memory_order_acquire);
+          if (snapshot->a_ != snapshot->b_) {
+            poisoned++;
+          }
+        }
+        QuiescentState::quiescent();
+      }
+    });
+  }
+
+  std::deque<std::pair<QuiescentState::Token, Snapshot *>> retired;
+  auto begin = std::chrono::steady_clock::now();
+  for (uint64_t i = 1; std::chrono::steady_clock::now() - begin < std::chrono::milliseconds(200); i++) {
+    Snapshot *old = current.exchange(new Snapshot{i, i}, std::memory_order_acq_rel);
+    retired.emplace_back(QuiescentState::retire(), old);
+    while (retired.size() && QuiescentState::passed(retired.front().first)) {
+      retired.front().second->b_ = ~retired.front().second->a_;
+      delete retired.front().second;
+      retired.pop_front();
+    }
+  }
+  running = false;
+  for (auto &t : readers) {
+    t.join();
+  }
+  ASSERT_EQ(poisoned, 0u);
+  for (auto &itr : retired) {
+    ASSERT_TRUE(QuiescentState::passed(itr.first));
+    delete itr.second;
+  }
+  delete current.load();
+}
+
+TEST(Common, DISABLED_DiffCacheBenchmark) {
+  const size_t kRounds = 1000000;
+  const vector<uint64_t> diffs = {1024, 3000, 16384, 65536, 100000, 262144};
+  const vector<uint32_t> bits = {0x1b0404cbu, 0x17376f56u, 0x180130e0u, 0x1d00ffffu};
+
+  for (const bool useCache : {false, true}) {
+    uint256 sum;
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < kRounds; i++) {
+      uint256 target;
+      DiffToTarget(diffs[i % diffs.size()], target, useCache);
+      sum.begin()[i % 32] ^= target.begin()[i % 32];
+    }
+    auto diffToTarget = std::chrono::steady_clock::now() - begin;
+
+    double total = 0;
+    begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < kRounds; i++) {
+      double diff;
+      BitsToDifficulty(bits[i % bits.size()], &diff, useCache);
+      total += diff;
+    }
+    auto bitsToDiff = std::chrono::steady_clock::now() - begin;
+
+    using std::chrono::nanoseconds;
+    LOG(INFO) << (useCache ? "cached" : "uncached") << ": "
+              << "DiffToTarget " << std::chrono::duration_cast<nanoseconds>(diffToTarget).count() / kRounds << " ns, "
+              << "BitsToDifficulty " << std::chrono::duration_cast<nanoseconds>(bitsToDiff).count() / kRounds << " ns"
+              << " (" << sum.GetHex().substr(0, 4) << ", " << (uint64_t)total << ")";
+  }
+}
+
 TEST(Common, formatDifficulty) {
   ASSERT_EQ(formatDifficulty(UINT64_MAX), 9223372036854775808ull);
 
@@ -0,0 +1,223 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) [2016] [BTC.COM]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+
+#include "gtest/gtest.h"
+#include "Common.h"
+#include "Kafka.h"
+#include "ShareBatch.h"
+#include "Utils.h"
+
+#include <string.h>
+#include <chrono>
+
+#include <glog/logging.h>
+
+// the mock cluster of librdkafka is available since v1.4.0
+#if RD_KAFKA_VERSION >= 0x010400ff
+#include <librdkafka/rdkafka_mock.h>
+
+//////////////////////////////// KafkaMockCluster ///////////////////////////////
+// An in-process Kafka cluster, doesn't need a broker to run the tests.
+class KafkaMockCluster {
+  rd_kafka_t *rk_;
+  rd_kafka_mock_cluster_t *cluster_;
+
+public:
+  KafkaMockCluster() : rk_(nullptr), cluster_(nullptr) {
+    char errstr[512];
+    rk_ = rd_kafka_new(RD_KAFKA_PRODUCER, rd_kafka_conf_new(), errstr, sizeof(errstr));
+    if (rk_ != nullptr) {
+      cluster_ = rd_kafka_mock_cluster_new(rk_, 1);
+    }
+  }
+  ~KafkaMockCluster() {
+    if (cluster_ != nullptr)
+      rd_kafka_mock_cluster_destroy(cluster_);
+    if (rk_ != nullptr)
+      rd_kafka_destroy(rk_);
+  }
+
+  bool createTopic(const char *topic) {
+    return cluster_ != nullptr &&
+           rd_kafka_mock_topic_create(cluster_, topic, 1, 1) == RD_KAFKA_RESP_ERR_NO_ERROR;
+  }
+  string getBrokers() const {
+    return rd_kafka_mock_cluster_bootstraps(cluster_);
+  }
+};
+
+static void produceMessages(const string &brokers, const char *topic, size_t count) {
+  // the destructor waits for the messages to be delivered
+  KafkaProducer producer(brokers.c_str(), topic, 0);
+  ASSERT_TRUE(producer.setup());
+
+  string payload(64, 'x');
+  for (size_t i = 0; i < count; i++) {
+    memcpy(&payload[0], &i, sizeof(i));
+    while (!producer.tryProduce(payload.data(), payload.size())) {
+      // the local queue is full
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  }
+}
+
+// return messages per second
+static double consumeMessages(const string &brokers, const char *topic,
+                              size_t count, size_t batchSize) {
+  KafkaConsumer consumer(brokers.c_str(), topic, 0);
+  EXPECT_TRUE(consumer.setup(RD_KAFKA_OFFSET_BEGINNING));
+
+  size_t received = 0;
+  bool inOrder = true;
+  auto handleMessage = [&](rd_kafka_message_t *rkmessage) {
+    if (rkmessage->err) {
+      return;
+    }
+    size_t i = 0;
+    memcpy(&i, rkmessage->payload, sizeof(i));
+    inOrder = inOrder && i == received;
+    received++;
+  };
+
+  auto begin = std::chrono::steady_clock::now();
+  auto deadline = begin + std::chrono::seconds(60);
+
+  while (received < count && std::chrono::steady_clock::now() < deadline) {
+    if (batchSize == 0) {
+      rd_kafka_message_t *rkmessage = consumer.consumer(100);
+      if (rkmessage != nullptr) {
+        handleMessage(rkmessage);
+        rd_kafka_message_destroy(rkmessage);
+      }
+    } else {
+      EXPECT_GE(consumer.consumeBatch(100, batchSize, handleMessage), 0);
+    }
+  }
+  auto elapsed = std::chrono::steady_clock::now() - begin;
+
+  EXPECT_EQ(received, count);
+  EXPECT_TRUE(inOrder);
+  return count / std::chrono::duration<double>(elapsed).count();
+}
+
+//////////////////////////////// KafkaConsumer ///////////////////////////////
+TEST(KafkaConsumer, ConsumeBatch) {
+  const char *topic = "TestConsumeBatch";
+  const size_t kMessages = 200000;
+
+  KafkaMockCluster cluster;
+  ASSERT_TRUE(cluster.createTopic(topic));
+  produceMessages(cluster.getBrokers(), topic, kMessages);
+
+  const double single = consumeMessages(cluster.getBrokers(), topic, kMessages, 0);
+  const double batch = consumeMessages(cluster.getBrokers(), topic, kMessages, 10000);
+
+  LOG(INFO) << "consume " << kMessages << " messages, consumer(): " << (uint64_t)single
+            << " msg/s, consumeBatch(): " << (uint64_t)batch << " msg/s";
+}
+
+//////////////////////////////// ShareBatch ///////////////////////////////
+// Produce `count` shares of 64 bytes, one per message or in batches of
+// `batchSize` bytes, and consume them. Returns the seconds it takes.
+static double produceAndConsumeShares(const string &brokers, const char *topic,
+                                      size_t count, size_t batchSize,
+                                      size_t &messages, size_t &bytes) {
+  auto begin = std::chrono::steady_clock::now();
+  messages = 0;
+  bytes = 0;
+  {
+    KafkaProducer producer(brokers.c_str(), topic, 0);
+    EXPECT_TRUE(producer.setup());
+
+    auto produce = [&](const uint8_t *data, size_t len) {
+      while (!producer.tryProduce(data, len)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+      messages++;
+      bytes += len;
+    };
+
+    ShareBatch batch;
+    string share(64, 'x');
+    for (size_t i = 0; i < count; i++) {
+      memcpy(&share[0], &i, sizeof(i));
+      if (batchSize == 0) {
+        produce((const uint8_t *)share.data(), share.size());
+        continue;
+      }
+      batch.add((const uint8_t *)share.data(), share.size());
+      if (batch.size() >= batchSize) {
+        produce(batch.data(), batch.size());
+        batch.clear();
+      }
+    }
+    if (batch.count() > 0) {
+      produce(batch.data(), batch.size());
+    }
+  }
+
+  KafkaConsumer consumer(brokers.c_str(), topic, 0);
+  EXPECT_TRUE(consumer.setup(RD_KAFKA_OFFSET_BEGINNING));
+  size_t received = 0;
+  bool inOrder = true;
+  auto deadline = begin + std::chrono::seconds(60);
+  while (received < count && std::chrono::steady_clock::now() < deadline) {
+    consumer.consumeBatch(100, 10000, [&](rd_kafka_message_t *rkmessage) {
+      if (rkmessage->err) {
+        return;
+      }
+      ShareBatch::forEachShare((const uint8_t *)rkmessage->payload, rkmessage->len,
+                               [&](const uint8_t *data, uint32_t size) {
+        size_t i = 0;
+        memcpy(&i, data, sizeof(i));
+        inOrder = inOrder && i == received && size == 64;
+        received++;
+      });
+    });
+  }
+  EXPECT_EQ(received, count);
+  EXPECT_TRUE(inOrder);
+
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+TEST(ShareBatch, DISABLED_ProduceBenchmark) {
+  const size_t kShares = 500000;
+
+  KafkaMockCluster cluster;
+  for (size_t batchSize : {0, 4096, 65536}) {
+    const string topic = Strings::Format("TestShareBatch%u", (uint32_t)batchSize);
+    ASSERT_TRUE(cluster.createTopic(topic.c_str()));
+
+    size_t messages = 0, bytes = 0;
+    const double seconds = produceAndConsumeShares(cluster.getBrokers(), topic.c_str(),
+                                                   kShares, batchSize, messages, bytes);
+    LOG(INFO) << kShares << " shares, batch size " << batchSize << ": "
+              << (uint64_t)(kShares / seconds) << " shares/s, "
+              << (uint64_t)(messages / seconds) << " messages/s, "
+              << (uint64_t)(bytes / seconds) << " bytes/s";
+  }
+}
+
+#endif  // RD_KAFKA_VERSION >= 0x010400ff
@@ -0,0 +1,162 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) [2016] [BTC.COM]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+#include "gtest/gtest.h"
+#include "Common.h"
+#include "MySQLConnection.h"
+#include "Utils.h"
+
+#include <chrono>
+#include <sstream>
+
+#include <glog/logging.h>
+
+//
+// Integration tests, they need a mysqld with `local_infile = ON`:
+//   export BTCPOOL_TEST_MYSQL="host:port:username:password:dbname"
+//
+static bool getTestMySQLInfo(MysqlConnectInfo &info) {
+  const char *env = getenv("BTCPOOL_TEST_MYSQL");
+  if (env == nullptr) {
+    LOG(INFO) << "BTCPOOL_TEST_MYSQL is not set, skip the mysql test";
+    return false;
+  }
+
+  vector<string> items;
+  std::istringstream ss(env);
+  string item;
+  while (std::getline(ss, item, ':')) {
+    items.push_back(item);
+  }
+  if (items.size() != 5) {
+    LOG(ERROR) << "wrong BTCPOOL_TEST_MYSQL: " << env;
+    return false;
+  }
+  info = MysqlConnectInfo(items[0], atoi(items[1].c_str()), items[2], items[3], items[4]);
+  return true;
+}
+
+static const char *kCreateTestTable = "CREATE TEMPORARY TABLE `%s` ("
+  "  `worker_id` bigint(20) NOT NULL,"
+  "  `puid` int(11) NOT NULL,"
+  "  `accept_1h` bigint(20) NOT NULL DEFAULT '0',"
+  "  `last_share_ip` char(16) NOT NULL DEFAULT '0.0.0.0',"
+  "  `last_share_time` timestamp NOT NULL DEFAULT '1970-01-01 00:00:01',"
+  "  UNIQUE KEY `puid_worker_id` (`puid`,`worker_id`)"
+  ") ENGINE=InnoDB DEFAULT CHARSET=utf8";
+
+TEST(MySQLConnection, LoadData) {
+  MysqlConnectInfo info("", 0, "", "", "");
+  if (!getTestMySQLInfo(info)) {
+    return;
+  }
+  MySQLConnection db(info);
+  ASSERT_TRUE(db.ping());
+  ASSERT_EQ(db.getVariable("local_infile"), "ON");
+  ASSERT_TRUE(db.execute(Strings::Format(kCreateTestTable, "load_data_test")));
+
+  const string fields = "`worker_id`,`puid`,`accept_1h`,`last_share_ip`,`last_share_time`";
+  vector<string> rows = {
+    "1\t2\t3\t10.0.0.1\t2018-10-01 00:00:00",
+    "4\t5\t6\t10.0.0.2\t2018-10-02 12:34:56"
+  };
+  ASSERT_EQ(db.loadData("load_data_test", fields, rows), 2);
+
+  MySQLResult result;
+  ASSERT_TRUE(db.query("SELECT * FROM `load_data_test` ORDER BY `worker_id`", result));
+  ASSERT_EQ(result.numRows(), 2u);
+  char **row = result.nextRow();
+  ASSERT_STREQ(row[0], "1");
+  ASSERT_STREQ(row[1], "2");
+  ASSERT_STREQ(row[2], "3");
+  ASSERT_STREQ(row[3], "10.0.0.1");
+  ASSERT_STREQ(row[4], "2018-10-01 00:00:00");
+  row = result.nextRow();
+  ASSERT_STREQ(row[0], "4");
+  ASSERT_STREQ(row[4], "2018-10-02 12:34:56");
+
+  // a row longer than the buffer of the client library
+  rows = {string(100000, '0') + "7\t8\t9\t10.0.0.3\t2018-10-03 00:00:00"};
+  ASSERT_EQ(db.loadData("load_data_test", fields, rows), 1);
+
+  // empty
+  ASSERT_EQ(db.loadData("load_data_test", fields, {}), 0);
+
+  // missing table
+  ASSERT_EQ(db.loadData("load_data_missing_test", fields, rows), -1);
+}
+
+TEST(MySQLConnection, DISABLED_LoadDataBenchmark) {
+  MysqlConnectInfo info("", 0, "", "", "");
+  if (!getTestMySQLInfo(info)) {
+    return;
+  }
+  MySQLConnection db(info);
+  ASSERT_TRUE(db.ping());
+  ASSERT_TRUE(db.execute(Strings::Format(kCreateTestTable, "load_data_test")));
+  ASSERT_TRUE(db.execute(Strings::Format(kCreateTestTable, "multi_insert_test")));
+
+  // 1M workers, as flushed by statshttpd
+  const size_t kWorkers = 1000000;
+  const string fields = "`worker_id`,`puid`,`accept_1h`,`last_share_ip`,`last_share_time`";
+  const time_t now = time(nullptr);
+  std::mt19937 gen(12345);
+  vector<string> rows, values;
+  rows.reserve(kWorkers);
+  values.reserve(kWorkers);
+  for (size_t i = 0; i < kWorkers; i++) {
+    const int64_t workerId = (int64_t)i * 7919 - 1000000;
+    const int32_t userId   = i % 10000 + 1;
+    const uint64_t accept  = gen();
+    const string ip        = Strings::Format("10.%u.%u.%u", gen() % 256, gen() % 256, gen() % 256);
+    const string shareTime = date("%F %T", now - gen() % 3600);
+    rows.push_back(Strings::Format("%" PRId64"\t%d\t%" PRIu64"\t%s\t%s",
+                                   workerId, userId, accept, ip.c_str(), shareTime.c_str()));
+    values.push_back(Strings::Format("%" PRId64",%d,%" PRIu64",\"%s\",\"%s\"",
+                                     workerId, userId, accept, ip.c_str(), shareTime.c_str()));
+  }
+
+  auto begin = std::chrono::steady_clock::now();
+  ASSERT_TRUE(multiLoadData(db, "load_data_test", fields, rows));
+  auto loadDataTime = std::chrono::steady_clock::now() - begin;
+
+  begin = std::chrono::steady_clock::now();
+  ASSERT_TRUE(multiInsert(db, "multi_insert_test", fields, values));
+  auto multiInsertTime = std::chrono::steady_clock::now() - begin;
+
+  // the same rows in both tables
+  MySQLResult result;
+  ASSERT_TRUE(db.query("SELECT COUNT(*) FROM `load_data_test`", result));
+  ASSERT_EQ(atoll(result.nextRow()[0]), (int64_t)kWorkers);
+  ASSERT_TRUE(db.query("SELECT COUNT(*) FROM `load_data_test` AS `a` "
+                       " JOIN `multi_insert_test` AS `b` USING (`puid`, `worker_id`) "
+                       " WHERE `a`.`accept_1h` = `b`.`accept_1h` "
+                       "   AND `a`.`last_share_ip` = `b`.`last_share_ip` "
+                       "   AND `a`.`last_share_time` = `b`.`last_share_time`", result));
+  ASSERT_EQ(atoll(result.nextRow()[0]), (int64_t)kWorkers);
+
+  LOG(INFO) << kWorkers << " rows, LOAD DATA: "
+            << std::chrono::duration_cast<std::chrono::milliseconds>(loadDataTime).count() << " ms, "
+            << "multi-insert: "
+            << std::chrono::duration_cast<std::chrono::milliseconds>(multiInsertTime).count() << " ms";
+}
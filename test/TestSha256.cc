@@ -0,0 +1,193 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) [2016] [BTC.COM]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+#include "gtest/gtest.h"
+#include "Common.h"
+#include "Utils.h"
+
+#include "bitcoin/Sha256.h"
+
+#include <chrono>
+
+// restores the backend chosen at startup
+class Sha256BackendGuard {
+  Sha256::Backend backend_;
+public:
+  Sha256BackendGuard() : backend_(Sha256::getBackend()) {}
+  ~Sha256BackendGuard() { Sha256::setBackend(backend_); }
+};
+
+static vector<Sha256::Backend> supportedBackends() {
+  vector<Sha256::Backend> backends;
+  for (size_t i = 0; i < Sha256::kBackends_; i++) {
+    const Sha256::Backend backend = (Sha256::Backend)i;
+    if (Sha256::isSupported(backend)) {
+      backends.push_back(backend);
+    } else {
+      LOG(INFO) << "sha256 backend " << Sha256::getBackendName(backend) << " is not supported, skipped";
+    }
+  }
+  return backends;
+}
+
+static string hashToHex(const uint8_t *hash) {
+  return HexStr(hash, hash + 32);
+}
+
+////////////////////////////////  Known Answers  /////////////////////////////////
+TEST(Sha256, Backends) {
+  ASSERT_TRUE(Sha256::isSupported(Sha256::GENERIC));
+  ASSERT_TRUE(Sha256::isSupported(Sha256::getBackend()));
+  LOG(INFO) << "sha256 backend: " << Sha256::getBackendName(Sha256::getBackend());
+}
+
+TEST(Sha256, KnownAnswers) {
+  Sha256BackendGuard guard;
+
+  // 64 bytes input: 0x00, 0x01, ..., 0x3f
+  uint8_t in64[64];
+  for (size_t i = 0; i < sizeof(in64); i++) {
+    in64[i] = (uint8_t)i;
+  }
+  // 1000 bytes input, more than one block and a tail
+  vector<uint8_t> in1000(1000);
+  for (size_t i = 0; i < in1000.size(); i++) {
+    in1000[i] = (uint8_t)(i % 251);
+  }
+  // the genesis block header of the bitcoin mainnet
+  const vector<unsigned char> genesis = ParseHex(
+    "0100000000000000000000000000000000000000000000000000000000000000000000003ba3edfd"
+    "7a7b12b27ac72c3e67768f617fc81bc3888a51323a9fb8aa4b1e5e4a29ab5f49ffff001d1dac2b7c");
+  ASSERT_EQ(genesis.size(), 80u);
+
+  for (const auto backend : supportedBackends()) {
+    SCOPED_TRACE(Sha256::getBackendName(backend));
+    ASSERT_TRUE(Sha256::setBackend(backend));
+    ASSERT_EQ(Sha256::getBackend(), backend);
+
+    uint8_t out[32];
+    Sha256::hashD(out, (const uint8_t *)"abc", 3);
+    ASSERT_EQ(hashToHex(out), "4f8b42c22dd3729b519ba6f68d2da7cc5b2d606d05daed5ad5128cc03e6c6358");
+
+    Sha256::hashD(out, nullptr, 0);
+    ASSERT_EQ(hashToHex(out), "5df6e0e2761359d30a8275058e299fcc0381534545f55cf43e41983f5d4c9456");
+
+    Sha256::hashD(out, in1000.data(), in1000.size());
+    ASSERT_EQ(hashToHex(out), "c88e98bd565d6e001a0a37ac287032e1183923f35f6fde42c14210cbe2098d7c");
+
+    Sha256::hashD(out, in64, sizeof(in64));
+    ASSERT_EQ(hashToHex(out), "01c9f464780a1b6af4eb400fe2f2896cfb2169f5a65701439e4c2c4e213903ef");
+    Sha256::hashD64(out, in64, 1);
+    ASSERT_EQ(hashToHex(out), "01c9f464780a1b6af4eb400fe2f2896cfb2169f5a65701439e4c2c4e213903ef");
+
+    // the block hash, displayed reversed as 000000000019d6...
+    Sha256::hashD80(out, genesis.data());
+    ASSERT_EQ(hashToHex(out), "6fe28c0ab6f1b372c1a6a246ae63f74f931e8365e15a089c68d6190000000000");
+    Sha256::hashD(out, genesis.data(), genesis.size());
+    ASSERT_EQ(hashToHex(out), "6fe28c0ab6f1b372c1a6a246ae63f74f931e8365e15a089c68d6190000000000");
+  }
+}
+
+TEST(Sha256, HashD64Lanes) {
+  Sha256BackendGuard guard;
+
+  // not a multiple of 4 or 8, so the multi-lane backends also
+  // go through the single-lane tail
+  const size_t kInputs = 8 * 3 + 4 + 3;
+  vector<uint8_t> in(64 * kInputs);
+  for (size_t i = 0; i < in.size(); i++) {
+    in[i] = (uint8_t)(i * 7 + i / 64);
+  }
+
+  vector<uint8_t> expected(32 * kInputs);
+  for (size_t i = 0; i < kInputs; i++) {
+    Sha256::hashD(expected.data() + 32 * i, in.data() + 64 * i, 64);
+  }
+
+  for (const auto backend : supportedBackends()) {
+    SCOPED_TRACE(Sha256::getBackendName(backend));
+    ASSERT_TRUE(Sha256::setBackend(backend));
+
+    vector<uint8_t> out(32 * kInputs);
+    Sha256::hashD64(out.data(), in.data(), kInputs);
+    ASSERT_EQ(out, expected);
+
+    // in place, like a level of a merkle tree
+    vector<uint8_t> inplace(in);
+    Sha256::hashD64(inplace.data(), inplace.data(), kInputs);
+    inplace.resize(32 * kInputs);
+    ASSERT_EQ(inplace, expected);
+  }
+}
+
+////////////////////////////////  Benchmark  /////////////////////////////////
+TEST(Sha256, DISABLED_SharesPerSecondBenchmark) {
+  Sha256BackendGuard guard;
+
+  // the hashing of checking a share: the coinbase tx, the merkle
+  // branch of a block with ~4000 txs and the block header
+  const size_t kShares = 50000;
+  const size_t kMerkleSteps = 12;
+  const size_t kCoinbaseSize = 250;
+  vector<uint8_t> coinbase(kCoinbaseSize, 0x5a);
+  vector<uint8_t> branch(32 * kMerkleSteps, 0xa5);
+  uint8_t header[80] = {0};
+
+  // building the merkle branch of a new job, 4096 txs
+  const size_t kLevelInputs = 2048;
+  vector<uint8_t> level(64 * kLevelInputs, 0x3c);
+
+  for (const auto backend : supportedBackends()) {
+    ASSERT_TRUE(Sha256::setBackend(backend));
+
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < kShares; i++) {
+      memcpy(coinbase.data(), &i, sizeof(i));  // the extra nonce
+
+      uint8_t buf[64];
+      Sha256::hashD(buf, coinbase.data(), coinbase.size());
+      for (size_t j = 0; j < kMerkleSteps; j++) {
+        memcpy(buf + 32, branch.data() + 32 * j, 32);
+        Sha256::hashD64(buf, buf, 1);
+      }
+      memcpy(header + 36, buf, 32);
+      Sha256::hashD80(buf, header);
+      header[76] = buf[0];  // the nonce, so nothing is optimized away
+    }
+    auto shares = std::chrono::steady_clock::now() - begin;
+
+    begin = std::chrono::steady_clock::now();
+    const size_t kLevels = 100;
+    for (size_t i = 0; i < kLevels; i++) {
+      Sha256::hashD64(level.data(), level.data(), kLevelInputs);
+    }
+    auto levels = std::chrono::steady_clock::now() - begin;
+
+    using std::chrono::microseconds;
+    const double sharesUs = std::chrono::duration_cast<microseconds>(shares).count();
+    const double levelsUs = std::chrono::duration_cast<microseconds>(levels).count();
+    LOG(INFO) << "sha256 backend " << Sha256::getBackendName(backend) << ": "
+              << (uint64_t)(kShares * 1000000.0 / sharesUs) << " shares/s/core, "
+              << (uint64_t)(kLevels * kLevelInputs * 1000000.0 / levelsUs) << " merkle nodes/s/core";
+  }
+}
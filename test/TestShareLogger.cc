@@ -0,0 +1,581 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) [2016] [BTC.COM]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+
+#include "gtest/gtest.h"
+#include "Common.h"
+#include "Utils.h"
+#include "ShareBatch.h"
+#include "ShareLogZstd.h"
+
+#include "bitcoin/StratumBitcoin.h"
+#include "bitcoin/ShareLogParserBitcoin.h"
+
+#include <sys/stat.h>
+
+#include <chrono>
+
+static const time_t kShareLogDate = 1538352000;  // 2018-10-01 00:00:00 UTC
+static const uint32_t kSharesPerHour = 100;
+
+static string makeSharePayload(uint32_t i, uint32_t timestamp) {
+  ShareBitcoin share;
+  share.set_jobid(1000 + i);
+  share.set_userid(1 + i % 3);
+  share.set_workerhashid(1 + i % 7);
+  share.set_height(527259);
+  share.set_blkbits(0x1d00ffffu);
+  share.set_sharediff(1 + i % 100);
+  share.set_timestamp(timestamp);
+  share.set_status(StratumStatus::ACCEPT);
+
+  string data;
+  uint32_t size = 0;
+  share.SerializeToArrayWithVersion(data, size);
+  data.resize(size);
+  return data;
+}
+
+// one frame per hour
+static void writeShareLog(const string &filePath, uint32_t beginHour, uint32_t endHour,
+                          vector<string> &payloads) {
+  ShareLogZstdWriter writer(filePath, 3);
+  ASSERT_TRUE(writer.open());
+
+  for (uint32_t hour = beginHour; hour < endHour; hour++) {
+    for (uint32_t i = 0; i < kSharesPerHour; i++) {
+      const uint32_t ts = kShareLogDate + hour * 3600 + i * 30;
+      payloads.push_back(makeSharePayload(payloads.size(), ts));
+      writer.append((const uint8_t *)payloads.back().data(), payloads.back().size(), ts);
+    }
+    ASSERT_EQ(writer.pendingCount(), kSharesPerHour);
+    ASSERT_TRUE(writer.flush());
+    ASSERT_EQ(writer.pendingCount(), 0u);
+  }
+}
+
+static vector<string> readShareLog(ShareLogZstdReader &reader) {
+  vector<string> payloads;
+  string records;
+  while (reader.readFrame(records)) {
+    EXPECT_TRUE(ShareLogZstdReader::forEachRecord(records, [&](const uint8_t *p, uint32_t size) {
+      payloads.push_back(string((const char *)p, size));
+    }));
+  }
+  return payloads;
+}
+
+static size_t getFileSize(const string &filePath) {
+  struct stat st;
+  return stat(filePath.c_str(), &st) == 0 ? st.st_size : 0;
+}
+
+static ShareBitcoin makeRandomShare(std::mt19937 &gen) {
+  ShareBitcoin share;
+  share.set_jobid(1 + gen());
+  share.set_userid(1 + gen() % 50);
+  share.set_workerhashid(1 + gen() % 500);
+  share.set_height(527259);
+  share.set_blkbits(0x1d00ffffu);
+  share.set_sharediff(1 + gen() % 100000);
+  share.set_timestamp(kShareLogDate + gen() % 86400);
+  share.set_status(gen() % 10 == 0 ? StratumStatus::REJECT_NO_REASON : StratumStatus::ACCEPT);
+  return share;
+}
+
+// the format written by ShareLogWriterT without raw_format
+static void writeLegacyShareLog(const string &filePath, size_t count, vector<WorkerKey> &keys) {
+  std::mt19937 gen(12345);
+  std::unordered_set<WorkerKey> keySet;
+  zstr::ofstream f(filePath, std::ios::binary);
+
+  string message;
+  for (size_t i = 0; i < count; i++) {
+    ShareBitcoin share = makeRandomShare(gen);
+    uint32_t size = 0;
+    ASSERT_TRUE(share.SerializeToBuffer(message, size));
+    f.write((char *)&size, sizeof(uint32_t));
+    f.write((char *)message.data(), size);
+
+    keySet.insert(WorkerKey(share.userid(), share.workerhashid()));
+    keySet.insert(WorkerKey(share.userid(), 0));
+  }
+  keySet.insert(WorkerKey(0, 0));
+  keys.assign(keySet.begin(), keySet.end());
+}
+
+static void compareShareStatsDay(ShareStatsDay<ShareBitcoin> &a, ShareStatsDay<ShareBitcoin> &b) {
+  for (uint32_t hour = 0; hour < 24; hour++) {
+    ASSERT_EQ(a.shareAccept1h_[hour], b.shareAccept1h_[hour]);
+    ASSERT_EQ(a.shareReject1h_[hour], b.shareReject1h_[hour]);
+    ASSERT_NEAR(a.score1h_[hour], b.score1h_[hour], a.score1h_[hour] * 1e-9);
+    ASSERT_NEAR(a.earn1h_[hour], b.earn1h_[hour], a.earn1h_[hour] * 1e-9);
+  }
+  ASSERT_EQ(a.shareAccept1d_, b.shareAccept1d_);
+  ASSERT_EQ(a.shareReject1d_, b.shareReject1d_);
+  ASSERT_NEAR(a.earn1d_, b.earn1d_, a.earn1d_ * 1e-9);
+  ASSERT_EQ(a.modifyHoursFlag_, b.modifyHoursFlag_);
+}
+
+////////////////////////////////  ShareLogZstd  /////////////////////////////////
+TEST(ShareLogZstd, RoundTrip) {
+  const string file = "./sharelog-zstd-test.bin";
+  remove(file.c_str());
+
+  vector<string> payloads;
+  writeShareLog(file, 0, 24, payloads);
+  ASSERT_TRUE(ShareLogZstdReader::isZstdFile(file));
+
+  ShareLogZstdReader reader(file);
+  ASSERT_TRUE(reader.open());
+
+  vector<ShareLogFrameIndex> index;
+  ASSERT_TRUE(reader.readIndex(index));
+  ASSERT_EQ(index.size(), 24u);
+  for (uint32_t hour = 0; hour < 24; hour++) {
+    ASSERT_EQ(index[hour].count_, kSharesPerHour);
+    ASSERT_EQ(index[hour].minTimestamp_, kShareLogDate + hour * 3600);
+    ASSERT_EQ(index[hour].maxTimestamp_, kShareLogDate + hour * 3600 + (kSharesPerHour - 1) * 30);
+  }
+
+  ASSERT_EQ(readShareLog(reader), payloads);
+  ASSERT_TRUE(reader.isEOF());
+
+  // seek to an hour
+  ASSERT_TRUE(reader.seek(kShareLogDate + 5 * 3600));
+  string records;
+  ShareLogFrameIndex frameIndex;
+  ASSERT_TRUE(reader.readFrame(records, &frameIndex));
+  ASSERT_EQ(frameIndex.offset_, index[5].offset_);
+  ASSERT_EQ(readShareLog(reader).size(), 18 * kSharesPerHour);
+
+  // seek after the last share
+  ASSERT_TRUE(reader.seek(kShareLogDate + 86400));
+  ASSERT_FALSE(reader.readFrame(records));
+  ASSERT_TRUE(reader.isEOF());
+
+  remove(file.c_str());
+}
+
+TEST(ShareLogZstd, TruncatedFrame) {
+  const string file = "./sharelog-zstd-truncated-test.bin";
+  remove(file.c_str());
+
+  vector<string> payloads;
+  writeShareLog(file, 0, 3, payloads);
+
+  // the process was killed while writing the last frame
+  const size_t fileSize = getFileSize(file);
+  ASSERT_EQ(truncate(file.c_str(), fileSize - 100), 0);
+  payloads.resize(2 * kSharesPerHour);
+
+  {
+    ShareLogZstdReader reader(file);
+    ASSERT_TRUE(reader.open());
+
+    vector<ShareLogFrameIndex> index;
+    ASSERT_TRUE(reader.readIndex(index));
+    ASSERT_EQ(index.size(), 2u);
+
+    ASSERT_EQ(readShareLog(reader), payloads);
+    ASSERT_TRUE(reader.isEOF());
+    ASSERT_LT(reader.offset(), reader.fileSize());
+  }
+
+  // the broken tail is truncated when appending
+  writeShareLog(file, 3, 4, payloads);
+  {
+    ShareLogZstdReader reader(file);
+    ASSERT_TRUE(reader.open());
+
+    vector<ShareLogFrameIndex> index;
+    ASSERT_TRUE(reader.readIndex(index));
+    ASSERT_EQ(index.size(), 3u);
+    ASSERT_EQ(index[2].minTimestamp_, kShareLogDate + 3 * 3600);
+
+    ASSERT_EQ(readShareLog(reader), payloads);
+    ASSERT_EQ(reader.offset(), reader.fileSize());
+  }
+
+  // can't append to the other formats
+  {
+    FILE *f = fopen(file.c_str(), "wb");
+    ASSERT_TRUE(f != nullptr);
+    fwrite("\x1f\x8b\x08\x00", 1, 4, f);
+    fclose(f);
+
+    ShareLogZstdWriter writer(file, 3);
+    ASSERT_FALSE(writer.open());
+  }
+
+  remove(file.c_str());
+}
+
+TEST(ShareLogZstd, TruncatedWhileReading) {
+  const string file = "./sharelog-zstd-truncated-reading-test.bin";
+  remove(file.c_str());
+
+  vector<string> payloads;
+  writeShareLog(file, 0, 3, payloads);
+
+  ShareLogZstdReader reader(file);
+  ASSERT_TRUE(reader.open());
+  string records;
+  ASSERT_TRUE(reader.readFrame(records));
+
+  // sharelogger truncates the file under the reader, it must not crash
+  ASSERT_EQ(truncate(file.c_str(), 100), 0);
+  ASSERT_FALSE(reader.readFrame(records));
+  ASSERT_TRUE(reader.isEOF());
+
+  remove(file.c_str());
+}
+
+////////////////////////////////  ShareLogParser  ///////////////////////////////
+TEST(ShareLogParser, RawShareLog) {
+  SelectParams(CBaseChainParams::MAIN);
+
+  const string file = getStatsFilePath("BTC", ".", kShareLogDate);
+  remove(file.c_str());
+
+  vector<string> payloads;
+  writeShareLog(file, 0, 24, payloads);
+
+  uint64_t hourAccept[24] = {0};
+  for (const auto &payload : payloads) {
+    ShareBitcoin share;
+    ASSERT_TRUE(share.UnserializeWithVersion((const uint8_t *)payload.data(), payload.size()));
+    hourAccept[(share.timestamp() - kShareLogDate) / 3600] += share.sharediff();
+  }
+
+  const MysqlConnectInfo dbInfo("127.0.0.1", 3306, "", "", "");
+  const WorkerKey pkey(0, 0);
+
+  // the whole day
+  {
+    ShareLogParserBitcoin parser("BTC", ".", kShareLogDate, dbInfo, nullptr, 1);
+    ASSERT_TRUE(parser.processUnchangedShareLog());
+
+    auto stats = parser.getShareStatsDayHandler(pkey);
+    ASSERT_TRUE(stats != nullptr);
+    for (uint32_t hour = 0; hour < 24; hour++) {
+      ASSERT_EQ(stats->shareAccept1h_[hour], hourAccept[hour]);
+    }
+  }
+
+  // from 20:00
+  {
+    ShareLogParserBitcoin parser("BTC", ".", kShareLogDate, dbInfo, nullptr, 1);
+    ASSERT_TRUE(parser.seekToHour(20));
+    ASSERT_TRUE(parser.processUnchangedShareLog());
+
+    auto stats = parser.getShareStatsDayHandler(pkey);
+    ASSERT_TRUE(stats != nullptr);
+    for (uint32_t hour = 0; hour < 24; hour++) {
+      ASSERT_EQ(stats->shareAccept1h_[hour], hour < 20 ? 0 : hourAccept[hour]);
+    }
+  }
+
+  // growing file
+  {
+    ShareLogParserBitcoin parser("BTC", ".", kShareLogDate, dbInfo, nullptr, 1);
+    int64_t shareNum = 0, total = 0;
+    while ((shareNum = parser.processGrowingShareLog()) > 0) {
+      total += shareNum;
+    }
+    ASSERT_EQ(total, (int64_t)payloads.size());
+    ASSERT_TRUE(parser.isReachEOF());
+  }
+
+  remove(file.c_str());
+
+  // only the raw format has an index
+  {
+    FILE *f = fopen(file.c_str(), "wb");
+    ASSERT_TRUE(f != nullptr);
+    fwrite("\x1f\x8b\x08\x00", 1, 4, f);
+    fclose(f);
+
+    ShareLogParserBitcoin parser("BTC", ".", kShareLogDate, dbInfo, nullptr, 1);
+    ASSERT_FALSE(parser.seekToHour(20));
+  }
+
+  remove(file.c_str());
+}
+
+////////////////////////////////  ShareBatch  /////////////////////////////////
+TEST(ShareBatch, ForEachShare) {
+  vector<string> payloads;
+  ShareBatch batch;
+  ASSERT_EQ(batch.count(), 0u);
+  for (uint32_t i = 0; i < 100; i++) {
+    payloads.push_back(makeSharePayload(i, kShareLogDate + i));
+    batch.add((const uint8_t *)payloads.back().data(), payloads.back().size());
+  }
+  ASSERT_EQ(batch.count(), 100u);
+  ASSERT_TRUE(ShareBatch::isBatch(batch.data(), batch.size()));
+
+  vector<string> shares;
+  auto collect = [&shares](const uint8_t *data, uint32_t size) {
+    shares.push_back(string((const char *)data, size));
+  };
+  ASSERT_TRUE(ShareBatch::forEachShare(batch.data(), batch.size(), collect));
+  ASSERT_EQ(shares, payloads);
+
+  // a single share
+  shares.clear();
+  ASSERT_FALSE(ShareBatch::isBatch((const uint8_t *)payloads[0].data(), payloads[0].size()));
+  ASSERT_TRUE(ShareBatch::forEachShare((const uint8_t *)payloads[0].data(), payloads[0].size(), collect));
+  ASSERT_EQ(shares.size(), 1u);
+  ASSERT_EQ(shares[0], payloads[0]);
+
+  // truncated, the complete shares are still returned
+  shares.clear();
+  ASSERT_FALSE(ShareBatch::forEachShare(batch.data(), batch.size() - 1, collect));
+  ASSERT_EQ(shares.size(), 99u);
+
+  // an empty batch
+  shares.clear();
+  batch.clear();
+  ASSERT_TRUE(ShareBatch::forEachShare(batch.data(), batch.size(), collect));
+  ASSERT_EQ(shares.size(), 0u);
+}
+
+TEST(ShareLogParser, RawShareLogBatches) {
+  SelectParams(CBaseChainParams::MAIN);
+
+  const string file = getStatsFilePath("BTC", ".", kShareLogDate);
+  remove(file.c_str());
+
+  // single shares and batches of 1 to 9 shares, as written by
+  // the sharelogger when sservers are upgraded one by one
+  uint64_t hourAccept[24] = {0};
+  size_t sharesNum = 0;
+  {
+    ShareLogZstdWriter writer(file, 3);
+    ASSERT_TRUE(writer.open());
+
+    ShareBatch batch;
+    for (uint32_t hour = 0; hour < 24; hour++) {
+      for (uint32_t i = 0; i < kSharesPerHour; i++) {
+        const uint32_t ts = kShareLogDate + hour * 3600 + i * 30;
+        const string payload = makeSharePayload(sharesNum++, ts);
+        ShareBitcoin share;
+        ASSERT_TRUE(share.UnserializeWithVersion((const uint8_t *)payload.data(), payload.size()));
+        hourAccept[hour] += share.sharediff();
+
+        if (i % 3 == 0) {
+          writer.append((const uint8_t *)payload.data(), payload.size(), ts);
+          continue;
+        }
+        batch.add((const uint8_t *)payload.data(), payload.size());
+        if (batch.count() == 1 + i % 9) {
+          writer.append(batch.data(), batch.size(), ts);
+          batch.clear();
+        }
+      }
+      if (batch.count() > 0) {
+        writer.append(batch.data(), batch.size(), kShareLogDate + hour * 3600 + 3599);
+        batch.clear();
+      }
+      ASSERT_TRUE(writer.flush());
+    }
+  }
+
+  const MysqlConnectInfo dbInfo("127.0.0.1", 3306, "", "", "");
+  const WorkerKey pkey(0, 0);
+
+  for (uint32_t threads : {1, 4}) {
+    ShareLogParserBitcoin parser("BTC", ".", kShareLogDate, dbInfo, nullptr, threads);
+    ASSERT_TRUE(parser.processUnchangedShareLog());
+
+    auto stats = parser.getShareStatsDayHandler(pkey);
+    ASSERT_TRUE(stats != nullptr);
+    for (uint32_t hour = 0; hour < 24; hour++) {
+      ASSERT_EQ(stats->shareAccept1h_[hour], hourAccept[hour]);
+    }
+  }
+
+  // growing file
+  {
+    ShareLogParserBitcoin parser("BTC", ".", kShareLogDate, dbInfo, nullptr, 1);
+    int64_t shareNum = 0, total = 0;
+    while ((shareNum = parser.processGrowingShareLog()) > 0) {
+      total += shareNum;
+    }
+    ASSERT_EQ(total, (int64_t)sharesNum);
+
+    auto stats = parser.getShareStatsDayHandler(pkey);
+    ASSERT_TRUE(stats != nullptr);
+    ASSERT_EQ(stats->shareAccept1h_[23], hourAccept[23]);
+  }
+
+  remove(file.c_str());
+}
+
+TEST(ShareLogParser, ParallelTotals) {
+  SelectParams(CBaseChainParams::MAIN);
+
+  const string file = getStatsFilePath("BTC", ".", kShareLogDate);
+  const MysqlConnectInfo dbInfo("127.0.0.1", 3306, "", "", "");
+
+  // both formats
+  for (int raw = 0; raw < 2; raw++) {
+    remove(file.c_str());
+
+    vector<WorkerKey> keys;
+    // a few parse chunks are enough
+    writeLegacyShareLog(file, 200000, keys);
+    if (raw) {
+      // convert it to the raw format
+      string legacyFile = file + ".legacy";
+      rename(file.c_str(), legacyFile.c_str());
+
+      zstr::ifstream in(legacyFile, std::ios::binary);
+      ShareLogZstdWriter writer(file, 3);
+      ASSERT_TRUE(writer.open());
+      uint32_t size = 0;
+      string message, payload;
+      while (in.read((char *)&size, sizeof(uint32_t))) {
+        message.resize(size);
+        in.read((char *)message.data(), size);
+        ShareBitcoin share;
+        ASSERT_TRUE(share.ParseFromArray(message.data(), size));
+        ASSERT_TRUE(share.SerializeToArrayWithVersion(payload, size));
+        writer.append((const uint8_t *)payload.data(), size, share.timestamp());
+        if (writer.pendingCount() >= 10000) {
+          ASSERT_TRUE(writer.flush());
+        }
+      }
+      ASSERT_TRUE(writer.flush());
+      remove(legacyFile.c_str());
+    }
+
+    ShareLogParserBitcoin single("BTC", ".", kShareLogDate, dbInfo, nullptr, 1);
+    ASSERT_TRUE(single.processUnchangedShareLog());
+
+    for (uint32_t threads : {2, 4}) {
+      ShareLogParserBitcoin parallel("BTC", ".", kShareLogDate, dbInfo, nullptr, threads);
+      ASSERT_TRUE(parallel.processUnchangedShareLog());
+
+      for (const auto &key : keys) {
+        auto a = single.getShareStatsDayHandler(key);
+        auto b = parallel.getShareStatsDayHandler(key);
+        ASSERT_TRUE(a != nullptr);
+        ASSERT_TRUE(b != nullptr);
+        compareShareStatsDay(*a, *b);
+      }
+    }
+  }
+
+  remove(file.c_str());
+}
+
+// Takes minutes and a few GB of disk, run it by:
+//   ./unittest --gtest_also_run_disabled_tests --gtest_filter=ShareLogParser.DISABLED_ParallelBenchmark
+TEST(ShareLogParser, DISABLED_ParallelBenchmark) {
+  SelectParams(CBaseChainParams::MAIN);
+
+  const size_t kShares = 50000000;
+  const string file = getStatsFilePath("BTC", ".", kShareLogDate);
+  const MysqlConnectInfo dbInfo("127.0.0.1", 3306, "", "", "");
+
+  vector<WorkerKey> keys;
+  writeLegacyShareLog(file, kShares, keys);
+
+  uint64_t accept1d = 0;
+  for (uint32_t threads : {1, 4, 8}) {
+    ShareLogParserBitcoin parser("BTC", ".", kShareLogDate, dbInfo, nullptr, threads);
+
+    auto begin = std::chrono::steady_clock::now();
+    ASSERT_TRUE(parser.processUnchangedShareLog());
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+
+    auto stats = parser.getShareStatsDayHandler(WorkerKey(0, 0));
+    ASSERT_TRUE(stats != nullptr);
+    if (accept1d == 0) {
+      accept1d = stats->shareAccept1d_;
+    }
+    ASSERT_EQ(stats->shareAccept1d_, accept1d);
+
+    LOG(INFO) << "parse " << kShares << " shares with " << threads << " threads: "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() << " ms";
+  }
+
+  remove(file.c_str());
+}
+
+TEST(ShareLogParser, HourIdx) {
+  // date() should not depend on the local timezone, check the days DST
+  // begins and ends in some of them
+  const char *timezones[] = {"UTC", "America/New_York", "Europe/Berlin", "Australia/Lord_Howe"};
+  const char *days[] = {"2018-03-11", "2018-03-25", "2018-04-01", "2018-10-07",
+                        "2018-10-28", "2018-11-04", "2016-12-31"};
+
+  const char *oldTZ = getenv("TZ");
+  const string savedTZ = oldTZ ? oldTZ : "";
+
+  for (const char *tz : timezones) {
+    setenv("TZ", tz, 1);
+    tzset();
+
+    for (const char *day : days) {
+      const time_t begin = str2time(Strings::Format("%s 00:00:00", day).c_str(), "%F %T");
+      // the seconds around the day too
+      for (time_t ts = begin - 3600; ts < begin + 86400 + 3600; ts++) {
+        ASSERT_EQ(ShareLogParserBitcoin::getHourIdx(ts), atoi(date("%H", ts).c_str()))
+          << "timezone: " << tz << ", timestamp: " << ts;
+      }
+    }
+  }
+
+  if (oldTZ) {
+    setenv("TZ", savedTZ.c_str(), 1);
+  } else {
+    unsetenv("TZ");
+  }
+  tzset();
+}
+
+TEST(ShareLogParser, DISABLED_HourIdxBenchmark) {
+  const uint32_t kCount = 1000000;
+  uint64_t sum1 = 0, sum2 = 0;
+
+  auto begin = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < kCount; i++) {
+    sum1 += atoi(date("%H", kShareLogDate + i * 7).c_str());
+  }
+  auto elapsed1 = std::chrono::steady_clock::now() - begin;
+
+  begin = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < kCount; i++) {
+    sum2 += ShareLogParserBitcoin::getHourIdx(kShareLogDate + i * 7);
+  }
+  auto elapsed2 = std::chrono::steady_clock::now() - begin;
+
+  ASSERT_EQ(sum1, sum2);
+  LOG(INFO) << kCount << " hour indexes, date(): "
+            << std::chrono::duration_cast<std::chrono::microseconds>(elapsed1).count() << " us, "
+            << "getHourIdx(): "
+            << std::chrono::duration_cast<std::chrono::microseconds>(elapsed2).count() << " us";
+}
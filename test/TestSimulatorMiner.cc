@@ -28,11 +28,15 @@
 
 #include "StratumMiner.h"
 #include "StratumClient.h"
+#include "eth/StratumClientEth.h"
 
 #include "utilities_js.hpp"
 
 #include <glog/logging.h>
 #include <libconfig.h++>
+#include <event2/thread.h>
+
+#include <chrono>
 
 using namespace libconfig;
 
@@ -225,3 +229,99 @@ TEST(SIMULATOR, miner) {
 
 
 
+
+//
+// Load test of the sserver's event loops, the sservers in the config should
+// be started with `enable_simulator = true` and different `event_loop_threads`.
+// The clients run in `client_threads` threads so they can saturate the
+// server, the rates are only logged: they depend on the machines.
+//
+// simulator.cfg:
+//   load_test = {
+//     seconds = 60;
+//     number_clients = 2000;
+//     client_threads = 8;
+//     share_interval_ms = 10;
+//     servers = (
+//       { port = 3333; event_loop_threads = 1; },
+//       { port = 3334; event_loop_threads = 4; },
+//       { port = 3335; event_loop_threads = 8; }
+//     );
+//   };
+//
+TEST(SIMULATOR, loadTestEventLoops) {
+  const char *conf = "simulator.cfg";
+  libconfig::Config cfg;
+  try
+  {
+    cfg.readFile(conf);
+  } catch(const FileIOException &fioex) {
+    std::cerr << "I/O error while reading file: " << conf << std::endl;
+    return;
+  } catch(const ParseException &pex) {
+    std::cerr << "Parse error at " << pex.getFile() << ":" << pex.getLine()
+    << " - " << pex.getError() << std::endl;
+    return;
+  }
+  if (!cfg.exists("simulator.load_test.servers")) {
+    LOG(INFO) << "simulator.load_test.servers not configured, skip the load test";
+    return;
+  }
+
+  string ssHost = cfg.lookup("simulator.ss_ip");
+  string userName = cfg.lookup("simulator.username");
+  string type = "BTC";
+  cfg.lookupValue("simulator.type", type);
+
+  int32_t seconds = 60;
+  int32_t numClients = 2000;
+  int32_t clientThreads = 8;
+  int32_t shareIntervalMs = 10;
+  cfg.lookupValue("simulator.load_test.seconds", seconds);
+  cfg.lookupValue("simulator.load_test.number_clients", numClients);
+  cfg.lookupValue("simulator.load_test.client_threads", clientThreads);
+  cfg.lookupValue("simulator.load_test.share_interval_ms", shareIntervalMs);
+  clientThreads = std::max(clientThreads, 1);
+
+  evthread_use_pthreads();
+  StratumClient::registerFactory<StratumClient>("BTC");
+  StratumClient::registerFactory<StratumClient>("DCR");
+  StratumClient::registerFactory<StratumClientEth>("ETH");
+
+  const Setting &servers = cfg.lookup("simulator.load_test.servers");
+  for (int i = 0; i < servers.getLength(); i++) {
+    int32_t port = 3333;
+    int32_t threads = 1;
+    servers[i].lookupValue("port", port);
+    servers[i].lookupValue("event_loop_threads", threads);
+
+    // every client thread has its own event base and connections
+    vector<unique_ptr<StratumClientWrapper>> wrappers;
+    vector<thread> runners;
+    for (int32_t t = 0; t < clientThreads; t++) {
+      wrappers.emplace_back(new StratumClientWrapper(ssHost.c_str(), port, numClients / clientThreads,
+                                                     userName, Strings::Format("loadtest%d", t), "", type));
+      wrappers.back()->setShareInterval(shareIntervalMs);
+      runners.push_back(thread(&StratumClientWrapper::run, wrappers.back().get()));
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    for (auto &wrapper : wrappers) {
+      wrapper->stop();
+    }
+    for (auto &runner : runners) {
+      runner.join();
+    }
+
+    uint64_t accepted = 0, rejected = 0;
+    for (auto &wrapper : wrappers) {
+      accepted += wrapper->getAcceptedShares();
+      rejected += wrapper->getRejectedShares();
+    }
+    LOG(INFO) << "event_loop_threads: " << threads
+              << ", client threads: " << clientThreads
+              << ", accepted shares: " << accepted
+              << ", rejected shares: " << rejected
+              << ", accepted shares per second: " << (double)accepted / seconds;
+    ASSERT_GT(accepted, 0u);
+  }
+}
@@ -163,6 +163,88 @@ TEST(StatsWindow, map) {
 }
 
 
+/////////////////////////////  HierarchicalStatsWindow  //////////////////////////
+static void checkHierarchicalStatsWindow(HierarchicalStatsWindow<uint64_t> &hw,
+                                         StatsWindow<uint64_t> &sw, int64_t now) {
+  // the last minute is always exact
+  ASSERT_EQ(hw.sumLastMinute(now), sw.sum(now, 60));
+
+  for (int32_t minutes : {1, 5, 15, 60}) {
+    // windows longer than 15 minutes are served by 5 minutes buckets
+    const int64_t bucket = minutes <= 15 ? 60 : 300;
+    const int64_t first = (now - minutes * 60 + 1) / bucket * bucket;
+
+    uint64_t sum = hw.sum(now, minutes);
+    if (now % bucket == bucket - 1 || first < 0) {
+      ASSERT_EQ(sum, sw.sum(now, minutes * 60));
+    } else {
+      // the oldest bucket [first, first + bucket) is partly counted
+      ASSERT_GE(sum, sw.sum(now, now - (first + bucket - 1)));
+      ASSERT_LE(sum, sw.sum(now, now - first + 1));
+    }
+  }
+}
+
+TEST(HierarchicalStatsWindow, sum) {
+  HierarchicalStatsWindow<uint64_t> hw;
+  ASSERT_EQ(hw.sumLastMinute(100), 0u);
+  ASSERT_EQ(hw.sum(100, 60), 0u);
+
+  // one per second
+  for (int64_t i = 0; i < 7200; i++) {
+    hw.insert(i, 1);
+    ASSERT_EQ(hw.sumLastMinute(i), (uint64_t)std::min<int64_t>(i + 1, 60));
+    if (i % 60 == 59) {
+      ASSERT_EQ(hw.sum(i, 5),  (uint64_t)std::min<int64_t>(i + 1, 300));
+      ASSERT_EQ(hw.sum(i, 15), (uint64_t)std::min<int64_t>(i + 1, 900));
+    }
+    if (i % 300 == 299) {
+      ASSERT_EQ(hw.sum(i, 60), (uint64_t)std::min<int64_t>(i + 1, 3600));
+    }
+  }
+
+  // all expired
+  ASSERT_EQ(hw.sumLastMinute(7200 + 60), 0u);
+  ASSERT_EQ(hw.sum(7200 + 3660, 60), 0u);
+  // too old
+  ASSERT_FALSE(hw.insert(6600, 1));
+
+  hw.clear();
+  ASSERT_EQ(hw.sum(100, 60), 0u);
+}
+
+TEST(HierarchicalStatsWindow, RandomShares) {
+  std::mt19937 gen(20190101);
+
+  for (int round = 0; round < 20; round++) {
+    HierarchicalStatsWindow<uint64_t> hw;
+    // a few more minutes for the bounds in checkHierarchicalStatsWindow()
+    StatsWindow<uint64_t> sw(3960);
+
+    int64_t now = 1500000000 + gen() % 3600;
+    for (int i = 0; i < 20000; i++) {
+      const uint32_t r = gen() % 1000;
+      if (r == 0) {
+        // miner offline for a while
+        now += gen() % 5000;
+      } else {
+        now += gen() % 3;
+      }
+
+      // some shares arrive late
+      int64_t ts = now - (gen() % 4 == 0 ? gen() % 30 : 0);
+      uint64_t diff = 1 + gen() % 100000;
+      hw.insert(ts, diff);
+      sw.insert(ts, diff);
+
+      if (i % 7 == 0) {
+        checkHierarchicalStatsWindow(hw, sw, now);
+      }
+    }
+  }
+}
+
+
 ////////////////////////////////  ShareStatsDay  ///////////////////////////////
 TEST(ShareStatsDay, ShareStatsDay) {
   // using mainnet
@@ -401,3 +483,31 @@ TEST(DuplicateShareChecker, DuplicateShareCheckerEth) {
     ASSERT_EQ(dsc.addShare(share), false);
   }
 }
+
+TEST(DuplicateShareChecker, Threads) {
+  DuplicateShareCheckerEth dsc(3);
+  const uint32_t kThreads = 4;
+  const uint64_t kShares = 10000;
+
+  // every share is added by all threads, only one of them wins
+  std::atomic<uint64_t> added(0);
+  vector<thread> threads;
+  for (uint32_t i = 0; i < kThreads; i++) {
+    threads.push_back(thread([&dsc, &added]() {
+      ShareEth share;
+      share.set_height(12345);
+      share.set_headerhash(0x12345678);
+      for (uint64_t nonce = 0; nonce < kShares; nonce++) {
+        share.set_nonce(nonce);
+        if (dsc.addShare(share)) {
+          added++;
+        }
+      }
+    }));
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  ASSERT_EQ(added.load(), kShares);
+  ASSERT_EQ(dsc.gshareSetMapSize(), 1ull);
+}
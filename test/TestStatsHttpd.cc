@@ -0,0 +1,709 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) [2016] [BTC.COM]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+#include "gtest/gtest.h"
+#include "Common.h"
+#include "Utils.h"
+
+#include "ShareBatch.h"
+#include "bitcoin/StatsHttpdBitcoin.h"
+
+#include <event2/buffer.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <regex>
+
+static shared_ptr<StatsServerBitcoin> createStatsServer() {
+  return std::make_shared<StatsServerBitcoin>("127.0.0.1:9092", "ShareLog", "CommonEvents",
+                                              "127.0.0.1", 8080, nullptr, nullptr,
+                                              1, "", 0, 0, 0, true, 15, "", nullptr, "", 300);
+}
+
+static string getWorkerStatus(StatsServerBitcoin &server, const char *userId,
+                              const char *workerIds, const char *isMerge) {
+  struct evbuffer *evb = evbuffer_new();
+  server.getWorkerStatus(evb, userId, workerIds, isMerge);
+  string result(evbuffer_get_length(evb), '\0');
+  evbuffer_remove(evb, &result[0], result.size());
+  evbuffer_free(evb);
+  return result;
+}
+
+static vector<ShareBitcoin> makeRandomShares(size_t count, uint32_t users, uint32_t workers,
+                                             uint32_t seconds = 3600) {
+  std::mt19937 gen(12345);
+  const time_t now = time(nullptr);
+  vector<ShareBitcoin> shares(count);
+
+  for (auto &share : shares) {
+    share.set_userid(1 + gen() % users);
+    share.set_workerhashid(1 + gen() % workers);
+    share.set_timestamp(now - gen() % seconds);
+    share.set_sharediff(1 + gen() % 1024);
+    share.set_status(gen() % 10 == 0 ? StratumStatus::REJECT_NO_REASON : StratumStatus::ACCEPT);
+    share.set_ip(Strings::Format("10.0.%u.%u", gen() % 256, gen() % 256));
+  }
+  return shares;
+}
+
+static void addRandomShares(StatsServerBitcoin &server) {
+  for (const auto &share : makeRandomShares(20000, 5, 20)) {
+    server.processShare(share);
+  }
+}
+
+// the results depend on the current time, retry if the second changed
+static void compareWorkerStatus(StatsServerBitcoin &a, StatsServerBitcoin &b,
+                                const bool ignoreLastShare = false) {
+  const char *workerIds = "0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20,21";
+
+  for (int retry = 0; retry < 3; retry++) {
+    const time_t begin = time(nullptr);
+    vector<string> resultsA, resultsB;
+    for (const char *userId : {"1", "2", "3", "4", "5", "6"}) {
+      resultsA.push_back(getWorkerStatus(a, userId, workerIds, "false"));
+      resultsA.push_back(getWorkerStatus(a, userId, workerIds, "true"));
+      resultsB.push_back(getWorkerStatus(b, userId, workerIds, "false"));
+      resultsB.push_back(getWorkerStatus(b, userId, workerIds, "true"));
+    }
+    if (begin != time(nullptr)) {
+      continue;
+    }
+
+    // the last share depends on the order of processing
+    const std::regex lastShare(",\"last_share_ip\":\"[^\"]*\",\"last_share_time\":[0-9]+");
+    for (size_t i = 0; i < resultsA.size(); i++) {
+      if (ignoreLastShare) {
+        ASSERT_EQ(std::regex_replace(resultsA[i], lastShare, ""), std::regex_replace(resultsB[i], lastShare, ""));
+      } else {
+        ASSERT_EQ(resultsA[i], resultsB[i]);
+      }
+    }
+    return;
+  }
+  FAIL() << "cannot get the worker status in the same second";
+}
+
+TEST(StatsServer, SnapshotRoundTrip) {
+  const string file = "./statshttpd-snapshot-test.dat";
+
+  auto server = createStatsServer();
+  addRandomShares(*server);
+  ASSERT_TRUE(server->saveSnapshot(file, 123456789));
+
+  auto restored = createStatsServer();
+  int64_t offset = 0;
+  ASSERT_TRUE(restored->loadSnapshot(file, offset));
+  ASSERT_EQ(offset, 123456789);
+
+  compareWorkerStatus(*server, *restored);
+
+  // shares after the snapshot are counted as usual
+  addRandomShares(*server);
+  addRandomShares(*restored);
+  compareWorkerStatus(*server, *restored);
+
+  remove(file.c_str());
+}
+
+TEST(StatsServer, ConsumeBatchedShares) {
+  auto expected = createStatsServer();
+  auto server = createStatsServer();
+  std::mt19937 gen(12345);
+  const time_t now = time(nullptr);
+
+  // single shares and batches of 1 to 16 shares mixed, as sent by
+  // sservers with and without share_batch_size
+  ShareBatch batch;
+  string payload;
+  for (int i = 0; i < 20000; i++) {
+    ShareBitcoin share;
+    share.set_jobid(1 + gen());
+    share.set_height(527259);
+    share.set_blkbits(0x1d00ffffu);
+    share.set_userid(1 + gen() % 5);
+    share.set_workerhashid(1 + gen() % 20);
+    share.set_timestamp(now - gen() % 3600);
+    share.set_sharediff(1 + gen() % 1024);
+    share.set_status(gen() % 10 == 0 ? StratumStatus::REJECT_NO_REASON : StratumStatus::ACCEPT);
+    share.set_ip(Strings::Format("10.0.%u.%u", gen() % 256, gen() % 256));
+    expected->processShare(share);
+
+    uint32_t size = 0;
+    ASSERT_TRUE(share.SerializeToArrayWithVersion(payload, size));
+    if (gen() % 4 == 0) {
+      server->consumeShares((const uint8_t *)payload.data(), size);
+      continue;
+    }
+    batch.add((const uint8_t *)payload.data(), size);
+    if (gen() % 16 == 0) {
+      server->consumeShares(batch.data(), batch.size());
+      batch.clear();
+    }
+  }
+  server->consumeShares(batch.data(), batch.size());
+
+  // shares of a truncated batch before the broken one are kept
+  ShareBitcoin share;
+  share.set_jobid(1);
+  share.set_height(527259);
+  share.set_blkbits(0x1d00ffffu);
+  share.set_userid(6);
+  share.set_workerhashid(21);
+  share.set_timestamp(now);
+  share.set_sharediff(1000);
+  share.set_status(StratumStatus::ACCEPT);
+  uint32_t size = 0;
+  ASSERT_TRUE(share.SerializeToArrayWithVersion(payload, size));
+  expected->processShare(share);
+  batch.clear();
+  batch.add((const uint8_t *)payload.data(), size);
+  batch.add((const uint8_t *)payload.data(), size);
+  server->consumeShares(batch.data(), batch.size() - 1);
+
+  compareWorkerStatus(*expected, *server);
+}
+
+TEST(StatsServer, ConcurrentProcessShares) {
+  auto expected = createStatsServer();
+  auto server = createStatsServer();
+  // the oldest minute of the reject window depends on the order of
+  // processing, keep the shares away from it
+  const vector<ShareBitcoin> shares = makeRandomShares(20000, 5, 20, 3000);
+
+  for (const auto &share : shares) {
+    expected->processShare(share);
+  }
+
+  // the shares of a worker are processed by all threads
+  const size_t kThreads = 4;
+  vector<thread> threads;
+  for (size_t t = 0; t < kThreads; t++) {
+    threads.push_back(thread([&server, &shares, t]() {
+      for (size_t i = t; i < shares.size(); i += kThreads) {
+        server->processShare(shares[i]);
+      }
+    }));
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  compareWorkerStatus(*expected, *server, true);
+  ASSERT_EQ(server->getServerStatus().workerCount_, 100u);
+  ASSERT_EQ(server->getServerStatus().userCount_, 5u);
+}
+
+static uint64_t getStatusField(const string &status, const string &field) {
+  std::smatch match;
+  if (!std::regex_search(status, match, std::regex("\"" + field + "\":\\[?([0-9]+)"))) {
+    return (uint64_t)-1;
+  }
+  return strtoull(match[1].str().c_str(), nullptr, 10);
+}
+
+TEST(StatsServer, UserTotals) {
+  auto server = createStatsServer();
+  const vector<ShareBitcoin> shares = makeRandomShares(20000, 5, 20);
+  for (const auto &share : shares) {
+    server->processShare(share);
+  }
+
+  // the workers and users live in different shards, the totals of a user
+  // still match its workers
+  for (int retry = 0; retry < 3; retry++) {
+    const time_t begin = time(nullptr);
+    vector<string> users, mergedWorkers;
+    for (const char *userId : {"1", "2", "3", "4", "5"}) {
+      users.push_back(getWorkerStatus(*server, userId, "0", "false"));
+      mergedWorkers.push_back(getWorkerStatus(*server, userId, "1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20", "true"));
+    }
+    if (begin != time(nullptr)) {
+      continue;
+    }
+
+    uint64_t acceptCount = 0;
+    for (size_t i = 0; i < users.size(); i++) {
+      ASSERT_EQ(getStatusField(users[i], "workers"), 20u);
+      // the 1m window has no interpolation
+      ASSERT_EQ(getStatusField(users[i], "accept"), getStatusField(mergedWorkers[i], "accept"));
+      ASSERT_EQ(getStatusField(users[i], "accept_count"), getStatusField(mergedWorkers[i], "accept_count"));
+      acceptCount += getStatusField(users[i], "accept_count");
+    }
+    ASSERT_EQ(acceptCount, (uint64_t)std::count_if(shares.begin(), shares.end(), [](const ShareBitcoin &share) {
+      return StratumStatus::isAccepted(share.status());
+    }));
+    ASSERT_EQ(server->getServerStatus().workerCount_, 100u);
+    ASSERT_EQ(server->getServerStatus().userCount_, 5u);
+    return;
+  }
+  FAIL() << "cannot get the worker status in the same second";
+}
+
+TEST(StatsServer, SnapshotCorrupt) {
+  const string file = "./statshttpd-snapshot-test.dat";
+
+  auto server = createStatsServer();
+  addRandomShares(*server);
+  ASSERT_TRUE(server->saveSnapshot(file, 100));
+
+  string data;
+  {
+    std::ifstream f(file, std::ios::binary);
+    data.assign((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+  }
+  auto writeFile = [&file](const string &content) {
+    std::ofstream f(file, std::ios::binary | std::ios::trunc);
+    f.write(content.data(), content.size());
+  };
+  int64_t offset = -1;
+
+  // truncated
+  writeFile(data.substr(0, data.size() - 10));
+  ASSERT_FALSE(createStatsServer()->loadSnapshot(file, offset));
+
+  // a flipped bit
+  string broken = data;
+  broken[broken.size() / 2] ^= 0x10;
+  writeFile(broken);
+  ASSERT_FALSE(createStatsServer()->loadSnapshot(file, offset));
+
+  // missing
+  remove(file.c_str());
+  ASSERT_FALSE(createStatsServer()->loadSnapshot(file, offset));
+  ASSERT_EQ(offset, -1);
+
+  // the original one is fine
+  writeFile(data);
+  ASSERT_TRUE(createStatsServer()->loadSnapshot(file, offset));
+  ASSERT_EQ(offset, 100);
+
+  remove(file.c_str());
+}
+
+////////////////////////////////  RedisStub  ////////////////////////////////
+// A minimal in-process redis server, it keeps the hashes, zsets and TTLs
+// written by StatsServerT and counts the commands received.
+class RedisStub {
+public:
+  std::map<string, std::map<string, string>> hashes_;
+  std::map<string, std::map<string, string>> zsets_;  // member -> score
+  std::map<string, int64_t> expires_;
+  std::map<string, size_t> commandCount_;
+
+  RedisStub() {
+    listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    socklen_t len = sizeof(addr);
+    if (::bind(listenFd_, (sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(listenFd_, 16) != 0 ||
+        getsockname(listenFd_, (sockaddr *)&addr, &len) != 0) {
+      LOG(FATAL) << "RedisStub: cannot listen on 127.0.0.1";
+    }
+    port_ = ntohs(addr.sin_port);
+    acceptThread_ = thread(&RedisStub::runAccept, this);
+  }
+
+  ~RedisStub() {
+    shutdown(listenFd_, SHUT_RDWR);
+    close(listenFd_);
+    acceptThread_.join();
+    {
+      ScopeLock sl(lock_);
+      for (int fd : clientFds_) {
+        shutdown(fd, SHUT_RDWR);
+      }
+    }
+    for (auto &t : clientThreads_) {
+      t.join();
+    }
+    for (int fd : clientFds_) {
+      close(fd);
+    }
+  }
+
+  int32_t port() const { return port_; }
+
+  size_t count(const string &command) {
+    ScopeLock sl(lock_);
+    return commandCount_[command];
+  }
+
+  size_t totalCount() {
+    ScopeLock sl(lock_);
+    size_t total = 0;
+    for (const auto &itr : commandCount_) {
+      total += itr.second;
+    }
+    return total;
+  }
+
+  void resetCount() {
+    ScopeLock sl(lock_);
+    commandCount_.clear();
+  }
+
+  // like FLUSHALL
+  void clear() {
+    ScopeLock sl(lock_);
+    hashes_.clear();
+    zsets_.clear();
+    expires_.clear();
+  }
+
+private:
+  int listenFd_;
+  int32_t port_;
+  mutex lock_;
+  thread acceptThread_;
+  vector<thread> clientThreads_;
+  vector<int> clientFds_;
+
+  void runAccept() {
+    for (;;) {
+      int fd = accept(listenFd_, nullptr, nullptr);
+      if (fd < 0) {
+        return;
+      }
+      ScopeLock sl(lock_);
+      clientFds_.push_back(fd);
+      clientThreads_.push_back(thread(&RedisStub::runClient, this, fd));
+    }
+  }
+
+  static bool readLine(int fd, string &buf, string &line) {
+    size_t pos;
+    while ((pos = buf.find("\r\n")) == string::npos) {
+      char data[4096];
+      ssize_t n = recv(fd, data, sizeof(data), 0);
+      if (n <= 0) {
+        return false;
+      }
+      buf.append(data, n);
+    }
+    line = buf.substr(0, pos);
+    buf.erase(0, pos + 2);
+    return true;
+  }
+
+  static bool readBytes(int fd, string &buf, size_t size, string &bytes) {
+    while (buf.size() < size + 2) {
+      char data[4096];
+      ssize_t n = recv(fd, data, sizeof(data), 0);
+      if (n <= 0) {
+        return false;
+      }
+      buf.append(data, n);
+    }
+    bytes = buf.substr(0, size);
+    buf.erase(0, size + 2);
+    return true;
+  }
+
+  void runClient(int fd) {
+    string buf, line;
+    for (;;) {
+      // commands are sent by hiredis as arrays of bulk strings
+      if (!readLine(fd, buf, line) || line.empty() || line[0] != '*') {
+        return;
+      }
+      vector<string> args(atoi(line.c_str() + 1));
+      for (auto &arg : args) {
+        if (!readLine(fd, buf, line) || line.empty() || line[0] != '$' ||
+            !readBytes(fd, buf, atoi(line.c_str() + 1), arg)) {
+          return;
+        }
+      }
+      const string reply = execute(args);
+      if (send(fd, reply.data(), reply.size(), MSG_NOSIGNAL) != (ssize_t)reply.size()) {
+        return;
+      }
+    }
+  }
+
+  string execute(const vector<string> &args) {
+    ScopeLock sl(lock_);
+    if (args.empty()) {
+      return "-ERR empty command\r\n";
+    }
+    commandCount_[args[0]]++;
+
+    if (args[0] == "PING") {
+      return "+PONG\r\n";
+    }
+    if (args[0] == "AUTH") {
+      return "+OK\r\n";
+    }
+    if (args[0] == "HMSET" && args.size() >= 4 && args.size() % 2 == 0) {
+      auto &hash = hashes_[args[1]];
+      for (size_t i = 2; i < args.size(); i += 2) {
+        hash[args[i]] = args[i + 1];
+      }
+      return "+OK\r\n";
+    }
+    if (args[0] == "EXPIRE" && args.size() == 3) {
+      if (hashes_.count(args[1]) == 0 && zsets_.count(args[1]) == 0) {
+        return ":0\r\n";
+      }
+      expires_[args[1]] = atoll(args[2].c_str());
+      return ":1\r\n";
+    }
+    if (args[0] == "PUBLISH" && args.size() == 3) {
+      return ":0\r\n";
+    }
+    if (args[0] == "ZADD" && args.size() >= 4 && args.size() % 2 == 0) {
+      auto &zset = zsets_[args[1]];
+      size_t added = 0;
+      for (size_t i = 2; i < args.size(); i += 2) {
+        added += zset.count(args[i + 1]) == 0 ? 1 : 0;
+        zset[args[i + 1]] = args[i];
+      }
+      return Strings::Format(":%zu\r\n", added);
+    }
+    return "-ERR unknown command '" + args[0] + "'\r\n";
+  }
+};
+
+static shared_ptr<StatsServerBitcoin> createRedisStatsServer(const RedisStub &redis,
+                                                             const bool incrementalFlush) {
+  RedisConnectInfo redisInfo("127.0.0.1", redis.port(), "");
+  return std::make_shared<StatsServerBitcoin>("127.0.0.1:9092", "ShareLog", "CommonEvents",
+                                              "127.0.0.1", 8080, nullptr, &redisInfo,
+                                              2, "", 600, 3, 511, incrementalFlush,
+                                              15, "", nullptr, "", 300);
+}
+
+static void compareRedisState(RedisStub &a, RedisStub &b) {
+  // updated_at is the time of the write, not part of the worker's status
+  auto withoutUpdatedAt = [](std::map<string, std::map<string, string>> hashes) {
+    for (auto &itr : hashes) {
+      itr.second.erase("updated_at");
+    }
+    return hashes;
+  };
+  ASSERT_FALSE(a.hashes_.empty());
+  ASSERT_EQ(withoutUpdatedAt(a.hashes_), withoutUpdatedAt(b.hashes_));
+  ASSERT_EQ(a.zsets_, b.zsets_);
+  ASSERT_EQ(a.expires_, b.expires_);
+}
+
+TEST(StatsServer, IncrementalRedisFlush) {
+  RedisStub fullRedis, incrementalRedis;
+  auto full = createRedisStatsServer(fullRedis, false);
+  auto incremental = createRedisStatsServer(incrementalRedis, true);
+  addRandomShares(*full);
+  addRandomShares(*incremental);
+
+  // 100 workers and 5 users
+  const size_t kItems = 105;
+  const time_t now = time(nullptr);
+  ShareBitcoin share;
+  share.set_userid(3);
+  share.set_workerhashid(7);
+  share.set_timestamp(now);
+  share.set_sharediff(4096);
+  share.set_status(StratumStatus::ACCEPT);
+  share.set_ip("10.1.2.3");
+
+  // the status depends on the current time, retry if the second changed
+  for (int retry = 0; retry < 5; retry++) {
+    const time_t begin = time(nullptr);
+
+    full->flushToRedis();
+    incremental->flushToRedis();
+    if (begin != time(nullptr)) {
+      continue;
+    }
+    compareRedisState(fullRedis, incrementalRedis);
+
+    // nothing changed: every key is rewritten by the full flush, only the
+    // TTLs are refreshed by the incremental one
+    fullRedis.resetCount();
+    incrementalRedis.resetCount();
+    full->flushToRedis();
+    incremental->flushToRedis();
+    if (begin != time(nullptr)) {
+      continue;
+    }
+    compareRedisState(fullRedis, incrementalRedis);
+    ASSERT_EQ(fullRedis.count("HMSET"), kItems);
+    ASSERT_EQ(incrementalRedis.count("HMSET"), 0u);
+    ASSERT_EQ(incrementalRedis.count("PUBLISH"), 0u);
+    ASSERT_EQ(incrementalRedis.count("ZADD"), 0u);
+    ASSERT_EQ(incrementalRedis.count("EXPIRE"), kItems);
+    LOG(INFO) << "redis commands of an idle flush, full: " << fullRedis.totalCount()
+              << ", incremental: " << incrementalRedis.totalCount();
+
+    // a new share only rewrites its worker and user
+    full->processShare(share);
+    incremental->processShare(share);
+    fullRedis.resetCount();
+    incrementalRedis.resetCount();
+    full->flushToRedis();
+    incremental->flushToRedis();
+    if (begin != time(nullptr)) {
+      continue;
+    }
+    compareRedisState(fullRedis, incrementalRedis);
+    ASSERT_EQ(incrementalRedis.count("HMSET"), 2u);
+    ASSERT_EQ(incrementalRedis.count("PUBLISH"), 2u);
+    ASSERT_EQ(incrementalRedis.count("EXPIRE"), kItems);
+
+    // the keys lost by redis are written again by the following flush
+    incrementalRedis.clear();
+    incremental->flushToRedis();
+    incremental->flushToRedis();
+    if (begin != time(nullptr)) {
+      continue;
+    }
+    compareRedisState(fullRedis, incrementalRedis);
+    return;
+  }
+  FAIL() << "cannot flush to redis in the same second";
+}
+
+TEST(StatsServer, DISABLED_ShardedSharesBenchmark) {
+  RedisStub redis;
+  auto server = createRedisStatsServer(redis, true);
+  // 200k workers of 2000 users, the shares of the last 30 minutes so
+  // none of them is too old when processed
+  vector<ShareBitcoin> shares = makeRandomShares(1000000, 2000, 100, 1800);
+  for (auto &share : shares) {
+    // worker ids are hashes of the worker names
+    share.set_workerhashid((int64_t)(share.workerhashid() * 0x9E3779B97F4A7C15ULL));
+  }
+
+  // http queries and redis flushes run during the whole benchmark
+  atomic<bool> running(true);
+  atomic<size_t> queries(0), flushes(0);
+  vector<thread> readers;
+  for (int i = 0; i < 2; i++) {
+    readers.push_back(thread([&server, &running, &queries, i]() {
+      std::mt19937 gen(i);
+      while (running) {
+        const string userId = std::to_string(1 + gen() % 2000);
+        getWorkerStatus(*server, userId.c_str(), "0,1,2,3,4,5,6,7,8,9,10", "false");
+        queries++;
+      }
+    }));
+  }
+  readers.push_back(thread([&server, &running, &flushes]() {
+    while (running) {
+      server->flushToRedis();
+      flushes++;
+    }
+  }));
+
+  for (size_t threads : {1, 4}) {
+    queries = 0;
+    flushes = 0;
+    auto begin = std::chrono::steady_clock::now();
+    vector<thread> writers;
+    for (size_t t = 0; t < threads; t++) {
+      writers.push_back(thread([&server, &shares, t, threads]() {
+        for (size_t i = t; i < shares.size(); i += threads) {
+          server->processShare(shares[i]);
+        }
+      }));
+    }
+    for (auto &t : writers) {
+      t.join();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+    LOG(INFO) << threads << " threads process " << shares.size() * 1000000
+                 / std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()
+              << " shares per second, with " << queries << " http queries and "
+              << flushes << " redis flushes in parallel";
+  }
+
+  running = false;
+  for (auto &t : readers) {
+    t.join();
+  }
+  std::unordered_set<WorkerKey> workers;
+  for (const auto &share : shares) {
+    workers.insert(WorkerKey(share.userid(), share.workerhashid()));
+  }
+  ASSERT_EQ(server->getServerStatus().workerCount_, workers.size());
+}
+
+static size_t getResidentMemory() {
+  size_t pages = 0, residentPages = 0;
+  FILE *f = fopen("/proc/self/statm", "r");
+  if (f == nullptr) {
+    return 0;
+  }
+  if (fscanf(f, "%zu %zu", &pages, &residentPages) != 2) {
+    residentPages = 0;
+  }
+  fclose(f);
+  return residentPages * sysconf(_SC_PAGESIZE);
+}
+
+TEST(StatsServer, DISABLED_WorkerSharesMemoryBenchmark) {
+  const size_t kWorkers = 1000000;
+  const time_t now = time(nullptr);
+
+  vector<unique_ptr<WorkerShares<ShareBitcoin>>> workers;
+  workers.reserve(kWorkers);
+  const size_t before = getResidentMemory();
+
+  ShareBitcoin share;
+  share.set_status(StratumStatus::ACCEPT);
+  share.set_sharediff(1024);
+  for (size_t i = 0; i < kWorkers; i++) {
+    workers.emplace_back(new WorkerShares<ShareBitcoin>(i, i % 1000));
+    share.set_timestamp(now - i % 3600);
+    workers.back()->processShare(share);
+  }
+  const size_t after = getResidentMemory();
+
+  auto begin = std::chrono::steady_clock::now();
+  WorkerStatus status;
+  uint64_t accept1h = 0;
+  for (auto &worker : workers) {
+    worker->getWorkerStatus(status);
+    accept1h += status.accept1h_;
+  }
+  auto elapsed = std::chrono::steady_clock::now() - begin;
+  ASSERT_GT(accept1h, 0u);
+
+  // the old one kept 3600 seconds and 60 minutes per worker
+  const size_t oldWindowBytes = (STATS_SLIDING_WINDOW_SECONDS + STATS_SLIDING_WINDOW_SECONDS / 60) * sizeof(uint64_t);
+  LOG(INFO) << kWorkers << " workers use " << (after - before) / 1024 / 1024 << " MB, "
+            << (after - before) / kWorkers << " bytes per worker (sizeof " << sizeof(WorkerShares<ShareBitcoin>)
+            << "), the windows of the old implementation need " << oldWindowBytes << " bytes per worker";
+  LOG(INFO) << "getWorkerStatus() takes "
+            << std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / kWorkers << " ns per worker";
+}
@@ -29,6 +29,7 @@
 
 #include "bitcoin/BitcoinUtils.h"
 #include "bitcoin/StratumBitcoin.h"
+#include "bitcoin/JobMakerBitcoin.h"
 #include "rsk/RskWork.h"
 
 #include <chainparams.h>
@@ -43,6 +44,8 @@
 
 #include <stdint.h>
 
+#include <chrono>
+
 
 TEST(Stratum, jobId2Time) {
   uint64_t jobId;
@@ -89,6 +92,151 @@ TEST(Stratum, Share2) {
   ASSERT_EQ(score2Str(s.score()), "0.0197582875516673");
 }
 
+static ShareBitcoin makeShareBitcoin(uint32_t i) {
+  ShareBitcoin share;
+  share.set_jobid(6645522065066147329ull + i);
+  share.set_workerhashid(1 + i % 5000);
+  share.set_userid(1 + i % 500);
+  share.set_sharediff(16384);
+  share.set_blkbits(0x17272fbdu);
+  share.set_timestamp(1547281171 + i);
+  share.set_height(558201);
+  share.set_nonce(i * 2654435761u);
+  share.set_sessionid(i % 0xffffff);
+  share.set_status(StratumStatus::ACCEPT);
+  return share;
+}
+
+TEST(Stratum, ShareIpBin) {
+  IpAddress ip;
+  ip.fromIpv4Int(htonl(167772161));  // 10.0.0.1
+
+  // the current version
+  {
+    ShareBitcoin share = makeShareBitcoin(1);
+    share.setIp(ip);
+    ASSERT_FALSE(share.has_ip());
+    ASSERT_EQ(share.ip_bin().size(), 16u);
+
+    string data;
+    uint32_t size = 0;
+    ASSERT_TRUE(share.SerializeToArrayWithVersion(data, size));
+
+    ShareBitcoin share2;
+    ASSERT_TRUE(share2.UnserializeWithVersion((const uint8_t *)data.data(), size));
+    ASSERT_EQ(share2.version(), ShareBitcoin::CURRENT_VERSION);
+    ASSERT_TRUE(share2.isValid());
+    ASSERT_EQ(share2.getIp().toString(), "10.0.0.1");
+    ASSERT_EQ(share2.toString(), share.toString());
+  }
+
+  // version 4, the IP is a string
+  {
+    ShareBitcoin share = makeShareBitcoin(1);
+    share.set_version(ShareBitcoin::STRING_IP_VERSION);
+    share.set_ip("10.0.0.1");
+
+    string data;
+    uint32_t size = 0;
+    ASSERT_TRUE(share.SerializeToArrayWithVersion(data, size));
+
+    ShareBitcoin share2;
+    ASSERT_TRUE(share2.UnserializeWithVersion((const uint8_t *)data.data(), size));
+    ASSERT_EQ(share2.version(), ShareBitcoin::STRING_IP_VERSION);
+    ASSERT_TRUE(share2.isValid());
+    ASSERT_TRUE(share2.ip_bin().empty());
+    ASSERT_EQ(share2.getIp().toString(), "10.0.0.1");
+
+    // old share logs have no version header
+    ASSERT_TRUE(share.SerializeToBuffer(data, size));
+    ShareBitcoin share3;
+    ASSERT_TRUE(share3.ParseFromArray(data.data(), size));
+    ASSERT_TRUE(share3.isValid());
+    ASSERT_EQ(share3.getIp().toString(), "10.0.0.1");
+  }
+
+  // version 3, the bytes struct
+  {
+    ShareBitcoinBytesVersion bytesShare;
+    bytesShare.version_ = ShareBitcoin::BYTES_VERSION;
+    bytesShare.workerHashId_ = 1;
+    bytesShare.userId_ = 1;
+    bytesShare.ip_ = ip;
+    bytesShare.jobId_ = 1;
+    bytesShare.shareDiff_ = 1;
+    bytesShare.blkBits_ = 0x1d00ffffu;
+    bytesShare.height_ = 1;
+    bytesShare.checkSum_ = bytesShare.checkSum();
+
+    ShareBitcoin share;
+    ASSERT_TRUE(share.UnserializeWithVersion((const uint8_t *)&bytesShare, sizeof(bytesShare)));
+    ASSERT_TRUE(share.isValid());
+    ASSERT_EQ(share.getIp().toString(), "10.0.0.1");
+  }
+
+  // IPv6
+  {
+    IpAddress ip6;
+    ASSERT_EQ(inet_pton(AF_INET6, "2001:db8::ff00:42:8329", &ip6.addrIpv6), 1);
+    ShareBitcoin share = makeShareBitcoin(1);
+    share.setIp(ip6);
+
+    string data;
+    uint32_t size = 0;
+    ASSERT_TRUE(share.SerializeToArrayWithVersion(data, size));
+    ShareBitcoin share2;
+    ASSERT_TRUE(share2.UnserializeWithVersion((const uint8_t *)data.data(), size));
+    ASSERT_EQ(share2.getIp().toString(), "2001:db8::ff00:42:8329");
+  }
+
+  // no IP
+  ASSERT_EQ(ShareBitcoin().getIp().toString(), "0.0.0.0");
+}
+
+TEST(Stratum, DISABLED_ShareIpBinBenchmark) {
+  const uint32_t kShares = 200000;
+  vector<IpAddress> ips(kShares);
+  for (uint32_t i = 0; i < kShares; i++) {
+    ips[i].fromIpv4Int(htonl(0xac100000u + i * 7919));
+  }
+
+  // sserver serializes the share, statshttpd parses it and reads the IP
+  auto run = [&](bool ipBin, size_t &bytes) {
+    string data;
+    uint32_t size = 0;
+    IpAddress last;
+    bytes = 0;
+
+    auto begin = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < kShares; i++) {
+      ShareBitcoin share = makeShareBitcoin(i);
+      if (ipBin) {
+        share.setIp(ips[i]);
+      } else {
+        share.set_version(ShareBitcoin::STRING_IP_VERSION);
+        share.set_ip(ips[i].toString());
+      }
+      share.SerializeToArrayWithVersion(data, size);
+      bytes += size;
+
+      ShareBitcoin share2;
+      share2.UnserializeWithVersion((const uint8_t *)data.data(), size);
+      last = share2.getIp();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+
+    EXPECT_EQ(last.toString(), ips.back().toString());
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / kShares;
+  };
+
+  size_t stringBytes = 0, binBytes = 0;
+  auto stringNs = run(false, stringBytes);
+  auto binNs = run(true, binBytes);
+
+  LOG(INFO) << kShares << " shares, ip string: " << stringBytes << " bytes, " << stringNs << " ns/share, "
+            << "ip_bin: " << binBytes << " bytes, " << binNs << " ns/share";
+}
+
 TEST(Stratum, StratumWorker) {
   StratumWorker w;
   uint64_t u;
@@ -268,6 +416,202 @@ TEST(Stratum, StratumJobBitcoin) {
   }
 }
 
+// a gbt with txCount copies of the same transaction
+static string makeGbtForTest(uint32_t txCount, uint32_t curTime = 1469006933) {
+  string gbt;
+  gbt += "{\"result\":{";
+  gbt += "\"capabilities\":[\"proposal\"],";
+  gbt += "\"version\":536870912,";
+  gbt += "\"previousblockhash\":\"000000004f2ea239532b2e77bb46c03b86643caac3fe92959a31fd2d03979c34\",";
+  gbt += "\"transactions\":[";
+  for (uint32_t i = 0; i < txCount; i++) {
+    if (i > 0) {
+      gbt += ",";
+    }
+    gbt += "{\"data\":\"01000000010291939c5ae8191c2e7d4ce8eba7d6616a66482e3200037cb8b8c2d0af45b445000000006a47304402204df709d9e149804e358de4b082e41d8bb21b3c9d347241b728b1362aafcb153602200d06d9b6f2eca899f43dcd62ec2efb2d9ce2e10adf02738bb908420d7db93ede012103cae98ab925e20dd6ae1f76e767e9e99bc47b3844095c68600af9c775104fb36cffffffff0290f1770b000000001976a91400dc5fd62f6ee48eb8ecda749eaec6824a780fdd88aca08601000000000017a914eb65573e5dd52d3d950396ccbe1a47daf8f400338700000000\",";
+    gbt += "\"hash\":\"bd36bd4fff574b573152e7d4f64adf2bb1c9ab0080a12f8544c351f65aca79ff\",";
+    gbt += "\"depends\":[],\"fee\":10000,\"sigops\":1}";
+  }
+  gbt += "],";
+  gbt += "\"coinbaseaux\":{\"flags\":\"\"},";
+  gbt += "\"coinbasevalue\":312659655,";
+  gbt += "\"longpollid\":\"000000004f2ea239532b2e77bb46c03b86643caac3fe92959a31fd2d03979c341911\",";
+  gbt += "\"target\":\"000000000000018ae20000000000000000000000000000000000000000000000\",";
+  gbt += "\"mintime\":1469001544,";
+  gbt += "\"mutable\":[\"time\",\"transactions\",\"prevblock\"],";
+  gbt += "\"noncerange\":\"00000000ffffffff\",";
+  gbt += "\"sigoplimit\":20000,";
+  gbt += "\"sizelimit\":1000000,";
+  gbt += Strings::Format("\"curtime\":%u,", curTime);
+  gbt += "\"bits\":\"1a018ae2\",";
+  gbt += "\"height\":898487";
+  gbt += "}}";
+  return gbt;
+}
+
+// the same as GbtMaker::makeRawGbtMsg(), the header fields are omitted
+// like the message of an old gbtmaker if withHeader is false
+static string makeRawGbtMsgForTest(const string &gbt, uint32_t txCount, bool withHeader) {
+  const uint256 gbtHash = Hash(gbt.begin(), gbt.end());
+  string header;
+  if (withHeader) {
+    header = Strings::Format("\"height\":898487,"
+                             "\"prevhash\":\"000000004f2ea239532b2e77bb46c03b86643caac3fe92959a31fd2d03979c34\","
+                             "\"bits\":\"1a018ae2\","
+                             "\"tx_count\":%u,"
+                             "\"is_empty_block\":%s,",
+                             txCount, txCount == 0 ? "true" : "false");
+  }
+  return Strings::Format("{\"created_at_ts\":%u,%s"
+                         "\"block_template_base64\":\"%s\","
+                         "\"gbthash\":\"%s\"}",
+                         (uint32_t)time(nullptr), header.c_str(),
+                         EncodeBase64(gbt).c_str(), gbtHash.ToString().c_str());
+}
+
+// make a job from the gbt string and another one from the gbt template,
+// retry if the second changed because the coinbase contains the current time
+static void makeStratumJobsForTest(const string &gbt, GbtTemplateBitcoin &gbtTemplate,
+                                   string &jobFromString, string &jobFromTemplate) {
+  SelectParams(CBaseChainParams::TESTNET);
+  CTxDestination poolPayoutAddr = BitcoinUtils::DecodeDestination("myxopLJB19oFtNBdrAxD5Z34Aw6P8o9P8U");
+
+  time_t now;
+  do {
+    now = time(nullptr);
+
+    StratumJobBitcoin sjob1;
+    ASSERT_TRUE(sjob1.initFromGbt(gbt.c_str(), "/BTC.COM/", poolPayoutAddr, 0, "", RskWork(), 1, false));
+
+    ASSERT_TRUE(gbtTemplate.parse());
+    StratumJobBitcoin sjob2;
+    ASSERT_TRUE(sjob2.initFromGbt(gbtTemplate.gbtHash_, gbtTemplate.json(),
+                                  "/BTC.COM/", poolPayoutAddr, 0, "", RskWork(), 1, false));
+
+    jobFromString = sjob1.serializeToJson();
+    jobFromTemplate = sjob2.serializeToJson();
+  } while (now != time(nullptr));
+}
+
+TEST(JobMaker, GbtTemplateBitcoin) {
+  for (uint32_t txCount : {0u, 1u, 100u}) {
+    const string gbt = makeGbtForTest(txCount);
+
+    // the header fields are read without parsing the template
+    {
+      GbtTemplateBitcoin gbtTemplate;
+      ASSERT_TRUE(gbtTemplate.initFromRawGbtMsg(makeRawGbtMsgForTest(gbt, txCount, true)));
+      ASSERT_TRUE(gbtTemplate.hasHeader_);
+      ASSERT_FALSE(gbtTemplate.isParsed());
+      ASSERT_EQ(gbtTemplate.gbtHash_, Hash(gbt.begin(), gbt.end()));
+      ASSERT_EQ(gbtTemplate.height_, 898487u);
+      ASSERT_EQ(gbtTemplate.isEmptyBlock_, txCount == 0);
+
+      string jobFromString, jobFromTemplate;
+      makeStratumJobsForTest(gbt, gbtTemplate, jobFromString, jobFromTemplate);
+      ASSERT_TRUE(gbtTemplate.isParsed());
+      ASSERT_EQ(gbtTemplate.gbt(), gbt);
+      ASSERT_EQ(jobFromTemplate, jobFromString);
+
+      // the parsed template is reused
+      ASSERT_TRUE(gbtTemplate.parse());
+      makeStratumJobsForTest(gbt, gbtTemplate, jobFromString, jobFromTemplate);
+      ASSERT_EQ(jobFromTemplate, jobFromString);
+    }
+
+    // the message of an old gbtmaker
+    {
+      GbtTemplateBitcoin gbtTemplate;
+      ASSERT_TRUE(gbtTemplate.initFromRawGbtMsg(makeRawGbtMsgForTest(gbt, txCount, false)));
+      ASSERT_FALSE(gbtTemplate.hasHeader_);
+      ASSERT_TRUE(gbtTemplate.parse());
+      ASSERT_EQ(gbtTemplate.height_, 898487u);
+      ASSERT_EQ(gbtTemplate.isEmptyBlock_, txCount == 0);
+
+      string jobFromString, jobFromTemplate;
+      makeStratumJobsForTest(gbt, gbtTemplate, jobFromString, jobFromTemplate);
+      ASSERT_EQ(jobFromTemplate, jobFromString);
+    }
+  }
+
+  // bad messages
+  GbtTemplateBitcoin gbtTemplate;
+  ASSERT_FALSE(gbtTemplate.initFromRawGbtMsg("{\"created_at_ts\":1}"));
+  ASSERT_TRUE(gbtTemplate.initFromRawGbtMsg("{\"created_at_ts\":1,\"block_template_base64\":\"e30=\",\"gbthash\":\"00\"}"));
+  ASSERT_FALSE(gbtTemplate.parse());
+}
+
+TEST(JobMaker, DISABLED_GbtTemplateBitcoinBenchmark) {
+  // jobmaker consumes the latest 20 rawgbt messages when it starts
+  const uint32_t kTemplates = 20;
+  // about 4MB
+  const uint32_t kTxCount = 6600;
+
+  vector<string> gbts, msgs;
+  for (uint32_t i = 0; i < kTemplates; i++) {
+    gbts.push_back(makeGbtForTest(kTxCount, 1469006933 + i));
+    msgs.push_back(makeRawGbtMsgForTest(gbts.back(), kTxCount, true));
+  }
+  LOG(INFO) << "gbt size: " << gbts[0].size() << ", rawgbt message size: " << msgs[0].size();
+
+  SelectParams(CBaseChainParams::TESTNET);
+  CTxDestination poolPayoutAddr = BitcoinUtils::DecodeDestination("myxopLJB19oFtNBdrAxD5Z34Aw6P8o9P8U");
+
+  // before: every message was decoded and parsed when it arrived,
+  // and the best one was parsed again to make the job.
+  auto begin = std::chrono::steady_clock::now();
+  string job1;
+  {
+    string best;
+    for (const auto &msg : msgs) {
+      JsonNode r;
+      ASSERT_TRUE(JsonNode::parse(msg.c_str(), msg.c_str() + msg.size(), r));
+      const string gbt = DecodeBase64(r["block_template_base64"].str());
+      JsonNode nodeGbt;
+      ASSERT_TRUE(JsonNode::parse(gbt.c_str(), gbt.c_str() + gbt.length(), nodeGbt));
+      ASSERT_EQ(nodeGbt["result"]["height"].uint32(), 898487u);
+      best = gbt;
+    }
+    StratumJobBitcoin sjob;
+    ASSERT_TRUE(sjob.initFromGbt(best.c_str(), "/BTC.COM/", poolPayoutAddr, 0, "", RskWork(), 1, false));
+    job1 = sjob.serializeToJson();
+  }
+  auto before = std::chrono::steady_clock::now() - begin;
+
+  // after: only the header fields are read, the best one is parsed once
+  begin = std::chrono::steady_clock::now();
+  string job2;
+  {
+    shared_ptr<GbtTemplateBitcoin> best;
+    for (const auto &msg : msgs) {
+      auto gbtTemplate = std::make_shared<GbtTemplateBitcoin>();
+      ASSERT_TRUE(gbtTemplate->initFromRawGbtMsg(msg));
+      ASSERT_EQ(gbtTemplate->height_, 898487u);
+      best = gbtTemplate;
+    }
+    ASSERT_TRUE(best->parse());
+    StratumJobBitcoin sjob;
+    ASSERT_TRUE(sjob.initFromGbt(best->gbtHash_, best->json(), "/BTC.COM/", poolPayoutAddr, 0, "", RskWork(), 1, false));
+    job2 = sjob.serializeToJson();
+  }
+  auto after = std::chrono::steady_clock::now() - begin;
+
+  using std::chrono::milliseconds;
+  LOG(INFO) << kTemplates << " rawgbt messages, parse every gbt: "
+            << std::chrono::duration_cast<milliseconds>(before).count() << " ms, "
+            << "parse the selected gbt once: "
+            << std::chrono::duration_cast<milliseconds>(after).count() << " ms";
+
+  // the job ids and the coinbase timestamps may differ
+  StratumJobBitcoin sjob1, sjob2;
+  ASSERT_TRUE(sjob1.unserializeFromJson(job1.c_str(), job1.length()));
+  ASSERT_TRUE(sjob2.unserializeFromJson(job2.c_str(), job2.length()));
+  ASSERT_EQ(sjob1.gbtHash_, sjob2.gbtHash_);
+  ASSERT_EQ(sjob1.merkleBranch_, sjob2.merkleBranch_);
+  ASSERT_EQ(sjob1.coinbase2_, sjob2.coinbase2_);
+  ASSERT_EQ(sjob1.nTime_, sjob2.nTime_);
+}
+
 #ifdef CHAIN_TYPE_BTC
 TEST(Stratum, StratumJobWithWitnessCommitment) {
   StratumJobBitcoin sjob;
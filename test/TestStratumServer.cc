@@ -27,9 +27,29 @@
 #include "Utils.h"
 
 #include "StratumServer.h"
+#include "StratumSession.h"
 #include "bitcoin/BitcoinUtils.h"
 #include "bitcoin/StratumBitcoin.h"
 #include "bitcoin/StratumServerBitcoin.h"
+#include "eth/StratumServerEth.h"
+#include "eth/StratumSessionEth.h"
+#include "WorkerPool.h"
+
+#include <event2/buffer.h>
+#include <event2/bufferevent.h>
+#include <event2/event.h>
+#include <event2/thread.h>
+
+#include <libconfig.h++>
+
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+#include <hash.h>
+#include <primitives/block.h>
+
+#include <chrono>
+#include <random>
 
 // #include "Kafka.h"
 
@@ -184,7 +204,7 @@ TEST(StratumServer, SessionIDManager8Bits) {
 
 #endif // #ifndef WORK_WITH_STRATUM_SWITCHER
 
-TEST(StratumServerBitcoin, CheckShare) {
+static shared_ptr<StratumJobBitcoin> createStratumJobBitcoin() {
   string sjobJson = "{\"jobId\":6645522065066147329,\"gbtHash\":\"d349be274f007c2e1ee773b33bd21ef43d2615c089b7c5460b66584881a10683\","
   "\"prevHash\":\"00000000000000000019d1d9c84df0ecc23e549b86644ad47cb92570a26b12a5\",\"prevHashBeStr\":\"a26b12a57cb9257086644ad4c23e"
   "549bc84df0ec0019d1d90000000000000000\",\"height\":558201,\"coinbase1\":\"020000000100000000000000000000000000000000000000000000000"
@@ -203,9 +223,14 @@ TEST(StratumServerBitcoin, CheckShare) {
   "9\",\"nmcRpcUserpass\":\"user:pass\",\"rskBlockHashForMergedMining\":\"0x9ad45fdcc194d788895f3ad389b583ea327f826353f7edf6b168db038"
   "372cb27\",\"rskNetworkTarget\":\"0x00000000000000001386e3444eba74f8a750a71a75ed0b7fecdfd282a8cef091\",\"rskFeesForMiner\":\"0\",\""
   "rskdRpcAddress\":\"http://127.0.0.1:4444\",\"rskdRpcUserPwd\":\"user:pass\",\"isRskCleanJob\":true}";
-  
+
   auto sjob = std::make_shared<StratumJobBitcoin>();
   sjob->unserializeFromJson(sjobJson.c_str(), sjobJson.size());
+  return sjob;
+}
+
+TEST(StratumServerBitcoin, CheckShare) {
+  auto sjob = createStratumJobBitcoin();
 
   StratumJobExBitcoin exjob(sjob, true);
   
@@ -224,3 +249,555 @@ TEST(StratumServerBitcoin, CheckShare) {
   uint256 blkHash = uint256S("1028e53e8145994a9ebe4f39eb6a7e3fd4036f2f21a05a5a696e8ac6d0829ef4");
   ASSERT_EQ(blkHash, header.GetHash());
 }
+
+// the coinbase tx & merkle root built from the hex strings,
+// as it was done before the binary coinbase template was introduced
+static void generateBlockHeaderFromHex(const StratumJobBitcoin &sjob,
+                                       CBlockHeader *header,
+                                       std::vector<char> *coinbaseBin,
+                                       const uint32_t extraNonce1,
+                                       const string &extraNonce2Hex) {
+  string coinbaseHex = sjob.coinbase1_;
+  coinbaseHex.append(Strings::Format("%08x%s", extraNonce1, extraNonce2Hex.c_str()));
+  coinbaseHex.append(sjob.coinbase2_);
+  Hex2Bin(coinbaseHex.c_str(), *coinbaseBin);
+
+  header->hashMerkleRoot = Hash(coinbaseBin->begin(), coinbaseBin->end());
+  for (const uint256 & step : sjob.merkleBranch_) {
+    header->hashMerkleRoot = Hash(BEGIN(header->hashMerkleRoot),
+                                  END  (header->hashMerkleRoot),
+                                  BEGIN(step),
+                                  END  (step));
+  }
+}
+
+TEST(StratumServerBitcoin, GenerateCoinbaseTx) {
+  auto sjob = createStratumJobBitcoin();
+  StratumJobExBitcoin exjob(sjob, true);
+
+  std::mt19937_64 gen(20190112);
+  for (size_t i = 0; i < 10000; i++) {
+    const uint32_t extraNonce1 = (uint32_t)gen();
+    const string extraNonce2Hex = Strings::Format("%016llx", (unsigned long long)gen());
+
+    CBlockHeader header, expectedHeader;
+    std::vector<char> coinbaseBin, expectedCoinbaseBin;
+
+    exjob.generateBlockHeader(
+      &header, &coinbaseBin,
+      extraNonce1, extraNonce2Hex,
+      sjob->merkleBranch_, sjob->prevHash_,
+      sjob->nBits_, sjob->nVersion_,
+      sjob->nTime_, (uint32_t)gen(), 0u);
+    generateBlockHeaderFromHex(*sjob, &expectedHeader, &expectedCoinbaseBin,
+                               extraNonce1, extraNonce2Hex);
+
+    ASSERT_EQ(coinbaseBin, expectedCoinbaseBin);
+    ASSERT_EQ(header.hashMerkleRoot, expectedHeader.hashMerkleRoot);
+  }
+}
+
+TEST(StratumServerBitcoin, DISABLED_GenerateCoinbaseTxBenchmark) {
+  auto sjob = createStratumJobBitcoin();
+  StratumJobExBitcoin exjob(sjob, true);
+  const vector<uint256> emptyBranch;
+  const size_t kShares = 200000;
+
+  CBlockHeader header;
+  std::vector<char> coinbaseBin;
+
+  auto begin = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < kShares; i++) {
+    exjob.generateBlockHeader(
+      &header, &coinbaseBin,
+      0xfe0000c3u, Strings::Format("%016llx", (unsigned long long)i),
+      emptyBranch, sjob->prevHash_,
+      sjob->nBits_, sjob->nVersion_,
+      sjob->nTime_, 0u, 0u);
+  }
+  auto cached = std::chrono::steady_clock::now() - begin;
+
+  auto sjobNoBranch = createStratumJobBitcoin();
+  sjobNoBranch->merkleBranch_.clear();
+  begin = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < kShares; i++) {
+    generateBlockHeaderFromHex(*sjobNoBranch, &header, &coinbaseBin,
+                               0xfe0000c3u, Strings::Format("%016llx", (unsigned long long)i));
+  }
+  auto hex = std::chrono::steady_clock::now() - begin;
+
+  LOG(INFO) << "coinbase tx (" << coinbaseBin.size() << " bytes) per share, "
+            << "hex template: " << std::chrono::duration_cast<std::chrono::nanoseconds>(hex).count() / kShares << " ns, "
+            << "binary template with midstate: " << std::chrono::duration_cast<std::chrono::nanoseconds>(cached).count() / kShares << " ns";
+}
+
+// Send a mining.notify to `sessions` socketpairs the way
+// StratumSessionBitcoin::sendMiningNotify() did (one string per session)
+// or does (a copied prefix and the shared tail of the job).
+static void miningNotifyFanOut(size_t sessions) {
+  struct rlimit limit;
+  getrlimit(RLIMIT_NOFILE, &limit);
+  limit.rlim_cur = limit.rlim_max;
+  setrlimit(RLIMIT_NOFILE, &limit);
+  if (sessions * 2 + 64 > limit.rlim_cur) {
+    sessions = (limit.rlim_cur - 64) / 2;
+    LOG(WARNING) << "open files limit is " << limit.rlim_cur << ", use " << sessions << " sessions";
+  }
+
+  evthread_use_pthreads();
+  struct event_base *base = event_base_new();
+  vector<struct bufferevent *> bevs;
+  vector<int> peers;
+  for (size_t i = 0; i < sessions; i++) {
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    evutil_make_socket_nonblocking(fds[0]);
+    evutil_make_socket_nonblocking(fds[1]);
+    bevs.push_back(bufferevent_socket_new(base, fds[0], BEV_OPT_CLOSE_ON_FREE|BEV_OPT_THREADSAFE));
+    bufferevent_enable(bevs.back(), EV_WRITE);
+    peers.push_back(fds[1]);
+  }
+
+  auto exJob = std::make_shared<StratumJobExBitcoin>(createStratumJobBitcoin(), true);
+
+  // write all output buffers to the sockets, then read them from the peers
+  std::vector<char> received(4096);
+  auto flush = [&](const string &expected) {
+    size_t pending;
+    do {
+      event_base_loop(base, EVLOOP_ONCE | EVLOOP_NONBLOCK);
+      pending = 0;
+      for (auto bev : bevs) {
+        pending += evbuffer_get_length(bufferevent_get_output(bev));
+      }
+    } while (pending > 0);
+
+    for (size_t i = 0; i < peers.size(); i++) {
+      ssize_t len = read(peers[i], received.data(), received.size());
+      ASSERT_EQ((size_t)len, expected.size());
+      if (i == 0 || i + 1 == peers.size()) {
+        ASSERT_EQ(string(received.data(), len), expected);
+      }
+    }
+  };
+
+  const string prefix = exJob->miningNotify1_ + "1";
+  const string expected = prefix + exJob->miningNotifyTail_;
+
+  auto begin = std::chrono::steady_clock::now();
+  for (auto bev : bevs) {
+    string notifyStr;
+    notifyStr.reserve(2048);
+    notifyStr.append(exJob->miningNotify1_);
+    notifyStr.append(Strings::Format("%u", 1));
+    notifyStr.append(exJob->miningNotify2_);
+    notifyStr.append(exJob->coinbase1_);
+    notifyStr.append(exJob->miningNotify3_);
+    bufferevent_write(bev, notifyStr.data(), notifyStr.size());
+  }
+  flush(expected);
+  auto copied = std::chrono::steady_clock::now() - begin;
+
+  begin = std::chrono::steady_clock::now();
+  for (auto bev : bevs) {
+    string notifyStr;
+    notifyStr.reserve(64);
+    notifyStr.append(exJob->miningNotify1_);
+    notifyStr.append(Strings::Format("%u", 1));
+    bufferevent_lock(bev);
+    bufferevent_write(bev, notifyStr.data(), notifyStr.size());
+    ASSERT_TRUE(StratumSession::addDataReference(bufferevent_get_output(bev),
+                                                 exJob->miningNotifyTail_.data(),
+                                                 exJob->miningNotifyTail_.size(), exJob));
+    bufferevent_unlock(bev);
+  }
+  // the tail is referenced until it's written
+  ASSERT_EQ(exJob.use_count(), (long)sessions + 1);
+  flush(expected);
+  ASSERT_EQ(exJob.use_count(), 1);
+  auto referenced = std::chrono::steady_clock::now() - begin;
+
+  // bytes copied in user space: building the string and bufferevent_write()
+  LOG(INFO) << "mining.notify (" << expected.size() << " bytes) to " << sessions << " sessions, "
+            << "copied: " << std::chrono::duration_cast<std::chrono::milliseconds>(copied).count() << " ms, "
+            << expected.size() * 2 * sessions << " bytes copied, "
+            << "shared tail: " << std::chrono::duration_cast<std::chrono::milliseconds>(referenced).count() << " ms, "
+            << prefix.size() * 2 * sessions << " bytes copied";
+
+  for (auto bev : bevs) {
+    bufferevent_free(bev);
+  }
+  for (auto fd : peers) {
+    close(fd);
+  }
+  event_base_free(base);
+}
+
+TEST(StratumServerBitcoin, MiningNotifyFanOut) {
+  miningNotifyFanOut(1000);
+}
+
+TEST(StratumServerBitcoin, DISABLED_MiningNotifyFanOutBenchmark) {
+  miningNotifyFanOut(100000);
+}
+
+TEST(StratumServerEth, ConcurrentLightCompute) {
+  // the constructor doesn't connect to kafka
+  JobRepositoryEth repo("127.0.0.1:9092", "test", "", nullptr);
+  EthashLightPtr light(ethash_light_new(0), ethash_light_delete);
+  ASSERT_NE(light, nullptr);
+  repo.setLight(light);
+
+  const size_t kShares = 2000;
+  std::vector<ethash_h256_t> headers(kShares);
+  std::vector<ethash_return_value_t> expected(kShares);
+  std::mt19937 gen(1);
+  for (size_t i = 0; i < kShares; i++) {
+    for (auto &b : headers[i].b) {
+      b = (uint8_t)gen();
+    }
+    expected[i] = ethash_light_compute(light.get(), headers[i], i);
+    ASSERT_TRUE(expected[i].success);
+  }
+
+  // check shares in worker threads and send results back to
+  // an event loop, the same as sserver does
+  evthread_use_pthreads();
+  struct event_base *base = event_base_new();
+  std::vector<ethash_return_value_t> results(kShares);
+  size_t finished = 0;
+  size_t failed = 0;
+  {
+    WorkerPool pool(8);
+    for (size_t i = 0; i < kShares; i++) {
+      pool.post([&, i]() {
+        ethash_return_value_t r;
+        bool success = repo.compute(headers[i], i, r);
+        runInEventLoop(base, [&, i, success, r]() {
+          if (!success) {
+            failed++;
+          }
+          results[i] = r;
+          if (++finished == kShares) {
+            event_base_loopbreak(base);
+          }
+        });
+      });
+    }
+
+    // replace the light with an equal one while computing,
+    // the replaced light must be kept until no one uses it.
+    thread swapper([&repo]() {
+      repo.setLight(EthashLightPtr(ethash_light_new(0), ethash_light_delete));
+    });
+    light.reset();
+
+    event_base_loop(base, EVLOOP_NO_EXIT_ON_EMPTY);
+    swapper.join();
+  }
+  event_base_free(base);
+
+  ASSERT_EQ(finished, kShares);
+  ASSERT_EQ(failed, 0u);
+  for (size_t i = 0; i < kShares; i++) {
+    ASSERT_TRUE(results[i].success);
+    ASSERT_EQ(memcmp(results[i].result.b, expected[i].result.b, 32), 0);
+    ASSERT_EQ(memcmp(results[i].mix_hash.b, expected[i].mix_hash.b, 32), 0);
+  }
+
+  // don't cache the light to file in the destructor
+  repo.setLight(nullptr);
+}
+
+class JobRepositoryEthForTest : public JobRepositoryEth {
+public:
+  // the constructor doesn't connect to kafka
+  explicit JobRepositoryEthForTest(ServerEth *server) : JobRepositoryEth("127.0.0.1:9092", "test", "", server) {}
+
+  uint64_t addJob(uint64_t jobId, const uint256 &networkTarget) {
+    auto sjob = std::make_shared<StratumJobEth>();
+    sjob->jobId_ = jobId;
+    sjob->networkTarget_ = networkTarget;
+    ScopeLock sl(lock_);
+    exJobs_[jobId] = createStratumJobEx(sjob, false);
+    updateJobsSnapshot();
+    return jobId;
+  }
+};
+
+// Shares submitted by sessions of several event loops and checked in the
+// share checking threads get the same results as checking them synchronously.
+TEST(StratumServerEth, ConcurrentSessionSubmit) {
+  libconfig::Config config;
+  ServerEth server(10, config);
+  ASSERT_TRUE(server.setupInternal(nullptr));
+
+  auto repo = new JobRepositoryEthForTest(&server);
+  static_cast<Server &>(server).jobRepository_ = repo;  // freed by the server
+  repo->setLight(EthashLightPtr(ethash_light_new(0), ethash_light_delete));
+  const uint64_t jobId = repo->addJob(0x5b0ec26100000001ull, uint256S("0000000000001000000000000000000000000000000000000000000000000000"));
+
+  const size_t kLoops = 4;
+  const size_t kSessionsPerLoop = 4;
+  const size_t kSharesPerLoop = 500;
+  const std::set<uint64_t> jobDiffs = {1, 4, 16};
+
+  struct Submit {
+    uint64_t jobId_;
+    uint64_t nonce_;
+    uint256 header_;
+    int status_;
+    uint64_t shareDiff_;
+  };
+  std::vector<Submit> submits(kLoops * kSharesPerLoop);
+  std::mt19937_64 gen(1);
+  for (size_t i = 0; i < submits.size(); i++) {
+    // some of them with an unknown job
+    submits[i].jobId_ = (i % 50 == 0) ? jobId + 1 : jobId;
+    submits[i].nonce_ = gen();
+    submits[i].header_ = uint256S(Strings::Format("%016llx%016llx%016llx%016llx",
+                                                  (unsigned long long)gen(), (unsigned long long)gen(),
+                                                  (unsigned long long)gen(), (unsigned long long)gen()));
+    submits[i].status_ = StratumStatus::UNKNOWN;
+    submits[i].shareDiff_ = 0;
+  }
+
+  evthread_use_pthreads();
+  std::vector<struct event_base *> bases;
+  std::vector<unique_ptr<StratumSession>> sessions;
+  std::vector<int> peers;
+  struct sockaddr_in saddr;
+  memset(&saddr, 0, sizeof(saddr));
+  saddr.sin_family = AF_INET;
+  for (size_t l = 0; l < kLoops; l++) {
+    bases.push_back(event_base_new());
+    for (size_t s = 0; s < kSessionsPerLoop; s++) {
+      int fds[2];
+      ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+      evutil_make_socket_nonblocking(fds[0]);
+      auto bev = bufferevent_socket_new(bases[l], fds[0], BEV_OPT_CLOSE_ON_FREE|BEV_OPT_THREADSAFE);
+      sessions.push_back(server.createConnection(bev, (struct sockaddr *)&saddr, l * kSessionsPerLoop + s));
+      peers.push_back(fds[1]);
+    }
+  }
+
+  // submit from the event loops and collect the results there,
+  // the same as StratumMinerEth does
+  std::vector<size_t> finished(kLoops, 0);
+  std::vector<thread> loops;
+  for (size_t l = 0; l < kLoops; l++) {
+    loops.push_back(thread([&, l]() {
+      event_base_loop(bases[l], EVLOOP_NO_EXIT_ON_EMPTY);
+    }));
+    for (size_t i = l * kSharesPerLoop; i < (l + 1) * kSharesPerLoop; i++) {
+      auto session = sessions[l * kSessionsPerLoop + i % kSessionsPerLoop].get();
+      runInEventLoop(bases[l], [&, l, i, session]() {
+        auto share = std::make_shared<ShareEth>();
+        server.checkShareAndUpdateDiffAsync(*session, share, submits[i].jobId_, submits[i].nonce_,
+                                            submits[i].header_, jobDiffs, "test.worker",
+                                            [&, l, i, share](int status, const uint256 &mixHash) {
+          submits[i].status_ = status;
+          submits[i].shareDiff_ = share->sharediff();
+          if (++finished[l] == kSharesPerLoop) {
+            event_base_loopbreak(bases[l]);
+          }
+        });
+      });
+    }
+  }
+  for (auto &t : loops) {
+    t.join();
+  }
+
+  for (auto &session : sessions) {
+    ASSERT_FALSE(session->hasAsyncTasks());
+  }
+  size_t accepted = 0;
+  for (auto &submit : submits) {
+    ShareEth share;
+    uint256 mixHash;
+    int status = server.checkShareAndUpdateDiff(share, submit.jobId_, submit.nonce_, submit.header_,
+                                                jobDiffs, mixHash, "test.worker");
+    ASSERT_EQ(submit.status_, status);
+    ASSERT_EQ(submit.shareDiff_, share.sharediff());
+    if (status == StratumStatus::ACCEPT) {
+      accepted++;
+    }
+  }
+  ASSERT_GT(accepted, 0u);
+
+  sessions.clear();
+  for (auto fd : peers) {
+    close(fd);
+  }
+  for (auto base : bases) {
+    event_base_free(base);
+  }
+  // don't cache the light to file in the destructor
+  repo->setLight(nullptr);
+}
+
+TEST(StratumServer, WorkerPoolPostAfterStop) {
+  atomic<int> done(0);
+  WorkerPool pool(2);
+  ASSERT_TRUE(pool.post([&done]() { done++; }));
+  while (done == 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  // the caller must know the task is dropped
+  pool.stop();
+  ASSERT_FALSE(pool.post([&done]() { done++; }));
+  ASSERT_EQ(done, 1);
+}
+
+class JobRepositoryForTest : public JobRepository {
+public:
+  // the constructor doesn't connect to kafka
+  JobRepositoryForTest() : JobRepository("127.0.0.1:9092", "test", "", nullptr) {}
+
+  shared_ptr<StratumJob> createStratumJob() override {
+    return std::make_shared<StratumJobBitcoin>();
+  }
+
+  void broadcastStratumJob(shared_ptr<StratumJob> sjob) override {
+    ScopeLock sl(lock_);
+    exJobs_[sjob->jobId_] = createStratumJobEx(sjob, false);
+    updateJobsSnapshot();
+  }
+
+  uint64_t addJob(uint32_t jobTime, uint32_t seq) {
+    auto sjob = createStratumJob();
+    sjob->jobId_ = ((uint64_t)jobTime << 32) | seq;
+    broadcastStratumJob(sjob);
+    return sjob->jobId_;
+  }
+
+  using JobRepository::tryCleanExpiredJobs;
+};
+
+TEST(StratumServer, JobRepositoryExpiredJobs) {
+  JobRepositoryForTest repo;
+  repo.setMaxJobDelay(300);
+  ASSERT_TRUE(repo.getStratumJobEx(1) == nullptr);
+  ASSERT_TRUE(repo.getLatestStratumJobEx() == nullptr);
+
+  const uint32_t now = (uint32_t)time(nullptr);
+  const uint64_t expired1 = repo.addJob(now - 400, 1);
+  const uint64_t expired2 = repo.addJob(now - 300, 2);
+  const uint64_t alive1 = repo.addJob(now - 100, 3);
+  const uint64_t alive2 = repo.addJob(now, 4);
+
+  auto job = repo.getStratumJobEx(expired1);
+  ASSERT_TRUE(job != nullptr);
+  ASSERT_EQ(job->sjob_->jobId_, expired1);
+  ASSERT_TRUE(repo.getStratumJobEx(expired2) != nullptr);
+  ASSERT_TRUE(repo.getStratumJobEx(alive1) != nullptr);
+  ASSERT_TRUE(repo.getStratumJobEx(expired1 + 1) == nullptr);
+  ASSERT_EQ(repo.getLatestStratumJobEx()->sjob_->jobId_, alive2);
+
+  repo.tryCleanExpiredJobs();
+  ASSERT_TRUE(repo.getStratumJobEx(expired1) == nullptr);
+  ASSERT_TRUE(repo.getStratumJobEx(expired2) == nullptr);
+  ASSERT_TRUE(repo.getStratumJobEx(alive1) != nullptr);
+  ASSERT_TRUE(repo.getStratumJobEx(alive2) != nullptr);
+  ASSERT_EQ(repo.getLatestStratumJobEx()->sjob_->jobId_, alive2);
+  // a job removed from the repository is still usable by its holder
+  ASSERT_EQ(job->sjob_->jobId_, expired1);
+
+  // the snapshot shares the jobs with exJobs_
+  ASSERT_FALSE(repo.getStratumJobEx(alive1)->isStale());
+  repo.markAllJobsAsStale();
+  ASSERT_TRUE(repo.getStratumJobEx(alive1)->isStale());
+  ASSERT_TRUE(repo.getStratumJobEx(alive2)->isStale());
+
+  // keep at least one job even if all of them are expired
+  repo.setMaxJobDelay(1);
+  repo.addJob(now - 100, 5);
+  repo.tryCleanExpiredJobs();
+  ASSERT_TRUE(repo.getStratumJobEx(alive1) == nullptr);
+  ASSERT_EQ(repo.getLatestStratumJobEx()->sjob_->jobId_, alive2);
+}
+
+TEST(StratumServer, DISABLED_JobRepositoryLookupBenchmark) {
+  const size_t kThreads = 8;
+  const size_t kLookups = 1000000;
+  const uint32_t kJobs = 16;
+  const uint32_t now = (uint32_t)time(nullptr);
+
+  JobRepositoryForTest repo;
+  repo.setMaxJobDelay(300);
+  // the same jobs in a locked map, how getStratumJobEx() used to work
+  mutex mapLock;
+  std::map<uint64_t, shared_ptr<StratumJobEx>> jobsMap;
+  vector<uint64_t> jobIds;
+  for (uint32_t i = 0; i < kJobs; i++) {
+    jobIds.push_back(repo.addJob(now, i));
+    jobsMap[jobIds.back()] = repo.getStratumJobEx(jobIds.back());
+  }
+
+  // submit threads look up jobs while the consume thread keeps adding
+  // and removing jobs
+  auto runContention = [&](std::function<bool(uint64_t)> lookup,
+                           std::function<void(uint32_t)> update) {
+    atomic<bool> running(true);
+    atomic<size_t> missed(0);
+    thread writer([&]() {
+      for (uint32_t seq = kJobs; running; seq++) {
+        update(seq);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    });
+
+    auto begin = std::chrono::steady_clock::now();
+    vector<thread> readers;
+    for (size_t t = 0; t < kThreads; t++) {
+      readers.push_back(thread([&, t]() {
+        // quiescent every 64 lookups, like an event loop handling a few shares
+        QuiescentReader reader;
+        for (size_t i = 0; i < kLookups; i++) {
+          if (!lookup(jobIds[(i + t) % kJobs])) {
+            missed++;
+          }
+          if (i % 64 == 63) {
+            QuiescentState::quiescent();
+          }
+        }
+      }));
+    }
+    for (auto &r : readers) {
+      r.join();
+    }
+    auto duration = std::chrono::steady_clock::now() - begin;
+
+    running = false;
+    writer.join();
+    EXPECT_EQ(missed.load(), 0u);
+    return (double)kThreads * kLookups /
+           std::chrono::duration_cast<std::chrono::duration<double>>(duration).count();
+  };
+
+  double locked = runContention(
+    [&](uint64_t jobId) {
+      ScopeLock sl(mapLock);
+      return jobsMap.find(jobId) != jobsMap.end();
+    },
+    [&](uint32_t seq) {
+      ScopeLock sl(mapLock);
+      jobsMap[((uint64_t)(now - 1000) << 32) | seq] = nullptr;
+      jobsMap.erase(jobsMap.begin());
+    });
+
+  double snapshot = runContention(
+    [&](uint64_t jobId) {
+      return repo.getStratumJobEx(jobId) != nullptr;
+    },
+    [&](uint32_t seq) {
+      // expired on arrival, removed by the next clean
+      repo.addJob(now - 1000, seq);
+      repo.tryCleanExpiredJobs();
+    });
+
+  LOG(INFO) << kThreads << " submit threads, " << kJobs << " jobs, lookups per second: "
+            << "locked map: " << (uint64_t)locked << ", snapshot: " << (uint64_t)snapshot;
+}
@@ -28,6 +28,9 @@
 
 #include <boost/algorithm/string.hpp>
 
+#include <chrono>
+#include <random>
+
 #include "StratumSession.h"
 #include "StratumMessageDispatcher.h"
 #include "StratumMiner.h"
@@ -97,6 +100,73 @@ TEST(StratumSession, LocalJob) {
   }
 }
 
+TEST(StratumSession, LocalJobManyShares) {
+  LocalJob lj(0);
+  std::set<LocalShare> expected;
+  std::mt19937_64 gen(1);
+
+  // shares differing in one field only, and random ones,
+  // enough to grow the table several times
+  for (uint32_t i = 0; i < 20000; i++) {
+    LocalShare shares[] = {
+      LocalShare(i, 0, 0, 0),
+      LocalShare(0, i, 0, 0),
+      LocalShare(0, 0, i, 0),
+      LocalShare(0, 0, 0, i),
+      LocalShare(gen(), (uint32_t)gen(), (uint32_t)gen(), (uint32_t)gen() & 0x1fffe000u),
+    };
+    for (const auto &share : shares) {
+      bool inserted = expected.insert(share).second;
+      ASSERT_EQ(lj.addLocalShare(share), inserted);
+      ASSERT_EQ(lj.addLocalShare(share), false);
+    }
+  }
+  ASSERT_EQ(lj.submitShares_.size(), expected.size());
+
+  for (const auto &share : expected) {
+    ASSERT_TRUE(lj.submitShares_.contains(share));
+  }
+  ASSERT_FALSE(lj.submitShares_.contains(LocalShare(20000, 1, 1, 1)));
+  ASSERT_FALSE(LocalJob(1).submitShares_.contains(LocalShare(0, 0, 0, 0)));
+}
+
+TEST(StratumSession, DISABLED_LocalJobBenchmark) {
+  std::mt19937_64 gen(1);
+
+  for (size_t kShares : {1000, 10000, 100000}) {
+    vector<LocalShare> shares;
+    for (size_t i = 0; i < kShares; i++) {
+      shares.emplace_back(gen(), (uint32_t)gen(), (uint32_t)gen(), 0u);
+    }
+    const size_t kRounds = 1000000 / kShares;
+
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < kRounds; r++) {
+      std::set<LocalShare> submitShares;
+      for (const auto &share : shares) {
+        submitShares.insert(share);
+      }
+      // resubmit one of them
+      ASSERT_FALSE(submitShares.insert(shares[r % kShares]).second);
+    }
+    auto set = std::chrono::steady_clock::now() - begin;
+
+    begin = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < kRounds; r++) {
+      LocalJob lj(r);
+      for (const auto &share : shares) {
+        lj.addLocalShare(share);
+      }
+      ASSERT_FALSE(lj.addLocalShare(shares[r % kShares]));
+    }
+    auto hashSet = std::chrono::steady_clock::now() - begin;
+
+    LOG(INFO) << kShares << " shares per job, addLocalShare(): "
+              << "std::set: " << std::chrono::duration_cast<std::chrono::nanoseconds>(set).count() / (kRounds * kShares) << " ns, "
+              << "LocalShareSet: " << std::chrono::duration_cast<std::chrono::nanoseconds>(hashSet).count() / (kRounds * kShares) << " ns";
+  }
+}
+
 class StratumSessionMock : public IStratumSession {
 public:
   MOCK_METHOD3(addWorker, void (const string &, const string &, int64_t));
@@ -0,0 +1,234 @@
+/*
+ The MIT License (MIT)
+
+ Copyright (c) [2016] [BTC.COM]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+#include "gtest/gtest.h"
+#include "Common.h"
+#include "Utils.h"
+
+#include "StratumServer.h"
+
+#include <event2/buffer.h>
+#include <event2/event.h>
+#include <event2/http.h>
+#include <event2/keyvalq_struct.h>
+#include <event2/thread.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include <fstream>
+#include <sstream>
+
+/////////////////////////////// StubUserApi ///////////////////////////////
+// A local stand-in for the user list API, backed by a file of
+// "<userName> <userId>" lines that is read again on every request.
+// Like the real API, it replies the users after `last_id` in pages.
+class StubUserApi {
+  string file_;
+  size_t pageSize_;
+
+  struct event_base *base_;
+  struct evhttp *httpd_;
+  uint16_t port_;
+  thread thread_;
+
+  atomic<uint32_t> requests_;
+
+  static void handle(struct evhttp_request *req, void *ptr) {
+    StubUserApi *api = static_cast<StubUserApi *>(ptr);
+    api->requests_++;
+
+    struct evkeyvalq params;
+    evhttp_parse_query(evhttp_request_get_uri(req), &params);
+    const char *lastIdStr = evhttp_find_header(&params, "last_id");
+    const int32_t lastId = lastIdStr != nullptr ? atoi(lastIdStr) : 0;
+    evhttp_clear_headers(&params);
+
+    string users;
+    size_t count = 0;
+    std::ifstream in(api->file_);
+    string userName;
+    int32_t userId;
+    while (count < api->pageSize_ && in >> userName >> userId) {
+      if (userId <= lastId) {
+        continue;
+      }
+#ifdef USER_DEFINED_COINBASE
+      users += Strings::Format("%s\"%s\":{\"puid\":%d,\"coinbase\":\"%s\"}",
+                               count ? "," : "", userName.c_str(), userId, userName.c_str());
+#else
+      users += Strings::Format("%s\"%s\":%d", count ? "," : "", userName.c_str(), userId);
+#endif
+      count++;
+    }
+
+    struct evbuffer *evb = evbuffer_new();
+#ifdef USER_DEFINED_COINBASE
+    evbuffer_add_printf(evb, "{\"err_no\":0,\"data\":{\"users\":{%s},\"time\":%u}}",
+                        users.c_str(), (uint32_t)time(nullptr));
+#else
+    evbuffer_add_printf(evb, "{\"err_no\":0,\"data\":{%s}}", users.c_str());
+#endif
+    evhttp_send_reply(req, HTTP_OK, "OK", evb);
+    evbuffer_free(evb);
+  }
+
+public:
+  StubUserApi(const string &file, size_t pageSize)
+    : file_(file), pageSize_(pageSize), port_(0), requests_(0)
+  {
+    // stopped from the test thread
+    evthread_use_pthreads();
+    base_ = event_base_new();
+    httpd_ = evhttp_new(base_);
+    evhttp_set_gencb(httpd_, StubUserApi::handle, this);
+
+    struct evhttp_bound_socket *handle = evhttp_bind_socket_with_handle(httpd_, "127.0.0.1", 0);
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    getsockname(evhttp_bound_socket_get_fd(handle), (struct sockaddr *)&addr, &len);
+    port_ = ntohs(addr.sin_port);
+
+    thread_ = thread([this]() { event_base_dispatch(base_); });
+  }
+
+  ~StubUserApi() {
+    event_base_loopexit(base_, nullptr);
+    thread_.join();
+    evhttp_free(httpd_);
+    event_base_free(base_);
+  }
+
+  string url() const { return Strings::Format("http://127.0.0.1:%u/userlist", port_); }
+  uint32_t requests() const { return requests_; }
+};
+
+class UserListFile {
+  string path_;
+public:
+  UserListFile() : path_(Strings::Format("/tmp/btcpool_test_userlist_%d.txt", (int)getpid())) {
+    std::ofstream out(path_, std::ios::trunc);
+  }
+  ~UserListFile() { unlink(path_.c_str()); }
+
+  const string &path() const { return path_; }
+
+  void append(int32_t first, int32_t last) {
+    std::ofstream out(path_, std::ios::app);
+    for (int32_t id = first; id <= last; id++) {
+      out << userName(id) << " " << id << "\n";
+    }
+  }
+
+  static string userName(int32_t id) { return Strings::Format("user%d", id); }
+};
+
+TEST(UserInfo, LoadUsersInPages) {
+  UserListFile file;
+  file.append(1, 2500);
+  StubUserApi api(file.path(), 1000);
+
+  UserInfo userInfo(api.url(), nullptr);
+  ASSERT_TRUE(userInfo.setupThreads());
+  // 3 pages and an empty one
+  ASSERT_EQ(api.requests(), 4u);
+
+  ASSERT_EQ(userInfo.getUserId("user1"), 1);
+  ASSERT_EQ(userInfo.getUserId("user1000"), 1000);
+  ASSERT_EQ(userInfo.getUserId("user2500"), 2500);
+  ASSERT_EQ(userInfo.getUserId("user2501"), 0);
+  ASSERT_EQ(userInfo.getUserId("nobody"), 0);
+#ifdef USER_DEFINED_COINBASE
+  ASSERT_EQ(userInfo.getCoinbaseInfo(2500).find("user2500") != string::npos, true);
+#endif
+
+  // new users are applied as a delta
+  file.append(2501, 2600);
+  ASSERT_EQ(userInfo.updateUsers(), 100);
+  ASSERT_EQ(userInfo.updateUsers(), 0);
+  ASSERT_EQ(userInfo.getUserId("user2501"), 2501);
+  ASSERT_EQ(userInfo.getUserId("user2600"), 2600);
+  ASSERT_EQ(userInfo.getUserId("user1"), 1);
+
+  // all pages of a poll are applied together
+  const uint32_t requests = api.requests();
+  file.append(2601, 4600);
+  ASSERT_EQ(userInfo.updateUsers(), 2000);
+  ASSERT_EQ(api.requests(), requests + 3);
+  ASSERT_EQ(userInfo.getUserId("user2601"), 2601);
+  ASSERT_EQ(userInfo.getUserId("user4600"), 4600);
+
+  userInfo.stop();
+}
+
+TEST(UserInfo, LookupUnderUpdateChurn) {
+  const int32_t kRounds = 200;
+  const int32_t kUsersPerRound = 50;
+  const int32_t kUsers = kRounds * kUsersPerRound;
+
+  UserListFile file;
+  StubUserApi api(file.path(), kUsersPerRound);
+  UserInfo userInfo(api.url(), nullptr);
+
+  // readers never block and never see a user disappear or change
+  atomic<bool> running(true);
+  atomic<uint64_t> lookups(0);
+  vector<thread> readers;
+  for (int r = 0; r < 4; r++) {
+    readers.emplace_back([&, r]() {
+      // quiescent every 64 lookups, like an event loop handling a few logins
+      QuiescentReader reader;
+      vector<bool> seen(kUsers + 1, false);
+      uint64_t n = 0;
+      for (uint32_t i = r; running; i += 7) {
+        const int32_t id = 1 + (int32_t)(i % kUsers);
+        const int32_t found = userInfo.getUserId(UserListFile::userName(id));
+        if (found != 0) {
+          ASSERT_EQ(found, id);
+          seen[id] = true;
+        } else {
+          ASSERT_FALSE(seen[id]) << "user" << id << " disappeared";
+        }
+        if (++n % 64 == 0) {
+          QuiescentState::quiescent();
+        }
+      }
+      lookups += n;
+    });
+  }
+
+  for (int32_t round = 0; round < kRounds; round++) {
+    file.append(round * kUsersPerRound + 1, (round + 1) * kUsersPerRound);
+    ASSERT_EQ(userInfo.updateUsers(), kUsersPerRound);
+  }
+  running = false;
+  for (auto &t : readers) {
+    t.join();
+  }
+
+  for (int32_t id = 1; id <= kUsers; id++) {
+    ASSERT_EQ(userInfo.getUserId(UserListFile::userName(id)), id);
+  }
+  LOG(INFO) << "lookups during " << kRounds << " updates: " << lookups;
+  ASSERT_GT(lookups, 0u);
+}